@@ -0,0 +1,51 @@
+#include "benchmark.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <utility>
+#include <vector>
+
+using rosewood::benchmarks::BenchmarkFunction;
+using rosewood::benchmarks::BenchmarkRegistration;
+
+static std::vector<std::pair<const char*, BenchmarkFunction>> &registry() {
+    static std::vector<std::pair<const char*, BenchmarkFunction>> benchmarks;
+    return benchmarks;
+}
+
+BenchmarkRegistration::BenchmarkRegistration(const char *name, BenchmarkFunction func) {
+    registry().emplace_back(name, func);
+}
+
+namespace rosewood { namespace benchmarks {
+
+    double measure_usec(size_t iterations, const std::function<void()> &func) {
+        func();
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            func();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+    }
+
+    void report(const std::string &name, double usec, const std::string &note) {
+        printf("%-48s %12.1f us  %s\n", name.c_str(), usec, note.c_str());
+    }
+
+    int run_benchmarks(const char *filter) {
+        for (auto &benchmark : registry()) {
+            if (filter && !strstr(benchmark.first, filter)) continue;
+
+            printf("[ %s ]\n", benchmark.first);
+            benchmark.second();
+        }
+
+        return 0;
+    }
+
+} }
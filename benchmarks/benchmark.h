@@ -0,0 +1,34 @@
+#ifndef __ROSEWOOD_BENCHMARKS_BENCHMARK_H__
+#define __ROSEWOOD_BENCHMARKS_BENCHMARK_H__
+
+#include <stddef.h>
+
+#include <functional>
+#include <string>
+
+namespace rosewood { namespace benchmarks {
+
+    typedef void (*BenchmarkFunction)();
+
+    struct BenchmarkRegistration {
+        BenchmarkRegistration(const char *name, BenchmarkFunction func);
+    };
+
+    // Runs func once to warm up, then `iterations` times, and returns the
+    // mean wall clock time per call in microseconds.
+    double measure_usec(size_t iterations, const std::function<void()> &func);
+
+    void report(const std::string &name, double usec, const std::string &note = "");
+
+    // Runs every registered benchmark whose name contains filter (all of
+    // them if filter is null).
+    int run_benchmarks(const char *filter);
+
+} }
+
+#define RW_BENCHMARK(name) \
+    static void rw_benchmark_##name(); \
+    static ::rosewood::benchmarks::BenchmarkRegistration rw_benchmark_registration_##name(#name, &rw_benchmark_##name); \
+    static void rw_benchmark_##name()
+
+#endif
@@ -0,0 +1,139 @@
+#include "benchmark.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "rosewood/data-format/object.h"
+#include "rosewood/data-format/object_conversions.h"
+#include "rosewood/data-format/object_view.h"
+#include "rosewood/data-format/reader.h"
+
+using rosewood::benchmarks::measure_usec;
+using rosewood::benchmarks::report;
+
+using rosewood::data_format::ObjectView;
+using rosewood::data_format::as;
+using rosewood::data_format::read_data;
+
+static const size_t kVertexCount = 300000;
+static const size_t kIterations = 10;
+
+// Mesh assets are laid out as [vertices, {"": normals}, {"": texcoords}],
+// encoded here the same way the build server's rbdef module does it.
+
+static void append_big_endian32(std::string *out, unsigned int value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out->push_back(char((value >> shift) & 0xff));
+    }
+}
+
+static void append_tagged_floats(std::string *out, const std::vector<float> &values) {
+    out->push_back('a');
+    append_big_endian32(out, (unsigned int)values.size());
+
+    for (auto value : values) {
+        unsigned int bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        out->push_back('p');
+        append_big_endian32(out, bits);
+    }
+}
+
+static void append_typed_floats(std::string *out, const std::vector<float> &values) {
+    out->push_back('v');
+    out->push_back('f');
+    append_big_endian32(out, (unsigned int)values.size());
+    out->append((4 - out->size() % 4) % 4, '\0');
+
+    // Assumes a little endian host, like the reader's fast path
+    out->append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+}
+
+static std::string make_mesh(void (*append_floats)(std::string*, const std::vector<float>&)) {
+    std::vector<float> vertices(kVertexCount * 3), normals(kVertexCount * 3), texcoords(kVertexCount * 2);
+
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        vertices[i] = float(i % 1000) * 0.25f;
+        normals[i] = float(i % 3) / 3.0f;
+    }
+    for (size_t i = 0; i < texcoords.size(); ++i) {
+        texcoords[i] = float(i % 100) / 100.0f;
+    }
+
+    std::string out;
+    out.push_back('a');
+    append_big_endian32(&out, 3);
+
+    append_floats(&out, vertices);
+
+    for (auto values : { &normals, &texcoords }) {
+        out.push_back('d');
+        append_big_endian32(&out, 1);
+        out.push_back('s');
+        append_big_endian32(&out, 0);
+        append_floats(&out, *values);
+    }
+
+    return out;
+}
+
+// Reads the three float arrays of a mesh through a view, the way
+// Mesh::reload_mesh_asset does
+static size_t read_mesh_view(const std::string &source, std::vector<float> *scratch, bool in_place) {
+    auto vertex_array = ObjectView(source)[0];
+    auto normal_arrays = vertex_array.next();
+    auto texcoord_arrays = normal_arrays.next();
+
+    size_t total = 0;
+
+    for (auto array : { vertex_array, normal_arrays[""], texcoord_arrays[""] }) {
+        auto floats = in_place ? array.float_data() : nullptr;
+        if (!floats) {
+            array.read_floats(scratch);
+            floats = scratch->data();
+        }
+
+        total += array.size() + (floats[0] > 0);
+    }
+
+    return total;
+}
+
+RW_BENCHMARK(MeshLoad) {
+    auto tagged = make_mesh(&append_tagged_floats);
+    auto typed = make_mesh(&append_typed_floats);
+
+    char note[64];
+    size_t sink = 0;
+
+    auto legacy = measure_usec(kIterations, [&] {
+        auto object = read_data(tagged);
+        sink += as<std::vector<float>>(object.array[0]).size();
+        sink += as<std::vector<float>>(object.array[1].dictionary.at("")).size();
+        sink += as<std::vector<float>>(object.array[2].dictionary.at("")).size();
+    });
+    snprintf(note, sizeof(note), "%zu bytes", tagged.size());
+    report("load/tagged:object-tree", legacy, note);
+
+    std::vector<float> scratch;
+
+    auto tagged_view = measure_usec(kIterations, [&] { sink += read_mesh_view(tagged, &scratch, false); });
+    snprintf(note, sizeof(note), "%.2fx", legacy / tagged_view);
+    report("load/tagged:view", tagged_view, note);
+
+    auto typed_copy = measure_usec(kIterations, [&] { sink += read_mesh_view(typed, &scratch, false); });
+    snprintf(note, sizeof(note), "%.2fx, %zu bytes", legacy / typed_copy, typed.size());
+    report("load/typed:memcpy", typed_copy, note);
+
+    auto typed_in_place = measure_usec(kIterations, [&] { sink += read_mesh_view(typed, &scratch, true); });
+    snprintf(note, sizeof(note), "%.2fx", legacy / typed_in_place);
+    report("load/typed:in-place", typed_in_place, note);
+
+    if (sink == 0) {
+        printf("unexpected empty mesh\n");
+    }
+}
@@ -0,0 +1,189 @@
+#include "benchmark.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "rosewood/core/event.h"
+#include "rosewood/core/job_system.h"
+
+using rosewood::benchmarks::measure_usec;
+using rosewood::benchmarks::report;
+
+using rosewood::core::Event;
+using rosewood::core::EventChannel;
+using rosewood::core::EventManager;
+using rosewood::core::JobSystem;
+
+static const size_t kSenderCount = 1000;
+static const size_t kEventCount = 1000000;
+static const size_t kIterations = 10;
+static const size_t kChannelIterations = 5;
+
+namespace {
+
+    struct Sender {
+        int id;
+    };
+
+    struct DamageEvent : public Event<DamageEvent> {
+        int amount;
+
+        DamageEvent(int amount) : amount(amount) { }
+    };
+
+    struct Listener {
+        long long total;
+
+        Listener() : total(0) { }
+
+        void did_take_damage(Sender *, const DamageEvent *event) {
+            total += event->amount;
+        }
+    };
+
+}
+
+static void report_rate(const std::string &name, double usec) {
+    char note[32];
+    snprintf(note, sizeof(note), "%.1fM events/s", kEventCount / usec);
+    report(name, usec, note);
+}
+
+RW_BENCHMARK(EventDispatch) {
+    std::vector<Sender> senders(kSenderCount);
+    std::vector<Listener> listeners(kSenderCount);
+    Listener global_listener;
+
+    EventManager<Sender*> events;
+    for (size_t i = 0; i < kSenderCount; ++i) {
+        events.add_listener<DamageEvent>(&senders[i], &listeners[i], &Listener::did_take_damage);
+    }
+
+    auto global_only = measure_usec(kIterations, [&] {
+        EventManager<Sender*> global_events;
+        global_events.add_listener<DamageEvent>(&global_listener, &Listener::did_take_damage);
+
+        for (size_t i = 0; i < kEventCount; ++i) {
+            global_events.send_event(&senders[i % kSenderCount], DamageEvent(1));
+        }
+    });
+    report_rate("send/global", global_only);
+
+    auto by_sender = measure_usec(kIterations, [&] {
+        for (size_t i = 0; i < kEventCount; ++i) {
+            events.send_event(&senders[i % kSenderCount], DamageEvent(1));
+        }
+    });
+    report_rate("send/by-sender", by_sender);
+
+    // Nobody listens to these senders, which used to grow the table
+    std::vector<Sender> silent_senders(kSenderCount);
+    auto unheard = measure_usec(kIterations, [&] {
+        for (size_t i = 0; i < kEventCount; ++i) {
+            events.send_event(&silent_senders[i % kSenderCount], DamageEvent(1));
+        }
+    });
+    report_rate("send/unheard-sender", unheard);
+
+    auto deferred = measure_usec(kIterations, [&] {
+        for (size_t i = 0; i < kEventCount; ++i) {
+            events.queue_event(&senders[i % kSenderCount], DamageEvent(1));
+        }
+        events.deliver_queued_events();
+    });
+    report_rate("queue+deliver/by-sender", deferred);
+
+    long long total = global_listener.total;
+    for (const auto &listener : listeners) {
+        total += listener.total;
+    }
+
+    if (!total) {
+        printf("no events were delivered\n");
+    }
+}
+
+// Producer threads send kEventCount events between them while the owning
+// thread keeps dispatching, against the obvious mutex and vector
+template<typename TSend, typename TDispatch>
+static double measure_contention(size_t threads, TSend send, TDispatch dispatch) {
+    return measure_usec(kChannelIterations, [&] {
+        std::atomic<size_t> running(threads);
+        std::vector<std::thread> producers;
+
+        for (size_t t = 0; t < threads; ++t) {
+            producers.emplace_back([&, t] {
+                for (size_t i = t; i < kEventCount; i += threads) {
+                    send(i);
+                }
+                --running;
+            });
+        }
+
+        size_t delivered = 0;
+        while (running || delivered < kEventCount) {
+            delivered += dispatch();
+        }
+
+        for (auto &producer : producers) {
+            producer.join();
+        }
+    });
+}
+
+RW_BENCHMARK(EventChannelContention) {
+    std::vector<Sender> senders(kSenderCount);
+    Listener listener;
+
+    EventManager<Sender*> events;
+    events.add_listener<DamageEvent>(&listener, &Listener::did_take_damage);
+
+    EventChannel<Sender*> channel;
+
+    std::mutex mutex;
+    std::vector<std::pair<Sender*, DamageEvent>> locked, locked_delivering;
+
+    auto max_threads = std::max(JobSystem::default_thread_count(), size_t(2));
+    for (size_t threads = 1; ; threads = std::min(threads * 2, max_threads)) {
+        auto lock_free = measure_contention(threads, [&](size_t i) {
+            channel.send_event(&senders[i % kSenderCount], DamageEvent(1));
+        }, [&] {
+            return channel.dispatch(&events);
+        });
+
+        auto mutexed = measure_contention(threads, [&](size_t i) {
+            std::lock_guard<std::mutex> lock(mutex);
+            locked.emplace_back(&senders[i % kSenderCount], DamageEvent(1));
+        }, [&] {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::swap(locked, locked_delivering);
+            }
+
+            for (const auto &pair : locked_delivering) {
+                events.send_event(pair.first, pair.second);
+            }
+
+            auto count = locked_delivering.size();
+            locked_delivering.clear();
+            return count;
+        });
+
+        auto suffix = "/producers:" + std::to_string(threads);
+        report_rate("channel" + suffix, lock_free);
+        report_rate("mutex+vector" + suffix, mutexed);
+
+        if (threads == max_threads) break;
+    }
+
+    if (!listener.total) {
+        printf("no events were delivered\n");
+    }
+}
@@ -0,0 +1,275 @@
+#include "benchmark.h"
+
+#include <limits.h>
+#include <stdio.h>
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "rosewood/math/math_types.h"
+#include "rosewood/math/matrix3.h"
+#include "rosewood/math/matrix4.h"
+#include "rosewood/math/vector.h"
+
+#include "rosewood/graphics/gl_state.h"
+#include "rosewood/graphics/metrics.h"
+
+using rosewood::benchmarks::measure_usec;
+using rosewood::benchmarks::report;
+
+using rosewood::math::Matrix3;
+using rosewood::math::Matrix4;
+using rosewood::math::Vector3;
+using rosewood::math::Vector4;
+using rosewood::math::make_translation4;
+
+using rosewood::graphics::UniformData;
+using rosewood::graphics::VertexAttribPointer;
+using rosewood::graphics::kTypeFloat;
+using rosewood::graphics::metrics::gl_calls_elided;
+using rosewood::graphics::metrics::gl_calls_issued;
+
+namespace gl_state = rosewood::graphics::gl_state;
+
+static const size_t kIterations = 200;
+static const size_t kDrawCount = 2000;
+static const GLuint kProgramCount = 4;
+static const GLuint kVAOCount = 16;
+
+enum { kUniformMVP, kUniformNormalMatrix, kUniformColor, kUniformTexture };
+
+// Stands in for the driver, so that only the cost of the cache is measured
+static size_t gRecordedCalls = 0;
+
+static void record_enum(GLenum) { ++gRecordedCalls; }
+static void record_boolean(GLboolean) { ++gRecordedCalls; }
+static void record_uint(GLuint) { ++gRecordedCalls; }
+static void record_enum_pair(GLenum, GLenum) { ++gRecordedCalls; }
+static void record_float_pair(GLfloat, GLfloat) { ++gRecordedCalls; }
+static void record_bind(GLenum, GLuint) { ++gRecordedCalls; }
+static void record_delete(GLsizei, const GLuint*) { ++gRecordedCalls; }
+static void record_matrix(GLint, GLsizei, GLboolean, const GLfloat*) { ++gRecordedCalls; }
+static void record_vector(GLint, GLsizei, const GLfloat*) { ++gRecordedCalls; }
+static void record_int(GLint, GLint) { ++gRecordedCalls; }
+static void record_attrib_pointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const GLvoid*) { ++gRecordedCalls; }
+
+static const gl_state::Dispatch gRecordingDispatch = {
+    record_enum, record_enum, record_enum, record_boolean, record_enum_pair, record_float_pair,
+    record_uint, record_bind, record_bind, record_delete, record_enum, record_uint, record_uint,
+    record_matrix, record_matrix, record_vector, record_int, record_uint, record_attrib_pointer,
+};
+
+// The cache as it was before the flat tables: a hash map per kind of
+// state, a std::function per call and a Variant copy per uniform
+namespace map_state {
+
+    typedef std::unordered_map<GLint, UniformData> uniform_map;
+
+    template<typename TKey, typename TValue, typename TNewValue>
+    static void if_changed(std::unordered_map<TKey, TValue> &map,
+                           TKey key, const TNewValue &value,
+                           std::function<void()> if_changed_fn) {
+        if (map.find(key) == end(map) || map.at(key) != value) {
+            if_changed_fn();
+            map[key] = value;
+        }
+    }
+
+    template<typename TValue>
+    static void if_changed(TValue &known_value, const TValue new_value,
+                           std::function<void()> if_changed_fn) {
+        if (known_value != new_value) {
+            if_changed_fn();
+            known_value = new_value;
+        }
+    }
+
+    static std::unordered_map<GLenum, bool> gKnownState;
+    static GLuint gCurrentVAO = UINT_MAX;
+    static GLuint gCurrentProgram = UINT_MAX;
+    static GLenum gCurrentDepthFunc = GL_LESS;
+    static bool gCurrentDepthMask = true;
+    static uniform_map gCurrentUniforms;
+    static std::unordered_map<GLuint, uniform_map> gSavedShaderStates;
+    static std::unordered_map<GLuint, uniform_map> gNewShaderStates;
+    static std::unordered_map<GLuint, bool> gKnownAttribArrays;
+    static std::unordered_map<GLuint, VertexAttribPointer> gCurrentVertexAttribPointers;
+
+    template<typename T>
+    static void set_uniform(GLint uniform, const T &value) {
+        if_changed(gCurrentUniforms, uniform, value, [&]() { ++gRecordedCalls; });
+    }
+
+    template<typename T>
+    static void set_uniform(GLuint program, GLint uniform, const T &value) {
+        if (gCurrentProgram == program) {
+            set_uniform(uniform, value);
+        }
+        else {
+            gNewShaderStates[program][uniform] = value;
+        }
+    }
+
+    static void set_state(GLenum state, bool enabled) {
+        if_changed(gKnownState, state, enabled, [=]() { ++gRecordedCalls; });
+    }
+
+    static void set_depth_func(GLenum depth_func) {
+        if_changed(gCurrentDepthFunc, depth_func, [=]() { ++gRecordedCalls; });
+    }
+
+    static void set_depth_mask(bool depth_mask) {
+        if_changed(gCurrentDepthMask, depth_mask, [=]() { ++gRecordedCalls; });
+    }
+
+    static void bind_vertex_array_object(GLuint vao) {
+        if_changed(gCurrentVAO, vao, [=]() {
+            ++gRecordedCalls;
+            gCurrentVertexAttribPointers.clear();
+            gKnownAttribArrays.clear();
+        });
+    }
+
+    static void use_program(GLuint program) {
+        if_changed(gCurrentProgram, program, [=]() {
+            ++gRecordedCalls;
+
+            gSavedShaderStates[gCurrentProgram] = gCurrentUniforms;
+            gCurrentUniforms = gSavedShaderStates[program];
+            gCurrentProgram = program;
+
+            for (auto pair : gNewShaderStates[program]) {
+                if (pair.second.has<int>()) set_uniform(pair.first, pair.second.get<int>());
+                else if (pair.second.has<Matrix3>()) set_uniform(pair.first, pair.second.get<Matrix3>());
+                else if (pair.second.has<Matrix4>()) set_uniform(pair.first, pair.second.get<Matrix4>());
+                else if (pair.second.has<Vector4>()) set_uniform(pair.first, pair.second.get<Vector4>());
+            }
+
+            gNewShaderStates[program].clear();
+        });
+    }
+
+    static void enable_vertex_attrib_array(GLuint attribute) {
+        if_changed(gKnownAttribArrays, attribute, true, [=]() { ++gRecordedCalls; });
+    }
+
+    static void set_vertex_attrib_pointer(GLuint attribute, VertexAttribPointer pointer) {
+        if_changed(gCurrentVertexAttribPointers, attribute, pointer, [&]() { ++gRecordedCalls; });
+    }
+
+}
+
+// What a sorted render queue asks of the cache: few program and VAO
+// changes, the same fixed function state on every draw and a new model
+// matrix on most of them
+template<typename TState>
+static void draw_frame(const std::vector<Matrix4> &mvps, const std::vector<Matrix3> &normal_matrices) {
+    for (size_t i = 0; i < kDrawCount; ++i) {
+        GLuint program = 1 + GLuint(i * kProgramCount / kDrawCount);
+        GLuint vao = 1 + GLuint(i * kVAOCount / kDrawCount);
+
+        TState::use_program(program);
+        TState::set_state(GL_DEPTH_TEST, true);
+        TState::set_depth_mask(true);
+        TState::set_depth_func(GL_LESS);
+        TState::set_state(GL_BLEND, program == kProgramCount);
+
+        TState::set_uniform(program, kUniformMVP, mvps[i]);
+        TState::set_uniform(program, kUniformNormalMatrix, normal_matrices[i]);
+        TState::set_uniform(program, kUniformColor, Vector4(1, 1, 1, 1));
+        TState::set_uniform(program, kUniformTexture, 0);
+
+        TState::bind_vertex_array_object(vao);
+        for (GLuint attribute = 0; attribute < 3; ++attribute) {
+            TState::enable_vertex_attrib_array(attribute);
+            TState::set_vertex_attrib_pointer(attribute, VertexAttribPointer(3, kTypeFloat, false, 32, attribute * 12));
+        }
+    }
+}
+
+struct MapState {
+    static void use_program(GLuint program) { map_state::use_program(program); }
+    static void set_state(GLenum state, bool enabled) { map_state::set_state(state, enabled); }
+    static void set_depth_mask(bool flag) { map_state::set_depth_mask(flag); }
+    static void set_depth_func(GLenum func) { map_state::set_depth_func(func); }
+    static void bind_vertex_array_object(GLuint vao) { map_state::bind_vertex_array_object(vao); }
+    static void enable_vertex_attrib_array(GLuint attribute) { map_state::enable_vertex_attrib_array(attribute); }
+
+    static void set_vertex_attrib_pointer(GLuint attribute, VertexAttribPointer pointer) {
+        map_state::set_vertex_attrib_pointer(attribute, pointer);
+    }
+
+    template<typename T>
+    static void set_uniform(GLuint program, GLint uniform, const T &value) {
+        map_state::set_uniform(program, uniform, value);
+    }
+};
+
+struct FlatState {
+    static void use_program(GLuint program) { gl_state::use_program(program); }
+    static void set_state(GLenum state, bool enabled) { gl_state::set_state(state, enabled); }
+    static void set_depth_mask(bool flag) { gl_state::set_depth_mask(flag); }
+    static void set_depth_func(GLenum func) { gl_state::set_depth_func(func); }
+    static void bind_vertex_array_object(GLuint vao) { gl_state::bind_vertex_array_object(vao); }
+    static void enable_vertex_attrib_array(GLuint attribute) { gl_state::enable_vertex_attrib_array(attribute); }
+
+    static void set_vertex_attrib_pointer(GLuint attribute, VertexAttribPointer pointer) {
+        gl_state::set_vertex_attrib_pointer(attribute, pointer);
+    }
+
+    template<typename T>
+    static void set_uniform(GLuint program, GLint uniform, const T &value) {
+        gl_state::set_uniform(program, uniform, value);
+    }
+};
+
+RW_BENCHMARK(GLStateCache) {
+    std::vector<Matrix4> mvps;
+    std::vector<Matrix3> normal_matrices;
+
+    for (size_t i = 0; i < kDrawCount; ++i) {
+        // Every fourth draw repeats the previous matrix, like a static
+        // object drawn twice
+        auto offset = float(i % 4 == 3 ? i - 1 : i);
+        mvps.push_back(make_translation4(Vector3(offset, 0, 0)));
+        normal_matrices.push_back(mat3(mvps.back()));
+    }
+
+    auto map = measure_usec(kIterations, [&] {
+        draw_frame<MapState>(mvps, normal_matrices);
+    });
+
+    // Calls made in one more frame, once the cache has settled
+    gRecordedCalls = 0;
+    draw_frame<MapState>(mvps, normal_matrices);
+
+    char note[64];
+    snprintf(note, sizeof(note), "%zu calls/frame", gRecordedCalls);
+    report("state/map", map, note);
+
+    gl_state::set_dispatch(gRecordingDispatch);
+    gl_state::reset();
+
+    auto flat = measure_usec(kIterations, [&] {
+        draw_frame<FlatState>(mvps, normal_matrices);
+    });
+
+    gRecordedCalls = 0;
+    auto issued_before = gl_calls_issued.total();
+    auto elided_before = gl_calls_elided.total();
+    draw_frame<FlatState>(mvps, normal_matrices);
+
+    auto issued = (size_t)(gl_calls_issued.total() - issued_before);
+    auto elided = (size_t)(gl_calls_elided.total() - elided_before);
+
+    snprintf(note, sizeof(note), "%.2fx, %zu calls/frame, %zu elided", map / flat, issued, elided);
+    report("state/flat", flat, note);
+
+    if (gRecordedCalls != issued) {
+        printf("issued call count does not match the recorded calls\n");
+    }
+
+    gl_state::set_dispatch(gl_state::platform_dispatch());
+    gl_state::reset();
+}
@@ -0,0 +1,5 @@
+#include "benchmark.h"
+
+int main(int argc, char **argv) {
+    return rosewood::benchmarks::run_benchmarks(argc > 1 ? argv[1] : nullptr);
+}
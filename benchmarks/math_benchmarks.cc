@@ -0,0 +1,146 @@
+#include "benchmark.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "rosewood/math/batch_transform.h"
+#include "rosewood/math/math_types.h"
+#include "rosewood/math/matrix3.h"
+#include "rosewood/math/matrix4.h"
+#include "rosewood/math/plane.h"
+#include "rosewood/math/quaternion.h"
+#include "rosewood/math/sphere_culling.h"
+#include "rosewood/math/vector.h"
+
+using rosewood::benchmarks::measure_usec;
+using rosewood::benchmarks::report;
+
+using rosewood::math::Matrix3;
+using rosewood::math::Matrix4;
+using rosewood::math::Plane;
+using rosewood::math::Quaternion;
+using rosewood::math::Vector2;
+using rosewood::math::Vector3;
+using rosewood::math::Vector4;
+
+static const size_t kVertexCount = 100000;
+static const size_t kIterations = 50;
+
+// Same interleaving as Mesh::instantiate: position, normal, texcoord
+static const size_t kStride = 8;
+
+RW_BENCHMARK(MeshInstantiate) {
+    std::vector<Vector3> vertices, normals;
+    std::vector<Vector2> texcoords;
+
+    for (size_t i = 0; i < kVertexCount; ++i) {
+        vertices.emplace_back(float(i % 100), float(i % 37), float(i % 11));
+        normals.emplace_back(0.0f, float(i % 2), float(i % 3));
+        texcoords.emplace_back(float(i % 5) / 5.0f, float(i % 7) / 7.0f);
+    }
+
+    auto transform = (make_translation4(Vector3(1, 2, 3))
+                      * make_rotation4(Quaternion(0.5f, 0.5f, 0.5f, 0.5f))
+                      * make_scale4(Vector3(2, 2, 2)));
+    auto n_matrix = transposed(mat3(transform));
+
+    std::vector<float> out(kVertexCount * kStride);
+
+    // The per-vertex loop Mesh::instantiate used before the batched kernels
+    auto scalar = measure_usec(kIterations, [&] {
+        auto destination = out.begin();
+
+        for (size_t i = 0; i < kVertexCount; ++i) {
+            auto v = transform * vertices[i];
+            auto n = n_matrix * normals[i];
+            auto t = texcoords[i];
+
+            *destination++ = v.x();
+            *destination++ = v.y();
+            *destination++ = v.z();
+            *destination++ = n.x();
+            *destination++ = n.y();
+            *destination++ = n.z();
+            *destination++ = t.x;
+            *destination++ = t.y;
+        }
+    });
+    report("instantiate/scalar", scalar);
+
+    auto batched = measure_usec(kIterations, [&] {
+        transform_points(transform, vertices.data(), kVertexCount, out.data(), kStride);
+        transform_directions(n_matrix, normals.data(), kVertexCount, out.data() + 3, kStride);
+
+        for (size_t i = 0; i < kVertexCount; ++i) {
+            out[i * kStride + 6] = texcoords[i].x;
+            out[i * kStride + 7] = texcoords[i].y;
+        }
+    });
+
+    char note[32];
+    snprintf(note, sizeof(note), "%.2fx", scalar / batched);
+    report("instantiate/batched", batched, note);
+}
+
+RW_BENCHMARK(FrustumCull) {
+    const size_t kSphereCount = 100000;
+
+    // A box of planes roughly the shape of a view frustum, normals inwards
+    const Plane planes[] = {
+        Plane(0, -0.8f, -0.6f, 0), Plane(0, 0.8f, -0.6f, 0),
+        Plane(0.8f, 0, -0.6f, 0), Plane(-0.8f, 0, -0.6f, 0),
+        Plane(0, 0, -1, -0.1f), Plane(0, 0, 1, 100),
+    };
+
+    std::vector<Matrix4> transforms;
+    std::vector<float> xs, ys, zs, radii;
+
+    for (size_t i = 0; i < kSphereCount; ++i) {
+        auto center = Vector3(float(i % 101) - 50, float(i % 53) - 26, -float(i % 97));
+        transforms.push_back(make_translation4(center));
+
+        xs.push_back(center.x());
+        ys.push_back(center.y());
+        zs.push_back(center.z());
+        radii.push_back(float(i % 4));
+    }
+
+    size_t sink = 0;
+
+    // What ViewFrustum::is_visible does for each object
+    auto scalar = measure_usec(kIterations, [&] {
+        for (size_t i = 0; i < kSphereCount; ++i) {
+            auto center = Vector3(transforms[i] * Vector4(0, 0, 0, 1));
+            auto radius2 = radii[i] * radii[i];
+            bool visible = true;
+
+            for (const auto &plane : planes) {
+                auto dist = distance(plane, center);
+                if (copysign(dist * dist, dist) < -radius2) {
+                    visible = false;
+                    break;
+                }
+            }
+
+            sink += visible;
+        }
+    });
+    report("cull/scalar", scalar);
+
+    std::vector<uint32_t> visible((kSphereCount + 31) / 32);
+    auto batched = measure_usec(kIterations, [&] {
+        cull_spheres(planes, 6, xs.data(), ys.data(), zs.data(), radii.data(), kSphereCount, visible.data());
+        sink += visible[0];
+    });
+
+    char note[32];
+    snprintf(note, sizeof(note), "%.2fx", scalar / batched);
+    report("cull/batched", batched, note);
+
+    if (sink == 0) {
+        printf("unexpected empty frustum\n");
+    }
+}
@@ -0,0 +1,74 @@
+#include "benchmark.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rosewood/core/job_system.h"
+#include "rosewood/core/metrics.h"
+
+using rosewood::benchmarks::measure_usec;
+using rosewood::benchmarks::report;
+
+using rosewood::core::JobSystem;
+using rosewood::core::metrics::Counter;
+using rosewood::core::metrics::Histogram;
+
+static const size_t kWrites = 10000000;
+static const size_t kIterations = 5;
+
+static const Counter gBenchmarkCounter("benchmarks.counter");
+static const Histogram gBenchmarkHistogram("benchmarks.histogram");
+
+// Splits kWrites between the threads
+template<typename TWrite>
+static double measure_writes(size_t threads, TWrite write) {
+    return measure_usec(kIterations, [&] {
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < threads; ++t) {
+            writers.emplace_back([&] {
+                for (size_t i = 0; i < kWrites / threads; ++i) write(i);
+            });
+        }
+
+        for (auto &writer : writers) {
+            writer.join();
+        }
+    });
+}
+
+static std::string rate(double usec) {
+    char note[32];
+    snprintf(note, sizeof(note), "%.0fM writes/s", kWrites / usec);
+    return note;
+}
+
+RW_BENCHMARK(MetricWrites) {
+    // What counters were before the registry: one shared value, here made
+    // atomic so that it is at least correct across threads
+    std::atomic<uint64_t> shared(0);
+
+    auto max_threads = std::max(JobSystem::default_thread_count(), size_t(2));
+    for (size_t threads = 1; ; threads = std::min(threads * 2, max_threads)) {
+        auto suffix = "/threads:" + std::to_string(threads);
+
+        auto atomic = measure_writes(threads, [&](size_t) { shared.fetch_add(1, std::memory_order_relaxed); });
+        report("shared-atomic" + suffix, atomic, rate(atomic));
+
+        auto counter = measure_writes(threads, [&](size_t) { gBenchmarkCounter.increment(); });
+        report("counter" + suffix, counter, rate(counter));
+
+        auto histogram = measure_writes(threads, [&](size_t i) { gBenchmarkHistogram.record(double(i & 1023)); });
+        report("histogram" + suffix, histogram, rate(histogram));
+
+        if (threads == max_threads) break;
+    }
+
+    if (!shared || !gBenchmarkCounter.total()) {
+        printf("nothing was counted\n");
+    }
+}
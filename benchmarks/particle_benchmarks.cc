@@ -0,0 +1,69 @@
+#include "benchmark.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+#include "rosewood/core/entity.h"
+#include "rosewood/core/job_system.h"
+#include "rosewood/core/transform.h"
+
+#include "rosewood/math/vector.h"
+
+#include "rosewood/particle-system/particle.h"
+#include "rosewood/particle-system/particle_system.h"
+
+#include "rosewood/utils/time.h"
+
+using rosewood::benchmarks::measure_usec;
+using rosewood::benchmarks::report;
+
+using rosewood::core::EntityManager;
+using rosewood::core::JobSystem;
+using rosewood::core::Transform;
+
+using rosewood::math::Vector3;
+
+using rosewood::particle_system::Particle;
+
+namespace particle_system = rosewood::particle_system::particle_system;
+
+static const size_t kParticleCount = 200000;
+static const size_t kIterations = 50;
+
+static void create_particles(EntityManager *entities) {
+    for (size_t i = 0; i < kParticleCount; ++i) {
+        auto e = entities->create_entity();
+        e.add_component<Transform>();
+
+        auto particle = e.add_component<Particle>();
+        particle->decay_time = std::numeric_limits<rosewood::utils::UsecTime>::max();
+        particle->velocity = Vector3(1, 2, 3);
+    }
+}
+
+RW_BENCHMARK(ParticleUpdate) {
+    EntityManager entities;
+    create_particles(&entities);
+
+    rosewood::utils::mark_frame_beginning();
+    rosewood::utils::mark_frame_beginning();
+
+    auto serial = measure_usec(kIterations, [&] { particle_system::update(&entities); });
+    report("update/serial", serial);
+
+    auto max_threads = JobSystem::default_thread_count();
+    for (size_t threads = 1; ; threads = std::min(threads * 2, max_threads)) {
+        JobSystem jobs(threads);
+
+        auto usec = measure_usec(kIterations, [&] { particle_system::update(&entities, &jobs); });
+
+        char note[32];
+        snprintf(note, sizeof(note), "%.2fx", serial / usec);
+        report("update/threads:" + std::to_string(threads), usec, note);
+
+        if (threads == max_threads) break;
+    }
+}
@@ -0,0 +1,50 @@
+#include "benchmark.h"
+
+#include <stdio.h>
+
+#include <string>
+
+#include "rosewood/core/profiler.h"
+
+using rosewood::benchmarks::measure_usec;
+using rosewood::benchmarks::report;
+
+namespace profiler = rosewood::core::profiler;
+
+// Comfortably below what a thread's buffer holds between two frames
+static const size_t kScopesPerFrame = 10000;
+static const size_t kFrames = 100;
+
+static std::string per_scope(double usec) {
+    char note[32];
+    snprintf(note, sizeof(note), "%.1f ns/scope", usec * 1000 / (kScopesPerFrame * kFrames));
+    return note;
+}
+
+static double measure_scopes() {
+    return measure_usec(5, [] {
+        for (size_t frame = 0; frame < kFrames; ++frame) {
+            for (size_t i = 0; i < kScopesPerFrame; ++i) {
+                RW_PROFILE_SCOPE("benchmarks.scope");
+            }
+            profiler::end_frame();
+        }
+    });
+}
+
+RW_BENCHMARK(ProfileScopes) {
+    profiler::set_enabled(false);
+    auto disabled = measure_scopes();
+    report("disabled", disabled, per_scope(disabled));
+
+    profiler::set_enabled(true);
+    auto enabled = measure_scopes();
+    report("enabled", enabled, per_scope(enabled));
+
+    profiler::set_enabled(false);
+
+    if (profiler::dropped_scope_count()) {
+        printf("%zu scopes were dropped\n", profiler::dropped_scope_count());
+    }
+    profiler::clear_capture();
+}
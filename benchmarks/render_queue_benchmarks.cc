@@ -0,0 +1,90 @@
+#include "benchmark.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "rosewood/data-structures/radix_sort.h"
+
+#include "rosewood/graphics/sort_key.h"
+
+using rosewood::benchmarks::measure_usec;
+using rosewood::benchmarks::report;
+
+using rosewood::data_structures::KeyIndex;
+using rosewood::data_structures::radix_sort;
+
+using rosewood::graphics::make_sort_key;
+using rosewood::graphics::quantize_depth;
+
+static const size_t kIterations = 20;
+
+// Stands in for a RenderCommand: the fields the sort looks at, plus the
+// two matrices a real command carries
+struct FakeCommand {
+    size_t camera;
+    int queue_index;
+    size_t shader_id;
+    size_t texture_id;
+    float depth;
+    float matrices[32];
+};
+
+static bool operator<(const FakeCommand &lhs, const FakeCommand &rhs) {
+    if (lhs.camera != rhs.camera) return lhs.camera < rhs.camera;
+    if (lhs.queue_index != rhs.queue_index) return lhs.queue_index < rhs.queue_index;
+    if (lhs.shader_id != rhs.shader_id) return lhs.shader_id < rhs.shader_id;
+    if (lhs.texture_id != rhs.texture_id) return lhs.texture_id < rhs.texture_id;
+    return lhs.depth < rhs.depth;
+}
+
+static std::vector<FakeCommand> make_commands(size_t count) {
+    std::mt19937 rng(42);
+    std::vector<FakeCommand> commands(count);
+
+    for (auto &command : commands) {
+        command.camera = rng() % 2;
+        command.queue_index = 100 + int(rng() % 3);
+        command.shader_id = rng() % 16;
+        command.texture_id = rng() % 64;
+        command.depth = -float(rng() % 100000) / 100.0f;
+    }
+
+    return commands;
+}
+
+RW_BENCHMARK(RenderQueueSort) {
+    for (size_t count : { 10000, 30000, 100000 }) {
+        auto commands = make_commands(count);
+        auto suffix = ":" + std::to_string(count);
+
+        std::vector<FakeCommand> sorted;
+        auto comparison = measure_usec(kIterations, [&] {
+            sorted = commands;
+            std::sort(begin(sorted), end(sorted));
+        });
+        auto copy = measure_usec(kIterations, [&] { sorted = commands; });
+        report("sort/std::sort" + suffix, comparison - copy, "commands moved");
+
+        // Key construction happens at add time in the queue, but it is
+        // counted here to keep the comparison honest
+        std::vector<KeyIndex> order, scratch;
+        auto keyed = measure_usec(kIterations, [&] {
+            order.clear();
+            for (size_t i = 0; i < commands.size(); ++i) {
+                const auto &c = commands[i];
+                order.push_back({ make_sort_key(c.camera, c.queue_index, c.shader_id, c.texture_id,
+                                                false, quantize_depth(c.depth)),
+                                  (uint32_t)i });
+            }
+            radix_sort(&order, &scratch);
+        });
+
+        char note[32];
+        snprintf(note, sizeof(note), "%.2fx", (comparison - copy) / keyed);
+        report("sort/radix" + suffix, keyed, note);
+    }
+}
@@ -0,0 +1,170 @@
+#include "benchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosewood/data-format/asset_archive.h"
+
+#include "rosewood/utils/archive_resource_loader.h"
+#include "rosewood/utils/folder_resource_loader.h"
+
+using rosewood::benchmarks::measure_usec;
+using rosewood::benchmarks::report;
+
+using rosewood::core::IResourceLoader;
+
+using rosewood::data_format::AssetArchiveFile;
+using rosewood::data_format::write_asset_archive;
+
+using rosewood::utils::ArchiveResourceLoader;
+using rosewood::utils::FolderResourceLoader;
+
+static const size_t kAssetCount = 2000;
+static const size_t kIterations = 20;
+
+// A game's worth of small assets: meshes of packed floats, shader text
+// and images that do not compress any further
+static std::vector<AssetArchiveFile> make_assets() {
+    std::vector<AssetArchiveFile> assets;
+    unsigned int seed = 1;
+
+    for (size_t i = 0; i < kAssetCount; ++i) {
+        AssetArchiveFile asset;
+        auto size = 512 + (i * 7919) % (16 * 1024);
+
+        switch (i % 3) {
+            case 0:
+                asset.path = "meshes/mesh" + std::to_string(i) + ".mesh-rbdef";
+                for (size_t j = 0; asset.contents.size() < size; ++j) {
+                    float value = float(j % 97) * 0.125f;
+                    asset.contents.append(reinterpret_cast<const char*>(&value), sizeof(value));
+                }
+                break;
+
+            case 1:
+                asset.path = "shaders/shader" + std::to_string(i) + ".rwshader-rbdef";
+                while (asset.contents.size() < size) {
+                    asset.contents += "gl_Position = rw_projection_matrix * rw_modelview_matrix * rw_position;\n";
+                }
+                break;
+
+            case 2:
+                asset.path = "textures/texture" + std::to_string(i) + ".png";
+                for (size_t j = 0; j < size; ++j) {
+                    seed = seed * 1103515245 + 12345;
+                    asset.contents.push_back(char(seed >> 16));
+                }
+                break;
+        }
+
+        asset.compress = i % 3 != 2;
+        assets.push_back(std::move(asset));
+    }
+
+    return assets;
+}
+
+static bool write_folder(const std::string &root, const std::vector<AssetArchiveFile> &assets) {
+    for (auto dir : { "meshes", "shaders", "textures" }) {
+        if (mkdir((root + dir).c_str(), 0700)) return false;
+    }
+
+    for (const auto &asset : assets) {
+        auto fp = fopen((root + asset.path).c_str(), "wb");
+        if (!fp) return false;
+
+        fwrite(asset.contents.data(), 1, asset.contents.size(), fp);
+        fclose(fp);
+    }
+
+    return true;
+}
+
+static void remove_folder(const std::string &root, const std::vector<AssetArchiveFile> &assets) {
+    for (const auto &asset : assets) {
+        unlink((root + asset.path).c_str());
+    }
+
+    for (auto dir : { "meshes", "shaders", "textures" }) {
+        rmdir((root + dir).c_str());
+    }
+}
+
+// What starting the game asks of a loader: open it, then look up and
+// read every asset once
+template<typename TMakeLoader>
+static double measure_startup(const std::vector<AssetArchiveFile> &assets, TMakeLoader make_loader) {
+    size_t bytes = 0;
+
+    auto usec = measure_usec(kIterations, [&] {
+        std::unique_ptr<IResourceLoader> loader(make_loader());
+
+        for (const auto &asset : assets) {
+            if (loader->find_file(asset.path).exists) {
+                bytes += loader->read_file(asset.path).size();
+            }
+        }
+    });
+
+    size_t expected = 0;
+    for (const auto &asset : assets) {
+        expected += asset.contents.size();
+    }
+
+    if (bytes != expected * (kIterations + 1)) {
+        printf("loader did not read back every asset\n");
+    }
+
+    return usec;
+}
+
+RW_BENCHMARK(ResourceStartup) {
+    char dir_template[] = "/tmp/rw_resource_benchmark_XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        printf("could not create a temporary directory\n");
+        return;
+    }
+
+    auto root = std::string(dir_template) + "/";
+    auto assets = make_assets();
+
+    auto stored_assets = assets;
+    for (auto &asset : stored_assets) {
+        asset.compress = false;
+    }
+
+    auto stored_path = root + "stored.rwpack";
+    auto compressed_path = root + "compressed.rwpack";
+
+    if (!write_folder(root, assets)
+        || !write_asset_archive(stored_path, stored_assets)
+        || !write_asset_archive(compressed_path, assets)) {
+        printf("could not write the assets\n");
+    }
+    else {
+        auto folder = measure_startup(assets, [&] { return new FolderResourceLoader(root); });
+
+        char note[64];
+        snprintf(note, sizeof(note), "%zu assets", assets.size());
+        report("startup/folder", folder, note);
+
+        auto stored = measure_startup(assets, [&] { return new ArchiveResourceLoader(stored_path); });
+        snprintf(note, sizeof(note), "%.2fx", folder / stored);
+        report("startup/archive", stored, note);
+
+        auto compressed = measure_startup(assets, [&] { return new ArchiveResourceLoader(compressed_path); });
+        snprintf(note, sizeof(note), "%.2fx", folder / compressed);
+        report("startup/archive-zlib", compressed, note);
+    }
+
+    remove_folder(root, assets);
+    unlink(stored_path.c_str());
+    unlink(compressed_path.c_str());
+    rmdir(dir_template);
+}
@@ -0,0 +1,120 @@
+#include "benchmark.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <random>
+#include <vector>
+
+#include "rosewood/core/entity.h"
+
+#include "rosewood/math/math_types.h"
+#include "rosewood/math/plane.h"
+#include "rosewood/math/sphere_culling.h"
+#include "rosewood/math/vector.h"
+
+#include "rosewood/graphics/bounding_volume_hierarchy.h"
+
+using rosewood::benchmarks::measure_usec;
+using rosewood::benchmarks::report;
+
+using rosewood::core::Entity;
+
+using rosewood::math::Plane;
+using rosewood::math::Vector3;
+using rosewood::math::cull_spheres;
+
+using rosewood::graphics::BoundingBox;
+using rosewood::graphics::BoundingVolumeHierarchy;
+
+static const size_t kObjectCount = 100000;
+static const size_t kIterations = 50;
+
+static BoundingBox sphere_box(float x, float y, float z, float radius) {
+    return BoundingBox{ Vector3(x - radius, y - radius, z - radius), Vector3(x + radius, y + radius, z + radius) };
+}
+
+// A large world with the camera only seeing a small part of it, which is
+// where skipping whole subtrees pays off
+RW_BENCHMARK(SceneCull) {
+    const Plane planes[] = {
+        Plane(0, -0.8f, -0.6f, 0), Plane(0, 0.8f, -0.6f, 0),
+        Plane(0.8f, 0, -0.6f, 0), Plane(-0.8f, 0, -0.6f, 0),
+        Plane(0, 0, -1, -0.1f), Plane(0, 0, 1, 100),
+    };
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-1000, 1000);
+    std::uniform_real_distribution<float> size(0.5f, 3);
+
+    std::vector<float> xs, ys, zs, radii;
+    BoundingVolumeHierarchy bvh;
+    std::vector<size_t> proxies;
+
+    for (size_t i = 0; i < kObjectCount; ++i) {
+        xs.push_back(position(rng));
+        ys.push_back(position(rng) * 0.05f);
+        zs.push_back(position(rng));
+        radii.push_back(size(rng));
+
+        proxies.push_back(bvh.insert(sphere_box(xs[i], ys[i], zs[i], radii[i]), Entity{ nullptr, i + 1 }));
+    }
+
+    size_t sink = 0;
+
+    std::vector<uint32_t> visible((kObjectCount + 31) / 32);
+    auto linear = measure_usec(kIterations, [&] {
+        cull_spheres(planes, 6, xs.data(), ys.data(), zs.data(), radii.data(), kObjectCount, visible.data());
+        sink += visible[0];
+    });
+    report("cull/linear", linear);
+
+    // Tree query, then the exact sphere test on whatever it returned, the
+    // way RenderSystem draws a camera
+    std::vector<size_t> hits;
+    std::vector<float> hit_xs, hit_ys, hit_zs, hit_radii;
+    std::vector<uint32_t> hit_visible;
+
+    auto tree = measure_usec(kIterations, [&] {
+        hits.clear();
+        bvh.query_planes(planes, 6, &hits);
+
+        hit_xs.clear(); hit_ys.clear(); hit_zs.clear(); hit_radii.clear();
+        for (auto proxy : hits) {
+            auto i = bvh.entity(proxy).eid - 1;
+            hit_xs.push_back(xs[i]);
+            hit_ys.push_back(ys[i]);
+            hit_zs.push_back(zs[i]);
+            hit_radii.push_back(radii[i]);
+        }
+
+        hit_visible.resize((hits.size() + 31) / 32);
+        cull_spheres(planes, 6, hit_xs.data(), hit_ys.data(), hit_zs.data(), hit_radii.data(),
+                     hits.size(), hit_visible.data());
+        sink += hits.size();
+    });
+
+    char note[64];
+    snprintf(note, sizeof(note), "%.2fx, %zu candidates", linear / tree, hits.size());
+    report("cull/tree", tree, note);
+
+    // The per-frame upkeep when one object in a hundred moves a little
+    std::uniform_real_distribution<float> step(-0.2f, 0.2f);
+    size_t reinserted = 0;
+
+    auto upkeep = measure_usec(kIterations, [&] {
+        for (size_t i = 0; i < kObjectCount; i += 100) {
+            xs[i] += step(rng);
+            zs[i] += step(rng);
+            reinserted += bvh.move(proxies[i], sphere_box(xs[i], ys[i], zs[i], radii[i]));
+        }
+    });
+
+    snprintf(note, sizeof(note), "%zu moves, %zu reinserted",
+             kIterations * (kObjectCount / 100), reinserted);
+    report("move/1%", upkeep, note);
+
+    if (sink == 0) {
+        printf("unexpected empty frustum\n");
+    }
+}
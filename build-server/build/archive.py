@@ -0,0 +1,90 @@
+'''Pack the built assets into a single archive, which the engine maps into
+memory and reads through ArchiveResourceLoader. See asset_archive.h in
+the engine for the layout.'''
+
+import os
+import struct
+import zlib
+
+from os import path
+
+MAGIC = b'RWPK'
+VERSION = 1
+DATA_ALIGNMENT = 16
+
+FLAG_COMPRESSED = 1
+
+# Already compressed, so deflating them again only costs load time
+STORED_EXTENSIONS = frozenset(['.png'])
+
+# Build bookkeeping, not assets
+SKIPPED_FILES = frozenset(['rw_build_cache.rbdef'])
+
+
+def path_hash(p):
+    '''64 bit FNV-1a of the asset path'''
+    h = 14695981039346656037
+    for c in bytearray(p):
+        h ^= c
+        h = (h * 1099511628211) & 0xffffffffffffffff
+    return h
+
+
+def align(offset):
+    return (offset + DATA_ALIGNMENT - 1) & ~(DATA_ALIGNMENT - 1)
+
+
+def collect_files(root):
+    files = []
+    for dirpath, dirnames, filenames in os.walk(root):
+        for filename in filenames:
+            if filename in SKIPPED_FILES:
+                continue
+
+            abspath = path.join(dirpath, filename)
+            asset_path = path.relpath(abspath, root).replace(os.sep, '/')
+            files.append((asset_path.encode('utf-8'), abspath))
+
+    return files
+
+
+def pack(root, out_filename):
+    entries = []
+    for asset_path, abspath in collect_files(root):
+        with open(abspath, 'rb') as f:
+            contents = f.read()
+
+        data, flags = contents, 0
+        if path.splitext(abspath)[1].lower() not in STORED_EXTENSIONS:
+            compressed = zlib.compress(contents, 9)
+            if len(compressed) < len(contents):
+                data, flags = compressed, FLAG_COMPRESSED
+
+        entries.append((path_hash(asset_path), asset_path, len(contents), data, flags))
+
+    entries.sort(key=lambda e: (e[0], e[1]))
+
+    strings = b''.join(e[1] for e in entries)
+
+    header = MAGIC + struct.pack(b'>III', VERSION, len(entries), len(strings))
+    index = []
+
+    data_offset = align(len(header) + 40 * len(entries) + len(strings))
+    path_offset = 0
+
+    for hash, asset_path, size, data, flags in entries:
+        index.append(struct.pack(b'>QQQQIHH', hash, data_offset, size, len(data),
+                                 path_offset, len(asset_path), flags))
+        data_offset = align(data_offset + len(data))
+        path_offset += len(asset_path)
+
+    with open(out_filename, 'wb') as out:
+        out.write(header)
+        out.write(b''.join(index))
+        out.write(strings)
+
+        for entry in entries:
+            out.write(b'\0' * (align(out.tell()) - out.tell()))
+            out.write(entry[3])
+
+    print 'packed {} assets into {}'.format(len(entries), out_filename)
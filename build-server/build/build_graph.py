@@ -263,6 +263,15 @@ def main():
 
         bld.save_build_cache()
 
+    elif sys.argv[1] == 'pack':
+        from archive import pack
+
+        if len(sys.argv) < 3:
+            print 'usage: build_graph.py pack archive-file'
+            return False
+
+        pack(path.join(bld.root, bld.out_dir), sys.argv[2])
+
     return True
 
 
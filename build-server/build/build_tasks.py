@@ -6,6 +6,7 @@ import json
 import rbdef
 import toml
 
+from array import array
 from os import path
 
 import fbx_importer as fbx
@@ -15,6 +16,16 @@ from build_graph import TaskNode, connect_nodes, disconnect_nodes
 BUILD_TASKS = {}
 
 
+def float_array(values):
+    '''Pack a flat list of numbers as an RBDEF typed array, which the engine
+    can load without decoding every number on its own.'''
+    return array(str('f'), values)
+
+
+def float_arrays(arrays):
+    return dict((k, float_array(v)) for k, v in arrays.items())
+
+
 def build_task_single(regex, name=None, output_map_fn=None):
 
     def inner(fn_or_cls):
@@ -105,9 +116,9 @@ class BuildJSONMeshTask(TaskNode):
         with file(self.mesh_node.filename) as infile:
             data = json.load(infile)
 
-        vertices = data['vertices']
-        normals = {'': data['normals']}
-        texcoords = {'': data['texcoords']}
+        vertices = float_array(data['vertices'])
+        normals = {'': float_array(data['normals'])}
+        texcoords = {'': float_array(data['texcoords'])}
 
         ensure_dir_for_file_exists(self.mesh_dest_node.filename)
 
@@ -200,9 +211,9 @@ class BuildFBXMeshTask(TaskNode):
     def _write_mesh(self, mesh):
         data = mesh.make_flattened_dict()
 
-        vertices = data['vertices']
-        normals = data['normals']
-        texcoords = data['uvs']
+        vertices = float_array(data['vertices'])
+        normals = float_arrays(data['normals'])
+        texcoords = float_arrays(data['uvs'])
 
         ensure_dir_for_file_exists(self.mesh_dest_node.filename)
 
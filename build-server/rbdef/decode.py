@@ -31,6 +31,12 @@ True
 >>> loads(dumps([1, 2, 3]))
 [1, 2, 3]
 
+>>> from array import array
+>>> loads(dumps(array(str('f'), [1.5, -2.0]))).tolist()
+[1.5, -2.0]
+>>> loads(dumps([array(str('H'), [1, 2, 3]), 'x'])) == [array(str('H'), [1, 2, 3]), b'x']
+True
+
 >>> result = loads(dumps({'x': 1, 'y': 2, 'z': 3}))
 >>> result[b'x'], result[b'y'], result[b'z']
 (1, 2, 3)
@@ -41,6 +47,7 @@ from __future__ import unicode_literals
 
 import sys
 
+from array import array
 from io import BytesIO
 from struct import Struct
 
@@ -76,6 +83,24 @@ def _load_array(dsc, fp):
     return [load(fp) for _ in range(size)]
 
 
+def _load_typed_array(dsc, fp):
+    typecode = fp.read(1)
+    size = _load_uint(dsc == b'V', fp)
+    fp.read(-fp.tell() % 4)
+
+    result = array(str(typecode.decode('ascii')))
+    data = fp.read(size * result.itemsize)
+    if PY3:
+        result.frombytes(data)
+    else:
+        result.fromstring(data)
+
+    if sys.byteorder != 'little':
+        result.byteswap()
+
+    return result
+
+
 def _load_dict(dsc, fp):
     size = _load_uint(dsc == 'D', fp)
     return dict((load(fp), load(fp)) for _ in range(size))
@@ -106,6 +131,9 @@ def load(fp):
     if b in (b'a', b'A'):
         return _load_array(b, fp)
 
+    if b in (b'v', b'V'):
+        return _load_typed_array(b, fp)
+
     if b in (b'd', b'D'):
         return _load_dict(b, fp)
 
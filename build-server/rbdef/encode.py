@@ -5,6 +5,7 @@ from __future__ import unicode_literals
 import struct
 import sys
 
+from array import array
 from io import BytesIO
 
 PY3 = sys.version_info >= (3, 0)
@@ -113,6 +114,44 @@ def dump_array(obj, fp):
         dump(elem, fp)
 
 
+_TYPED_ARRAY_TYPES = {'f': (b'f', 4), 'H': (b'H', 2), 'I': (b'I', 4)}
+
+
+def dump_typed_array(obj, fp):
+    '''Write an array.array of floats or unsigned ints as a packed, little
+    endian typed array. Items start at a multiple of four bytes from the
+    start of ``fp``, so it has to support ``tell``.
+
+    >>> dumps(array(str('f'), [5.5])) == b'vf\\x00\\x00\\x00\\x01\\x00\\x00\\x00\\x00\\xb0\\x40'
+    True
+    >>> dumps(array(str('H'), [1, 2])) == b'vH\\x00\\x00\\x00\\x02\\x00\\x00\\x01\\x00\\x02\\x00'
+    True
+    '''
+
+    if obj.typecode not in _TYPED_ARRAY_TYPES:
+        raise ValueError('Unsupported typed array type: %s' % obj.typecode)
+
+    elem_type, elem_size = _TYPED_ARRAY_TYPES[obj.typecode]
+    if obj.itemsize != elem_size:
+        raise ValueError('Typed array of %s has item size %d, expected %d'
+                         % (obj.typecode, obj.itemsize, elem_size))
+
+    if len(obj) < 2**32:
+        fp.write(b'v' + elem_type)
+        fp.write(struct.pack(b'>I', len(obj)))
+    else:
+        fp.write(b'V' + elem_type)
+        fp.write(struct.pack(b'>Q', len(obj)))
+
+    fp.write(b'\x00' * (-fp.tell() % 4))
+
+    if sys.byteorder != 'little':
+        obj = array(obj.typecode, obj)
+        obj.byteswap()
+
+    fp.write(obj.tobytes() if PY3 else obj.tostring())
+
+
 def dump_dict(obj, fp):
     '''Write a dictionary of string/object pairs
 
@@ -150,6 +189,8 @@ def dump(obj, fp):
         dump_str(obj, fp)
     elif PY3 and isinstance(obj, str):
         dump_unicode(obj, fp)
+    elif isinstance(obj, array):
+        dump_typed_array(obj, fp)
     elif isinstance(obj, list) or isinstance(obj, tuple):
         dump_array(obj, fp)
     elif isinstance(obj, dict):
@@ -0,0 +1,236 @@
+#ifndef __ROSEWOOD_CORE_ARCHETYPE_H__
+#define __ROSEWOOD_CORE_ARCHETYPE_H__
+
+#include <stddef.h>
+
+#include <array>
+#include <bitset>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "rosewood/core/assert.h"
+
+namespace rosewood { namespace core {
+
+    const size_t kMaxArchetypeComponentTypes = 64;
+    const size_t kArchetypeChunkBytes = 16 * 1024;
+
+    typedef std::bitset<kMaxArchetypeComponentTypes> ComponentMask;
+
+    // An archetype owns every entity that has exactly the component set
+    // described by its mask. Entities are packed into fixed size chunks,
+    // and every chunk stores one contiguous column per component type
+    // (plus a column of entity indices).
+    //
+    // Rows are swap-removed, so a component pointer is only valid until
+    // the next structural change (adding/removing a component or
+    // destroying an entity) in the same archetype.
+    class Archetype {
+    public:
+        explicit Archetype(ComponentMask mask);
+        ~Archetype();
+
+        ComponentMask mask() const { return _mask; }
+        bool contains(ComponentMask mask) const { return (_mask & mask) == mask; }
+        bool has_type(unsigned int type_code) const { return _mask.test(type_code); }
+
+        size_t size() const { return _size; }
+        size_t chunk_count() const { return _chunks.size(); }
+        size_t chunk_size(size_t chunk) const { return _chunks[chunk].count; }
+        size_t chunk_capacity() const { return _chunk_capacity; }
+
+        size_t index_at(size_t chunk, size_t row) const {
+            return reinterpret_cast<const size_t*>(_chunks[chunk].data)[row];
+        }
+
+        void *component_at(unsigned int type_code, size_t chunk, size_t row) {
+            return (_chunks[chunk].data + _column_offsets[type_code]
+                    + row * _type_infos[type_code].size);
+        }
+
+        template<typename TComp> TComp *column(size_t chunk) {
+            auto type_code = TComp::register_type();
+            RW_ASSERT(has_type(type_code), "Archetype does not contain component type");
+            return reinterpret_cast<TComp*>(_chunks[chunk].data + _column_offsets[type_code]);
+        }
+
+        Archetype(const Archetype&) = delete;
+        Archetype &operator=(const Archetype&) = delete;
+
+    private:
+        struct Chunk {
+            unsigned char *data;
+            size_t count;
+        };
+
+        struct TypeInfo {
+            size_t size;
+            size_t alignment;
+            void (*relocate)(void *dest, void *source);
+            void (*destroy)(void *ptr);
+        };
+
+        ComponentMask _mask;
+        std::vector<unsigned int> _types;
+        std::array<size_t, kMaxArchetypeComponentTypes> _column_offsets;
+
+        std::vector<Chunk> _chunks;
+        size_t _chunk_capacity;
+        size_t _chunk_bytes;
+        size_t _chunk_alignment;
+        size_t _size;
+
+        static std::vector<TypeInfo> _type_infos;
+
+        void compute_layout();
+
+        void allocate_row(size_t index, size_t *out_chunk, size_t *out_row);
+        size_t remove_row(size_t chunk, size_t row);
+
+        friend class ArchetypeStorage;
+    };
+
+    struct ArchetypeLocation {
+        Archetype *archetype;
+        size_t chunk;
+        size_t row;
+    };
+
+    // Archetype based component storage used by EntityManager when it is
+    // created with StorageMode::Archetype. Adding or removing a component
+    // moves the entity (and all its components) to the archetype matching
+    // its new component set.
+    class ArchetypeStorage {
+    public:
+        static const size_t kNoIndex = size_t(-1);
+
+        ArchetypeStorage() { }
+
+        template<typename TComp, typename... TArgs> TComp *create(size_t index, TArgs... args);
+        template<typename TComp> TComp *at(size_t index);
+        template<typename TComp> void remove(size_t index);
+
+        void remove_all(size_t index);
+
+        size_t archetype_count() const { return _archetypes.size(); }
+        Archetype *archetype(size_t i) const { return _archetypes[i]; }
+
+        template<typename TComp>
+        static ComponentMask mask_of();
+
+        template<typename TComp, typename TComp2, typename... TComps>
+        static ComponentMask mask_of();
+
+        ArchetypeStorage(const ArchetypeStorage&) = delete;
+        ArchetypeStorage &operator=(const ArchetypeStorage&) = delete;
+
+    private:
+        std::unordered_map<ComponentMask, std::unique_ptr<Archetype>> _by_mask;
+        std::vector<Archetype*> _archetypes;
+        std::vector<ArchetypeLocation> _locations;
+
+        Archetype *archetype_for(ComponentMask mask);
+        void move_entity(size_t index, Archetype *to);
+
+        ArchetypeLocation &location(size_t index) {
+            if (index >= _locations.size()) {
+                _locations.resize(index + 1, ArchetypeLocation{nullptr, 0, 0});
+            }
+            return _locations[index];
+        }
+
+        template<typename TComp>
+        static void register_component();
+    };
+
+    template<typename TComp, typename... TArgs>
+    TComp *ArchetypeStorage::create(size_t index, TArgs... args) {
+        register_component<TComp>();
+        auto type_code = TComp::register_type();
+
+        auto &loc = location(index);
+        if (loc.archetype && loc.archetype->has_type(type_code)) {
+            auto existing = static_cast<TComp*>(loc.archetype->component_at(type_code, loc.chunk, loc.row));
+            existing->~TComp();
+            return new(existing) TComp(std::forward<TArgs>(args)...);
+        }
+
+        auto mask = loc.archetype ? loc.archetype->mask() : ComponentMask();
+        mask.set(type_code);
+        move_entity(index, archetype_for(mask));
+
+        const auto &new_loc = _locations[index];
+        void *data = new_loc.archetype->component_at(type_code, new_loc.chunk, new_loc.row);
+        return new(data) TComp(std::forward<TArgs>(args)...);
+    }
+
+    template<typename TComp>
+    TComp *ArchetypeStorage::at(size_t index) {
+        if (index >= _locations.size()) {
+            return nullptr;
+        }
+
+        auto type_code = TComp::register_type();
+        const auto &loc = _locations[index];
+        if (!loc.archetype || !loc.archetype->has_type(type_code)) {
+            return nullptr;
+        }
+
+        return static_cast<TComp*>(loc.archetype->component_at(type_code, loc.chunk, loc.row));
+    }
+
+    template<typename TComp>
+    void ArchetypeStorage::remove(size_t index) {
+        if (!at<TComp>(index)) {
+            return;
+        }
+
+        auto mask = _locations[index].archetype->mask();
+        mask.reset(TComp::register_type());
+        move_entity(index, mask.none() ? nullptr : archetype_for(mask));
+    }
+
+    template<typename TComp>
+    ComponentMask ArchetypeStorage::mask_of() {
+        auto type_code = TComp::register_type();
+        RW_ASSERT(type_code < kMaxArchetypeComponentTypes,
+                  "Too many component types for archetype storage");
+
+        ComponentMask mask;
+        mask.set(type_code);
+        return mask;
+    }
+
+    template<typename TComp, typename TComp2, typename... TComps>
+    ComponentMask ArchetypeStorage::mask_of() {
+        return mask_of<TComp>() | mask_of<TComp2, TComps...>();
+    }
+
+    template<typename TComp>
+    void ArchetypeStorage::register_component() {
+        auto type_code = TComp::register_type();
+        RW_ASSERT(type_code < kMaxArchetypeComponentTypes,
+                  "Too many component types for archetype storage");
+
+        auto &type_infos = Archetype::_type_infos;
+        if (type_code >= type_infos.size()) {
+            type_infos.resize(type_code + 1, Archetype::TypeInfo{0, 0, nullptr, nullptr});
+        }
+        if (!type_infos[type_code].destroy) {
+            type_infos[type_code].size = sizeof(TComp);
+            type_infos[type_code].alignment = std::alignment_of<TComp>::value;
+            type_infos[type_code].relocate = [](void *dest, void *source) {
+                new(dest) TComp(std::move(*static_cast<TComp*>(source)));
+                static_cast<TComp*>(source)->~TComp();
+            };
+            type_infos[type_code].destroy = [](void *ptr) { static_cast<TComp*>(ptr)->~TComp(); };
+        }
+    }
+
+} }
+
+#endif
@@ -1,12 +1,16 @@
 #ifndef __ROSEWOOD_CORE_COMPONENT_ARRAY_H__
 #define __ROSEWOOD_CORE_COMPONENT_ARRAY_H__
 
+#include <algorithm>
+#include <memory>
 #include <vector>
 #include <functional>
 #include <type_traits>
 
 #include "rosewood/data-structures/stable_vector.h"
 
+#include "rosewood/core/archetype.h"
+
 namespace rosewood { namespace core {
     
     class ComponentArray {
@@ -33,7 +37,10 @@ namespace rosewood { namespace core {
             }
 
             auto data = comp_data<TComp>(index);
-            data->flag = 1;
+            if (!data->flag) {
+                _dense.push_back(index);
+                data->flag = (flag_type)_dense.size();
+            }
             return new(&data->data) TComp(std::forward<TArgs>(args)...);
         }
         
@@ -45,6 +52,7 @@ namespace rosewood { namespace core {
         template<typename TComp> void remove(size_t index) {
             auto data = comp_data<TComp>(index);
             if (data->flag) {
+                unlink_dense(data->flag - 1, TComp::register_type());
                 data->flag = 0;
                 data->data.~TComp();
             }
@@ -56,9 +64,20 @@ namespace rosewood { namespace core {
         size_t size() const {
             return _data.size() / stride<TComp>();
         }
+
+        // Number of live components, and the index of the n:th live
+        // component. Removing a component moves the last live index into
+        // its place, so the order is only stable while no components are
+        // removed.
+        size_t population() const { return _dense.size(); }
+        size_t index_at(size_t position) const { return _dense[position]; }
         
     private:
         data_structures::StableVector<unsigned char> _data;
+
+        // Indices of all live components. The flag of a live component
+        // stores its position in this list plus one.
+        std::vector<size_t> _dense;
         
         static std::vector<std::function<void(void*)>> _destructors;
         static std::vector<size_t> _sizes;
@@ -83,20 +102,45 @@ namespace rosewood { namespace core {
         
         template<typename TComp>
         static void register_component();
+
+        void unlink_dense(size_t position, unsigned int type_code);
     };
     
     template<typename TComp>
     class ComponentArrayIterator {
     public:
         ComponentArrayIterator(ComponentArray *component_array, size_t index, int initial_step)
-        : _component_array(component_array), _index(index) {
+        : _component_array(component_array), _index(index)
+        , _archetypes(nullptr), _position(0) {
             if (initial_step) {
                 step_to_valid(initial_step);
             }
         }
+
+        // Iterates all archetypes containing TComp below archetype index
+        // `index`, backwards from the last row. Rows are swap-removed from
+        // the end, so the current entity can be destroyed without another
+        // entity being skipped. Only the rows each archetype had when
+        // iteration started are visited, so an entity that gains or loses
+        // a component moves past them rather than being visited again.
+        ComponentArrayIterator(ArchetypeStorage *archetypes, size_t index)
+        : _component_array(nullptr), _index(index)
+        , _archetypes(archetypes), _position(0) {
+            if (_index) {
+                auto sizes = std::make_shared<std::vector<size_t>>();
+                for (size_t a = 0; a < _index; ++a) {
+                    sizes->push_back(_archetypes->archetype(a)->size());
+                }
+
+                _sizes = std::move(sizes);
+                _position = (*_sizes)[_index - 1];
+            }
+            step_to_valid_row();
+        }
         
         bool operator==(const ComponentArrayIterator<TComp> &rhs) const {
-            return _index == rhs._index && _component_array == rhs._component_array;
+            return (_index == rhs._index && _component_array == rhs._component_array
+                    && _archetypes == rhs._archetypes && _position == rhs._position);
         }
         
         bool operator!=(const ComponentArrayIterator<TComp> &rhs) const {
@@ -104,8 +148,14 @@ namespace rosewood { namespace core {
         }
         
         ComponentArrayIterator<TComp> &operator++() {
-            ++_index;
-            step_to_valid(1);
+            if (_archetypes) {
+                --_position;
+                step_to_valid_row();
+            }
+            else {
+                ++_index;
+                step_to_valid(1);
+            }
             return *this;
         }
         ComponentArrayIterator<TComp> operator++(int) {
@@ -115,10 +165,22 @@ namespace rosewood { namespace core {
         }
         
         TComp *operator*() {
+            if (_archetypes) {
+                auto archetype = _archetypes->archetype(_index - 1);
+                auto capacity = archetype->chunk_capacity();
+                return (archetype->template column<TComp>((_position - 1) / capacity)
+                        + (_position - 1) % capacity);
+            }
             return _component_array->at<TComp>(_index);
         }
 
         const TComp *operator*() const {
+            if (_archetypes) {
+                auto archetype = _archetypes->archetype(_index - 1);
+                auto capacity = archetype->chunk_capacity();
+                return (archetype->template column<TComp>((_position - 1) / capacity)
+                        + (_position - 1) % capacity);
+            }
             return _component_array->at<TComp>(_index);
         }
         
@@ -131,24 +193,63 @@ namespace rosewood { namespace core {
     private:
         ComponentArray *_component_array;
         size_t _index;
+
+        // In archetype mode _index and _position are one past the current
+        // archetype and row, so that zero marks the end. Chunks are filled
+        // in order, so rows are numbered across them.
+        ArchetypeStorage *_archetypes;
+        size_t _position;
+        std::shared_ptr<const std::vector<size_t>> _sizes;
+
+        void step_to_valid_row() {
+            auto type_code = TComp::register_type();
+
+            while (_index) {
+                auto archetype = _archetypes->archetype(_index - 1);
+
+                // Rows might have been removed since the last step
+                if (archetype->has_type(type_code)) {
+                    _position = std::min(_position, archetype->size());
+                    if (_position) {
+                        return;
+                    }
+                }
+
+                --_index;
+                _position = _index ? (*_sizes)[_index - 1] : 0;
+            }
+
+            _position = 0;
+        }
     };
     
     template<typename TComp>
     class ComponentArrayView {
     public:
-        ComponentArrayView(ComponentArray *component_array) : _component_array(component_array) { }
+        ComponentArrayView(ComponentArray *component_array)
+        : _component_array(component_array), _archetypes(nullptr) { }
+
+        ComponentArrayView(ArchetypeStorage *archetypes)
+        : _component_array(nullptr), _archetypes(archetypes) { }
         
         ComponentArrayIterator<TComp> begin() {
+            if (_archetypes) {
+                return ComponentArrayIterator<TComp>(_archetypes, _archetypes->archetype_count());
+            }
             return ComponentArrayIterator<TComp>(_component_array, 0, 1);
         }
         
         ComponentArrayIterator<TComp> end() {
+            if (_archetypes) {
+                return ComponentArrayIterator<TComp>(_archetypes, 0);
+            }
             return ComponentArrayIterator<TComp>(_component_array,
                                                  _component_array->size<TComp>(), 0);
         }
         
     private:
         ComponentArray *_component_array;
+        ArchetypeStorage *_archetypes;
     };
     
     template<typename TComp>
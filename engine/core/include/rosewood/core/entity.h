@@ -1,14 +1,40 @@
 #ifndef __ROSEWOOD_CORE_ENTITY_H__
 #define __ROSEWOOD_CORE_ENTITY_H__
 
+#include <functional>
+#include <memory>
+#include <utility>
 #include <vector>
 
+#include "rosewood/core/assert.h"
+
 #include "rosewood/data-structures/stable_vector.h"
+#include "rosewood/core/archetype.h"
 #include "rosewood/core/component_array.h"
+#include "rosewood/core/job_system.h"
+#include "rosewood/core/transform_hierarchy.h"
 
 namespace rosewood { namespace core {
 
-    typedef unsigned int EntityId;
+    // An EntityId packs the entity's slot index in the low 32 bits and the
+    // slot's generation in the high 32 bits. Generations are odd while the
+    // slot is alive and even once it has been destroyed, so handles to
+    // destroyed entities never compare equal to a recycled slot.
+    typedef unsigned long long EntityId;
+    typedef unsigned int EntityIndex;
+    typedef unsigned int EntityGeneration;
+
+    inline constexpr EntityId make_entity_id(EntityIndex index, EntityGeneration generation) {
+        return (EntityId(generation) << 32) | EntityId(index);
+    }
+
+    inline constexpr EntityIndex entity_index(EntityId eid) {
+        return EntityIndex(eid & 0xffffffffull);
+    }
+
+    inline constexpr EntityGeneration entity_generation(EntityId eid) {
+        return EntityGeneration(eid >> 32);
+    }
 
     class EntityManager;
 
@@ -48,9 +74,26 @@ namespace rosewood { namespace core {
         return !(e1 == e2);
     }
 
+    // Sparse storage keeps one ComponentArray per component type, indexed
+    // by entity id, and never moves components once created.
+    //
+    // Archetype storage packs entities with the same component set into
+    // dense chunks, which makes iteration over sparse component types much
+    // cheaper. Components must be move constructible: they are moved (and
+    // the old instance destroyed) when the entity's component set
+    // changes, so pointers to components must not be held across adding or
+    // removing components or destroying entities. Components that point at
+    // each other, like Transform, have to fix up those pointers when moved.
+    enum class StorageMode {
+        Sparse,
+        Archetype,
+    };
+
     class EntityManager {
     public:
-        EntityManager();
+        explicit EntityManager(StorageMode storage_mode = StorageMode::Sparse);
+
+        StorageMode storage_mode() const { return _storage_mode; }
 
         Entity create_entity();
         void destroy_entity(Entity e);
@@ -61,6 +104,8 @@ namespace rosewood { namespace core {
         bool is_valid(Entity e) const;
         size_t entity_count() const;
 
+        TransformHierarchy &transform_hierarchy() { return _transform_hierarchy; }
+
         template<typename TComp, typename... TArgs>
         TComp *add_component(Entity entity, TArgs... args);
 
@@ -79,18 +124,92 @@ namespace rosewood { namespace core {
         template<typename TComp>
         ComponentArrayView<TComp> components();
 
+        // Starts recording which entities gain, lose or change a TComp, for
+        // systems that keep derived data up to date incrementally. Entities
+        // that already have one are recorded as changed.
+        template<typename TComp>
+        void track_component_changes();
+
+        // Records a change to an entity's TComp that systems tracking it
+        // need to know about, like a renderable getting a new mesh. Does
+        // nothing unless TComp is tracked.
+        template<typename TComp>
+        void notify_component_changed(Entity entity);
+
+        // Moves the recorded changes into `changed` (added or notified) and
+        // `removed`. An entity can end up in both lists, so check that it
+        // still has the component when handling `changed`.
+        template<typename TComp>
+        void take_component_changes(std::vector<Entity> *changed, std::vector<Entity> *removed);
+
         template<typename... TComps, typename F>
         void for_components(const F &func);
 
+        // Like for_components, but splits the matching entities into ranges
+        // of `grain` entities (whole chunks in archetype mode) and runs them
+        // on the job system. Returns when every entity has been visited.
+        //
+        // func runs concurrently on several threads, and each matching
+        // entity is visited exactly once. While the call is running:
+        //
+        // * func may read and write the components it is passed.
+        // * func may read other entities' components only if no invocation
+        //   writes them. Transform setters only touch their own transform,
+        //   but reading a stale world (or local) matrix recomputes it and
+        //   its ancestors, so call TransformHierarchy::update() first if
+        //   func needs matrices.
+        // * func must not create or destroy entities or add or remove
+        //   components, on any thread. Collect such changes and apply them
+        //   after the call returns.
+        template<typename... TComps, typename F>
+        void parallel_for_components(JobSystem &jobs, const F &func, size_t grain = 256);
+
     private:
-        EntityId _max_eid;
-        std::vector<EntityId> _free_list;
+        StorageMode _storage_mode;
+        EntityIndex _max_index;
+        std::vector<EntityIndex> _free_list;
+        std::vector<EntityGeneration> _generations;
+
+        // Must outlive the components, since destroying a Transform
+        // releases its node.
+        TransformHierarchy _transform_hierarchy;
+
         data_structures::StableVector<ComponentArray> _components;
+        ArchetypeStorage _archetypes;
+
+        struct ComponentJournal {
+            std::function<bool(Entity)> has_component;
+            std::vector<Entity> changed;
+            std::vector<Entity> removed;
+        };
+
+        // Indexed by component type code, null for untracked types
+        std::vector<std::unique_ptr<ComponentJournal>> _journals;
+
+        template<typename TComp>
+        ComponentJournal *component_journal();
 
         template<typename TComp>
         void ensure_component_index_available(size_t index);
+
+        template<typename TComp>
+        ComponentArray *component_array();
+
+        template<typename... TComps>
+        ComponentArray *join_driver();
+
+        template<typename TComp>
+        TComp *component_at_index(size_t entity_index);
     };
 
+    inline bool EntityManager::is_valid(Entity e) const {
+        auto index = entity_index(e.eid);
+        auto generation = entity_generation(e.eid);
+
+        return (e.owner == this && index < _generations.size()
+                && (generation & 1) && _generations[index] == generation);
+    }
+
     template<typename TComp, typename... TArgs>
     TComp *Entity::add_component(TArgs... args) {
         return owner->add_component<TComp>(*this, std::forward<TArgs>(args)...);
@@ -120,11 +239,23 @@ namespace rosewood { namespace core {
 
     template<typename TComp, typename... TArgs>
     TComp *EntityManager::add_component(Entity entity, TArgs... args) {
+        RW_ASSERT(is_valid(entity), "Can not add components to a destroyed entity");
+
+        if (auto journal = component_journal<TComp>()) {
+            journal->changed.push_back(entity);
+        }
+
+        if (_storage_mode == StorageMode::Archetype) {
+            return _archetypes.template create<TComp>(entity_index(entity.eid), entity,
+                                                      std::forward<TArgs>(args)...);
+        }
+
         auto index = TComp::register_type();
         ensure_component_index_available<TComp>(index);
 
         auto &comp_array = _components[index];
-        return comp_array.template create<TComp>(entity.eid, entity, std::forward<TArgs>(args)...);
+        return comp_array.template create<TComp>(entity_index(entity.eid), entity,
+                                                 std::forward<TArgs>(args)...);
     };
 
     template<typename TComp>
@@ -140,13 +271,15 @@ namespace rosewood { namespace core {
 
     template<typename TComp>
     TComp *EntityManager::component(Entity entity) {
-        auto index = TComp::register_type();
-        if (index >= _components.size() || entity.eid >= _components[index].template size<TComp>()) {
+        if (!is_valid(entity)) {
             return nullptr;
         }
 
-        auto &comp_array = _components[index];
-        return comp_array.template at<TComp>(entity.eid);
+        if (_storage_mode == StorageMode::Archetype) {
+            return _archetypes.template at<TComp>(entity_index(entity.eid));
+        }
+
+        return component_at_index<TComp>(entity_index(entity.eid));
     }
 
     template<typename TComp>
@@ -155,17 +288,71 @@ namespace rosewood { namespace core {
             return;
         }
 
+        if (auto journal = component_journal<TComp>()) {
+            journal->removed.push_back(entity);
+        }
+
+        if (_storage_mode == StorageMode::Archetype) {
+            _archetypes.template remove<TComp>(entity_index(entity.eid));
+            return;
+        }
+
         auto index = TComp::register_type();
         auto &comp_array = _components[index];
-        comp_array.template remove<TComp>(entity.eid);
+        comp_array.template remove<TComp>(entity_index(entity.eid));
     }
 
     template<typename TComp>
     ComponentArrayView<TComp> EntityManager::components() {
+        if (_storage_mode == StorageMode::Archetype) {
+            return ComponentArrayView<TComp>(&_archetypes);
+        }
+
         auto index = TComp::register_type();
         return ComponentArrayView<TComp>(&_components[index]);
     }
 
+    template<typename TComp>
+    void EntityManager::track_component_changes() {
+        auto index = TComp::register_type();
+        if (index >= _journals.size()) {
+            _journals.resize(index + 1);
+        }
+        if (_journals[index]) {
+            return;
+        }
+
+        _journals[index].reset(new ComponentJournal);
+        auto journal = _journals[index].get();
+
+        journal->has_component = [this](Entity entity) { return component<TComp>(entity) != nullptr; };
+        for_components<TComp>([journal](TComp *comp) { journal->changed.push_back(comp->entity()); });
+    }
+
+    template<typename TComp>
+    void EntityManager::notify_component_changed(Entity entity) {
+        if (auto journal = component_journal<TComp>()) {
+            journal->changed.push_back(entity);
+        }
+    }
+
+    template<typename TComp>
+    void EntityManager::take_component_changes(std::vector<Entity> *changed, std::vector<Entity> *removed) {
+        changed->clear();
+        removed->clear();
+
+        if (auto journal = component_journal<TComp>()) {
+            changed->swap(journal->changed);
+            removed->swap(journal->removed);
+        }
+    }
+
+    template<typename TComp>
+    EntityManager::ComponentJournal *EntityManager::component_journal() {
+        auto index = TComp::register_type();
+        return index < _journals.size() ? _journals[index].get() : nullptr;
+    }
+
     template<typename T>
     bool all_not_null(T *ptr) {
         return ptr != nullptr;
@@ -179,15 +366,139 @@ namespace rosewood { namespace core {
         return all_not_null<TSecond, TRest...>(second, rest...);
     }
 
+    template<typename F, typename... TComps>
+    void call_if_all_not_null(const F &func, TComps*... comps) {
+        if (all_not_null(comps...)) {
+            func(comps...);
+        }
+    }
+
     template<typename... TComps, typename F>
     void EntityManager::for_components(const F &func) {
-        for (EntityId i = 0; i <= _max_eid; ++i) {
-            Entity e{this, i};
+        if (_storage_mode == StorageMode::Archetype) {
+            auto mask = ArchetypeStorage::mask_of<TComps...>();
+
+            // func may move entities between archetypes, and one moved to
+            // another matching archetype not walked yet would be visited
+            // again. So the matching entities are collected first, and each
+            // is visited if it is still alive and still matches when its
+            // turn comes, like in the sparse path below. Entities func
+            // creates are not visited.
+            std::vector<std::pair<EntityIndex, EntityGeneration>> matching;
+            for (size_t a = _archetypes.archetype_count(); a-- > 0; ) {
+                auto archetype = _archetypes.archetype(a);
+                if (!archetype->contains(mask)) continue;
+
+                for (size_t c = archetype->chunk_count(); c-- > 0; ) {
+                    for (size_t r = archetype->chunk_size(c); r-- > 0; ) {
+                        auto index = EntityIndex(archetype->index_at(c, r));
+                        matching.emplace_back(index, _generations[index]);
+                    }
+                }
+            }
+
+            for (const auto &entity : matching) {
+                if (_generations[entity.first] != entity.second) continue;
+
+                call_if_all_not_null(func, _archetypes.template at<TComps>(entity.first)...);
+            }
+            return;
+        }
+
+        // Drive the join from the component type with the fewest live
+        // components and probe the others by index, so the cost scales with
+        // the size of the smallest set rather than the largest entity id.
+        // The driving set is walked backwards, which makes it safe for func
+        // to remove the current entity's components or destroy it.
+        auto driver = join_driver<TComps...>();
+        if (!driver) {
+            return;
+        }
+
+        for (size_t position = driver->population(); position-- > 0; ) {
+            if (position >= driver->population()) {
+                continue;
+            }
+
+            auto index = driver->index_at(position);
+            call_if_all_not_null(func, component_at_index<TComps>(index)...);
+        }
+    }
 
-            if (is_valid(e) && all_not_null(component<TComps>(e)...)) {
-                func(component<TComps>(e)...);
+    template<typename... TComps, typename F>
+    void EntityManager::parallel_for_components(JobSystem &jobs, const F &func, size_t grain) {
+        if (_storage_mode == StorageMode::Archetype) {
+            auto mask = ArchetypeStorage::mask_of<TComps...>();
+
+            std::vector<std::pair<Archetype*, size_t>> chunks;
+            for (size_t a = 0; a < _archetypes.archetype_count(); ++a) {
+                auto archetype = _archetypes.archetype(a);
+                if (!archetype->contains(mask)) continue;
+
+                for (size_t c = 0; c < archetype->chunk_count(); ++c) {
+                    chunks.emplace_back(archetype, c);
+                }
             }
+
+            jobs.parallel_for(0, chunks.size(), 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    auto archetype = chunks[i].first;
+                    auto c = chunks[i].second;
+
+                    for (size_t r = 0; r < archetype->chunk_size(c); ++r) {
+                        func((archetype->template column<TComps>(c) + r)...);
+                    }
+                }
+            });
+            return;
+        }
+
+        auto driver = join_driver<TComps...>();
+        if (!driver) {
+            return;
         }
+
+        jobs.parallel_for(0, driver->population(), grain, [&](size_t begin, size_t end) {
+            for (size_t position = begin; position < end; ++position) {
+                auto index = driver->index_at(position);
+                call_if_all_not_null(func, component_at_index<TComps>(index)...);
+            }
+        });
+    }
+
+    // Returns the array with the fewest live components among TComps, or
+    // nullptr if any of them has no components at all.
+    template<typename... TComps>
+    ComponentArray *EntityManager::join_driver() {
+        ComponentArray *arrays[] = { component_array<TComps>()... };
+
+        ComponentArray *driver = nullptr;
+        for (auto array : arrays) {
+            if (!array || !array->population()) {
+                return nullptr;
+            }
+            if (!driver || array->population() < driver->population()) {
+                driver = array;
+            }
+        }
+
+        return driver;
+    }
+
+    template<typename TComp>
+    ComponentArray *EntityManager::component_array() {
+        auto index = TComp::register_type();
+        return index < _components.size() ? &_components[index] : nullptr;
+    }
+
+    template<typename TComp>
+    TComp *EntityManager::component_at_index(size_t entity_index) {
+        auto index = TComp::register_type();
+        if (index >= _components.size() || entity_index >= _components[index].template size<TComp>()) {
+            return nullptr;
+        }
+
+        return _components[index].template at<TComp>(entity_index);
     }
 
     template<typename TComp>
@@ -1,19 +1,16 @@
 #ifndef __ROSEWOOD_CORE_EVENT_H__
 #define __ROSEWOOD_CORE_EVENT_H__
 
-#include <functional>
+#include <stddef.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <unordered_map>
-#include <tuple>
+#include <utility>
 #include <vector>
-#include <algorithm>
-
-namespace std {
-    template<typename T1, typename T2> struct hash<tuple<T1, T2>> {
-        size_t operator()(const tuple<T1, T2> &t) const {
-            return hash<T1>()(get<0>(t)) ^ hash<T2>()(get<1>(t));
-        }
-    };
-}
 
 namespace rosewood { namespace core {
 
@@ -24,6 +21,8 @@ namespace rosewood { namespace core {
         static EventTypeCode _type_code_counter;
     };
 
+    // Type codes are handed out densely from zero, so they can index
+    // tables directly
     template<typename Derived>
     struct Event : public BaseEvent {
         static EventTypeCode type_code() {
@@ -32,105 +31,467 @@ namespace rosewood { namespace core {
         }
     };
 
+    template<typename THandler, typename TListener, typename TSender, typename TEvent>
+    typename std::enable_if<std::is_member_function_pointer<THandler>::value>::type
+    invoke_event_handler(const THandler &handler, TListener *listener, TSender sender, const TEvent *event) {
+        (listener->*handler)(sender, event);
+    }
+
+    template<typename THandler, typename TListener, typename TSender, typename TEvent>
+    typename std::enable_if<!std::is_member_function_pointer<THandler>::value>::type
+    invoke_event_handler(const THandler &handler, TListener *listener, TSender sender, const TEvent *event) {
+        handler(listener, sender, event);
+    }
+
+    // A listener and its handler behind one plain function pointer call.
+    // Member function pointers, function pointers and small lambdas are
+    // stored inline; anything larger is allocated once when the listener
+    // is added.
+    template<typename TSender>
+    class EventDelegate {
+    public:
+        template<typename TEvent, typename TListener, typename THandler>
+        static EventDelegate make(TListener *listener, const THandler &handler) {
+            typedef std::integral_constant<bool,
+                sizeof(THandler) <= sizeof(Storage)
+                && std::alignment_of<THandler>::value <= std::alignment_of<Storage>::value
+                && std::is_trivially_copyable<THandler>::value
+                && std::is_trivially_destructible<THandler>::value> fits_inline;
+
+            EventDelegate delegate;
+            delegate._listener = listener;
+            delegate.store<TEvent, TListener>(handler, fits_inline());
+            return delegate;
+        }
+
+        const void *listener() const { return _listener; }
+
+        bool is_removed() const { return !_call; }
+        void mark_removed() { _call = nullptr; }
+
+        void operator()(TSender sender, const BaseEvent *event) const {
+            _call(&_storage, _listener, sender, event);
+        }
+
+    private:
+        typedef void (*CallFunction)(const void *storage, void *listener, TSender sender, const BaseEvent *event);
+        typedef typename std::aligned_storage<2 * sizeof(void*), std::alignment_of<void*>::value>::type Storage;
+
+        Storage _storage;
+        void *_listener;
+        CallFunction _call;
+        std::shared_ptr<void> _owned;
+
+        template<typename TEvent, typename TListener, typename THandler>
+        void store(const THandler &handler, std::true_type) {
+            new(&_storage) THandler(handler);
+            _call = [](const void *storage, void *listener, TSender sender, const BaseEvent *event) {
+                invoke_event_handler(*static_cast<const THandler*>(storage),
+                                     static_cast<TListener*>(listener), sender,
+                                     static_cast<const TEvent*>(event));
+            };
+        }
+
+        template<typename TEvent, typename TListener, typename THandler>
+        void store(const THandler &handler, std::false_type) {
+            auto owned = std::make_shared<THandler>(handler);
+            new(&_storage) const THandler*(owned.get());
+            _owned = std::move(owned);
+            _call = [](const void *storage, void *listener, TSender sender, const BaseEvent *event) {
+                invoke_event_handler(**static_cast<const THandler* const*>(storage),
+                                     static_cast<TListener*>(listener), sender,
+                                     static_cast<const TEvent*>(event));
+            };
+        }
+    };
+
+    // Delivers events from senders to listeners. Handlers are either
+    // member functions of the listener taking (TSender, const TEvent*), or
+    // callables taking (TListener*, TSender, const TEvent*).
+    //
+    // Listeners are kept in one table per event type, indexed by the type
+    // code, so sending an event is an array lookup, a hash lookup on the
+    // sender if anyone listens to specific senders, and one indirect call
+    // per listener. Listeners may be added and removed from inside a
+    // handler: new listeners don't see the event being sent, and removed
+    // ones are skipped.
     template<typename TSender>
     class EventManager {
     public:
+        EventManager() : _dispatch_depth(0) { }
+
+        EventManager(const EventManager&) = delete;
+        EventManager &operator=(const EventManager&) = delete;
+
+        // Listen to events of type TEvent from one sender
         template<typename TEvent, typename TListener, typename THandler>
         void add_listener(TSender sender, TListener *listener, const THandler &handler);
 
+        // Listen to events of type TEvent from every sender
         template<typename TEvent, typename TListener, typename THandler>
         void add_listener(TListener *listener, const THandler &handler);
 
         template<typename TEvent>
         void send_event(TSender sender, const TEvent &event);
 
+        // Copies the event into this frame's queue instead of delivering
+        // it. Queues keep their memory between frames, so this does not
+        // allocate once they have grown to a frame's worth of events.
+        template<typename TEvent>
+        void queue_event(TSender sender, const TEvent &event);
+
+        // Delivers every queued event, one event type at a time in the
+        // order the types were first queued, and events of one type in the
+        // order they were queued. Events queued by the handlers are left
+        // for the next call. Meant to be called once per frame.
+        void deliver_queued_events();
+
         template<typename TListener>
         void remove_listener(const TListener *listener);
 
-        typedef std::tuple<TSender, EventTypeCode> SenderEventTuple;
-        typedef std::function<void(TSender, void*, const BaseEvent*)> GenericHandler;
-        typedef std::tuple<void*, GenericHandler> ListenerHandlerTuple;
-
     private:
-        // Mapping from (sender, event) -> [ (listener, handler) ]
-        std::unordered_map<SenderEventTuple, std::vector<ListenerHandlerTuple>> _handlers;
+        typedef EventDelegate<TSender> Delegate;
+
+        struct IEventQueue {
+            virtual ~IEventQueue() { }
+            virtual void deliver(EventManager *manager) = 0;
+        };
 
-        // Mapping from event -> [ (global listener, handler) ]
-        std::unordered_map<EventTypeCode, std::vector<ListenerHandlerTuple>> _global_handlers;
+        template<typename TEvent>
+        struct EventQueue : public IEventQueue {
+            std::vector<std::pair<TSender, TEvent>> queued;
+            std::vector<std::pair<TSender, TEvent>> delivering;
+
+            virtual void deliver(EventManager *manager) override {
+                std::swap(queued, delivering);
+
+                auto &table = *manager->_tables[TEvent::type_code()];
+                for (const auto &pair : delivering) {
+                    manager->dispatch(table, pair.first, &pair.second);
+                }
+
+                delivering.clear();
+            }
+        };
+
+        struct ListenerTable {
+            std::vector<Delegate> global;
+            std::unordered_map<TSender, std::vector<Delegate>> by_sender;
+            std::unique_ptr<IEventQueue> queue;
+        };
+
+        // Where a listener was added, so that removing it does not have to
+        // look through every table
+        struct Registration {
+            EventTypeCode type_code;
+            bool is_global;
+            TSender sender;
+        };
+
+        std::vector<std::unique_ptr<ListenerTable>> _tables;
+        std::unordered_map<const void*, std::vector<Registration>> _registrations;
+
+        std::vector<EventTypeCode> _queued_types;
+        std::vector<EventTypeCode> _delivering_types;
+
+        size_t _dispatch_depth;
+        std::vector<Registration> _pending_prunes;
+
+        ListenerTable &table(EventTypeCode type_code);
+        const ListenerTable *find_table(EventTypeCode type_code) const;
+        std::vector<Delegate> *find_delegates(const Registration &registration);
+
+        void add_registration(const void *listener, const Registration &registration);
+        void dispatch(const ListenerTable &table, TSender sender, const BaseEvent *event);
+        void prune(const Registration &registration);
     };
 
     template<typename TSender>
     template<typename TEvent, typename TListener, typename THandler>
     void EventManager<TSender>::add_listener(TSender sender, TListener *listener,
                                              const THandler &handler) {
-        typedef std::function<void(TListener*, TSender, const TEvent*)> THandlerFn;
+        auto type_code = TEvent::type_code();
 
-        THandlerFn handler_fn = handler;
-        auto gen_handler = [handler_fn](TSender sender, void *listener, const BaseEvent *event) {
-            handler_fn(static_cast<TListener*>(listener),
-                       static_cast<TSender>(sender),
-                       static_cast<const TEvent*>(event));
-        };
-
-        auto se_tuple = SenderEventTuple(sender, TEvent::type_code());
-        auto lh_tuple = ListenerHandlerTuple(listener, gen_handler);
-
-        _handlers[se_tuple].emplace_back(lh_tuple);
+        table(type_code).by_sender[sender].push_back(Delegate::template make<TEvent>(listener, handler));
+        add_registration(listener, Registration{type_code, false, sender});
     }
 
     template<typename TSender>
     template<typename TEvent, typename TListener, typename THandler>
     void EventManager<TSender>::add_listener(TListener *listener,
                                              const THandler &handler) {
-        typedef std::function<void(TListener*, TSender, const TEvent*)> THandlerFn;
-
-        THandlerFn handler_fn = handler;
-        auto gen_handler = [handler_fn](TSender sender, void *listener, const BaseEvent *event) {
-            handler_fn(static_cast<TListener*>(listener),
-                       static_cast<TSender>(sender),
-                       static_cast<const TEvent*>(event));
-        };
+        auto type_code = TEvent::type_code();
 
-        auto lh_tuple = ListenerHandlerTuple(listener, gen_handler);
-
-        _global_handlers[TEvent::type_code()].emplace_back(lh_tuple);
+        table(type_code).global.push_back(Delegate::template make<TEvent>(listener, handler));
+        add_registration(listener, Registration{type_code, true, TSender()});
     }
 
     template<typename TSender>
     template<typename TEvent>
     void EventManager<TSender>::send_event(TSender sender, const TEvent &event) {
-        auto se_tuple = SenderEventTuple(sender, TEvent::type_code());
-        for (auto &lh_tuple : _handlers[se_tuple]) {
-            auto listener = std::get<0>(lh_tuple);
-            auto &handler = std::get<1>(lh_tuple);
-            handler(sender, listener, &event);
+        auto table = find_table(TEvent::type_code());
+        if (table) {
+            dispatch(*table, sender, &event);
+        }
+    }
+
+    template<typename TSender>
+    template<typename TEvent>
+    void EventManager<TSender>::queue_event(TSender sender, const TEvent &event) {
+        auto type_code = TEvent::type_code();
+        auto &queue_table = table(type_code);
+
+        if (!queue_table.queue) {
+            queue_table.queue.reset(new EventQueue<TEvent>());
+        }
+
+        auto &queue = static_cast<EventQueue<TEvent>&>(*queue_table.queue);
+        if (queue.queued.empty()) {
+            _queued_types.push_back(type_code);
         }
 
-        for (auto &lh_tuple : _global_handlers[TEvent::type_code()]) {
-            auto listener = std::get<0>(lh_tuple);
-            auto &handler = std::get<1>(lh_tuple);
-            handler(sender, listener, &event);
+        queue.queued.emplace_back(sender, event);
+    }
+
+    template<typename TSender>
+    void EventManager<TSender>::deliver_queued_events() {
+        std::swap(_queued_types, _delivering_types);
+
+        for (auto type_code : _delivering_types) {
+            _tables[type_code]->queue->deliver(this);
         }
+
+        _delivering_types.clear();
     }
 
     template<typename TSender>
     template<typename TListener>
     void EventManager<TSender>::remove_listener(const TListener *listener) {
-        for (auto &pair : _handlers) {
-            auto new_begin = std::remove_if(begin(pair.second), end(pair.second),
-                                            [listener](ListenerHandlerTuple &lh_tuple) {
-                                                return std::get<0>(lh_tuple) == listener;
-                                            });
-            pair.second.erase(new_begin, end(pair.second));
+        auto it = _registrations.find(listener);
+        if (it == end(_registrations)) return;
+
+        for (const auto &registration : it->second) {
+            auto delegates = find_delegates(registration);
+            if (!delegates) continue;
+
+            for (auto &delegate : *delegates) {
+                if (delegate.listener() == listener) {
+                    delegate.mark_removed();
+                }
+            }
+
+            // Handlers might be iterating over this list right now
+            if (_dispatch_depth) {
+                _pending_prunes.push_back(registration);
+            }
+            else {
+                prune(registration);
+            }
+        }
+
+        _registrations.erase(it);
+    }
+
+    template<typename TSender>
+    typename EventManager<TSender>::ListenerTable &EventManager<TSender>::table(EventTypeCode type_code) {
+        if (type_code >= _tables.size()) {
+            _tables.resize(type_code + 1);
+        }
+
+        auto &table = _tables[type_code];
+        if (!table) {
+            table.reset(new ListenerTable());
+        }
+
+        return *table;
+    }
+
+    template<typename TSender>
+    const typename EventManager<TSender>::ListenerTable *EventManager<TSender>::find_table(EventTypeCode type_code) const {
+        return type_code < _tables.size() ? _tables[type_code].get() : nullptr;
+    }
+
+    template<typename TSender>
+    std::vector<typename EventManager<TSender>::Delegate> *
+    EventManager<TSender>::find_delegates(const Registration &registration) {
+        auto &table = *_tables[registration.type_code];
+        if (registration.is_global) {
+            return &table.global;
+        }
+
+        auto it = table.by_sender.find(registration.sender);
+        return it == end(table.by_sender) ? nullptr : &it->second;
+    }
+
+    template<typename TSender>
+    void EventManager<TSender>::add_registration(const void *listener, const Registration &registration) {
+        auto &registrations = _registrations[listener];
+
+        for (const auto &existing : registrations) {
+            if (existing.type_code == registration.type_code
+                && existing.is_global == registration.is_global
+                && existing.sender == registration.sender) {
+                return;
+            }
+        }
+
+        registrations.push_back(registration);
+    }
+
+    template<typename TSender>
+    void EventManager<TSender>::dispatch(const ListenerTable &table, TSender sender, const BaseEvent *event) {
+        ++_dispatch_depth;
+
+        // Lists are indexed rather than iterated since handlers may add
+        // listeners, and sized up front so those don't receive this event.
+        // Adding a listener can also reallocate the list, so each delegate
+        // is copied out before it's called; an inline handler would
+        // otherwise be moved away from under itself.
+        if (!table.by_sender.empty()) {
+            auto it = table.by_sender.find(sender);
+            if (it != end(table.by_sender)) {
+                const auto &delegates = it->second;
+                for (size_t i = 0, count = delegates.size(); i < count; ++i) {
+                    if (delegates[i].is_removed()) continue;
+
+                    auto delegate = delegates[i];
+                    delegate(sender, event);
+                }
+            }
         }
 
-        for (auto &pair : _global_handlers) {
-            auto new_begin = std::remove_if(begin(pair.second), end(pair.second),
-                                            [listener](ListenerHandlerTuple &lh_tuple) {
-                                                return std::get<0>(lh_tuple) == listener;
-                                            });
-            pair.second.erase(new_begin, end(pair.second));
+        const auto &delegates = table.global;
+        for (size_t i = 0, count = delegates.size(); i < count; ++i) {
+            if (delegates[i].is_removed()) continue;
+
+            auto delegate = delegates[i];
+            delegate(sender, event);
         }
+
+        if (!--_dispatch_depth && !_pending_prunes.empty()) {
+            for (const auto &registration : _pending_prunes) {
+                prune(registration);
+            }
+            _pending_prunes.clear();
+        }
+    }
+
+    template<typename TSender>
+    void EventManager<TSender>::prune(const Registration &registration) {
+        auto delegates = find_delegates(registration);
+        if (!delegates) return;
+
+        delegates->erase(std::remove_if(begin(*delegates), end(*delegates),
+                                        [](const Delegate &delegate) { return delegate.is_removed(); }),
+                         end(*delegates));
+
+        if (!registration.is_global && delegates->empty()) {
+            _tables[registration.type_code]->by_sender.erase(registration.sender);
+        }
+    }
+
+    // Carries events from any number of threads to the thread that owns an
+    // EventManager. send_event takes no lock: it allocates a node and links
+    // it into an intrusive MPSC list with one atomic exchange. The owning
+    // thread calls dispatch at a fixed point in the frame, which sends
+    // everything queued so far in the order it was queued, so events of one
+    // type keep their order per producer.
+    template<typename TSender>
+    class EventChannel {
+    public:
+        EventChannel();
+        ~EventChannel();
+
+        EventChannel(const EventChannel&) = delete;
+        EventChannel &operator=(const EventChannel&) = delete;
+
+        // Safe to call from any thread
+        template<typename TEvent>
+        void send_event(TSender sender, const TEvent &event);
+
+        // Owning thread only. Events sent while dispatching, including by
+        // the handlers, wait for the next call. Returns the number of
+        // events sent.
+        size_t dispatch(EventManager<TSender> *events);
+
+    private:
+        struct Node {
+            std::atomic<Node*> next;
+            void (*send)(Node *node, EventManager<TSender> *events);
+            void (*destroy)(Node *node);
+        };
+
+        template<typename TEvent>
+        struct EventNode : public Node {
+            TSender sender;
+            TEvent event;
+
+            EventNode(TSender sender, const TEvent &event) : sender(sender), event(event) { }
+        };
+
+        // Producers only touch the head and the consumer only the tail, so
+        // keep them on separate cache lines
+        std::atomic<Node*> _head;
+        char _padding[64];
+        Node *_tail;
+        Node _stub;
+
+        void retire(Node *node) {
+            if (node != &_stub) node->destroy(node);
+        }
+    };
+
+    template<typename TSender>
+    EventChannel<TSender>::EventChannel() : _head(&_stub), _tail(&_stub) {
+        _stub.next.store(nullptr, std::memory_order_relaxed);
+        _stub.send = nullptr;
+        _stub.destroy = nullptr;
+    }
+
+    template<typename TSender>
+    EventChannel<TSender>::~EventChannel() {
+        while (_tail) {
+            auto next = _tail->next.load(std::memory_order_acquire);
+            retire(_tail);
+            _tail = next;
+        }
+    }
+
+    template<typename TSender>
+    template<typename TEvent>
+    void EventChannel<TSender>::send_event(TSender sender, const TEvent &event) {
+        auto node = new EventNode<TEvent>(sender, event);
+        node->next.store(nullptr, std::memory_order_relaxed);
+        node->send = [](Node *node, EventManager<TSender> *events) {
+            auto event_node = static_cast<EventNode<TEvent>*>(node);
+            events->send_event(event_node->sender, event_node->event);
+        };
+        node->destroy = [](Node *node) { delete static_cast<EventNode<TEvent>*>(node); };
+
+        // Until the link below is stored the consumer sees the list end at
+        // prev, and simply picks this event up on its next dispatch
+        auto prev = _head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    template<typename TSender>
+    size_t EventChannel<TSender>::dispatch(EventManager<TSender> *events) {
+        auto last = _head.load(std::memory_order_acquire);
+        size_t count = 0;
+
+        while (_tail != last) {
+            auto next = _tail->next.load(std::memory_order_acquire);
+            if (!next) break;
+
+            // The sent node stays as the list's sentinel until the next one
+            // is taken
+            next->send(next, events);
+            retire(_tail);
+            _tail = next;
+            ++count;
+        }
+
+        return count;
     }
 
 } }
@@ -0,0 +1,72 @@
+#ifndef __ROSEWOOD_CORE_JOB_SYSTEM_H__
+#define __ROSEWOOD_CORE_JOB_SYSTEM_H__
+
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rosewood { namespace core {
+
+    // A fixed pool of worker threads with one job deque per thread.
+    // Threads pop jobs from the back of their own deque and steal from the
+    // front of the other deques when they run dry. A thread calling
+    // parallel_for helps running jobs until all of its jobs have finished,
+    // so nested parallel_for calls from inside a job are fine.
+    class JobSystem {
+    public:
+        typedef std::function<void(size_t begin, size_t end)> RangeFunction;
+
+        // The thread count includes the calling thread: a JobSystem with a
+        // thread count of 1 starts no threads and runs everything inline.
+        explicit JobSystem(size_t thread_count = default_thread_count());
+        ~JobSystem();
+
+        size_t thread_count() const { return _queues.size(); }
+
+        // Splits [begin, end) into ranges of at most `grain` elements and
+        // runs func on them in parallel. Returns when all ranges are done.
+        void parallel_for(size_t begin, size_t end, size_t grain, const RangeFunction &func);
+
+        static size_t default_thread_count();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem &operator=(const JobSystem&) = delete;
+
+    private:
+        struct Job {
+            const RangeFunction *func;
+            size_t begin;
+            size_t end;
+            std::atomic<size_t> *pending;
+        };
+
+        struct JobQueue {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+        };
+
+        // Queue 0 is shared by all threads that are not workers
+        std::vector<std::unique_ptr<JobQueue>> _queues;
+        std::vector<std::thread> _threads;
+
+        std::mutex _wake_mutex;
+        std::condition_variable _wake;
+        std::atomic<size_t> _queued_jobs;
+        bool _stopping;
+
+        void worker_main(size_t queue_index);
+        size_t current_queue_index() const;
+        bool pop_or_steal(size_t queue_index, Job *out_job);
+        void run(const Job &job);
+    };
+
+} }
+
+#endif
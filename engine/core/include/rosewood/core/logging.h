@@ -7,10 +7,20 @@
 #define WARNING rosewood::core::LogLevel::kWarningLevel
 #define ERROR rosewood::core::LogLevel::kErrorLevel
 
-#define LOG(level, ...) rosewood::core::LogWriter(level, __FILE__, __LINE__, ##__VA_ARGS__)
+// Messages below this level are compiled out, arguments and all
+#ifndef RW_MIN_LOG_LEVEL
+#define RW_MIN_LOG_LEVEL 0
+#endif
+
+// An expression rather than an if/else, so that an unbraced
+// `if (x) LOG(...) << ...; else ...` keeps its else
+#define LOG(level, ...) \
+	!rosewood::core::is_log_level_enabled(level) ? (void)0 \
+	: rosewood::core::LogVoidify() & rosewood::core::LogWriter(level, __FILE__, __LINE__, ##__VA_ARGS__)
 #define LOG_STMT(stmt) LOG(STMT, #stmt); stmt
 
-#include <string>
+#include <stddef.h>
+
 #include <sstream>
 
 namespace rosewood { namespace core {
@@ -23,9 +33,20 @@ namespace rosewood { namespace core {
 			kErrorLevel = 50
 		};
 
+		// Formats one message and hands it to the logging thread, which
+		// writes it to stderr. Each thread queues into its own ring buffer
+		// without locking; only a thread that fills its ring waits, while it
+		// writes the queued messages out itself.
+		//
+		// Messages below ERROR from one call site are rate limited: after
+		// kRateLimitBurst messages in a second the rest are dropped, and
+		// the next one to get through says how many were. Errors are
+		// always written.
 		class LogWriter {
 		public:
-			LogWriter(LogLevel level, const std::string &file, int line, const std::string &message = "");
+			static const size_t kRateLimitBurst = 20;
+
+			LogWriter(LogLevel level, const char *file, int line, const char *message = nullptr);
 
 			~LogWriter();
 
@@ -40,13 +61,28 @@ namespace rosewood { namespace core {
 			bool _enabled;
 			LogLevel _level;
 
-			std::string _file;
+			const char *_file;
 			int _line;
+			size_t _suppressed;
 
 			std::ostringstream _stream;
 
 		};
 
+		// Binds looser than << but tighter than ?:, turning the whole
+		// stream expression in LOG into void
+		struct LogVoidify {
+			void operator&(const LogWriter&) { }
+		};
+
+		inline bool is_log_level_enabled(LogLevel level) {
+			return (int)level >= RW_MIN_LOG_LEVEL && level >= LogWriter::gLogLevel;
+		}
+
+		// Blocks until every message logged so far has been written. Called
+		// before aborting on a failed assertion.
+		void flush_log();
+
 } }
 
 #endif
@@ -0,0 +1,123 @@
+#ifndef __ROSEWOOD_CORE_METRICS_H__
+#define __ROSEWOOD_CORE_METRICS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <string>
+
+namespace rosewood { namespace core { namespace metrics {
+
+    // Counters and gauges share one index space, histograms have their own
+    static const size_t kMaxMetrics = 256;
+    static const size_t kMaxHistograms = 32;
+
+    // Number of frames the rolling windows cover
+    static const size_t kWindowFrames = 120;
+
+    // Metrics are registered by name when the handle is constructed,
+    // normally as a global in the subsystem that writes it. Handles with
+    // the same name share one metric.
+    //
+    // Writes go to a shard owned by the calling thread, so they are plain
+    // stores with no locking or atomic read-modify-write. end_frame folds
+    // the shards into per-frame values and the rolling windows; reading
+    // takes the registry's lock and is meant for tools and debug displays.
+
+    // Summed over each frame
+    class Counter {
+    public:
+        explicit Counter(const char *name);
+
+        void increment(uint64_t amount = 1) const;
+
+        // Everything ever counted, including by threads that have exited
+        uint64_t total() const;
+
+        // Counted since the last end_frame
+        uint64_t current_frame() const;
+
+        uint64_t last_frame() const;
+        double window_average() const;
+
+        const char *name() const { return _name; }
+
+    private:
+        const char *_name;
+        size_t _index;
+    };
+
+    // Holds the last value set, sampled at the end of every frame
+    class Gauge {
+    public:
+        explicit Gauge(const char *name);
+
+        void set(double value) const;
+        double value() const;
+
+        double window_average() const;
+        double window_max() const;
+
+        const char *name() const { return _name; }
+
+    private:
+        const char *_name;
+        size_t _index;
+    };
+
+    // Distribution of recorded values over the rolling window. Values are
+    // bucketed logarithmically, eight buckets per power of two, so
+    // percentiles are accurate to within about 6%.
+    class Histogram {
+    public:
+        explicit Histogram(const char *name);
+
+        void record(double value) const;
+
+        // p in [0, 1]. Returns 0 if nothing was recorded in the window.
+        double percentile(double p) const;
+        uint64_t window_count() const;
+
+        const char *name() const { return _name; }
+
+    private:
+        const char *_name;
+        size_t _index;
+    };
+
+    // Records the time until the end of the scope, in microseconds
+    class ScopedLatency {
+    public:
+        explicit ScopedLatency(const Histogram &histogram)
+        : _histogram(histogram), _start(std::chrono::steady_clock::now()) { }
+
+        ~ScopedLatency() {
+            auto elapsed = std::chrono::steady_clock::now() - _start;
+            _histogram.record(std::chrono::duration<double, std::micro>(elapsed).count());
+        }
+
+        ScopedLatency(const ScopedLatency&) = delete;
+        ScopedLatency &operator=(const ScopedLatency&) = delete;
+
+    private:
+        const Histogram &_histogram;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+    // Time between consecutive calls to end_frame
+    extern const Histogram frame_time_usec;
+
+    // Closes the current frame: folds every thread's writes into the
+    // windows, samples the gauges and records the frame time. Called once
+    // per frame by utils::mark_frame_beginning.
+    void end_frame();
+
+    // Returns nullptr if nothing registered that name
+    const Counter *find_counter(const std::string &name);
+    const Gauge *find_gauge(const std::string &name);
+    const Histogram *find_histogram(const std::string &name);
+
+} } }
+
+#endif
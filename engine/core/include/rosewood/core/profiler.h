@@ -0,0 +1,89 @@
+#ifndef __ROSEWOOD_CORE_PROFILER_H__
+#define __ROSEWOOD_CORE_PROFILER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+// Builds defining this to 0 compile every profile scope out
+#ifndef RW_ENABLE_PROFILER
+#define RW_ENABLE_PROFILER 1
+#endif
+
+#define RW_PROFILE_CONCAT_INNER(a, b) a##b
+#define RW_PROFILE_CONCAT(a, b) RW_PROFILE_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing scope. `name` must be a string literal,
+// conventionally "subsystem.what", e.g. RW_PROFILE_SCOPE("render.sort").
+#if RW_ENABLE_PROFILER
+#define RW_PROFILE_SCOPE(name) \
+    ::rosewood::core::profiler::ProfileScope RW_PROFILE_CONCAT(rw_profile_scope_, __LINE__)(name)
+#else
+#define RW_PROFILE_SCOPE(name) do { } while (0)
+#endif
+
+namespace rosewood { namespace core { namespace profiler {
+
+    // Frames with the longest durations among roughly the last
+    // kCaptureWindowFrames are kept with all their scopes
+    static const size_t kSlowestFrameCount = 8;
+    static const size_t kCaptureWindowFrames = 600;
+
+    extern std::atomic<bool> gProfilerEnabled;
+
+    // Off by default; while off a scope costs one relaxed load
+    void set_enabled(bool enabled);
+    inline bool is_enabled() { return gProfilerEnabled.load(std::memory_order_relaxed); }
+
+    inline uint64_t now_nsec() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Appends a finished scope to the calling thread's buffer. Scopes past
+    // what the buffer holds between two end_frame calls are dropped and
+    // counted.
+    void record(const char *name, uint64_t start_nsec, uint64_t end_nsec);
+
+    class ProfileScope {
+    public:
+        explicit ProfileScope(const char *name)
+        : _name(is_enabled() ? name : nullptr), _start(_name ? now_nsec() : 0) { }
+
+        ~ProfileScope() {
+            if (_name) record(_name, _start, now_nsec());
+        }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope &operator=(const ProfileScope&) = delete;
+
+    private:
+        const char *_name;
+        uint64_t _start;
+    };
+
+    // Shown in the trace instead of the thread's number. The string is
+    // kept, so pass a literal.
+    void set_thread_name(const char *name);
+
+    // Collects every thread's scopes into the frame that just ended and
+    // keeps it if it is among the slowest. Called once per frame by
+    // utils::mark_frame_beginning.
+    void end_frame();
+
+    // The captured frames as Chrome trace_event JSON, for chrome://tracing
+    // or Perfetto. Each frame is also an event on its own "frames" track.
+    std::string chrome_trace();
+    bool write_chrome_trace(const std::string &path);
+
+    void clear_capture();
+
+    // Scopes lost because a thread's buffer filled up within a frame
+    size_t dropped_scope_count();
+
+} } }
+
+#endif
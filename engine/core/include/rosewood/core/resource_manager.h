@@ -1,6 +1,7 @@
 #ifndef __ROSEWOOD_CORE_RESOURCE_MANAGER_H__
 #define __ROSEWOOD_CORE_RESOURCE_MANAGER_H__
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <functional>
@@ -11,14 +12,27 @@
 namespace rosewood { namespace core {
     
     class AssetView;
+    class ResourceCache;
+
+    namespace stats {
+        struct AssetTypeStats;
+    }
     
     class Asset {
     public:
-        Asset(const std::string &file_contents);
+        Asset(std::string file_contents);
 
         const std::string &str() const;
         
         void set_file_contents(const std::string &file_contents);
+
+        // Called by users of the asset once they have decoded the
+        // contents. If the resource cache drops decoded contents they are
+        // freed here, and read again when the asset is next requested.
+        // While views are being told about new contents, the contents are
+        // only freed once every view has been notified.
+        void did_decode();
+        bool has_contents() const { return !_contents_dropped; }
         
         Asset(const Asset&) = delete;
         Asset &operator=(const Asset&) = delete;
@@ -26,7 +40,19 @@ namespace rosewood { namespace core {
     private:
         std::vector<std::weak_ptr<AssetView>> _views;
         std::string _file_contents;
+        bool _contents_dropped;
+
+        // Set by set_file_contents() while it notifies the views, and by
+        // did_decode() calls made meanwhile
+        bool _notifying_views;
+        bool _decoded_while_notifying;
+
+        // Set while the asset is held by the resource cache
+        stats::AssetTypeStats *_type_stats;
 
+        void replace_contents(std::string file_contents);
+
+        friend class ResourceCache;
         friend std::shared_ptr<AssetView> create_view(const std::shared_ptr<Asset> &asset,
                                                       const std::function<void()> &change_callback);
     };
@@ -37,6 +63,7 @@ namespace rosewood { namespace core {
                   const std::function<void()> &change_callback);
         
         const std::string &str() const;
+        void did_decode() const;
         
         AssetView(const AssetView&) = delete;
         AssetView &operator=(const AssetView&) = delete;
@@ -57,15 +84,38 @@ namespace rosewood { namespace core {
         struct timespec mtime;
     };
     
+    // Loaders are also called from the resource loading threads, so they
+    // must be safe to use from several threads at once
     class IResourceLoader {
     public:
         virtual ~IResourceLoader() = 0;
         
         virtual FileInfo find_file(std::string path) const = 0;
         virtual std::string read_file(std::string path) const = 0;
+
+        // Appends the paths of files changed since the last call, for
+        // loaders that watch their files. Only called from the thread
+        // calling reload_changed_resources().
+        virtual void collect_changed_files(std::vector<std::string> *out_paths);
     };
     
     void add_resource_loader(std::unique_ptr<IResourceLoader> loader);
+
+    // Loaded assets stay in the resource cache after their last user lets
+    // go of them, and are freed least recently released first once the
+    // contents of all cached assets exceed the budget. Assets in use count
+    // towards the budget but are never freed.
+    struct ResourceCacheOptions {
+        size_t budget_bytes;
+        bool drop_decoded_contents;
+    };
+
+    void set_resource_cache_options(const ResourceCacheOptions &options);
+    const ResourceCacheOptions &resource_cache_options();
+
+    // Frees released assets until the cache is within its budget. Also
+    // done by commit_loaded_resources() and whenever an asset is loaded.
+    void trim_resource_cache();
     
     std::shared_ptr<Asset> get_resource(std::string path);
     std::shared_ptr<AssetView> create_view(const std::shared_ptr<Asset> &asset,
@@ -73,6 +123,84 @@ namespace rosewood { namespace core {
 
     
     void notify_file_changed(std::string path);
+
+    // Collects the files changed according to the loaders, and reloads the
+    // loaded assets among them once no new change has been seen for
+    // `quiet_usec`, so that a file written in several steps is reloaded
+    // once. Meant to be called once per frame.
+    void reload_changed_resources(double quiet_usec);
+
+    enum class LoadPriority {
+        Low,
+        Normal,
+        High,
+    };
+
+    // Handle to a load started by get_resource_async()
+    class ResourceRequest {
+    public:
+        ResourceRequest(std::string path, LoadPriority priority);
+
+        const std::string &path() const { return _path; }
+        LoadPriority priority() const { return _priority; }
+
+        // Set by commit_loaded_resources() right before the request's
+        // callback runs, so only meaningful on the thread committing the
+        // loads. The asset is null if the file could not be found.
+        bool is_done() const { return _done; }
+        std::shared_ptr<Asset> asset() const { return _asset; }
+
+        // A cancelled request is skipped by the loading threads if they
+        // have not read it yet, and its callback never runs
+        void cancel() { _cancelled = true; }
+        bool is_cancelled() const { return _cancelled; }
+
+        ResourceRequest(const ResourceRequest&) = delete;
+        ResourceRequest &operator=(const ResourceRequest&) = delete;
+
+    private:
+        std::string _path;
+        LoadPriority _priority;
+        std::atomic<bool> _cancelled;
+
+        bool _done;
+        std::shared_ptr<Asset> _asset;
+
+        friend size_t commit_loaded_resources(double budget_usec);
+    };
+
+    // Runs on a loading thread with the contents of the file, and returns
+    // whatever the callback needs to finish the load, e.g. decoded pixels
+    typedef std::function<std::shared_ptr<void>(const std::string &file_contents)> ResourceDecodeFunction;
+
+    typedef std::function<void(const std::shared_ptr<Asset> &asset)> ResourceCallback;
+    typedef std::function<void(const std::shared_ptr<Asset> &asset,
+                               const std::shared_ptr<void> &decoded)> DecodedResourceCallback;
+
+    // Number of threads reading and decoding files for get_resource_async(),
+    // started by its first call
+    const size_t kResourceLoaderThreadCount = 2;
+
+    // Reads the file on a loading thread, higher priorities first, and
+    // calls `on_loaded` from commit_loaded_resources(). Assets that are
+    // already loaded are not read again, but still wait for the commit.
+    std::shared_ptr<ResourceRequest> get_resource_async(std::string path,
+                                                        ResourceCallback on_loaded,
+                                                        LoadPriority priority = LoadPriority::Normal);
+
+    // Like above, but also runs `decode` on the loading thread. It is not
+    // called for files that could not be found.
+    std::shared_ptr<ResourceRequest> get_resource_async(std::string path,
+                                                        ResourceDecodeFunction decode,
+                                                        DecodedResourceCallback on_loaded,
+                                                        LoadPriority priority = LoadPriority::Normal);
+
+    // Publishes finished loads and runs their callbacks on the calling
+    // thread, oldest first, until `budget_usec` has passed. Meant to be
+    // called once per frame from the thread owning the GL context, so the
+    // callbacks can upload what was decoded. At least one load is
+    // committed per call. Returns the number of loads left waiting.
+    size_t commit_loaded_resources(double budget_usec);
     
 } }
 
@@ -3,28 +3,47 @@
 
 #include <stddef.h>
 
+#include <string>
+
+#include "rosewood/core/metrics.h"
+
 namespace rosewood { namespace core {
 
     namespace stats {
 
-        template<typename T>
-        class Counter {
-        public:
-            T read() const { return _count; }
-            void increment() { _count += T(1); }
-            void increment(T amount) { _count += amount; }
-            void reset() { _count = T(0); }
-
-        private:
-            T _count;
+        // Resource cache activity for one type of asset. The lookups and
+        // evictions are registry counters named e.g. "resources.png.hits",
+        // since lookups happen on the resource loading threads too. The
+        // resident sizes are only touched by the resource cache.
+        struct AssetTypeStats {
+            explicit AssetTypeStats(const std::string &type);
+
+            // The registry keeps pointers to the names, so they live here,
+            // declared before the counters
+            const std::string hits_name;
+            const std::string misses_name;
+            const std::string evictions_name;
+
+            const metrics::Counter hits;
+            const metrics::Counter misses;
+            const metrics::Counter evictions;
+
+            // Assets held by the cache, whether in use or not, and the
+            // bytes of file contents they keep
+            size_t resident_count;
+            size_t resident_bytes;
+
+            AssetTypeStats(const AssetTypeStats&) = delete;
+            AssetTypeStats &operator=(const AssetTypeStats&) = delete;
         };
 
-        extern Counter<size_t> draw_calls;
-        extern Counter<size_t> triangle_count;
-        extern Counter<size_t> shader_change_count;
-
-        extern size_t render_queue_size;
+        // Keyed by the last extension of the asset path, e.g. "png" or
+        // "mesh-rbdef". Created on first use and never freed, so the
+        // reference stays valid. Safe to call from any thread.
+        AssetTypeStats &asset_type_stats(const std::string &type);
 
+        // Only draw the draw call with this index within the frame, as
+        // counted by graphics::metrics::draw_calls
         extern int debug_single_draw_call_index;
         extern bool debug_single_draw_call_enabled;
     }
@@ -3,7 +3,9 @@
 
 #include "rosewood/math/math_types.h"
 
+#include "rosewood/core/assert.h"
 #include "rosewood/core/component.h"
+#include "rosewood/core/transform_hierarchy.h"
 
 namespace rosewood { namespace core {
 
@@ -16,15 +18,33 @@ namespace rosewood { namespace core {
 
     Transform *transform(Entity entity);
 
+    // Transforms keep their parent and children as pointers, but the
+    // local and world state lives in the owning EntityManager's
+    // TransformHierarchy. Transforms of entities without an owner share a
+    // separate hierarchy.
     class Transform : public Component<Transform> {
     public:
         explicit Transform(Entity owner);
+        Transform(Transform &&other);
+        ~Transform();
+
+        Transform(const Transform&) = delete;
+        Transform &operator=(const Transform&) = delete;
 
         const Transform *parent() const { return _parent; }
         Transform *parent() { return _parent; }
 
-        const Transform *root() const { return _parent ? _parent->root() : this; }
-        Transform *root() { return _parent ? _parent->root() : this; }
+        const Transform *root() const {
+            auto node = this;
+            while (node->_parent) node = node->_parent;
+            return node;
+        }
+
+        Transform *root() {
+            auto node = this;
+            while (node->_parent) node = node->_parent;
+            return node;
+        }
 
         void add_child(Transform *child);
         const std::vector<Transform*> &children() const { return _children; }
@@ -33,15 +53,14 @@ namespace rosewood { namespace core {
 
 
         // Getting/setting local transform
-        math::Vector3 local_position() const { return _local_position; }
-        math::Quaternion local_rotation() const { return _local_rotation; }
-        math::Vector3 local_scale() const { return _local_scale; }
+        math::Vector3 local_position() const { return _hierarchy->local_position(_node); }
+        math::Quaternion local_rotation() const { return _hierarchy->local_rotation(_node); }
+        math::Vector3 local_scale() const { return _hierarchy->local_scale(_node); }
 
 
         void set_local_position(math::Vector3 v, ChildPositions cpos = ChildPositions::KeepLocal) {
             if (cpos == ChildPositions::KeepLocal) {
-                _local_position = v;
-                invalidate_transform_matrices();
+                _hierarchy->set_local_position(_node, v);
             }
             else {
                 set_local_position_preserving_child_world_positions(v);
@@ -53,13 +72,13 @@ namespace rosewood { namespace core {
         }
 
         void set_local_rotation(math::Quaternion rotation) {
-            _local_rotation = rotation; invalidate_transform_matrices();
+            _hierarchy->set_local_rotation(_node, rotation);
         }
 
         void set_local_axis_angle(float x, float y, float z, float angle);
 
         void set_local_scale(math::Vector3 v) {
-            _local_scale = v; invalidate_transform_matrices();
+            _hierarchy->set_local_scale(_node, v);
         }
 
         void set_local_scale(float x, float y, float z) {
@@ -124,52 +143,32 @@ namespace rosewood { namespace core {
 
         // Extracting transform matrices
         math::Matrix4 local_transform() const {
-            construct_transform_matrices_if_invalid();
-            return _local_transform;
+            return _hierarchy->local_transform(_node);
         }
 
         math::Matrix4 inverse_local_transform() const {
-            construct_transform_matrices_if_invalid();
-            return _inverse_local_transform;
+            return _hierarchy->inverse_local_transform(_node);
         }
 
 
         math::Matrix4 world_transform() const {
-            construct_transform_matrices_if_invalid();
-            return _world_transform;
+            return _hierarchy->world_transform(_node);
         }
 
         math::Matrix4 inverse_world_transform() const {
-            construct_transform_matrices_if_invalid();
-            return _inverse_world_transform;
+            return _hierarchy->inverse_world_transform(_node);
         }
 
     private:
+        TransformHierarchy *_hierarchy;
+        size_t _node;
+
         std::vector<Transform*> _children;
         Transform *_parent;
 
-        math::Vector3 _local_position;
-        math::Quaternion _local_rotation;
-        math::Vector3 _local_scale;
-
-        mutable math::Matrix4 _local_transform;
-        mutable math::Matrix4 _inverse_local_transform;
-
-        mutable math::Matrix4 _world_transform;
-        mutable math::Matrix4 _inverse_world_transform;
-
-        mutable bool _transform_matrices_invalid;
-
         void set_local_position_preserving_child_world_positions(math::Vector3 v);
 
-        void invalidate_transform_matrices();
-        void construct_transform_matrices() const;
-
-        void construct_transform_matrices_if_invalid() const {
-            if (_transform_matrices_invalid) {
-                construct_transform_matrices();
-            }
-        }
+        friend class TransformHierarchy;
     };
 
     inline Transform *transform(Entity entity) {
@@ -177,27 +176,23 @@ namespace rosewood { namespace core {
     }
 
     inline void Transform::add_child(Transform *child) {
+        RW_ASSERT(child->_hierarchy == _hierarchy,
+                  "Transforms can only be parented within the same entity manager");
+
         if (child->_parent) {
             child->remove_from_parent();
         }
 
         _children.push_back(child);
         child->_parent = this;
-        child->invalidate_transform_matrices();
+        _hierarchy->set_parent(child->_node, _node);
     }
 
     inline void Transform::remove_from_parent() {
         auto it = std::find(begin(_parent->children()), end(_parent->children()), this);
         _parent->_children.erase(it);
         _parent = nullptr;
-        invalidate_transform_matrices();
-    }
-
-    inline void Transform::invalidate_transform_matrices() {
-        _transform_matrices_invalid = true;
-        for (auto child : _children) {
-            child->invalidate_transform_matrices();
-        }
+        _hierarchy->set_parent(_node, TransformHierarchy::kNoNode);
     }
 
 } }
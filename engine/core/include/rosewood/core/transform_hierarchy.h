@@ -0,0 +1,130 @@
+#ifndef __ROSEWOOD_CORE_TRANSFORM_HIERARCHY_H__
+#define __ROSEWOOD_CORE_TRANSFORM_HIERARCHY_H__
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "rosewood/math/math_types.h"
+
+namespace rosewood { namespace core {
+
+    class Transform;
+    struct Entity;
+
+    // Flat storage for the local and world state of every Transform owned
+    // by an EntityManager. Each node lives at an index into a set of
+    // parallel arrays, and update() periodically re-sorts the arrays so
+    // that parents always come before their children.
+    //
+    // Setting a local property only marks the node as dirty. World
+    // matrices are recomputed either by update(), which walks the arrays
+    // once in order and only touches nodes that changed (or whose parent
+    // changed), or lazily when a stale world matrix is read. A node's
+    // world matrix is stale if the node is dirty or if its parent's world
+    // matrix has changed since it was last computed, which is tracked
+    // with a version counter per node instead of invalidating subtrees.
+    class TransformHierarchy {
+    public:
+        static const size_t kNoNode = size_t(-1);
+
+        TransformHierarchy();
+
+        size_t create_node(Transform *owner);
+        void destroy_node(size_t node);
+
+        void set_owner(size_t node, Transform *owner) { _owners[node] = owner; }
+        void set_parent(size_t node, size_t parent);
+
+        size_t parent(size_t node) const { return _parents[node]; }
+
+        const math::Vector3 &local_position(size_t node) const { return _local_positions[node]; }
+        const math::Quaternion &local_rotation(size_t node) const { return _local_rotations[node]; }
+        const math::Vector3 &local_scale(size_t node) const { return _local_scales[node]; }
+
+        void set_local_position(size_t node, const math::Vector3 &v) {
+            _local_positions[node] = v; _dirty[node] = 1;
+        }
+
+        void set_local_rotation(size_t node, const math::Quaternion &q) {
+            _local_rotations[node] = q; _dirty[node] = 1;
+        }
+
+        void set_local_scale(size_t node, const math::Vector3 &v) {
+            _local_scales[node] = v; _dirty[node] = 1;
+        }
+
+        const math::Matrix4 &local_transform(size_t node) {
+            update_node_if_stale(node);
+            return _local_transforms[node];
+        }
+
+        const math::Matrix4 &inverse_local_transform(size_t node) {
+            update_node_if_stale(node);
+            return _inverse_local_transforms[node];
+        }
+
+        const math::Matrix4 &world_transform(size_t node) {
+            update_node_if_stale(node);
+            return _world_transforms[node];
+        }
+
+        const math::Matrix4 &inverse_world_transform(size_t node) {
+            update_node_if_stale(node);
+            return _inverse_world_transforms[node];
+        }
+
+        // Brings every world matrix up to date in a single parent before
+        // child pass. Should be called once per frame before rendering.
+        void update();
+
+        size_t node_count() const { return _owners.size() - _free_nodes.size(); }
+
+        // Once enabled, update() records every node whose world matrix has
+        // been recomputed since the last call to take_world_changes(),
+        // which moves the owning entities into `changed`. Lazily updated
+        // nodes are picked up by the next update().
+        void set_tracks_world_changes(bool tracks) { _tracks_world_changes = tracks; }
+        void take_world_changes(std::vector<Entity> *changed);
+
+        TransformHierarchy(const TransformHierarchy&) = delete;
+        TransformHierarchy &operator=(const TransformHierarchy&) = delete;
+
+    private:
+        std::vector<Transform*> _owners;
+        std::vector<size_t> _parents;
+
+        std::vector<math::Vector3> _local_positions;
+        std::vector<math::Quaternion> _local_rotations;
+        std::vector<math::Vector3> _local_scales;
+
+        std::vector<math::Matrix4> _local_transforms;
+        std::vector<math::Matrix4> _inverse_local_transforms;
+        std::vector<math::Matrix4> _world_transforms;
+        std::vector<math::Matrix4> _inverse_world_transforms;
+
+        // Not std::vector<bool>: setters on different nodes must be safe
+        // to call from different threads.
+        std::vector<unsigned char> _dirty;
+        std::vector<unsigned int> _world_versions;
+        std::vector<unsigned int> _parent_versions;
+
+        // 1 when the world matrix changed, 2 once the node is in
+        // _world_changes. Per node for the same reason as _dirty.
+        std::vector<unsigned char> _world_changed;
+        std::vector<size_t> _world_changes;
+        bool _tracks_world_changes;
+
+        std::vector<size_t> _free_nodes;
+        bool _order_invalid;
+
+        bool is_stale(size_t node) const;
+        void update_node_if_stale(size_t node);
+        void update_node(size_t node);
+
+        void sort_nodes();
+    };
+
+} }
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef __ROSEWOOD_DATA_STRUCTURES_RADIX_SORT_H__
+#define __ROSEWOOD_DATA_STRUCTURES_RADIX_SORT_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include <utility>
+#include <vector>
+
+namespace rosewood { namespace data_structures {
+
+    // A sort key along with the index of the item it was computed for, so
+    // that large items can be ordered without moving them
+    struct KeyIndex {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    // Stable LSD radix sort on the keys, one byte per pass. Passes where
+    // every key has the same byte are skipped, which makes keys with
+    // mostly constant high bits cheap to sort. `scratch` is only used as
+    // storage and can be reused between calls to avoid allocating.
+    inline void radix_sort(std::vector<KeyIndex> *entries, std::vector<KeyIndex> *scratch) {
+        auto count = entries->size();
+        if (count < 2) {
+            return;
+        }
+
+        // Count every byte of every key in a single sweep
+        size_t histograms[8][256];
+        memset(histograms, 0, sizeof(histograms));
+
+        for (const auto &entry : *entries) {
+            auto key = entry.key;
+            for (int pass = 0; pass < 8; ++pass) {
+                ++histograms[pass][(key >> (pass * 8)) & 0xff];
+            }
+        }
+
+        scratch->resize(count);
+        auto source = entries->data();
+        auto target = scratch->data();
+
+        for (int pass = 0; pass < 8; ++pass) {
+            auto &histogram = histograms[pass];
+            auto shift = pass * 8;
+
+            if (histogram[(source[0].key >> shift) & 0xff] == count) {
+                continue;
+            }
+
+            size_t offset = 0;
+            for (auto &bucket : histogram) {
+                auto n = bucket;
+                bucket = offset;
+                offset += n;
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                target[histogram[(source[i].key >> shift) & 0xff]++] = source[i];
+            }
+
+            std::swap(source, target);
+        }
+
+        if (source != entries->data()) {
+            entries->swap(*scratch);
+        }
+    }
+
+} }
+
+#endif
@@ -0,0 +1,170 @@
+#include "rosewood/core/archetype.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+
+using rosewood::core::Archetype;
+using rosewood::core::ArchetypeStorage;
+using rosewood::core::ComponentMask;
+
+std::vector<Archetype::TypeInfo> Archetype::_type_infos;
+
+static size_t align_up(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+Archetype::Archetype(ComponentMask mask)
+: _mask(mask), _chunk_capacity(0), _chunk_bytes(0)
+, _chunk_alignment(std::alignment_of<size_t>::value), _size(0) {
+    _column_offsets.fill(0);
+
+    for (unsigned int type_code = 0; type_code < kMaxArchetypeComponentTypes; ++type_code) {
+        if (_mask.test(type_code)) {
+            RW_ASSERT(type_code < _type_infos.size() && _type_infos[type_code].destroy,
+                      "Component type must be registered before creating an archetype");
+            _types.push_back(type_code);
+        }
+    }
+
+    compute_layout();
+}
+
+Archetype::~Archetype() {
+    for (auto &chunk : _chunks) {
+        for (size_t row = 0; row < chunk.count; ++row) {
+            for (auto type_code : _types) {
+                _type_infos[type_code].destroy(chunk.data + _column_offsets[type_code]
+                                               + row * _type_infos[type_code].size);
+            }
+        }
+        free(chunk.data);
+    }
+}
+
+void Archetype::compute_layout() {
+    size_t row_bytes = sizeof(size_t);
+    for (auto type_code : _types) {
+        row_bytes += _type_infos[type_code].size;
+        _chunk_alignment = std::max(_chunk_alignment, _type_infos[type_code].alignment);
+    }
+
+    // Start from the capacity that would fit without padding and shrink
+    // until the padded layout fits in a chunk. A single row is always
+    // allowed, even if it overflows kArchetypeChunkBytes.
+    _chunk_capacity = std::max<size_t>(1, kArchetypeChunkBytes / row_bytes);
+
+    while (true) {
+        size_t offset = _chunk_capacity * sizeof(size_t);
+
+        for (auto type_code : _types) {
+            offset = align_up(offset, _type_infos[type_code].alignment);
+            _column_offsets[type_code] = offset;
+            offset += _chunk_capacity * _type_infos[type_code].size;
+        }
+
+        _chunk_bytes = align_up(offset, _chunk_alignment);
+
+        if (_chunk_bytes <= kArchetypeChunkBytes || _chunk_capacity == 1) {
+            break;
+        }
+        --_chunk_capacity;
+    }
+}
+
+void Archetype::allocate_row(size_t index, size_t *out_chunk, size_t *out_row) {
+    if (_chunks.empty() || _chunks.back().count == _chunk_capacity) {
+        void *data;
+        if (posix_memalign(&data, std::max(_chunk_alignment, sizeof(void*)), _chunk_bytes)) {
+            throw std::bad_alloc();
+        }
+        _chunks.push_back(Chunk{static_cast<unsigned char*>(data), 0});
+    }
+
+    auto &chunk = _chunks.back();
+    *out_chunk = _chunks.size() - 1;
+    *out_row = chunk.count;
+
+    reinterpret_cast<size_t*>(chunk.data)[chunk.count] = index;
+    ++chunk.count;
+    ++_size;
+}
+
+size_t Archetype::remove_row(size_t chunk, size_t row) {
+    auto last_chunk = _chunks.size() - 1;
+    auto last_row = _chunks[last_chunk].count - 1;
+    auto moved_index = ArchetypeStorage::kNoIndex;
+
+    if (chunk != last_chunk || row != last_row) {
+        for (auto type_code : _types) {
+            _type_infos[type_code].relocate(component_at(type_code, chunk, row),
+                                            component_at(type_code, last_chunk, last_row));
+        }
+
+        moved_index = index_at(last_chunk, last_row);
+        reinterpret_cast<size_t*>(_chunks[chunk].data)[row] = moved_index;
+    }
+
+    --_size;
+    if (!--_chunks[last_chunk].count) {
+        free(_chunks[last_chunk].data);
+        _chunks.pop_back();
+    }
+
+    return moved_index;
+}
+
+void ArchetypeStorage::remove_all(size_t index) {
+    if (index < _locations.size()) {
+        move_entity(index, nullptr);
+    }
+}
+
+Archetype *ArchetypeStorage::archetype_for(ComponentMask mask) {
+    auto it = _by_mask.find(mask);
+    if (it != _by_mask.end()) {
+        return it->second.get();
+    }
+
+    auto archetype = new Archetype(mask);
+    _by_mask.emplace(mask, std::unique_ptr<Archetype>(archetype));
+    _archetypes.push_back(archetype);
+    return archetype;
+}
+
+void ArchetypeStorage::move_entity(size_t index, Archetype *to) {
+    auto &loc = location(index);
+    auto from = loc.archetype;
+
+    if (from == to) {
+        return;
+    }
+
+    ArchetypeLocation new_loc{to, 0, 0};
+    if (to) {
+        to->allocate_row(index, &new_loc.chunk, &new_loc.row);
+    }
+
+    if (from) {
+        for (auto type_code : from->_types) {
+            void *source = from->component_at(type_code, loc.chunk, loc.row);
+
+            if (to && to->has_type(type_code)) {
+                void *dest = to->component_at(type_code, new_loc.chunk, new_loc.row);
+                Archetype::_type_infos[type_code].relocate(dest, source);
+            }
+            else {
+                Archetype::_type_infos[type_code].destroy(source);
+            }
+        }
+
+        // remove_row relocates the archetype's last row into the hole we
+        // just left, so the entity living there needs a new location.
+        auto moved_index = from->remove_row(loc.chunk, loc.row);
+        if (moved_index != kNoIndex) {
+            _locations[moved_index] = ArchetypeLocation{from, loc.chunk, loc.row};
+        }
+    }
+
+    loc = new_loc;
+}
@@ -4,6 +4,7 @@
 
 void rosewood::core::assert::fail(const char *filename, int line_number, const char *msg, ...) {
     LOG(ERROR) << filename << ":" << line_number << ": Assertion failure:";
+    rosewood::core::flush_log();
 
     va_list args;
     va_start(args, msg);
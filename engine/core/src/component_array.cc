@@ -21,7 +21,19 @@ void ComponentArray::remove_dynamic(size_t index, unsigned int type_code) {
         return;
     }
     
+    unlink_dense(*flag_ptr - 1, type_code);
     *flag_ptr = 0;
     void *data_ptr = &_data[assumed_data_index];
     _destructors[type_code](data_ptr);
 }
+
+void ComponentArray::unlink_dense(size_t position, unsigned int type_code) {
+    auto moved_index = _dense.back();
+    _dense[position] = moved_index;
+    _dense.pop_back();
+
+    if (position < _dense.size()) {
+        auto flag_index = moved_index * _sizes[type_code] + _flag_offsets[type_code];
+        *reinterpret_cast<flag_type*>(&_data[flag_index]) = (flag_type)(position + 1);
+    }
+}
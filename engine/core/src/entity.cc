@@ -2,6 +2,7 @@
 
 using rosewood::core::Entity;
 using rosewood::core::EntityManager;
+using rosewood::core::StorageMode;
 
 void Entity::destroy() {
     owner->destroy_entity(*this);
@@ -11,41 +12,52 @@ bool Entity::is_valid() const {
     return owner && owner->is_valid(*this);
 }
 
-EntityManager::EntityManager() : _max_eid(0) { }
+EntityManager::EntityManager(StorageMode storage_mode)
+: _storage_mode(storage_mode), _max_index(0), _generations(1, 0) { }
 
 Entity EntityManager::create_entity() {
-    EntityId eid;
+    EntityIndex index;
 
     if (_free_list.empty()) {
-        eid = ++_max_eid;
+        index = ++_max_index;
+        _generations.push_back(0);
     }
     else {
-        eid = _free_list.back();
+        index = _free_list.back();
         _free_list.pop_back();
     }
 
-    return Entity{this, eid};
+    auto generation = ++_generations[index];
+    return Entity{this, make_entity_id(index, generation)};
 }
 
 void EntityManager::destroy_entity(Entity e) {
-    unsigned int type_code = 0;
-    for (auto &comp_array : _components) {
-        comp_array.remove_dynamic(e.eid, type_code++);
+    if (!is_valid(e)) {
+        return;
     }
 
-    if (e.eid == _max_eid) {
-        --_max_eid;
+    for (auto &journal : _journals) {
+        if (journal && journal->has_component(e)) {
+            journal->removed.push_back(e);
+        }
+    }
+
+    auto index = entity_index(e.eid);
+
+    if (_storage_mode == StorageMode::Archetype) {
+        _archetypes.remove_all(index);
     }
     else {
-        _free_list.push_back(e.eid);
+        unsigned int type_code = 0;
+        for (auto &comp_array : _components) {
+            comp_array.remove_dynamic(index, type_code++);
+        }
     }
-}
 
-bool EntityManager::is_valid(Entity e) const {
-    return (e.eid <= _max_eid &&
-            std::find(begin(_free_list), end(_free_list), e.eid) == end(_free_list));
+    ++_generations[index];
+    _free_list.push_back(index);
 }
 
 size_t EntityManager::entity_count() const {
-    return _max_eid - _free_list.size();
+    return _max_index - _free_list.size();
 }
@@ -0,0 +1,145 @@
+#include "rosewood/core/job_system.h"
+
+#include <algorithm>
+
+using rosewood::core::JobSystem;
+
+JobSystem::JobSystem(size_t thread_count)
+: _queued_jobs(0), _stopping(false) {
+    thread_count = std::max<size_t>(1, thread_count);
+
+    for (size_t i = 0; i < thread_count; ++i) {
+        _queues.emplace_back(new JobQueue);
+    }
+
+    for (size_t i = 1; i < thread_count; ++i) {
+        _threads.emplace_back(&JobSystem::worker_main, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(_wake_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+
+    for (auto &thread : _threads) {
+        thread.join();
+    }
+}
+
+size_t JobSystem::default_thread_count() {
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+void JobSystem::parallel_for(size_t begin, size_t end, size_t grain, const RangeFunction &func) {
+    if (begin >= end) {
+        return;
+    }
+
+    grain = std::max<size_t>(1, grain);
+
+    if (_threads.empty() || end - begin <= grain) {
+        func(begin, end);
+        return;
+    }
+
+    auto n_jobs = (end - begin + grain - 1) / grain;
+    std::atomic<size_t> pending(n_jobs);
+
+    auto queue_index = current_queue_index();
+    {
+        auto &queue = *_queues[queue_index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        for (size_t job_begin = begin; job_begin < end; job_begin += grain) {
+            queue.jobs.push_back(Job{&func, job_begin, std::min(end, job_begin + grain), &pending});
+        }
+    }
+
+    _queued_jobs += n_jobs;
+    {
+        std::lock_guard<std::mutex> lock(_wake_mutex);
+    }
+    _wake.notify_all();
+
+    // Help out until every job from this call is done. The jobs we run
+    // here might belong to other parallel_for calls, which is fine.
+    Job job;
+    while (pending.load(std::memory_order_acquire)) {
+        if (pop_or_steal(queue_index, &job)) {
+            run(job);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::worker_main(size_t queue_index) {
+    Job job;
+
+    while (true) {
+        if (pop_or_steal(queue_index, &job)) {
+            run(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_wake_mutex);
+        _wake.wait(lock, [this] { return _stopping || _queued_jobs.load(); });
+
+        if (_stopping) {
+            return;
+        }
+    }
+}
+
+size_t JobSystem::current_queue_index() const {
+    auto id = std::this_thread::get_id();
+
+    for (size_t i = 0; i < _threads.size(); ++i) {
+        if (_threads[i].get_id() == id) {
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+bool JobSystem::pop_or_steal(size_t queue_index, Job *out_job) {
+    if (!_queued_jobs.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    {
+        auto &own = *_queues[queue_index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+
+        if (!own.jobs.empty()) {
+            *out_job = own.jobs.back();
+            own.jobs.pop_back();
+            --_queued_jobs;
+            return true;
+        }
+    }
+
+    for (size_t offset = 1; offset < _queues.size(); ++offset) {
+        auto &victim = *_queues[(queue_index + offset) % _queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (!victim.jobs.empty()) {
+            *out_job = victim.jobs.front();
+            victim.jobs.pop_front();
+            --_queued_jobs;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void JobSystem::run(const Job &job) {
+    (*job.func)(job.begin, job.end);
+    job.pending->fetch_sub(1, std::memory_order_release);
+}
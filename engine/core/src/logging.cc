@@ -1,45 +1,333 @@
 #include "rosewood/core/logging.h"
 
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
-#include <map>
-#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rosewood/target.h"
 
 using rosewood::core::LogLevel;
 using rosewood::core::LogWriter;
 
-static std::string basename(const std::string &path) {
-    size_t pos = path.rfind('/');
+const size_t LogWriter::kRateLimitBurst;
+
+static const size_t kLogRingSize = 64 * 1024;
+static const size_t kRateLimitSlotCount = 256;
+static const int64_t kRateLimitWindowUsec = 1000000;
 
-    if (pos == std::string::npos) {
-        return path;
-    }
+// How long the logging thread sleeps between draining the rings
+static const std::chrono::milliseconds kLogSinkInterval(5);
+
+static const char *file_basename(const char *path) {
+	auto slash = strrchr(path, '/');
+	return slash ? slash + 1 : path;
+}
 
-    return path.substr(pos + 1);
+static const char *level_name(LogLevel level) {
+	switch (level) {
+		case LogLevel::kStatementLevel: return "STMT";
+		case LogLevel::kDebugLevel:     return "DEBUG";
+		case LogLevel::kInfoLevel:      return "INFO";
+		case LogLevel::kWarningLevel:   return "WARNING";
+		case LogLevel::kErrorLevel:     return "ERROR";
+	}
+	return "?";
 }
 
-static const std::map<LogLevel, std::string> kLogLevelNames {
-	{ LogLevel::kStatementLevel, "STMT" },
-	{ LogLevel::kDebugLevel,     "DEBUG" },
-	{ LogLevel::kInfoLevel,      "INFO" },
-	{ LogLevel::kWarningLevel,   "WARNING" },
-	{ LogLevel::kErrorLevel,     "ERROR" },
-};
+namespace {
+
+	// One thread's formatted messages, each stored as a u32 length and the
+	// text. Only the owning thread moves _write and only the thread holding
+	// the sink's mutex moves _read.
+	class LogRing {
+	public:
+		std::atomic<bool> released;
+
+		LogRing() : released(false), _write(0), _read(0) { }
+
+		bool push(const std::string &record) {
+			auto length = (uint32_t)std::min(record.size(), kLogRingSize - sizeof(uint32_t));
+
+			auto write = _write.load(std::memory_order_relaxed);
+			auto read = _read.load(std::memory_order_acquire);
+
+			if (kLogRingSize - (write - read) < sizeof(length) + length) {
+				return false;
+			}
+
+			copy_in(write, &length, sizeof(length));
+			copy_in(write + sizeof(length), record.data(), length);
+			_write.store(write + sizeof(length) + length, std::memory_order_release);
+
+			return true;
+		}
+
+		void drain(std::string *out) {
+			auto read = _read.load(std::memory_order_relaxed);
+			auto write = _write.load(std::memory_order_acquire);
+
+			while (read != write) {
+				uint32_t length;
+				copy_out(read, &length, sizeof(length));
+
+				auto offset = out->size();
+				out->resize(offset + length);
+				copy_out(read + sizeof(length), &(*out)[offset], length);
+
+				read += sizeof(length) + length;
+			}
+
+			_read.store(read, std::memory_order_release);
+		}
+
+	private:
+		char _data[kLogRingSize];
+		std::atomic<size_t> _write;
+		std::atomic<size_t> _read;
+
+		void copy_in(size_t position, const void *source, size_t size) {
+			position %= kLogRingSize;
+			auto first = std::min(size, kLogRingSize - position);
 
-static std::mutex gWriterMutex;
+			memcpy(_data + position, source, first);
+			memcpy(_data, static_cast<const char*>(source) + first, size - first);
+		}
+
+		void copy_out(size_t position, void *dest, size_t size) const {
+			position %= kLogRingSize;
+			auto first = std::min(size, kLogRingSize - position);
+
+			memcpy(dest, _data + position, first);
+			memcpy(static_cast<char*>(dest) + first, _data, size - first);
+		}
+	};
+
+	// Owns the rings and the thread writing them to stderr. Writing always
+	// happens with _mutex held, which keeps each ring's consumer single.
+	class LogSink {
+	public:
+		LogSink() : _running(false), _stopping(false) {
+#if !TARGET_WEBGL
+			_running = true;
+			_thread = std::thread([this] { run(); });
+			atexit([] { log_sink().stop(); });
+#endif
+		}
+
+		static LogSink &log_sink();
+
+		void write(const std::string &record);
+		void flush();
+
+	private:
+		std::mutex _mutex;
+		std::condition_variable _wakeup;
+		std::vector<LogRing*> _rings;
+		std::string _batch;
+
+		std::atomic<bool> _running;
+		bool _stopping;
+		std::thread _thread;
+
+		void run();
+		void stop();
+		void drain_locked();
+		LogRing *thread_ring();
+	};
+
+	// Releases the thread's ring when the thread exits, and remembers that
+	// it did so that later messages from thread-local destructors go straight
+	// out
+	struct ThreadLogRing {
+		LogRing *ring;
+
+		ThreadLogRing() : ring(nullptr) { }
+		~ThreadLogRing();
+	};
+
+	struct RateLimitSlot {
+		std::atomic<uintptr_t> site;
+		std::atomic<int64_t> window_start;
+		std::atomic<size_t> count;
+		std::atomic<size_t> suppressed;
+	};
+
+}
+
+static thread_local ThreadLogRing gThreadLogRing;
+static thread_local bool gThreadLogRingReleased = false;
+
+static RateLimitSlot gRateLimitSlots[kRateLimitSlotCount];
 
 LogLevel LogWriter::gLogLevel = LogLevel::kStatementLevel;
 
-LogWriter::LogWriter(LogLevel level, const std::string &file, int line, const std::string &message)
+ThreadLogRing::~ThreadLogRing() {
+	if (ring) ring->released.store(true, std::memory_order_release);
+	gThreadLogRingReleased = true;
+}
+
+LogSink &LogSink::log_sink() {
+	// Leaked, so that it outlives everything logging at exit
+	static auto sink = new LogSink();
+	return *sink;
+}
+
+void LogSink::write(const std::string &record) {
+	if (!_running.load(std::memory_order_acquire) || gThreadLogRingReleased) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		drain_locked();
+		fwrite(record.data(), 1, record.size(), stderr);
+		return;
+	}
+
+	auto ring = thread_ring();
+	if (!ring->push(record)) {
+		// Full: write out everything queued so far, ours included, so the
+		// message still comes after the ones before it
+		std::lock_guard<std::mutex> lock(_mutex);
+		drain_locked();
+		fwrite(record.data(), 1, record.size(), stderr);
+		return;
+	}
+
+	// The logging thread might have stopped after the check above
+	if (!_running.load(std::memory_order_acquire)) {
+		flush();
+	}
+}
+
+void LogSink::flush() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	drain_locked();
+}
+
+void LogSink::run() {
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (!_stopping) {
+		drain_locked();
+		_wakeup.wait_for(lock, kLogSinkInterval);
+	}
+
+	drain_locked();
+}
+
+void LogSink::stop() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+		_running = false;
+	}
+
+	_wakeup.notify_one();
+	_thread.join();
+}
+
+void LogSink::drain_locked() {
+	for (auto it = begin(_rings); it != end(_rings); ) {
+		auto ring = *it;
+
+		// Anything pushed before the release is visible to this drain
+		bool released = ring->released.load(std::memory_order_acquire);
+		ring->drain(&_batch);
+
+		if (released) {
+			delete ring;
+			it = _rings.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	if (!_batch.empty()) {
+		fwrite(_batch.data(), 1, _batch.size(), stderr);
+		fflush(stderr);
+		_batch.clear();
+	}
+}
+
+LogRing *LogSink::thread_ring() {
+	auto &ring = gThreadLogRing.ring;
+
+	if (!ring) {
+		ring = new LogRing();
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_rings.push_back(ring);
+	}
+
+	return ring;
+}
+
+// Call sites are told apart by the address of __FILE__ and the line; two
+// sharing a slot just share their budget until one takes it over
+static bool pass_rate_limit(const char *file, int line, size_t *out_suppressed) {
+	auto site = reinterpret_cast<uintptr_t>(file) ^ ((uintptr_t)line * 2654435761u);
+	auto &slot = gRateLimitSlots[site % kRateLimitSlotCount];
+
+	auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	if (slot.site.load(std::memory_order_relaxed) != site) {
+		slot.site.store(site, std::memory_order_relaxed);
+		slot.window_start.store(now, std::memory_order_relaxed);
+		slot.count.store(0, std::memory_order_relaxed);
+		slot.suppressed.store(0, std::memory_order_relaxed);
+	}
+	else if (now - slot.window_start.load(std::memory_order_relaxed) >= kRateLimitWindowUsec) {
+		slot.window_start.store(now, std::memory_order_relaxed);
+		slot.count.store(0, std::memory_order_relaxed);
+	}
+
+	if (slot.count.fetch_add(1, std::memory_order_relaxed) >= LogWriter::kRateLimitBurst) {
+		slot.suppressed.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	*out_suppressed = slot.suppressed.exchange(0, std::memory_order_relaxed);
+	return true;
+}
+
+LogWriter::LogWriter(LogLevel level, const char *file, int line, const char *message)
 	: _enabled(level >= gLogLevel)
 	, _level(level)
 	, _file(file)
 	, _line(line)
-	, _stream(message)
-{ }
+	, _suppressed(0)
+{
+	_enabled = _enabled && (level >= LogLevel::kErrorLevel || pass_rate_limit(file, line, &_suppressed));
+	if (_enabled && message) _stream << message;
+}
 
 LogWriter::~LogWriter() {
 	if (!_enabled) return;
 
-	std::lock_guard<std::mutex> lock(gWriterMutex);
-	std::cerr << "[" << kLogLevelNames.at(_level) << " " << basename(_file.c_str()) << ":" << _line << "] " << _stream.str() << std::endl;
+	char header[128];
+	snprintf(header, sizeof(header), "[%s %s:%d] ", level_name(_level), file_basename(_file), _line);
+
+	std::string record(header);
+	record += _stream.str();
+
+	if (_suppressed) {
+		record += " (" + std::to_string(_suppressed) + " similar messages suppressed)";
+	}
+
+	record += '\n';
+
+	LogSink::log_sink().write(record);
+}
+
+void rosewood::core::flush_log() {
+	LogSink::log_sink().flush();
 }
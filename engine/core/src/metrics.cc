@@ -0,0 +1,467 @@
+#include "rosewood/core/metrics.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "rosewood/core/assert.h"
+
+using rosewood::core::metrics::Counter;
+using rosewood::core::metrics::Gauge;
+using rosewood::core::metrics::Histogram;
+using rosewood::core::metrics::kMaxHistograms;
+using rosewood::core::metrics::kMaxMetrics;
+using rosewood::core::metrics::kWindowFrames;
+
+// Bucket 0 holds values below 1, then eight linear buckets for each power
+// of two up to 2^40
+static const int kHistogramExponents = 40;
+static const int kHistogramSubBuckets = 8;
+static const size_t kHistogramBucketCount = 1 + kHistogramExponents * kHistogramSubBuckets;
+
+static size_t histogram_bucket(double value) {
+    if (!(value >= 1)) return 0;
+
+    int exponent;
+    auto mantissa = frexp(value, &exponent);
+    if (exponent > kHistogramExponents) return kHistogramBucketCount - 1;
+
+    auto sub_bucket = (int)((mantissa * 2 - 1) * kHistogramSubBuckets);
+    return 1 + (exponent - 1) * kHistogramSubBuckets + sub_bucket;
+}
+
+// The middle of the bucket's range
+static double histogram_bucket_value(size_t bucket) {
+    if (!bucket) return 0.5;
+
+    auto exponent = (int)(bucket - 1) / kHistogramSubBuckets;
+    auto sub_bucket = (int)(bucket - 1) % kHistogramSubBuckets;
+    return ldexp(1 + (sub_bucket + 0.5) / kHistogramSubBuckets, exponent);
+}
+
+namespace {
+
+    typedef std::atomic<uint64_t> Slot;
+
+    // The owner is the only writer, so adding is a load and a store
+    void add(Slot *slot, uint64_t amount) {
+        slot->store(slot->load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    // One thread's running totals. Histogram buckets are allocated the first
+    // time the thread records into that histogram.
+    struct MetricShard {
+        Slot counters[kMaxMetrics];
+        std::atomic<Slot*> histograms[kMaxHistograms];
+
+        MetricShard() {
+            for (auto &counter : counters) counter.store(0, std::memory_order_relaxed);
+            for (auto &histogram : histograms) histogram.store(nullptr, std::memory_order_relaxed);
+        }
+
+        ~MetricShard() {
+            for (auto &histogram : histograms) delete[] histogram.load(std::memory_order_relaxed);
+        }
+
+        Slot *histogram_buckets(size_t index) {
+            auto buckets = histograms[index].load(std::memory_order_relaxed);
+            if (!buckets) {
+                buckets = new Slot[kHistogramBucketCount];
+                for (size_t i = 0; i < kHistogramBucketCount; ++i) {
+                    buckets[i].store(0, std::memory_order_relaxed);
+                }
+                histograms[index].store(buckets, std::memory_order_release);
+            }
+            return buckets;
+        }
+    };
+
+    struct MetricState {
+        const char *name;
+        const void *handle;
+        bool is_gauge;
+
+        // Counted by threads that have since exited
+        uint64_t retired;
+        uint64_t last_total;
+
+        std::vector<double> window;
+    };
+
+    struct HistogramState {
+        const char *name;
+        const Histogram *handle;
+
+        std::vector<uint64_t> retired;
+        std::vector<uint64_t> last_totals;
+
+        // Each frame's new samples as (bucket, count), and their sum
+        std::vector<std::vector<std::pair<uint32_t, uint64_t>>> frames;
+        std::vector<uint64_t> window_buckets;
+        uint64_t window_count;
+    };
+
+    class MetricRegistry {
+    public:
+        std::mutex mutex;
+
+        std::vector<MetricState> metrics;
+        std::vector<HistogramState> histograms;
+        std::atomic<double> gauges[kMaxMetrics];
+
+        std::vector<MetricShard*> shards;
+
+        // Number of frames ended so far
+        size_t frame_count;
+        std::chrono::steady_clock::time_point last_frame_end;
+
+        MetricRegistry() : frame_count(0) {
+            for (auto &gauge : gauges) gauge.store(0, std::memory_order_relaxed);
+        }
+
+        size_t register_metric(const char *name, const void *handle, bool is_gauge);
+        size_t register_histogram(const char *name, const Histogram *handle);
+
+        uint64_t counter_total(size_t index) const;
+        void histogram_totals(size_t index, std::vector<uint64_t> *out_totals) const;
+        size_t window_size() const { return std::min(frame_count, kWindowFrames); }
+
+        MetricShard *add_shard();
+        void retire_shard(MetricShard *shard);
+
+        void end_frame();
+
+    private:
+        std::vector<uint64_t> _scratch_totals;
+    };
+
+    // Hands the shard back when the thread exits
+    struct ThreadMetricShard {
+        MetricShard *shard;
+
+        ThreadMetricShard() : shard(nullptr) { }
+        ~ThreadMetricShard();
+    };
+
+}
+
+static thread_local ThreadMetricShard gThreadMetricShard;
+static thread_local bool gThreadMetricShardReleased = false;
+
+static MetricRegistry &registry() {
+    // Leaked, so that threads exiting late can still retire their shards
+    static auto registry = new MetricRegistry();
+    return *registry;
+}
+
+// Null once the thread's thread-local destructors have run, and writes
+// are dropped
+static MetricShard *thread_shard() {
+    auto &shard = gThreadMetricShard.shard;
+
+    if (!shard && !gThreadMetricShardReleased) {
+        shard = registry().add_shard();
+    }
+
+    return shard;
+}
+
+ThreadMetricShard::~ThreadMetricShard() {
+    if (shard) registry().retire_shard(shard);
+    gThreadMetricShardReleased = true;
+}
+
+size_t MetricRegistry::register_metric(const char *name, const void *handle, bool is_gauge) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        if (!strcmp(metrics[i].name, name)) {
+            RW_ASSERT(metrics[i].is_gauge == is_gauge, "Metric %s registered as both counter and gauge", name);
+            return i;
+        }
+    }
+
+    RW_ASSERT(metrics.size() < kMaxMetrics, "Too many metrics registered, raise kMaxMetrics");
+
+    MetricState state{name, handle, is_gauge, 0, 0, std::vector<double>(kWindowFrames)};
+    metrics.push_back(std::move(state));
+    return metrics.size() - 1;
+}
+
+size_t MetricRegistry::register_histogram(const char *name, const Histogram *handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (size_t i = 0; i < histograms.size(); ++i) {
+        if (!strcmp(histograms[i].name, name)) return i;
+    }
+
+    RW_ASSERT(histograms.size() < kMaxHistograms, "Too many histograms registered, raise kMaxHistograms");
+
+    HistogramState state;
+    state.name = name;
+    state.handle = handle;
+    state.retired.resize(kHistogramBucketCount);
+    state.last_totals.resize(kHistogramBucketCount);
+    state.frames.resize(kWindowFrames);
+    state.window_buckets.resize(kHistogramBucketCount);
+    state.window_count = 0;
+
+    histograms.push_back(std::move(state));
+    return histograms.size() - 1;
+}
+
+uint64_t MetricRegistry::counter_total(size_t index) const {
+    auto total = metrics[index].retired;
+    for (auto shard : shards) {
+        total += shard->counters[index].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void MetricRegistry::histogram_totals(size_t index, std::vector<uint64_t> *out_totals) const {
+    *out_totals = histograms[index].retired;
+
+    for (auto shard : shards) {
+        auto buckets = shard->histograms[index].load(std::memory_order_acquire);
+        if (!buckets) continue;
+
+        for (size_t i = 0; i < kHistogramBucketCount; ++i) {
+            (*out_totals)[i] += buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+MetricShard *MetricRegistry::add_shard() {
+    auto shard = new MetricShard();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    shards.push_back(shard);
+    return shard;
+}
+
+void MetricRegistry::retire_shard(MetricShard *shard) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        metrics[i].retired += shard->counters[i].load(std::memory_order_relaxed);
+    }
+
+    for (size_t i = 0; i < histograms.size(); ++i) {
+        auto buckets = shard->histograms[i].load(std::memory_order_acquire);
+        if (!buckets) continue;
+
+        for (size_t b = 0; b < kHistogramBucketCount; ++b) {
+            histograms[i].retired[b] += buckets[b].load(std::memory_order_relaxed);
+        }
+    }
+
+    shards.erase(std::find(begin(shards), end(shards), shard));
+    delete shard;
+}
+
+void MetricRegistry::end_frame() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto position = frame_count % kWindowFrames;
+
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        auto &metric = metrics[i];
+
+        if (metric.is_gauge) {
+            metric.window[position] = gauges[i].load(std::memory_order_relaxed);
+        }
+        else {
+            auto total = counter_total(i);
+            metric.window[position] = (double)(total - metric.last_total);
+            metric.last_total = total;
+        }
+    }
+
+    for (size_t i = 0; i < histograms.size(); ++i) {
+        auto &histogram = histograms[i];
+        auto &frame = histogram.frames[position];
+
+        // The frame falling out of the window
+        for (const auto &pair : frame) {
+            histogram.window_buckets[pair.first] -= pair.second;
+            histogram.window_count -= pair.second;
+        }
+        frame.clear();
+
+        histogram_totals(i, &_scratch_totals);
+
+        for (size_t b = 0; b < kHistogramBucketCount; ++b) {
+            auto count = _scratch_totals[b] - histogram.last_totals[b];
+            if (!count) continue;
+
+            frame.emplace_back((uint32_t)b, count);
+            histogram.window_buckets[b] += count;
+            histogram.window_count += count;
+            histogram.last_totals[b] = _scratch_totals[b];
+        }
+    }
+
+    ++frame_count;
+}
+
+namespace rosewood { namespace core { namespace metrics {
+
+    const Histogram frame_time_usec("core.frame_time_usec");
+
+    Counter::Counter(const char *name)
+    : _name(name), _index(registry().register_metric(name, this, false)) { }
+
+    void Counter::increment(uint64_t amount) const {
+        auto shard = thread_shard();
+        if (shard) add(&shard->counters[_index], amount);
+    }
+
+    uint64_t Counter::total() const {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        return r.counter_total(_index);
+    }
+
+    uint64_t Counter::current_frame() const {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        return r.counter_total(_index) - r.metrics[_index].last_total;
+    }
+
+    uint64_t Counter::last_frame() const {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (!r.frame_count) return 0;
+        return (uint64_t)r.metrics[_index].window[(r.frame_count - 1) % kWindowFrames];
+    }
+
+    double Counter::window_average() const {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+
+        auto size = r.window_size();
+        if (!size) return 0;
+
+        const auto &window = r.metrics[_index].window;
+        double sum = 0;
+        for (size_t i = 0; i < size; ++i) sum += window[i];
+        return sum / size;
+    }
+
+    Gauge::Gauge(const char *name)
+    : _name(name), _index(registry().register_metric(name, this, true)) { }
+
+    void Gauge::set(double value) const {
+        registry().gauges[_index].store(value, std::memory_order_relaxed);
+    }
+
+    double Gauge::value() const {
+        return registry().gauges[_index].load(std::memory_order_relaxed);
+    }
+
+    double Gauge::window_average() const {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+
+        auto size = r.window_size();
+        if (!size) return 0;
+
+        const auto &window = r.metrics[_index].window;
+        double sum = 0;
+        for (size_t i = 0; i < size; ++i) sum += window[i];
+        return sum / size;
+    }
+
+    double Gauge::window_max() const {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+
+        auto size = r.window_size();
+        if (!size) return 0;
+
+        const auto &window = r.metrics[_index].window;
+        return *std::max_element(begin(window), begin(window) + size);
+    }
+
+    Histogram::Histogram(const char *name)
+    : _name(name), _index(registry().register_histogram(name, this)) { }
+
+    void Histogram::record(double value) const {
+        auto shard = thread_shard();
+        if (shard) add(&shard->histogram_buckets(_index)[histogram_bucket(value)], 1);
+    }
+
+    double Histogram::percentile(double p) const {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+
+        const auto &histogram = r.histograms[_index];
+        if (!histogram.window_count) return 0;
+
+        auto target = std::max((uint64_t)ceil(p * histogram.window_count), uint64_t(1));
+        uint64_t seen = 0;
+
+        for (size_t b = 0; b < kHistogramBucketCount; ++b) {
+            seen += histogram.window_buckets[b];
+            if (seen >= target) return histogram_bucket_value(b);
+        }
+
+        return histogram_bucket_value(kHistogramBucketCount - 1);
+    }
+
+    uint64_t Histogram::window_count() const {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        return r.histograms[_index].window_count;
+    }
+
+    void end_frame() {
+        auto &r = registry();
+        auto now = std::chrono::steady_clock::now();
+
+        // Recorded before folding, so the frame it closes includes it. Done
+        // without the lock, which a thread's first write takes.
+        if (r.frame_count) {
+            frame_time_usec.record(std::chrono::duration<double, std::micro>(now - r.last_frame_end).count());
+        }
+        r.last_frame_end = now;
+
+        r.end_frame();
+    }
+
+    const Counter *find_counter(const std::string &name) {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+
+        for (const auto &metric : r.metrics) {
+            if (!metric.is_gauge && name == metric.name) return static_cast<const Counter*>(metric.handle);
+        }
+        return nullptr;
+    }
+
+    const Gauge *find_gauge(const std::string &name) {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+
+        for (const auto &metric : r.metrics) {
+            if (metric.is_gauge && name == metric.name) return static_cast<const Gauge*>(metric.handle);
+        }
+        return nullptr;
+    }
+
+    const Histogram *find_histogram(const std::string &name) {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+
+        for (const auto &histogram : r.histograms) {
+            if (name == histogram.name) return histogram.handle;
+        }
+        return nullptr;
+    }
+
+} } }
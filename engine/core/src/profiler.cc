@@ -0,0 +1,337 @@
+#include "rosewood/core/profiler.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+using rosewood::core::profiler::kCaptureWindowFrames;
+using rosewood::core::profiler::kSlowestFrameCount;
+using rosewood::core::profiler::now_nsec;
+
+// Scopes a thread can record between two end_frame calls
+static const size_t kProfileBufferSize = 16 * 1024;
+
+// Track 0 in the trace holds the frames themselves
+static const uint32_t kFrameTrackId = 0;
+
+namespace {
+
+    struct ProfileEvent {
+        const char *name;
+        uint64_t start_nsec;
+        uint64_t end_nsec;
+        uint32_t thread_id;
+    };
+
+    // One thread's finished scopes. Only the owning thread moves _write and
+    // only end_frame, with the profiler's mutex held, moves _read.
+    class ProfileBuffer {
+    public:
+        const uint32_t thread_id;
+        std::atomic<bool> released;
+
+        explicit ProfileBuffer(uint32_t thread_id)
+        : thread_id(thread_id), released(false), _write(0), _read(0) { }
+
+        bool push(const char *name, uint64_t start_nsec, uint64_t end_nsec) {
+            auto write = _write.load(std::memory_order_relaxed);
+            if (write - _read.load(std::memory_order_acquire) == kProfileBufferSize) return false;
+
+            _events[write % kProfileBufferSize] = ProfileEvent{name, start_nsec, end_nsec, thread_id};
+            _write.store(write + 1, std::memory_order_release);
+            return true;
+        }
+
+        void drain(std::vector<ProfileEvent> *out) {
+            auto read = _read.load(std::memory_order_relaxed);
+            auto write = _write.load(std::memory_order_acquire);
+
+            for (; read != write; ++read) {
+                out->push_back(_events[read % kProfileBufferSize]);
+            }
+
+            _read.store(read, std::memory_order_release);
+        }
+
+    private:
+        ProfileEvent _events[kProfileBufferSize];
+        std::atomic<size_t> _write;
+        std::atomic<size_t> _read;
+    };
+
+    struct CapturedFrame {
+        uint64_t index;
+        uint64_t start_nsec;
+        uint64_t end_nsec;
+        std::vector<ProfileEvent> events;
+
+        uint64_t duration() const { return end_nsec - start_nsec; }
+    };
+
+    struct ProfilerState {
+        std::mutex mutex;
+        std::vector<ProfileBuffer*> buffers;
+        std::vector<std::string> thread_names;
+
+        uint64_t frame_index;
+        uint64_t frame_start_nsec;
+        std::vector<ProfileEvent> frame_events;
+        std::vector<CapturedFrame> captured;
+
+        std::atomic<size_t> dropped;
+
+        ProfilerState() : thread_names(1, "frames"), frame_index(0), frame_start_nsec(0), dropped(0) { }
+
+        ProfileBuffer *add_buffer(const char *thread_name);
+        void end_frame();
+        void capture_frame(uint64_t end_nsec);
+        std::string chrome_trace();
+    };
+
+    // Hands the buffer back when the thread exits
+    struct ThreadProfileBuffer {
+        ProfileBuffer *buffer;
+        const char *name;
+
+        ThreadProfileBuffer() : buffer(nullptr), name(nullptr) { }
+        ~ThreadProfileBuffer();
+    };
+
+}
+
+static thread_local ThreadProfileBuffer gThreadProfileBuffer;
+static thread_local bool gThreadProfileBufferReleased = false;
+
+static ProfilerState &profiler_state() {
+    // Leaked, so that threads exiting late can still release their buffers
+    static auto state = new ProfilerState();
+    return *state;
+}
+
+// Null once the thread's thread-local destructors have run, and scopes
+// are dropped
+static ProfileBuffer *thread_buffer() {
+    auto &buffer = gThreadProfileBuffer.buffer;
+
+    if (!buffer && !gThreadProfileBufferReleased) {
+        buffer = profiler_state().add_buffer(gThreadProfileBuffer.name);
+    }
+
+    return buffer;
+}
+
+ThreadProfileBuffer::~ThreadProfileBuffer() {
+    // end_frame collects what is left and deletes the buffer
+    if (buffer) buffer->released.store(true, std::memory_order_release);
+    gThreadProfileBufferReleased = true;
+}
+
+ProfileBuffer *ProfilerState::add_buffer(const char *thread_name) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto buffer = new ProfileBuffer((uint32_t)thread_names.size());
+    thread_names.push_back(thread_name ? thread_name : "thread " + std::to_string(buffer->thread_id));
+    buffers.push_back(buffer);
+    return buffer;
+}
+
+void ProfilerState::end_frame() {
+    auto now = now_nsec();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto it = begin(buffers); it != end(buffers); ) {
+        auto buffer = *it;
+
+        // Anything pushed before the release is visible to this drain
+        bool released = buffer->released.load(std::memory_order_acquire);
+        buffer->drain(&frame_events);
+
+        if (released) {
+            delete buffer;
+            it = buffers.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    // Frames where nothing was profiled are not worth keeping
+    if (frame_start_nsec && !frame_events.empty()) {
+        capture_frame(now);
+    }
+
+    frame_events.clear();
+    frame_start_nsec = now;
+    ++frame_index;
+}
+
+void ProfilerState::capture_frame(uint64_t end_nsec) {
+    captured.erase(std::remove_if(begin(captured), end(captured), [this](const CapturedFrame &frame) {
+        return frame_index - frame.index >= kCaptureWindowFrames;
+    }), end(captured));
+
+    CapturedFrame *slot = nullptr;
+
+    if (captured.size() < kSlowestFrameCount) {
+        captured.push_back(CapturedFrame());
+        slot = &captured.back();
+    }
+    else {
+        auto fastest = std::min_element(begin(captured), end(captured), [](const CapturedFrame &a, const CapturedFrame &b) {
+            return a.duration() < b.duration();
+        });
+
+        if (fastest->duration() >= end_nsec - frame_start_nsec) return;
+        slot = &*fastest;
+    }
+
+    slot->index = frame_index;
+    slot->start_nsec = frame_start_nsec;
+    slot->end_nsec = end_nsec;
+
+    // The replaced frame's storage is reused for the next one
+    slot->events.swap(frame_events);
+}
+
+static void append_json_string(std::string *out, const char *text) {
+    *out += '"';
+
+    for (auto c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            *out += '\\';
+            *out += *c;
+        }
+        else if ((unsigned char)*c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)*c);
+            *out += escaped;
+        }
+        else {
+            *out += *c;
+        }
+    }
+
+    *out += '"';
+}
+
+static void append_complete_event(std::string *out, const char *name, const char *category,
+                                  uint64_t start_nsec, uint64_t end_nsec, uint64_t origin_nsec,
+                                  uint32_t thread_id)
+{
+    *out += ",\n{\"name\":";
+    append_json_string(out, name);
+
+    char fields[160];
+    snprintf(fields, sizeof(fields), ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+             category, (start_nsec - origin_nsec) / 1000.0, (end_nsec - start_nsec) / 1000.0, thread_id);
+    *out += fields;
+}
+
+std::string ProfilerState::chrome_trace() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<const CapturedFrame*> frames;
+    for (auto &frame : captured) frames.push_back(&frame);
+
+    std::sort(begin(frames), end(frames), [](const CapturedFrame *a, const CapturedFrame *b) {
+        return a->index < b->index;
+    });
+
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"rosewood\"}}";
+
+    for (uint32_t i = 0; i < thread_names.size(); ++i) {
+        out += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(i) + ",\"args\":{\"name\":";
+        append_json_string(&out, thread_names[i].c_str());
+        out += "}}";
+    }
+
+    auto origin = frames.empty() ? 0 : frames.front()->start_nsec;
+    std::vector<ProfileEvent> events;
+
+    for (auto frame : frames) {
+        auto name = "frame " + std::to_string(frame->index);
+        append_complete_event(&out, name.c_str(), "frame", frame->start_nsec, frame->end_nsec, origin, kFrameTrackId);
+
+        // Outer scopes first, so that equal start times still nest
+        events = frame->events;
+        std::sort(begin(events), end(events), [](const ProfileEvent &a, const ProfileEvent &b) {
+            if (a.thread_id != b.thread_id) return a.thread_id < b.thread_id;
+            if (a.start_nsec != b.start_nsec) return a.start_nsec < b.start_nsec;
+            return a.end_nsec > b.end_nsec;
+        });
+
+        for (auto &event : events) {
+            // Work started before the first captured frame is clamped to it
+            auto start = std::max(event.start_nsec, origin);
+            append_complete_event(&out, event.name, "rosewood", start, std::max(event.end_nsec, start), origin, event.thread_id);
+        }
+    }
+
+    out += "\n]}\n";
+    return out;
+}
+
+namespace rosewood { namespace core { namespace profiler {
+
+    std::atomic<bool> gProfilerEnabled(false);
+
+    void set_enabled(bool enabled) {
+        gProfilerEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void record(const char *name, uint64_t start_nsec, uint64_t end_nsec) {
+        auto buffer = thread_buffer();
+
+        if (!buffer || !buffer->push(name, start_nsec, end_nsec)) {
+            profiler_state().dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void set_thread_name(const char *name) {
+        // Threads that never record a scope don't get a buffer
+        gThreadProfileBuffer.name = name;
+
+        auto buffer = gThreadProfileBuffer.buffer;
+        if (!buffer) return;
+
+        auto &p = profiler_state();
+        std::lock_guard<std::mutex> lock(p.mutex);
+        p.thread_names[buffer->thread_id] = name;
+    }
+
+    void end_frame() {
+        profiler_state().end_frame();
+    }
+
+    std::string chrome_trace() {
+        return profiler_state().chrome_trace();
+    }
+
+    bool write_chrome_trace(const std::string &path) {
+        auto trace = chrome_trace();
+
+        auto file = fopen(path.c_str(), "wb");
+        if (!file) return false;
+
+        bool written = fwrite(trace.data(), 1, trace.size(), file) == trace.size();
+        return fclose(file) == 0 && written;
+    }
+
+    void clear_capture() {
+        auto &p = profiler_state();
+        std::lock_guard<std::mutex> lock(p.mutex);
+
+        p.captured.clear();
+        p.dropped.store(0, std::memory_order_relaxed);
+    }
+
+    size_t dropped_scope_count() {
+        return profiler_state().dropped.load(std::memory_order_relaxed);
+    }
+
+} } }
@@ -1,22 +1,57 @@
 #include "rosewood/core/resource_manager.h"
 
 #include "rosewood/core/logging.h"
+#include "rosewood/core/metrics.h"
+#include "rosewood/core/profiler.h"
+#include "rosewood/core/stats.h"
 
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 
 using rosewood::core::Asset;
 using rosewood::core::AssetView;
+using rosewood::core::DecodedResourceCallback;
 using rosewood::core::IResourceLoader;
+using rosewood::core::LoadPriority;
+using rosewood::core::ResourceCache;
+using rosewood::core::ResourceCacheOptions;
+using rosewood::core::ResourceCallback;
+using rosewood::core::ResourceDecodeFunction;
+using rosewood::core::ResourceRequest;
+using rosewood::core::kResourceLoaderThreadCount;
+using rosewood::core::metrics::Counter;
+using rosewood::core::metrics::Histogram;
 
+// Loaders are only ever added, so the loading threads copy the pointers
+// under the lock and read files without holding it
+static std::mutex gResourceLoadersMutex;
 static std::vector<std::unique_ptr<IResourceLoader>> gResourceLoaders;
-static std::unordered_map<std::string, std::weak_ptr<Asset>> gLoadedAssets;
 
-Asset::Asset(const std::string &file_contents) : _file_contents(file_contents) { }
+static ResourceCacheOptions gResourceCacheOptions = { 32 * 1024 * 1024, false };
+
+static ResourceCache *resource_cache();
+
+Asset::Asset(std::string file_contents)
+: _file_contents(std::move(file_contents)), _contents_dropped(false)
+, _notifying_views(false), _decoded_while_notifying(false), _type_stats(nullptr) { }
 
 const std::string &Asset::str() const { return _file_contents; }
 
 void Asset::set_file_contents(const std::string &file_contents) {
-    _file_contents = file_contents;
+    replace_contents(file_contents);
+
+    // Every view decodes the new contents in its callback, so they can
+    // only be dropped after the last one
+    _notifying_views = true;
+    _decoded_while_notifying = false;
 
     for (auto weak_view : _views) {
         auto view = weak_view.lock();
@@ -24,6 +59,25 @@ void Asset::set_file_contents(const std::string &file_contents) {
 
         view->notify_change();
     }
+
+    _notifying_views = false;
+
+    if (_decoded_while_notifying) {
+        did_decode();
+    }
+}
+
+void Asset::did_decode() {
+    if (_notifying_views) {
+        _decoded_while_notifying = true;
+        return;
+    }
+
+    // Only cached assets can be read again
+    if (gResourceCacheOptions.drop_decoded_contents && _type_stats && !_contents_dropped) {
+        replace_contents(std::string());
+        _contents_dropped = true;
+    }
 }
 
 std::shared_ptr<AssetView> rosewood::core::create_view(const std::shared_ptr<Asset> &asset,
@@ -42,6 +96,7 @@ AssetView::AssetView(const std::shared_ptr<Asset> &asset,
 : _asset(asset), _change_callback(change_callback) { }
 
 const std::string &AssetView::str() const { return _asset->str(); }
+void AssetView::did_decode() const { _asset->did_decode(); }
 
 void AssetView::notify_change() const {
     _change_callback();
@@ -49,58 +104,568 @@ void AssetView::notify_change() const {
 
 IResourceLoader::~IResourceLoader() { }
 
+void IResourceLoader::collect_changed_files(std::vector<std::string>*) { }
+
 void rosewood::core::add_resource_loader(std::unique_ptr<IResourceLoader> loader) {
+    std::lock_guard<std::mutex> lock(gResourceLoadersMutex);
     gResourceLoaders.push_back(std::move(loader));
 }
 
-static bool load_newest_asset_contents(const std::string &path, std::string *out_contents) {
+static bool load_newest_asset_contents(const std::string &path, std::string *out_contents,
+                                       struct timespec *out_mtime = nullptr) {
     IResourceLoader *newest_loader = nullptr;
     struct timespec newest_spec{0, 0};
 
-    if (gResourceLoaders.empty()) {
+    std::vector<IResourceLoader*> loaders;
+    {
+        std::lock_guard<std::mutex> lock(gResourceLoadersMutex);
+        for (const auto &loader : gResourceLoaders) {
+            loaders.push_back(loader.get());
+        }
+    }
+
+    if (loaders.empty()) {
         LOG(WARNING, "There are no resource loaders registered");
     }
 
-    for (const auto &loader : gResourceLoaders) {
+    for (auto loader : loaders) {
         auto info = loader->find_file(path);
         if (info.exists && newest_spec.tv_sec < info.mtime.tv_sec) {
-            newest_loader = loader.get();
+            newest_loader = loader;
             newest_spec = info.mtime;
         }
     }
 
     if (newest_loader) {
         *out_contents = newest_loader->read_file(path);
+        if (out_mtime) {
+            *out_mtime = newest_spec;
+        }
         return true;
     }
 
     return false;
 }
 
-std::shared_ptr<Asset> rosewood::core::get_resource(std::string path) {
-    if (gLoadedAssets.find(path) == gLoadedAssets.end() || gLoadedAssets[path].expired()) {
-        std::string file_contents;
+namespace rosewood { namespace core {
+
+    // Owns every loaded asset, and hands out handles sharing one reference
+    // count per asset. When the last handle goes away the asset is queued
+    // as released, and released assets are freed in that order once the
+    // cache is over budget. Handles may be dropped on any thread, anything
+    // else happens on the thread calling get_resource().
+    class ResourceCache {
+    public:
+        ResourceCache() : _bytes(0) { }
+
+        // Returns nullptr if the path is not cached
+        std::shared_ptr<Asset> find(const std::string &path);
+        std::shared_ptr<Asset> insert(const std::string &path, std::shared_ptr<Asset> asset);
+
+        void restore_contents(Asset *asset, std::string file_contents);
+        void resize(Asset *asset, size_t old_size);
+
+        void trim();
+
+    private:
+        struct Entry {
+            std::shared_ptr<Asset> asset;
+            std::weak_ptr<Asset> handle;
+            std::list<std::string>::iterator released_position;
+            bool released;
+        };
+
+        std::unordered_map<std::string, Entry> _entries;
+
+        // Least recently released first
+        std::list<std::string> _released;
+        size_t _bytes;
+
+        std::mutex _newly_released_mutex;
+        std::vector<std::string> _newly_released;
+
+        std::shared_ptr<Asset> acquire(const std::string &path, Entry *entry);
+        void collect_released();
+    };
+
+} }
+
+// Leaked, so that handles released during exit can still report back
+static ResourceCache *resource_cache() {
+    static auto cache = new ResourceCache;
+    return cache;
+}
+
+static std::string asset_type(const std::string &path) {
+    auto dot = path.find_last_of("./");
+    return dot == std::string::npos || path[dot] == '/' ? std::string() : path.substr(dot + 1);
+}
+
+static void count_lookup(const std::string &path, bool hit) {
+    auto &type_stats = rosewood::core::stats::asset_type_stats(asset_type(path));
+    (hit ? type_stats.hits : type_stats.misses).increment();
+}
+
+void Asset::replace_contents(std::string file_contents) {
+    auto old_size = _file_contents.size();
+
+    _file_contents = std::move(file_contents);
+    _file_contents.shrink_to_fit();
+    _contents_dropped = false;
+
+    if (_type_stats) {
+        resource_cache()->resize(this, old_size);
+    }
+}
+
+std::shared_ptr<Asset> ResourceCache::find(const std::string &path) {
+    auto it = _entries.find(path);
+    return it == _entries.end() ? nullptr : acquire(path, &it->second);
+}
+
+std::shared_ptr<Asset> ResourceCache::insert(const std::string &path, std::shared_ptr<Asset> asset) {
+    auto &type_stats = stats::asset_type_stats(asset_type(path));
+    asset->_type_stats = &type_stats;
+
+    ++type_stats.resident_count;
+    type_stats.resident_bytes += asset->_file_contents.size();
+    _bytes += asset->_file_contents.size();
+
+    auto &entry = _entries[path];
+    entry.asset = std::move(asset);
+    entry.released = false;
 
-        if (load_newest_asset_contents(path, &file_contents)) {
-            auto asset = std::make_shared<Asset>(file_contents);
-            gLoadedAssets[path] = asset;
-            return asset;
+    auto handle = acquire(path, &entry);
+    trim();
+    return handle;
+}
+
+void ResourceCache::restore_contents(Asset *asset, std::string file_contents) {
+    asset->replace_contents(std::move(file_contents));
+}
+
+void ResourceCache::resize(Asset *asset, size_t old_size) {
+    auto new_size = asset->_file_contents.size();
+
+    asset->_type_stats->resident_bytes += new_size - old_size;
+    _bytes += new_size - old_size;
+}
+
+void ResourceCache::trim() {
+    collect_released();
+
+    while (_bytes > gResourceCacheOptions.budget_bytes && !_released.empty()) {
+        auto it = _entries.find(_released.front());
+        _released.pop_front();
+
+        auto &asset = *it->second.asset;
+        auto &type_stats = *asset._type_stats;
+
+        type_stats.evictions.increment();
+        --type_stats.resident_count;
+        type_stats.resident_bytes -= asset._file_contents.size();
+        _bytes -= asset._file_contents.size();
+
+        asset._type_stats = nullptr;
+        _entries.erase(it);
+    }
+}
+
+std::shared_ptr<Asset> ResourceCache::acquire(const std::string &path, Entry *entry) {
+    auto handle = entry->handle.lock();
+    if (handle) {
+        return handle;
+    }
+
+    if (entry->released) {
+        _released.erase(entry->released_position);
+        entry->released = false;
+    }
+
+    // The deleter keeps its own reference, so handles stay valid even if
+    // the cache has let go of the asset
+    auto owner = entry->asset;
+    handle = std::shared_ptr<Asset>(owner.get(), [this, owner, path](Asset*) {
+        std::lock_guard<std::mutex> lock(_newly_released_mutex);
+        _newly_released.push_back(path);
+    });
+
+    entry->handle = handle;
+    return handle;
+}
+
+void ResourceCache::collect_released() {
+    std::vector<std::string> newly_released;
+    {
+        std::lock_guard<std::mutex> lock(_newly_released_mutex);
+        newly_released.swap(_newly_released);
+    }
+
+    for (auto &path : newly_released) {
+        auto it = _entries.find(path);
+
+        // Requested again since, or released twice before being collected
+        if (it == _entries.end() || it->second.released || !it->second.handle.expired()) {
+            continue;
         }
 
+        it->second.released = true;
+        it->second.released_position = _released.insert(_released.end(), std::move(path));
+    }
+}
+
+void rosewood::core::set_resource_cache_options(const ResourceCacheOptions &options) {
+    gResourceCacheOptions = options;
+    trim_resource_cache();
+}
+
+const ResourceCacheOptions &rosewood::core::resource_cache_options() {
+    return gResourceCacheOptions;
+}
+
+void rosewood::core::trim_resource_cache() {
+    resource_cache()->trim();
+}
+
+std::shared_ptr<Asset> rosewood::core::get_resource(std::string path) {
+    auto cache = resource_cache();
+    auto asset = cache->find(path);
+
+    if (asset && asset->has_contents()) {
+        count_lookup(path, true);
+        return asset;
+    }
+
+    count_lookup(path, false);
+
+    RW_PROFILE_SCOPE("resources.load");
+
+    std::string file_contents;
+    if (!load_newest_asset_contents(path, &file_contents)) {
         LOG(WARNING) << "Could not find asset named " << path;
-        return nullptr;
+        return asset;
     }
 
-    return gLoadedAssets[path].lock();
+    if (asset) {
+        cache->restore_contents(asset.get(), std::move(file_contents));
+        return asset;
+    }
+
+    return cache->insert(path, std::make_shared<Asset>(std::move(file_contents)));
 }
 
 void rosewood::core::notify_file_changed(std::string path) {
-    if (gLoadedAssets.find(path) == gLoadedAssets.end()) return;
-
-    auto asset = get_resource(path);
+    auto asset = resource_cache()->find(path);
+    if (!asset) return;
 
     std::string file_contents;
     if (load_newest_asset_contents(path, &file_contents)) {
         asset->set_file_contents(file_contents);
     }
 }
+
+// When each changed path was last reported by a loader
+static std::unordered_map<std::string, std::chrono::steady_clock::time_point> gPendingChanges;
+
+// Time from the file being modified to the asset's views having been
+// notified
+static const Counter gHotReloads("resources.hot_reloads");
+static const Histogram gHotReloadLatency("resources.hot_reload_latency_usec");
+
+void rosewood::core::reload_changed_resources(double quiet_usec) {
+    RW_PROFILE_SCOPE("resources.hot_reload");
+
+    auto now = std::chrono::steady_clock::now();
+
+    std::vector<IResourceLoader*> loaders;
+    {
+        std::lock_guard<std::mutex> lock(gResourceLoadersMutex);
+        for (const auto &loader : gResourceLoaders) {
+            loaders.push_back(loader.get());
+        }
+    }
+
+    std::vector<std::string> changed;
+    for (auto loader : loaders) {
+        loader->collect_changed_files(&changed);
+    }
+
+    for (auto &path : changed) {
+        gPendingChanges[path] = now;
+    }
+
+    std::vector<std::string> settled;
+    for (auto it = begin(gPendingChanges); it != end(gPendingChanges);) {
+        if (std::chrono::duration<double, std::micro>(now - it->second).count() >= quiet_usec) {
+            settled.push_back(it->first);
+            it = gPendingChanges.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for (const auto &path : settled) {
+        auto asset = resource_cache()->find(path);
+        if (!asset) continue;
+
+        std::string file_contents;
+        struct timespec mtime;
+        if (!load_newest_asset_contents(path, &file_contents, &mtime)) continue;
+
+        asset->set_file_contents(file_contents);
+
+        auto modified = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::seconds(mtime.tv_sec) + std::chrono::nanoseconds(mtime.tv_nsec)));
+        auto latency = std::chrono::duration<double, std::micro>(std::chrono::system_clock::now() - modified).count();
+
+        gHotReloads.increment();
+        gHotReloadLatency.record(latency);
+
+        LOG(INFO) << "Reloaded " << path << " " << latency / 1000 << " ms after it changed";
+    }
+}
+
+ResourceRequest::ResourceRequest(std::string path, LoadPriority priority)
+: _path(std::move(path)), _priority(priority), _cancelled(false), _done(false) { }
+
+namespace {
+
+    struct LoadJob {
+        std::shared_ptr<ResourceRequest> request;
+        ResourceDecodeFunction decode;
+        DecodedResourceCallback on_loaded;
+        uint64_t sequence;
+
+        // Filled in by the loading thread. `asset` is already set for
+        // assets that were loaded when the request was made, and the
+        // contents are then a copy to decode from.
+        std::shared_ptr<Asset> asset;
+        std::string file_contents;
+        std::shared_ptr<void> decoded;
+    };
+
+    // Lower priorities and later requests compare as less, so that the
+    // heap hands out the most important and then the oldest job first
+    struct LoadJobOrder {
+        bool operator()(const std::unique_ptr<LoadJob> &a, const std::unique_ptr<LoadJob> &b) const {
+            if (a->request->priority() != b->request->priority()) {
+                return a->request->priority() < b->request->priority();
+            }
+            return a->sequence > b->sequence;
+        }
+    };
+
+    class ResourceLoadQueue {
+    public:
+        ResourceLoadQueue() : _next_sequence(0), _stopping(false) { }
+
+        ~ResourceLoadQueue() {
+            {
+                std::lock_guard<std::mutex> lock(_pending_mutex);
+                _stopping = true;
+            }
+            _wake.notify_all();
+
+            for (auto &thread : _threads) {
+                thread.join();
+            }
+        }
+
+        void push_pending(std::unique_ptr<LoadJob> job) {
+            {
+                std::lock_guard<std::mutex> lock(_pending_mutex);
+
+                if (_threads.empty()) {
+                    for (size_t i = 0; i < kResourceLoaderThreadCount; ++i) {
+                        _threads.emplace_back(&ResourceLoadQueue::worker_main, this);
+                    }
+                }
+
+                job->sequence = _next_sequence++;
+                _pending.push_back(std::move(job));
+                std::push_heap(begin(_pending), end(_pending), LoadJobOrder());
+            }
+            _wake.notify_one();
+        }
+
+        void push_finished(std::unique_ptr<LoadJob> job) {
+            std::lock_guard<std::mutex> lock(_finished_mutex);
+            _finished.push_back(std::move(job));
+        }
+
+        std::unique_ptr<LoadJob> pop_finished(size_t *out_remaining) {
+            std::lock_guard<std::mutex> lock(_finished_mutex);
+
+            std::unique_ptr<LoadJob> job;
+            if (!_finished.empty()) {
+                job = std::move(_finished.front());
+                _finished.pop_front();
+            }
+
+            *out_remaining = _finished.size();
+            return job;
+        }
+
+    private:
+        std::mutex _pending_mutex;
+        std::condition_variable _wake;
+        std::vector<std::unique_ptr<LoadJob>> _pending;
+        uint64_t _next_sequence;
+        bool _stopping;
+
+        std::mutex _finished_mutex;
+        std::deque<std::unique_ptr<LoadJob>> _finished;
+
+        std::vector<std::thread> _threads;
+
+        void worker_main() {
+            rosewood::core::profiler::set_thread_name("resource loader");
+
+            for (;;) {
+                std::unique_ptr<LoadJob> job;
+                {
+                    std::unique_lock<std::mutex> lock(_pending_mutex);
+                    _wake.wait(lock, [this] { return _stopping || !_pending.empty(); });
+
+                    if (_stopping) return;
+
+                    std::pop_heap(begin(_pending), end(_pending), LoadJobOrder());
+                    job = std::move(_pending.back());
+                    _pending.pop_back();
+                }
+
+                if (job->request->is_cancelled()) continue;
+
+                load(job.get());
+
+                if (job->request->is_cancelled()) continue;
+
+                push_finished(std::move(job));
+            }
+        }
+
+        static void load(LoadJob *job) {
+            RW_PROFILE_SCOPE("resources.load");
+
+            if (!job->asset) {
+                std::string file_contents;
+                if (!load_newest_asset_contents(job->request->path(), &file_contents)) {
+                    return;
+                }
+
+                // Not visible to any other thread until it is committed
+                job->asset = std::make_shared<Asset>(std::move(file_contents));
+                if (job->decode) {
+                    job->decoded = job->decode(job->asset->str());
+                }
+            }
+            else if (job->decode) {
+                job->decoded = job->decode(job->file_contents);
+                job->file_contents.clear();
+            }
+        }
+    };
+
+}
+
+// Declared after the loaders, so that the loading threads are stopped
+// before the loaders they use are destroyed
+static ResourceLoadQueue gResourceLoadQueue;
+
+std::shared_ptr<ResourceRequest> rosewood::core::get_resource_async(std::string path,
+                                                                    ResourceCallback on_loaded,
+                                                                    LoadPriority priority) {
+    return get_resource_async(std::move(path), nullptr,
+                              [on_loaded](const std::shared_ptr<Asset> &asset, const std::shared_ptr<void>&) {
+                                  on_loaded(asset);
+                              },
+                              priority);
+}
+
+std::shared_ptr<ResourceRequest> rosewood::core::get_resource_async(std::string path,
+                                                                    ResourceDecodeFunction decode,
+                                                                    DecodedResourceCallback on_loaded,
+                                                                    LoadPriority priority) {
+    auto request = std::make_shared<ResourceRequest>(std::move(path), priority);
+
+    std::unique_ptr<LoadJob> job(new LoadJob);
+    job->request = request;
+    job->decode = std::move(decode);
+    job->on_loaded = std::move(on_loaded);
+    job->asset = resource_cache()->find(request->path());
+
+    // Assets whose contents were dropped are read again
+    if (job->asset && !job->asset->has_contents()) {
+        job->asset = nullptr;
+    }
+    count_lookup(request->path(), !!job->asset);
+
+    if (job->asset && !job->decode) {
+        gResourceLoadQueue.push_finished(std::move(job));
+    }
+    else {
+        if (job->asset) {
+            // The asset may be reloaded while the copy is being decoded
+            job->file_contents = job->asset->str();
+        }
+        gResourceLoadQueue.push_pending(std::move(job));
+    }
+
+    return request;
+}
+
+size_t rosewood::core::commit_loaded_resources(double budget_usec) {
+    RW_PROFILE_SCOPE("resources.commit");
+
+    auto start = std::chrono::steady_clock::now();
+    auto cache = resource_cache();
+
+    size_t remaining = 0;
+
+    for (;;) {
+        auto job = gResourceLoadQueue.pop_finished(&remaining);
+        if (!job) break;
+
+        auto &request = *job->request;
+        if (!request.is_cancelled()) {
+            auto asset = job->asset;
+
+            if (asset) {
+                // Another request or get_resource() may have published the
+                // same file in the meantime, possibly with its contents
+                // dropped since
+                auto loaded = cache->find(request.path());
+                if (!loaded) {
+                    asset = cache->insert(request.path(), std::move(asset));
+                }
+                else {
+                    if (loaded != asset && !loaded->has_contents()) {
+                        cache->restore_contents(loaded.get(), asset->str());
+                    }
+                    asset = loaded;
+                }
+            }
+            else {
+                LOG(WARNING) << "Could not find asset named " << request.path();
+            }
+
+            request._asset = asset;
+            request._done = true;
+
+            if (job->on_loaded) {
+                job->on_loaded(asset, job->decoded);
+            }
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        if (!remaining || std::chrono::duration<double, std::micro>(elapsed).count() >= budget_usec) {
+            break;
+        }
+    }
+
+    // Picks up the assets released since the last frame
+    cache->trim();
+    return remaining;
+}
@@ -1,11 +1,37 @@
 #include "rosewood/core/stats.h"
 
+#include <map>
+#include <memory>
+#include <mutex>
+
+using rosewood::core::stats::AssetTypeStats;
+
+static std::string metric_name(const std::string &type, const char *what) {
+    return "resources." + (type.empty() ? std::string("untyped") : type) + "." + what;
+}
+
+AssetTypeStats::AssetTypeStats(const std::string &type)
+: hits_name(metric_name(type, "hits"))
+, misses_name(metric_name(type, "misses"))
+, evictions_name(metric_name(type, "evictions"))
+, hits(hits_name.c_str()), misses(misses_name.c_str()), evictions(evictions_name.c_str())
+, resident_count(0), resident_bytes(0) { }
+
 namespace rosewood { namespace core { namespace stats {
 
-    Counter<size_t> draw_calls;
-    Counter<size_t> triangle_count;
-    Counter<size_t> shader_change_count;
-    size_t render_queue_size;
+    AssetTypeStats &asset_type_stats(const std::string &type) {
+        // Leaked, since cached assets point into it until exit
+        static auto mutex = new std::mutex;
+        static auto asset_types = new std::map<std::string, std::unique_ptr<AssetTypeStats>>;
+
+        std::lock_guard<std::mutex> lock(*mutex);
+
+        auto &type_stats = (*asset_types)[type];
+        if (!type_stats) {
+            type_stats.reset(new AssetTypeStats(type));
+        }
+        return *type_stats;
+    }
 
     int debug_single_draw_call_index;
     bool debug_single_draw_call_enabled = false;
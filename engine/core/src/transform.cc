@@ -1,23 +1,67 @@
 #include "rosewood/core/transform.h"
 
+#include <algorithm>
+
 #include "rosewood/math/matrix4.h"
 #include "rosewood/math/quaternion.h"
 #include "rosewood/math/vector.h"
 
 using rosewood::core::Entity;
 using rosewood::core::Transform;
+using rosewood::core::TransformHierarchy;
 
-using rosewood::math::Matrix4;
 using rosewood::math::Vector3;
 using rosewood::math::Quaternion;
 using rosewood::math::quaternion_from_axis_angle;
-using rosewood::math::quaternion_identity;
+
+static TransformHierarchy *hierarchy_for(Entity entity) {
+    static TransformHierarchy detached_hierarchy;
+
+    return entity.owner ? &entity.owner->transform_hierarchy() : &detached_hierarchy;
+}
 
 Transform::Transform(Entity entity)
 : core::Component<Transform>(entity)
-, _parent(nullptr), _local_position(0, 0, 0)
-, _local_scale(1, 1, 1), _local_rotation(quaternion_identity())
-, _transform_matrices_invalid(true) {
+, _hierarchy(hierarchy_for(entity)), _node(_hierarchy->create_node(this))
+, _parent(nullptr) {
+}
+
+// Archetype storage relocates components, so the parent, the children and
+// the hierarchy need to learn the new address.
+Transform::Transform(Transform &&other)
+: core::Component<Transform>(other.entity())
+, _hierarchy(other._hierarchy), _node(other._node)
+, _children(std::move(other._children)), _parent(other._parent) {
+    other._node = TransformHierarchy::kNoNode;
+    other._children.clear();
+    other._parent = nullptr;
+
+    _hierarchy->set_owner(_node, this);
+
+    if (_parent) {
+        *std::find(begin(_parent->_children), end(_parent->_children), &other) = this;
+    }
+
+    for (auto child : _children) {
+        child->_parent = this;
+    }
+}
+
+Transform::~Transform() {
+    if (_node == TransformHierarchy::kNoNode) {
+        return;
+    }
+
+    for (auto child : _children) {
+        child->_parent = nullptr;
+        _hierarchy->set_parent(child->_node, TransformHierarchy::kNoNode);
+    }
+
+    if (_parent) {
+        remove_from_parent();
+    }
+
+    _hierarchy->destroy_node(_node);
 }
 
 void Transform::set_local_axis_angle(float x, float y, float z, float angle) {
@@ -59,30 +103,8 @@ void Transform::set_local_position_preserving_child_world_positions(Vector3 v) {
     for (auto child : _children) {
         child_positions.push_back(child->world_position());
     }
-    _local_position = v;
-    invalidate_transform_matrices();
+    _hierarchy->set_local_position(_node, v);
     for (size_t i = 0; i < _children.size(); ++i) {
         _children[i]->set_world_position(child_positions[i]);
     }
 }
-
-void Transform::construct_transform_matrices() const {
-    Matrix4 local_transform = math::make_translation4(_local_position);
-    math::apply_rotate_by(local_transform, _local_rotation);
-    math::apply_scale_by(local_transform, _local_scale);
-
-    Matrix4 inverse_local_transform = math::make_scale4(1.0f / _local_scale);
-    math::apply_rotate_by(inverse_local_transform, conjugate(_local_rotation));
-    math::apply_translate_by(inverse_local_transform, -_local_position);
-
-    Matrix4 parent_world_transform = _parent ? _parent->world_transform() : math::make_identity4();
-    Matrix4 inverse_parent_world_transform = (_parent
-                                              ? _parent->inverse_world_transform()
-                                              : math::make_identity4());
-
-    _local_transform = local_transform;
-    _inverse_local_transform = inverse_local_transform;
-    _world_transform = parent_world_transform * _local_transform;
-    _inverse_world_transform = _inverse_local_transform * inverse_parent_world_transform;
-    _transform_matrices_invalid = false;
-}
@@ -0,0 +1,282 @@
+#include "rosewood/core/transform_hierarchy.h"
+
+#include <algorithm>
+
+#include "rosewood/core/entity.h"
+#include "rosewood/core/transform.h"
+
+#include "rosewood/math/matrix4.h"
+#include "rosewood/math/quaternion.h"
+#include "rosewood/math/vector.h"
+
+using rosewood::core::TransformHierarchy;
+
+using rosewood::math::Matrix4;
+using rosewood::math::Quaternion;
+using rosewood::math::Vector3;
+using rosewood::math::quaternion_identity;
+
+const size_t TransformHierarchy::kNoNode;
+
+TransformHierarchy::TransformHierarchy() : _tracks_world_changes(false), _order_invalid(false) { }
+
+size_t TransformHierarchy::create_node(Transform *owner) {
+    size_t node;
+
+    if (_free_nodes.empty()) {
+        node = _owners.size();
+
+        _owners.push_back(owner);
+        _parents.push_back(kNoNode);
+        _local_positions.push_back(Vector3(0, 0, 0));
+        _local_rotations.push_back(quaternion_identity());
+        _local_scales.push_back(Vector3(1, 1, 1));
+        _local_transforms.push_back(math::make_identity4());
+        _inverse_local_transforms.push_back(math::make_identity4());
+        _world_transforms.push_back(math::make_identity4());
+        _inverse_world_transforms.push_back(math::make_identity4());
+        _dirty.push_back(1);
+        _world_versions.push_back(0);
+        _parent_versions.push_back(0);
+        _world_changed.push_back(0);
+    }
+    else {
+        node = _free_nodes.back();
+        _free_nodes.pop_back();
+
+        // Nothing from the previous owner may leak into the new one. The
+        // node might still be listed in _world_changes, which
+        // take_world_changes() copes with.
+        _owners[node] = owner;
+        _parents[node] = kNoNode;
+        _local_positions[node] = Vector3(0, 0, 0);
+        _local_rotations[node] = quaternion_identity();
+        _local_scales[node] = Vector3(1, 1, 1);
+        _local_transforms[node] = math::make_identity4();
+        _inverse_local_transforms[node] = math::make_identity4();
+        _world_transforms[node] = math::make_identity4();
+        _inverse_world_transforms[node] = math::make_identity4();
+        _dirty[node] = 1;
+        _world_versions[node] = 0;
+        _parent_versions[node] = 0;
+        _world_changed[node] = 0;
+    }
+
+    return node;
+}
+
+void TransformHierarchy::destroy_node(size_t node) {
+    _owners[node] = nullptr;
+    _parents[node] = kNoNode;
+    _free_nodes.push_back(node);
+}
+
+void TransformHierarchy::set_parent(size_t node, size_t parent) {
+    _parents[node] = parent;
+    _dirty[node] = 1;
+
+    // update() relies on parents being stored before their children
+    if (parent != kNoNode && parent > node) {
+        _order_invalid = true;
+    }
+}
+
+void TransformHierarchy::update() {
+    if (_order_invalid) {
+        sort_nodes();
+    }
+
+    // Parents come first, so their world matrices are always up to date
+    // by the time we look at their children.
+    for (size_t node = 0; node < _owners.size(); ++node) {
+        if (!_owners[node]) continue;
+
+        auto parent = _parents[node];
+        if (_dirty[node] || (parent != kNoNode && _parent_versions[node] != _world_versions[parent])) {
+            update_node(node);
+        }
+
+        if (_tracks_world_changes && _world_changed[node] == 1) {
+            _world_changed[node] = 2;
+            _world_changes.push_back(node);
+        }
+    }
+}
+
+void TransformHierarchy::take_world_changes(std::vector<Entity> *changed) {
+    changed->clear();
+
+    // A node reused after being listed can be listed twice, but its flag
+    // is only set for the first entry
+    for (auto node : _world_changes) {
+        if (_world_changed[node] != 2) continue;
+        _world_changed[node] = 0;
+
+        if (_owners[node]) {
+            changed->push_back(_owners[node]->entity());
+        }
+    }
+
+    _world_changes.clear();
+}
+
+bool TransformHierarchy::is_stale(size_t node) const {
+    while (true) {
+        if (_dirty[node]) {
+            return true;
+        }
+
+        auto parent = _parents[node];
+        if (parent == kNoNode) {
+            return false;
+        }
+        if (_parent_versions[node] != _world_versions[parent]) {
+            return true;
+        }
+
+        node = parent;
+    }
+}
+
+void TransformHierarchy::update_node_if_stale(size_t node) {
+    if (!is_stale(node)) {
+        return;
+    }
+
+    auto parent = _parents[node];
+    if (parent != kNoNode) {
+        update_node_if_stale(parent);
+    }
+
+    update_node(node);
+}
+
+void TransformHierarchy::update_node(size_t node) {
+    if (_dirty[node]) {
+        auto position = _local_positions[node];
+        auto rotation = _local_rotations[node];
+        auto scale = _local_scales[node];
+
+        Matrix4 local_transform = math::make_translation4(position);
+        math::apply_rotate_by(local_transform, rotation);
+        math::apply_scale_by(local_transform, scale);
+
+        Matrix4 inverse_local_transform = math::make_scale4(1.0f / scale);
+        math::apply_rotate_by(inverse_local_transform, conjugate(rotation));
+        math::apply_translate_by(inverse_local_transform, -position);
+
+        _local_transforms[node] = local_transform;
+        _inverse_local_transforms[node] = inverse_local_transform;
+        _dirty[node] = 0;
+    }
+
+    auto parent = _parents[node];
+    if (parent != kNoNode) {
+        _world_transforms[node] = _world_transforms[parent] * _local_transforms[node];
+        _inverse_world_transforms[node] = _inverse_local_transforms[node] * _inverse_world_transforms[parent];
+        _parent_versions[node] = _world_versions[parent];
+    }
+    else {
+        _world_transforms[node] = _local_transforms[node];
+        _inverse_world_transforms[node] = _inverse_local_transforms[node];
+    }
+
+    ++_world_versions[node];
+
+    if (!_world_changed[node]) {
+        _world_changed[node] = 1;
+    }
+}
+
+template<typename T>
+static void permute(std::vector<T> &values, const std::vector<size_t> &new_to_old) {
+    std::vector<T> permuted;
+    permuted.reserve(new_to_old.size());
+
+    for (auto old_node : new_to_old) {
+        permuted.push_back(values[old_node]);
+    }
+
+    values.swap(permuted);
+}
+
+void TransformHierarchy::sort_nodes() {
+    // Depths are computed from the parent links rather than maintained on
+    // reparenting, since that would mean walking whole subtrees.
+    std::vector<unsigned int> depths(_owners.size(), 0);
+    std::vector<unsigned char> depth_known(_owners.size(), 0);
+    std::vector<size_t> chain;
+    unsigned int max_depth = 0;
+
+    for (size_t node = 0; node < _owners.size(); ++node) {
+        if (!_owners[node] || depth_known[node]) continue;
+
+        auto current = node;
+        while (current != kNoNode && !depth_known[current]) {
+            chain.push_back(current);
+            current = _parents[current];
+        }
+
+        auto depth = current == kNoNode ? 0 : depths[current] + 1;
+        while (!chain.empty()) {
+            depths[chain.back()] = depth++;
+            depth_known[chain.back()] = 1;
+            chain.pop_back();
+        }
+
+        max_depth = std::max(max_depth, depth - 1);
+    }
+
+    // Counting sort by depth, keeping the current order within each
+    // level, and dropping the free nodes.
+    std::vector<size_t> level_starts(max_depth + 2, 0);
+    for (size_t node = 0; node < _owners.size(); ++node) {
+        if (_owners[node]) ++level_starts[depths[node] + 1];
+    }
+    for (size_t level = 1; level < level_starts.size(); ++level) {
+        level_starts[level] += level_starts[level - 1];
+    }
+
+    std::vector<size_t> new_to_old(level_starts.back());
+    std::vector<size_t> old_to_new(_owners.size(), kNoNode);
+    for (size_t node = 0; node < _owners.size(); ++node) {
+        if (!_owners[node]) continue;
+
+        auto new_node = level_starts[depths[node]]++;
+        new_to_old[new_node] = node;
+        old_to_new[node] = new_node;
+    }
+
+    permute(_owners, new_to_old);
+    permute(_parents, new_to_old);
+    permute(_local_positions, new_to_old);
+    permute(_local_rotations, new_to_old);
+    permute(_local_scales, new_to_old);
+    permute(_local_transforms, new_to_old);
+    permute(_inverse_local_transforms, new_to_old);
+    permute(_world_transforms, new_to_old);
+    permute(_inverse_world_transforms, new_to_old);
+    permute(_dirty, new_to_old);
+    permute(_world_versions, new_to_old);
+    permute(_parent_versions, new_to_old);
+    permute(_world_changed, new_to_old);
+
+    // Recorded changes of destroyed nodes are dropped along with them
+    std::vector<size_t> world_changes;
+    for (auto node : _world_changes) {
+        if (old_to_new[node] != kNoNode) {
+            world_changes.push_back(old_to_new[node]);
+        }
+    }
+    _world_changes.swap(world_changes);
+
+    for (size_t node = 0; node < _owners.size(); ++node) {
+        if (_parents[node] != kNoNode) {
+            _parents[node] = old_to_new[_parents[node]];
+        }
+        _owners[node]->_node = node;
+    }
+
+    _free_nodes.clear();
+    _order_invalid = false;
+}
@@ -0,0 +1,83 @@
+#ifndef __ROSEWOOD_DATA_FORMAT_ASSET_ARCHIVE_H__
+#define __ROSEWOOD_DATA_FORMAT_ASSET_ARCHIVE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rosewood/data-format/mapped_file.h"
+
+namespace rosewood { namespace data_format {
+
+    // Many assets packed into one file, as written by the build server's
+    // `pack` command:
+    //
+    //     "RWPK", u32 version, u32 entry count, u32 string table size
+    //     entries, sorted by path hash and then path:
+    //         u64 path hash, u64 data offset, u64 size, u64 stored size,
+    //         u32 path offset, u16 path length, u16 flags
+    //     path string table
+    //     entry data, each entry aligned to kDataAlignment
+    //
+    // Numbers are big endian like in RBDEF, and path hashes are 64 bit
+    // FNV-1a. Compressed entries are zlib streams which inflate to `size`
+    // bytes.
+    class AssetArchive {
+    public:
+        struct Entry {
+            const char *data;
+            size_t stored_size;
+            size_t size;
+            bool compressed;
+        };
+
+        static const uint32_t kVersion = 1;
+        static const size_t kDataAlignment = 16;
+
+        enum EntryFlags {
+            kCompressed = 1,
+        };
+
+        // Returns nullptr if the file can't be mapped or is not a valid
+        // archive
+        static std::unique_ptr<AssetArchive> open(const std::string &path);
+
+        size_t entry_count() const { return _entry_count; }
+
+        // Binary search over the index, without allocating
+        bool find(const std::string &path, Entry *out_entry) const;
+
+        // Copies the entry's bytes, inflating them if needed
+        static bool read(const Entry &entry, std::string *out_contents);
+
+        static uint64_t path_hash(const char *path, size_t length);
+
+        AssetArchive(const AssetArchive&) = delete;
+        AssetArchive &operator=(const AssetArchive&) = delete;
+
+    private:
+        std::unique_ptr<MappedFile> _file;
+        const char *_index;
+        size_t _entry_count;
+        const char *_strings;
+        size_t _strings_size;
+
+        AssetArchive(std::unique_ptr<MappedFile> file) : _file(std::move(file)) { }
+    };
+
+    struct AssetArchiveFile {
+        std::string path;
+        std::string contents;
+        bool compress;
+    };
+
+    // Writes `files` as an archive. Meant for tools and tests; the build
+    // server has its own writer.
+    bool write_asset_archive(const std::string &path, const std::vector<AssetArchiveFile> &files);
+
+} }
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef __ROSEWOOD_DATA_FORMAT_MAPPED_FILE_H__
+#define __ROSEWOOD_DATA_FORMAT_MAPPED_FILE_H__
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+
+#include "rosewood/data-format/object_view.h"
+
+namespace rosewood { namespace data_format {
+
+    // A read-only memory mapping of a whole file. Views created from it
+    // are valid for as long as the MappedFile is alive.
+    class MappedFile {
+    public:
+        // Returns nullptr if the file can't be opened or mapped
+        static std::unique_ptr<MappedFile> open(const std::string &path);
+
+        ~MappedFile();
+
+        const char *data() const { return _data; }
+        size_t size() const { return _size; }
+
+        ObjectView root() const { return ObjectView(_data, _size); }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile &operator=(const MappedFile&) = delete;
+
+    private:
+        const char *_data;
+        size_t _size;
+
+        MappedFile(const char *data, size_t size) : _data(data), _size(size) { }
+    };
+
+} }
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef __ROSEWOOD_DATA_FORMAT_OBJECT_VIEW_H__
+#define __ROSEWOOD_DATA_FORMAT_OBJECT_VIEW_H__
+
+#include <stddef.h>
+#include <string.h>
+
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "rosewood/core/assert.h"
+
+#include "rosewood/data-format/object.h"
+
+namespace rosewood { namespace data_format {
+
+    // A non-owning reference to a run of bytes, used for strings read
+    // through an ObjectView.
+    class StringView {
+    public:
+        StringView() : _data(nullptr), _size(0) { }
+        StringView(const char *data, size_t size) : _data(data), _size(size) { }
+        StringView(const char *c_str) : _data(c_str), _size(strlen(c_str)) { }
+        StringView(const std::string &string) : _data(string.data()), _size(string.size()) { }
+
+        const char *data() const { return _data; }
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+
+        const char *begin() const { return _data; }
+        const char *end() const { return _data + _size; }
+
+        char operator[](size_t index) const { return _data[index]; }
+
+        std::string str() const { return std::string(_data, _size); }
+
+    private:
+        const char *_data;
+        size_t _size;
+    };
+
+    inline bool operator==(StringView a, StringView b) {
+        return a.size() == b.size() && (a.size() == 0 || memcmp(a.data(), b.data(), a.size()) == 0);
+    }
+
+    inline bool operator!=(StringView a, StringView b) {
+        return !(a == b);
+    }
+
+    // Element types of packed typed arrays
+    enum class TypedArrayType {
+        Float32,
+        UInt16,
+        UInt32,
+    };
+
+    // A lazy view of an RBDEF object inside a borrowed byte buffer. Nothing
+    // is decoded until it is asked for, and strings point straight into
+    // the buffer, which must outlive the view and everything read from it.
+    //
+    // Arrays and dictionaries only store their length up front, so
+    // reaching the n:th item means skipping over the n items before it.
+    // Walk containers with begin()/end() or next() rather than indexing
+    // them in a loop.
+    class ObjectView {
+    public:
+        class Iterator;
+
+        ObjectView() : _data(nullptr), _size(0), _offset(0) { }
+        ObjectView(const char *data, size_t size) : _data(data), _size(size), _offset(0) { }
+        explicit ObjectView(const std::string &source) : _data(source.data()), _size(source.size()), _offset(0) { }
+
+        DataType type() const;
+        bool is_null() const { return type() == DataType::Null; }
+
+        bool as_bool() const;
+        long long as_int() const;
+        double as_double() const;
+        float as_float() const { return float(as_double()); }
+        StringView as_string() const;
+
+        // Number of items in an array, or key/value pairs in a dictionary
+        size_t size() const;
+
+        // Linear in the size of the skipped items
+        ObjectView operator[](size_t index) const;
+
+        // Linear in the size of the dictionary. Returns a default
+        // constructed view if the key isn't present.
+        ObjectView find(StringView key) const;
+        bool contains(StringView key) const { return find(key).valid(); }
+        ObjectView operator[](StringView key) const;
+
+        // Items of an array. For dictionaries, keys and values alternate.
+        Iterator begin() const;
+        Iterator end() const;
+
+        // The object directly following this one in the buffer
+        ObjectView next() const { return ObjectView(_data, _size, end_offset()); }
+
+        // Reads an array of numbers into result, reusing its storage. Typed
+        // arrays whose data is truncated only yield the elements present.
+        void read_floats(std::vector<float> *result) const;
+
+        // Reads at most `capacity` numbers from an array into destination,
+        // returning the number of values written. Float32 typed arrays are
+        // copied with a single memcpy on little endian hosts.
+        size_t copy_floats(float *destination, size_t capacity) const;
+
+        // Typed arrays store fixed size little endian numbers back to back.
+        // They report DataType::Array, but their items can only be read
+        // through the bulk accessors, not iterated or indexed.
+        bool is_typed_array() const { return tag() == 'v' || tag() == 'V'; }
+        TypedArrayType typed_array_type() const;
+
+        // Pointers to the elements of a typed array inside the buffer, or
+        // nullptr if this isn't a typed array of the right type, its data is
+        // truncated, or it can't be used in place (on a big endian host or
+        // a misaligned buffer).
+        const float *float_data() const;
+        const unsigned short *uint16_data() const;
+        const unsigned int *uint32_data() const;
+
+        bool valid() const { return _data != nullptr; }
+
+        // Converts this object and everything below it into an Object tree
+        Object to_object() const;
+
+    private:
+        const char *_data;
+        size_t _size;
+        size_t _offset;
+
+        ObjectView(const char *data, size_t size, size_t offset)
+        : _data(data), _size(size), _offset(offset) { }
+
+        char tag() const {
+            RW_ASSERT(_data && _offset < _size, "Can't read outside buffer");
+            return _data[_offset];
+        }
+
+        size_t header_size() const;
+        size_t typed_header_size() const;
+
+        // The elements of a typed array, and how many of them lie inside the
+        // buffer: fewer than size() if the data is truncated
+        const char *typed_elements(TypedArrayType type, size_t *out_count) const;
+        size_t first_child_offset() const { return _offset + header_size(); }
+        size_t end_offset() const;
+
+        friend class Iterator;
+    };
+
+    class ObjectView::Iterator : public std::iterator<std::forward_iterator_tag, ObjectView> {
+    public:
+        Iterator(ObjectView current, size_t remaining) : _current(current), _remaining(remaining) { }
+
+        const ObjectView &operator*() const { return _current; }
+        const ObjectView *operator->() const { return &_current; }
+
+        Iterator &operator++() {
+            if (--_remaining) {
+                _current = _current.next();
+            }
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        bool operator==(const Iterator &other) const { return _remaining == other._remaining; }
+        bool operator!=(const Iterator &other) const { return _remaining != other._remaining; }
+
+    private:
+        ObjectView _current;
+        size_t _remaining;
+    };
+
+    inline ObjectView::Iterator ObjectView::begin() const {
+        RW_ASSERT(!is_typed_array(), "Typed arrays can only be read in bulk");
+
+        auto n_items = type() == DataType::Dictionary ? 2 * size() : size();
+        return Iterator(ObjectView(_data, _size, first_child_offset()), n_items);
+    }
+
+    inline ObjectView::Iterator ObjectView::end() const {
+        return Iterator(ObjectView(), 0);
+    }
+
+} }
+
+#endif
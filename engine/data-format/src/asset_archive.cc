@@ -0,0 +1,267 @@
+#include "rosewood/data-format/asset_archive.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <zlib.h>
+
+#include "byte_order.h"
+
+using rosewood::data_format::AssetArchive;
+using rosewood::data_format::AssetArchiveFile;
+using rosewood::data_format::MappedFile;
+using rosewood::data_format::ntoh;
+
+static const char kMagic[4] = { 'R', 'W', 'P', 'K' };
+static const size_t kHeaderSize = 16;
+static const size_t kEntrySize = 40;
+
+const uint32_t AssetArchive::kVersion;
+const size_t AssetArchive::kDataAlignment;
+
+template<typename T>
+static T read_number(const char *source) {
+    T value;
+    memcpy(&value, source, sizeof(value));
+    return ntoh(value);
+}
+
+static uint64_t read_u64(const char *source) { return read_number<unsigned long long>(source); }
+static uint32_t read_u32(const char *source) { return read_number<unsigned int>(source); }
+
+static uint16_t read_u16(const char *source) {
+    auto bytes = reinterpret_cast<const unsigned char*>(source);
+    return (uint16_t)((bytes[0] << 8) | bytes[1]);
+}
+
+namespace {
+
+    // Accessors for one entry of the index
+    struct IndexEntry {
+        const char *p;
+
+        uint64_t path_hash() const { return read_u64(p); }
+        uint64_t data_offset() const { return read_u64(p + 8); }
+        uint64_t size() const { return read_u64(p + 16); }
+        uint64_t stored_size() const { return read_u64(p + 24); }
+        uint32_t path_offset() const { return read_u32(p + 32); }
+        uint16_t path_length() const { return read_u16(p + 36); }
+        uint16_t flags() const { return read_u16(p + 38); }
+    };
+
+}
+
+uint64_t AssetArchive::path_hash(const char *path, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char)path[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::unique_ptr<AssetArchive> AssetArchive::open(const std::string &path) {
+    auto file = MappedFile::open(path);
+    if (!file || file->size() < kHeaderSize || memcmp(file->data(), kMagic, sizeof(kMagic))) {
+        return nullptr;
+    }
+
+    auto data = file->data();
+    auto size = file->size();
+
+    if (read_u32(data + 4) != kVersion) {
+        return nullptr;
+    }
+
+    size_t entry_count = read_u32(data + 8);
+    size_t strings_size = read_u32(data + 12);
+
+    if ((size - kHeaderSize) / kEntrySize < entry_count
+        || size - kHeaderSize - entry_count * kEntrySize < strings_size) {
+        return nullptr;
+    }
+
+    std::unique_ptr<AssetArchive> archive(new AssetArchive(std::move(file)));
+    archive->_index = data + kHeaderSize;
+    archive->_entry_count = entry_count;
+    archive->_strings = archive->_index + entry_count * kEntrySize;
+    archive->_strings_size = strings_size;
+
+    // Check every entry once, so that lookups can trust the index
+    for (size_t i = 0; i < entry_count; ++i) {
+        IndexEntry entry{archive->_index + i * kEntrySize};
+
+        if ((uint64_t)entry.path_offset() + entry.path_length() > strings_size
+            || entry.data_offset() > size || entry.stored_size() > size - entry.data_offset()
+            || (!(entry.flags() & kCompressed) && entry.stored_size() != entry.size())) {
+            return nullptr;
+        }
+    }
+
+    return archive;
+}
+
+bool AssetArchive::find(const std::string &path, Entry *out_entry) const {
+    auto hash = path_hash(path.data(), path.size());
+
+    size_t first = 0;
+    size_t count = _entry_count;
+
+    while (count) {
+        auto step = count / 2;
+        IndexEntry entry{_index + (first + step) * kEntrySize};
+
+        if (entry.path_hash() < hash) {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else {
+            count = step;
+        }
+    }
+
+    for (size_t i = first; i < _entry_count; ++i) {
+        IndexEntry entry{_index + i * kEntrySize};
+        if (entry.path_hash() != hash) break;
+
+        if (entry.path_length() != path.size()
+            || memcmp(_strings + entry.path_offset(), path.data(), path.size())) {
+            continue;
+        }
+
+        out_entry->data = _file->data() + entry.data_offset();
+        out_entry->stored_size = (size_t)entry.stored_size();
+        out_entry->size = (size_t)entry.size();
+        out_entry->compressed = entry.flags() & kCompressed;
+        return true;
+    }
+
+    return false;
+}
+
+bool AssetArchive::read(const Entry &entry, std::string *out_contents) {
+    if (!entry.compressed) {
+        out_contents->assign(entry.data, entry.size);
+        return true;
+    }
+
+    out_contents->resize(entry.size);
+
+    uLongf size = (uLongf)entry.size;
+    auto result = uncompress(reinterpret_cast<Bytef*>(&(*out_contents)[0]), &size,
+                             reinterpret_cast<const Bytef*>(entry.data), (uLong)entry.stored_size);
+
+    if (result != Z_OK || size != entry.size) {
+        out_contents->clear();
+        return false;
+    }
+
+    return true;
+}
+
+static void write_u64(std::string *out, uint64_t value) {
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        out->push_back((char)(value >> shift));
+    }
+}
+
+static void write_u32(std::string *out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out->push_back((char)(value >> shift));
+    }
+}
+
+static void write_u16(std::string *out, uint16_t value) {
+    out->push_back((char)(value >> 8));
+    out->push_back((char)value);
+}
+
+static size_t align(size_t offset) {
+    auto mask = AssetArchive::kDataAlignment - 1;
+    return (offset + mask) & ~mask;
+}
+
+bool rosewood::data_format::write_asset_archive(const std::string &path,
+                                                const std::vector<AssetArchiveFile> &files) {
+    struct PendingEntry {
+        const AssetArchiveFile *file;
+        uint64_t hash;
+        std::string compressed;
+    };
+
+    std::vector<PendingEntry> entries;
+    for (const auto &file : files) {
+        if (file.path.size() > UINT16_MAX) {
+            return false;
+        }
+
+        PendingEntry entry{&file, AssetArchive::path_hash(file.path.data(), file.path.size()), ""};
+
+        if (file.compress) {
+            auto bound = compressBound((uLong)file.contents.size());
+            entry.compressed.resize(bound);
+
+            uLongf size = bound;
+            if (compress2(reinterpret_cast<Bytef*>(&entry.compressed[0]), &size,
+                          reinterpret_cast<const Bytef*>(file.contents.data()),
+                          (uLong)file.contents.size(), Z_BEST_COMPRESSION) != Z_OK) {
+                return false;
+            }
+
+            // Not worth inflating if it barely shrinks
+            entry.compressed.resize(size < file.contents.size() ? size : 0);
+        }
+
+        entries.push_back(std::move(entry));
+    }
+
+    std::sort(begin(entries), end(entries), [](const PendingEntry &a, const PendingEntry &b) {
+        return a.hash != b.hash ? a.hash < b.hash : a.file->path < b.file->path;
+    });
+
+    std::string strings;
+    for (const auto &entry : entries) {
+        strings += entry.file->path;
+    }
+
+    std::string out(kMagic, sizeof(kMagic));
+    write_u32(&out, AssetArchive::kVersion);
+    write_u32(&out, (uint32_t)entries.size());
+    write_u32(&out, (uint32_t)strings.size());
+
+    auto data_offset = align(kHeaderSize + entries.size() * kEntrySize + strings.size());
+    size_t path_offset = 0;
+
+    for (const auto &entry : entries) {
+        bool compressed = !entry.compressed.empty();
+        auto stored_size = compressed ? entry.compressed.size() : entry.file->contents.size();
+
+        write_u64(&out, entry.hash);
+        write_u64(&out, data_offset);
+        write_u64(&out, entry.file->contents.size());
+        write_u64(&out, stored_size);
+        write_u32(&out, (uint32_t)path_offset);
+        write_u16(&out, (uint16_t)entry.file->path.size());
+        write_u16(&out, compressed ? AssetArchive::kCompressed : 0);
+
+        data_offset = align(data_offset + stored_size);
+        path_offset += entry.file->path.size();
+    }
+
+    out += strings;
+
+    for (const auto &entry : entries) {
+        out.resize(align(out.size()));
+        out += entry.compressed.empty() ? entry.file->contents : entry.compressed;
+    }
+
+    auto fp = fopen(path.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+
+    bool written = fwrite(out.data(), 1, out.size(), fp) == out.size();
+    return fclose(fp) == 0 && written;
+}
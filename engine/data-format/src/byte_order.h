@@ -0,0 +1,53 @@
+#ifndef __ROSEWOOD_DATA_FORMAT_BYTE_ORDER_H__
+#define __ROSEWOOD_DATA_FORMAT_BYTE_ORDER_H__
+
+#include <arpa/inet.h>
+
+#if defined(__APPLE__)
+
+# include <libkern/OSByteOrder.h>
+# define ntohl64(x) OSSwapBigToHostInt64(x)
+
+#elif defined(EMSCRIPTEN)
+
+# include <endian.h>
+# define ntohl64(x) betoh64(x)
+
+#elif defined(__linux__)
+
+# include <endian.h>
+# define ntohl64(x) be64toh(x)
+
+#else
+
+# error Unknown platform - please create 64 bit byte swapping primitives
+
+#endif
+
+namespace rosewood { namespace data_format {
+
+    inline int ntoh(int x) { return ntohl(x); }
+    inline unsigned int ntoh(unsigned int x) { return ntohl(x); }
+    inline long long ntoh(long long x) { return ntohl64(x); }
+    inline unsigned long long ntoh(unsigned long long x) { return ntohl64(x); }
+
+    inline bool host_is_little_endian() {
+        return __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+    }
+
+    // Assembles little endian values byte by byte, which works regardless
+    // of the host's byte order
+    inline unsigned short read_little_endian16(const char *source) {
+        auto bytes = reinterpret_cast<const unsigned char*>(source);
+        return (unsigned short)(bytes[0] | (bytes[1] << 8));
+    }
+
+    inline unsigned int read_little_endian32(const char *source) {
+        auto bytes = reinterpret_cast<const unsigned char*>(source);
+        return (unsigned int)bytes[0] | ((unsigned int)bytes[1] << 8)
+            | ((unsigned int)bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+    }
+
+} }
+
+#endif
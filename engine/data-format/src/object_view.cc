@@ -0,0 +1,417 @@
+#include "rosewood/data-format/object_view.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <type_traits>
+
+#include "byte_order.h"
+
+using rosewood::data_format::DataType;
+using rosewood::data_format::Object;
+using rosewood::data_format::ObjectView;
+using rosewood::data_format::StringView;
+using rosewood::data_format::TypedArrayType;
+using rosewood::data_format::host_is_little_endian;
+using rosewood::data_format::ntoh;
+using rosewood::data_format::read_little_endian16;
+using rosewood::data_format::read_little_endian32;
+
+template<typename T>
+static T read_number(const char *source) {
+    T value;
+    memcpy(&value, source, sizeof(value));
+    return ntoh(value);
+}
+
+static float read_float32(const char *source) {
+    auto bits = read_number<unsigned int>(source);
+    float number;
+    memcpy(&number, &bits, sizeof(number));
+    return number;
+}
+
+static double read_float64(const char *source) {
+    auto bits = read_number<unsigned long long>(source);
+    double number;
+    memcpy(&number, &bits, sizeof(number));
+    return number;
+}
+
+static float read_little_endian_float32(const char *source) {
+    auto bits = read_little_endian32(source);
+    float number;
+    memcpy(&number, &bits, sizeof(number));
+    return number;
+}
+
+static size_t element_size(TypedArrayType type) {
+    switch (type) {
+        case TypedArrayType::Float32: return 4;
+        case TypedArrayType::UInt16: return 2;
+        case TypedArrayType::UInt32: return 4;
+    }
+
+    RW_UNREACHABLE("Unknown typed array type");
+}
+
+template<typename T>
+static const T *in_place(const char *elements) {
+    if (!elements || !host_is_little_endian()
+        || reinterpret_cast<uintptr_t>(elements) % std::alignment_of<T>::value) {
+        return nullptr;
+    }
+
+    return reinterpret_cast<const T*>(elements);
+}
+
+DataType ObjectView::type() const {
+    switch (tag()) {
+        case 'n': return DataType::Null;
+        case 'f': case 't': return DataType::Boolean;
+        case 'i': case 'I': return DataType::IntOrFloat;
+        case 'p': case 'P': return DataType::Float;
+        case 's': case 'S': return DataType::String;
+        case 'a': case 'A': case 'v': case 'V': return DataType::Array;
+        case 'd': case 'D': return DataType::Dictionary;
+    }
+
+    RW_UNREACHABLE("Unknown byte in RBDEF");
+}
+
+bool ObjectView::as_bool() const {
+    RW_ASSERT(type() == DataType::Boolean, "Can't convert non-boolean to boolean");
+    return tag() == 't';
+}
+
+long long ObjectView::as_int() const {
+    switch (tag()) {
+        case 'i': return read_number<int>(_data + _offset + 1);
+        case 'I': return read_number<long long>(_data + _offset + 1);
+    }
+
+    RW_UNREACHABLE("Can't convert non-integral to int");
+}
+
+double ObjectView::as_double() const {
+    switch (tag()) {
+        case 'i': return read_number<int>(_data + _offset + 1);
+        case 'I': return read_number<long long>(_data + _offset + 1);
+        case 'p': return read_float32(_data + _offset + 1);
+        case 'P': return read_float64(_data + _offset + 1);
+    }
+
+    RW_UNREACHABLE("Can't convert non-number to double");
+}
+
+StringView ObjectView::as_string() const {
+    RW_ASSERT(type() == DataType::String, "Can't convert non-string to string");
+
+    auto length = size();
+    auto start = first_child_offset();
+    RW_ASSERT(start + length <= _size, "Can't read outside buffer");
+
+    return StringView(_data + start, length);
+}
+
+size_t ObjectView::size() const {
+    switch (tag()) {
+        case 'v':
+            return read_number<unsigned int>(_data + _offset + 2);
+        case 'V':
+            return (size_t)read_number<unsigned long long>(_data + _offset + 2);
+        case 's': case 'a': case 'd':
+            return read_number<unsigned int>(_data + _offset + 1);
+        case 'S': case 'A': case 'D':
+            return (size_t)read_number<unsigned long long>(_data + _offset + 1);
+    }
+
+    RW_UNREACHABLE("Only strings, arrays and dictionaries have a size");
+}
+
+ObjectView ObjectView::operator[](size_t index) const {
+    RW_ASSERT(type() == DataType::Array, "Can only use operator [int] for array-like objects");
+    RW_ASSERT(!is_typed_array(), "Typed arrays can only be read in bulk");
+    RW_ASSERT(index < size(), "Array index out of bounds");
+
+    auto item = ObjectView(_data, _size, first_child_offset());
+    while (index--) {
+        item = item.next();
+    }
+
+    return item;
+}
+
+ObjectView ObjectView::find(StringView key) const {
+    RW_ASSERT(type() == DataType::Dictionary, "Can only look up keys in dictionary-like objects");
+
+    auto n_pairs = size();
+    auto item_key = ObjectView(_data, _size, first_child_offset());
+
+    for (size_t i = 0; i < n_pairs; ++i) {
+        auto value = item_key.next();
+        if (item_key.as_string() == key) {
+            return value;
+        }
+        item_key = value.next();
+    }
+
+    return ObjectView();
+}
+
+ObjectView ObjectView::operator[](StringView key) const {
+    auto value = find(key);
+    RW_ASSERT(value.valid(), "Key not found in dictionary");
+    return value;
+}
+
+void ObjectView::read_floats(std::vector<float> *result) const {
+    result->resize(size());
+    result->resize(copy_floats(result->data(), result->size()));
+}
+
+size_t ObjectView::copy_floats(float *destination, size_t capacity) const {
+    RW_ASSERT(type() == DataType::Array, "Can't read floats from non-array");
+
+    auto count = std::min(size(), capacity);
+
+    if (is_typed_array()) {
+        auto type = typed_array_type();
+        size_t n_elements;
+        auto elements = typed_elements(type, &n_elements);
+        count = std::min(count, n_elements);
+
+        switch (type) {
+            case TypedArrayType::Float32:
+                if (host_is_little_endian()) {
+                    memcpy(destination, elements, count * sizeof(float));
+                }
+                else {
+                    for (size_t i = 0; i < count; ++i) {
+                        destination[i] = read_little_endian_float32(elements + 4 * i);
+                    }
+                }
+                break;
+            case TypedArrayType::UInt16:
+                for (size_t i = 0; i < count; ++i) {
+                    destination[i] = float(read_little_endian16(elements + 2 * i));
+                }
+                break;
+            case TypedArrayType::UInt32:
+                for (size_t i = 0; i < count; ++i) {
+                    destination[i] = float(read_little_endian32(elements + 4 * i));
+                }
+                break;
+        }
+
+        return count;
+    }
+
+    auto position = first_child_offset();
+
+    for (size_t i = 0; i < count; ++i) {
+        RW_ASSERT(position < _size, "Can't read outside buffer");
+
+        auto source = _data + position + 1;
+        switch (_data[position]) {
+            case 'p': destination[i] = read_float32(source); position += 5; break;
+            case 'P': destination[i] = float(read_float64(source)); position += 9; break;
+            case 'i': destination[i] = float(read_number<int>(source)); position += 5; break;
+            case 'I': destination[i] = float(read_number<long long>(source)); position += 9; break;
+            default:
+                RW_UNREACHABLE("Can't convert non-number to float");
+        }
+    }
+
+    return count;
+}
+
+Object ObjectView::to_object() const {
+    switch (type()) {
+        case DataType::Null:
+            return Object::make_null();
+
+        case DataType::Boolean:
+            return Object::make_boolean(as_bool());
+
+        case DataType::IntOrFloat:
+            return Object::make_int(as_int());
+
+        case DataType::Float:
+            return Object::make_float(as_double());
+
+        case DataType::String:
+            return Object::make_string(as_string().str());
+
+        case DataType::Array: {
+            Object result(DataType::Array);
+            result.array.reserve(size());
+
+            if (is_typed_array()) {
+                auto type = typed_array_type();
+                size_t n_elements;
+                auto elements = typed_elements(type, &n_elements);
+
+                for (size_t i = 0; i < n_elements; ++i) {
+                    switch (type) {
+                        case TypedArrayType::Float32:
+                            result.array.emplace_back(Object::make_float(read_little_endian_float32(elements + 4 * i)));
+                            break;
+                        case TypedArrayType::UInt16:
+                            result.array.emplace_back(Object::make_int(read_little_endian16(elements + 2 * i)));
+                            break;
+                        case TypedArrayType::UInt32:
+                            result.array.emplace_back(Object::make_int(read_little_endian32(elements + 4 * i)));
+                            break;
+                    }
+                }
+                return result;
+            }
+
+            for (const auto &item : *this) {
+                result.array.emplace_back(item.to_object());
+            }
+            return result;
+        }
+
+        case DataType::Dictionary: {
+            Object result(DataType::Dictionary);
+            result.dictionary.reserve(size());
+
+            for (auto it = begin(); it != end(); ++it) {
+                auto key = it->as_string().str();
+                ++it;
+
+                RW_ASSERT(result.dictionary.count(key) == 0, "Object keys must be unique");
+                result.dictionary.emplace(key, it->to_object());
+            }
+            return result;
+        }
+    }
+
+    RW_UNREACHABLE("Unknown byte in RBDEF");
+}
+
+size_t ObjectView::header_size() const {
+    switch (tag()) {
+        case 'n': case 'f': case 't':
+            return 1;
+        case 'i': case 'p': case 's': case 'a': case 'd':
+            return 5;
+        case 'I': case 'P': case 'S': case 'A': case 'D':
+            return 9;
+        case 'v': case 'V':
+            return typed_header_size();
+    }
+
+    RW_UNREACHABLE("Unknown byte in RBDEF");
+}
+
+size_t ObjectView::typed_header_size() const {
+    // Tag, element type and count, then padding up to the next multiple
+    // of four bytes from the start of the buffer
+    size_t unpadded = tag() == 'v' ? 6 : 10;
+    size_t padding = (4 - (_offset + unpadded) % 4) % 4;
+
+    return unpadded + padding;
+}
+
+TypedArrayType ObjectView::typed_array_type() const {
+    RW_ASSERT(is_typed_array(), "Object is not a typed array");
+
+    switch (_data[_offset + 1]) {
+        case 'f': return TypedArrayType::Float32;
+        case 'H': return TypedArrayType::UInt16;
+        case 'I': return TypedArrayType::UInt32;
+    }
+
+    RW_UNREACHABLE("Unknown typed array element type");
+}
+
+const char *ObjectView::typed_elements(TypedArrayType type, size_t *out_count) const {
+    // Asset files can be truncated or corrupt, so this is checked in
+    // release builds too
+    auto start = std::min(first_child_offset(), _size);
+    *out_count = std::min(size(), (_size - start) / element_size(type));
+
+    return _data + start;
+}
+
+const float *ObjectView::float_data() const {
+    if (!is_typed_array() || typed_array_type() != TypedArrayType::Float32) {
+        return nullptr;
+    }
+
+    size_t n_elements;
+    auto elements = typed_elements(TypedArrayType::Float32, &n_elements);
+    if (n_elements < size()) {
+        return nullptr;
+    }
+
+    return in_place<float>(elements);
+}
+
+const unsigned short *ObjectView::uint16_data() const {
+    if (!is_typed_array() || typed_array_type() != TypedArrayType::UInt16) {
+        return nullptr;
+    }
+
+    size_t n_elements;
+    auto elements = typed_elements(TypedArrayType::UInt16, &n_elements);
+    if (n_elements < size()) {
+        return nullptr;
+    }
+
+    return in_place<unsigned short>(elements);
+}
+
+const unsigned int *ObjectView::uint32_data() const {
+    if (!is_typed_array() || typed_array_type() != TypedArrayType::UInt32) {
+        return nullptr;
+    }
+
+    size_t n_elements;
+    auto elements = typed_elements(TypedArrayType::UInt32, &n_elements);
+    if (n_elements < size()) {
+        return nullptr;
+    }
+
+    return in_place<unsigned int>(elements);
+}
+
+size_t ObjectView::end_offset() const {
+    // Skip iteratively, counting the objects that are still to be
+    // stepped over, so deeply nested data can't overflow the stack.
+    auto position = _offset;
+    size_t pending = 1;
+
+    while (pending) {
+        --pending;
+
+        ObjectView object(_data, _size, position);
+
+        if (object.is_typed_array()) {
+            position += object.header_size() + object.size() * element_size(object.typed_array_type());
+            continue;
+        }
+
+        switch (object.type()) {
+            case DataType::String:
+                position += object.header_size() + object.size();
+                break;
+            case DataType::Array:
+                pending += object.size();
+                position += object.header_size();
+                break;
+            case DataType::Dictionary:
+                pending += 2 * object.size();
+                position += object.header_size();
+                break;
+            default:
+                position += object.header_size();
+                break;
+        }
+    }
+
+    return position;
+}
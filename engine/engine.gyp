@@ -65,6 +65,29 @@
             "dependencies": [
                 "rw_core",
             ],
+
+            "conditions": [
+                [
+                    "OS == 'mac' or OS == 'ios'",
+                    {
+                        "all_dependent_settings": {
+                            "libraries": [
+                                "$(SDKROOT)/usr/lib/libz.dylib",
+                            ],
+                        },
+                    }
+                ],
+                [
+                    "OS != 'mac' and OS != 'ios'",
+                    {
+                        "all_dependent_settings": {
+                            "libraries": [
+                                "-lz",
+                            ],
+                        },
+                    }
+                ],
+            ],
         },
 
         {
@@ -200,6 +223,7 @@
 
             "dependencies": [
                 "rw_core",
+                "rw_data_format",
                 "rw_graphics",
                 "rw_math",
             ],
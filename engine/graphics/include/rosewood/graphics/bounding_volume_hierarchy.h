@@ -0,0 +1,108 @@
+#ifndef __ROSEWOOD_GRAPHICS_BOUNDING_VOLUME_HIERARCHY_H__
+#define __ROSEWOOD_GRAPHICS_BOUNDING_VOLUME_HIERARCHY_H__
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "rosewood/core/entity.h"
+
+#include "rosewood/math/math_types.h"
+
+namespace rosewood { namespace graphics {
+
+    struct BoundingBox {
+        math::Vector3 min;
+        math::Vector3 max;
+    };
+
+    // A dynamic AABB tree over entities, kept balanced with tree rotations
+    // as proxies are inserted, moved and removed. Leaves store their box
+    // enlarged by a margin, so objects moving a little don't touch the
+    // tree at all.
+    //
+    // Queries append the proxies whose enlarged boxes pass the test to
+    // `result`, and only descend into subtrees that can contain hits, so
+    // their cost depends on the number of hits rather than the number of
+    // proxies. Callers needing exact results should test the hits again
+    // against their own bounds.
+    class BoundingVolumeHierarchy {
+    public:
+        static const size_t kNoProxy = size_t(-1);
+
+        // Leaf boxes are enlarged by `margin` times their largest extent
+        explicit BoundingVolumeHierarchy(float margin = 0.1f);
+
+        size_t insert(const BoundingBox &box, core::Entity entity);
+        void remove(size_t proxy);
+
+        // Returns whether the proxy had to be reinserted, which only
+        // happens when the new box sticks out of the enlarged one
+        bool move(size_t proxy, const BoundingBox &box);
+
+        core::Entity entity(size_t proxy) const { return _nodes[proxy].entity; }
+        const BoundingBox &fat_box(size_t proxy) const { return _nodes[proxy].box; }
+
+        size_t proxy_count() const { return _proxy_count; }
+        int height() const;
+
+        // Walks the whole tree and checks its links, boxes and heights, and
+        // that no node's children differ in height by more than one. For
+        // tests and debugging.
+        bool validate() const;
+
+        // Proxies at least partly in front of every plane, where "in front"
+        // means a positive distance. Subtrees entirely in front of a plane
+        // are not tested against it again.
+        void query_planes(const math::Plane *planes, size_t n_planes, std::vector<size_t> *result) const;
+
+        void query_box(const BoundingBox &box, std::vector<size_t> *result) const;
+
+        // Proxies hit by the segment from `origin` to `origin + direction *
+        // max_distance`, in no particular order
+        void query_ray(const math::Vector3 &origin, const math::Vector3 &direction, float max_distance,
+                       std::vector<size_t> *result) const;
+
+        BoundingVolumeHierarchy(const BoundingVolumeHierarchy&) = delete;
+        BoundingVolumeHierarchy &operator=(const BoundingVolumeHierarchy&) = delete;
+
+    private:
+        struct Node {
+            BoundingBox box;
+            core::Entity entity;
+
+            // Next free node while the node is on the free list
+            size_t parent;
+            size_t left, right;
+
+            // 0 for leaves, -1 for free nodes
+            int height;
+
+            bool is_leaf() const { return left == kNoProxy; }
+        };
+
+        std::vector<Node> _nodes;
+        size_t _root;
+        size_t _free_list;
+        size_t _proxy_count;
+        float _margin;
+
+        size_t allocate_node();
+        void free_node(size_t node);
+
+        void insert_leaf(size_t leaf);
+        void remove_leaf(size_t leaf);
+        void refit_from(size_t node);
+        size_t balance(size_t node);
+
+        void collect_leaves(size_t node, std::vector<size_t> *result) const;
+    };
+
+    // Smallest box containing both
+    BoundingBox box_union(const BoundingBox &a, const BoundingBox &b);
+    bool contains(const BoundingBox &outer, const BoundingBox &inner);
+    bool overlaps(const BoundingBox &a, const BoundingBox &b);
+
+} }
+
+#endif
@@ -51,6 +51,41 @@ namespace rosewood { namespace graphics {
 
         typedef std::unordered_map<GLint, UniformData> uniform_map;
 
+        // Highest attribute index the cache tracks, plus one
+        static const GLuint kMaxVertexAttribs = 16;
+
+        // The GL entry points behind the cache. Headless tools and
+        // benchmarks can swap in stubs that record the calls instead.
+        struct Dispatch {
+            void (*enable)(GLenum cap);
+            void (*disable)(GLenum cap);
+            void (*depth_func)(GLenum func);
+            void (*depth_mask)(GLboolean flag);
+            void (*blend_func)(GLenum sfactor, GLenum dfactor);
+            void (*polygon_offset)(GLfloat factor, GLfloat units);
+            void (*bind_vertex_array)(GLuint vao);
+            void (*bind_buffer)(GLenum target, GLuint buffer);
+            void (*bind_texture)(GLenum target, GLuint texture);
+            void (*delete_textures)(GLsizei n, const GLuint *textures);
+            void (*active_texture)(GLenum unit);
+            void (*use_program)(GLuint program);
+            void (*delete_program)(GLuint program);
+            void (*uniform_matrix4fv)(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+            void (*uniform_matrix3fv)(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+            void (*uniform4fv)(GLint location, GLsizei count, const GLfloat *value);
+            void (*uniform1i)(GLint location, GLint value);
+            void (*enable_vertex_attrib_array)(GLuint index);
+            void (*vertex_attrib_pointer)(GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                          GLsizei stride, const GLvoid *pointer);
+        };
+
+        const Dispatch &platform_dispatch();
+        void set_dispatch(const Dispatch &dispatch);
+
+        // Forgets everything known about the GL state, so that the next
+        // call of every kind goes through. Needed after a context switch.
+        void reset();
+
         void set_state(GLenum state, bool enabled);
         void enable(GLenum state);
         void disable(GLenum state);
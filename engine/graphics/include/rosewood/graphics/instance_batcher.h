@@ -0,0 +1,65 @@
+#ifndef __ROSEWOOD_GRAPHICS_INSTANCE_BATCHER_H__
+#define __ROSEWOOD_GRAPHICS_INSTANCE_BATCHER_H__
+
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "rosewood/math/math_types.h"
+
+namespace rosewood { namespace graphics {
+
+    class Light;
+    class Material;
+    class Mesh;
+    class Shader;
+
+    // The render queue's bookkeeping for instanced commands. Commands that
+    // share a shader, material, mesh and light get the same batch id,
+    // which goes into the low bits of their sort keys so that they end up
+    // next to each other. Each run of them is then packed into one
+    // per-instance buffer.
+    class InstanceBatcher {
+    public:
+        // Ids are handed out densely from 0 in order of first use
+        uint32_t batch_id(const Shader *shader, const Material *material,
+                          const Mesh *mesh, const Light *light);
+        size_t batch_count() const { return _batches.size(); }
+
+        // Appends one instance in the layout the instance attributes read:
+        // the column-major modelview matrix, then the column-major normal
+        // matrix derived from the inverse modelview matrix.
+        // MeshBuffer::kFloatsPerInstance floats per instance.
+        void add_instance(const math::Matrix4 &modelview, const math::Matrix4 &inverse_modelview);
+        void clear_instances() { _instance_data.clear(); }
+
+        const std::vector<float> &instance_data() const { return _instance_data; }
+        size_t instance_count() const;
+
+        void clear();
+
+    private:
+        struct Batch {
+            const Shader *shader;
+            const Material *material;
+            const Mesh *mesh;
+            const Light *light;
+
+            bool operator==(const Batch &other) const {
+                return (shader == other.shader && material == other.material
+                        && mesh == other.mesh && light == other.light);
+            }
+        };
+
+        struct BatchHash {
+            size_t operator()(const Batch &batch) const;
+        };
+
+        std::unordered_map<Batch, uint32_t, BatchHash> _batches;
+        std::vector<float> _instance_data;
+    };
+
+} }
+
+#endif
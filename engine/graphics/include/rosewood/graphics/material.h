@@ -16,6 +16,7 @@ namespace rosewood { namespace graphics {
     class Mesh;
     class Texture;
     class Light;
+    class StreamingBuffer;
 
     class Material {
     public:
@@ -35,7 +36,20 @@ namespace rosewood { namespace graphics {
         void enqueue_mesh(const Mesh *mesh,
                           math::Matrix4 transform, math::Matrix4 inverse_transform);
         bool has_enqueued_meshes() const;
-        void submit_draw_calls();
+
+        // Uploads the enqueued vertices into `stream` and draws them from
+        // there
+        void submit_draw_calls(StreamingBuffer *stream);
+
+        // Draws a static mesh straight from its GPU buffer, bypassing the
+        // vertex buffer. The shader must already be set up with the mesh's
+        // modelview and normal matrices.
+        void draw_static_mesh(const Mesh *mesh);
+
+        // Draws `instance_count` copies of a mesh from its GPU buffer, with
+        // per-instance matrices read from `instance_buffer`. The shader
+        // must support instancing.
+        void draw_instanced_mesh(const Mesh *mesh, GLuint instance_buffer, size_t instance_count);
         
         void print_debug_info(std::ostream &os, int indent) const;
 
@@ -46,18 +60,17 @@ namespace rosewood { namespace graphics {
         Light *_light;
 
         std::vector<float> _buffer;
-        GLuint _vbo;
         GLuint _vao;
-        size_t _last_size;
         size_t _buffer_index;
         size_t _vertex_count;
 
-        void init_vbo();
-        void init_vao();
+        // The streaming buffer the VAO's attributes point into
+        GLuint _vao_buffer;
+
+        void init_vao(GLuint buffer);
 
         void bind_texture() const;
-        void upload_vbo_data();
-        void draw_triangles() const;
+        void draw_triangles(size_t first_vertex) const;
     };
     
     inline std::shared_ptr<Texture> Material::texture() const { return _texture; }
@@ -1,6 +1,7 @@
 #ifndef __ROSEWOOD_GRAPHICS_MESH_H__
 #define __ROSEWOOD_GRAPHICS_MESH_H__
 
+#include <functional>
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -20,10 +21,14 @@ namespace rosewood { namespace math {
 namespace rosewood { namespace core {
     class Asset;
     class AssetView;
+    class ResourceRequest;
+    enum class LoadPriority;
 } }
 
 namespace rosewood { namespace graphics {
 
+    class MeshBuffer;
+
     class Mesh {
     public:
         typedef std::vector<math::Vector3> vertex_list;
@@ -35,9 +40,30 @@ namespace rosewood { namespace graphics {
         typedef std::unordered_map<data_map_key, normal_list> normal_list_map;
         typedef std::unordered_map<data_map_key, texcoord_list> texcoord_list_map;
 
+        // Static meshes are uploaded to the GPU once and drawn from there,
+        // with their transform passed as a uniform. Dynamic meshes are
+        // transformed on the CPU every frame and batched with everything
+        // else using the same material, which is cheaper for tiny meshes.
+        enum class Usage {
+            Dynamic,
+            Static,
+        };
+
+        // Meshes loaded from assets with at least this many vertices start
+        // out as static, anything else as dynamic
+        static const size_t kMinStaticVertexCount = 64;
+
         static std::shared_ptr<Mesh> create(const std::shared_ptr<core::Asset> &mesh_asset);
         static std::shared_ptr<Mesh> create(const std::string &resource_path);
 
+        // Reads and parses the mesh on a resource loading thread, and hands
+        // it to `on_loaded` from core::commit_loaded_resources(). The mesh
+        // is null if it could not be found.
+        static std::shared_ptr<core::ResourceRequest>
+        create_async(const std::string &resource_path,
+                     std::function<void(std::shared_ptr<Mesh>)> on_loaded,
+                     core::LoadPriority priority);
+
         Mesh(const std::shared_ptr<core::Asset> &mesh_asset);
         Mesh();
 
@@ -73,6 +99,17 @@ namespace rosewood { namespace graphics {
 
         float bounding_sphere_radius2() const;
 
+        // Changes whenever the bounds do, including on hot reload, so
+        // anything caching them can tell when to recompute
+        unsigned int bounds_version() const;
+
+        Usage usage() const;
+        void set_usage(Usage usage);
+
+        // The GPU copy of a static mesh, laid out for `shader`. Built on
+        // first use and rebuilt whenever the mesh data changes.
+        const MeshBuffer &gpu_buffer(const Shader &shader) const;
+
     private:
         vertex_list _vertex_data;
         normal_list_map _normal_datas;
@@ -82,13 +119,44 @@ namespace rosewood { namespace graphics {
         data_map_key _default_texcoord_data_key;
 
         float _bounding_sphere_radius2;
+        unsigned int _bounds_version;
+
+        Usage _usage;
+        mutable std::shared_ptr<MeshBuffer> _gpu_buffer;
 
         typedef data_structures::Variant<std::vector<math::Vector4>, std::vector<float>> AttributeData;
         std::unordered_map<std::string, AttributeData> _extra_data;
 
         std::shared_ptr<core::AssetView> _mesh_asset;
 
+        // Where each of a shader's extra attributes is read from, resolved
+        // once per attribute layout instead of once per instantiation
+        struct AttributeCopy {
+            const float *source;
+            size_t n_comps;
+        };
+
+        struct AttributePlan {
+            std::vector<std::string> names;
+            std::vector<AttributeCopy> copies;
+            size_t floats_per_vertex;
+            bool valid;
+
+            AttributePlan() : floats_per_vertex(0), valid(false) { }
+
+            // The sources point into the mesh the plan was resolved for, so
+            // a copied mesh has to resolve its own
+            AttributePlan(const AttributePlan&) : floats_per_vertex(0), valid(false) { }
+            AttributePlan &operator=(const AttributePlan&) { valid = false; return *this; }
+        };
+
+        mutable AttributePlan _attribute_plan;
+
+        const AttributePlan &attribute_plan(const std::vector<Shader::AttributeSpec> &attribute_specs) const;
+
         void reload_mesh_asset();
+        void load_mesh_data(const std::string &mesh_data);
+        void attach_mesh_asset(const std::shared_ptr<core::Asset> &mesh_asset);
         void recompute_bounds();
     };
 
@@ -102,27 +170,32 @@ namespace rosewood { namespace graphics {
     inline void Mesh::set_vertex_data(const Mesh::vertex_list &vertex_data) {
         _vertex_data = vertex_data;
         _mesh_asset = nullptr;
+        _gpu_buffer = nullptr;
         recompute_bounds();
     }
 
     inline void Mesh::set_normal_data(const Mesh::normal_list &normal_data) {
         _normal_datas[_default_normal_data_key] = normal_data;
         _mesh_asset = nullptr;
+        _gpu_buffer = nullptr;
     }
 
     inline void Mesh::set_texcoord_data(const Mesh::texcoord_list &texcoord_data) {
         _texcoord_datas[_default_texcoord_data_key] = texcoord_data;
         _mesh_asset = nullptr;
+        _gpu_buffer = nullptr;
     }
 
     inline void Mesh::set_normal_data(const data_map_key &key, const normal_list &normal_data) {
         _normal_datas[key] = normal_data;
         _mesh_asset = nullptr;
+        _gpu_buffer = nullptr;
     }
 
     inline void Mesh::set_texcoord_data(const data_map_key &key, const texcoord_list &texcoord_data) {
         _texcoord_datas[key] = texcoord_data;
         _mesh_asset = nullptr;
+        _gpu_buffer = nullptr;
     }
 
     inline const Mesh::data_map_key &Mesh::default_normal_data_key() const {
@@ -135,13 +208,19 @@ namespace rosewood { namespace graphics {
 
     inline void Mesh::set_default_normal_data_key(const Mesh::data_map_key &key) {
         _default_normal_data_key = key;
+        _gpu_buffer = nullptr;
     }
 
     inline void Mesh::set_default_texcoord_data_key(const Mesh::data_map_key &key) {
         _default_texcoord_data_key = key;
+        _gpu_buffer = nullptr;
     }
 
     inline float Mesh::bounding_sphere_radius2() const { return _bounding_sphere_radius2; }
+    inline unsigned int Mesh::bounds_version() const { return _bounds_version; }
+
+    inline Mesh::Usage Mesh::usage() const { return _usage; }
+    inline void Mesh::set_usage(Mesh::Usage usage) { _usage = usage; }
 
 } }
 
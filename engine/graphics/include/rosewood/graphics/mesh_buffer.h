@@ -0,0 +1,71 @@
+#ifndef __ROSEWOOD_GRAPHICS_MESH_BUFFER_H__
+#define __ROSEWOOD_GRAPHICS_MESH_BUFFER_H__
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "rosewood/graphics/platform_gl.h"
+
+namespace rosewood { namespace graphics {
+
+    class Mesh;
+    class Shader;
+
+    // A GPU-resident copy of a mesh's untransformed vertices, interleaved
+    // the way a shader expects them. Identical vertices are merged, and
+    // the triangles are drawn through an index buffer.
+    class MeshBuffer {
+    public:
+        // Instance data is a column-major modelview matrix followed by a
+        // column-major normal matrix per instance
+        static const size_t kFloatsPerInstance = 16 + 9;
+
+        MeshBuffer(const Mesh &mesh, const Shader &shader);
+        ~MeshBuffer();
+
+        // Whether the buffer's vertex layout fits `shader`'s attributes
+        bool matches(const Shader &shader) const;
+
+        void bind() const;
+        void draw() const;
+
+        // Points the shader's instance attributes at `instance_buffer`.
+        // The buffer must stay alive for as long as this MeshBuffer is
+        // drawn instanced with it.
+        void enable_instancing(GLuint instance_buffer, const Shader &shader) const;
+        void draw_instanced(size_t instance_count) const;
+
+        size_t vertex_count() const { return _vertex_count; }
+        size_t index_count() const { return _index_count; }
+
+        MeshBuffer(const MeshBuffer&) = delete;
+        MeshBuffer &operator=(const MeshBuffer&) = delete;
+
+    private:
+        GLuint _vbo;
+        GLuint _ibo;
+        GLuint _vao;
+        GLenum _index_type;
+
+        size_t _vertex_count;
+        size_t _index_count;
+
+        int _stride;
+        std::vector<std::string> _extra_attribute_names;
+
+        // The instance buffer the VAO's instance attributes point into
+        mutable GLuint _instance_buffer;
+    };
+
+    // Merges identical vertices of `floats_per_vertex` floats each,
+    // writing the unique ones to `unique_vertices` and one index per
+    // input vertex to `indices`
+    void deduplicate_vertices(const std::vector<float> &vertices, size_t floats_per_vertex,
+                              std::vector<float> *unique_vertices,
+                              std::vector<unsigned int> *indices);
+
+} }
+
+#endif
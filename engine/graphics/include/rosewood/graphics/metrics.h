@@ -0,0 +1,37 @@
+#ifndef __ROSEWOOD_GRAPHICS_METRICS_H__
+#define __ROSEWOOD_GRAPHICS_METRICS_H__
+
+#include "rosewood/core/metrics.h"
+
+namespace rosewood { namespace graphics { namespace metrics {
+
+    extern const core::metrics::Counter draw_calls;
+    extern const core::metrics::Counter triangle_count;
+    extern const core::metrics::Counter shader_change_count;
+
+    // State changing GL calls made by gl_state, and those it skipped
+    // because the state was already set
+    extern const core::metrics::Counter gl_calls_issued;
+    extern const core::metrics::Counter gl_calls_elided;
+
+    // Instanced draws are also counted in draw_calls. Dividing
+    // instance_count by instanced_draw_calls gives the average number of
+    // instances per instanced draw.
+    extern const core::metrics::Counter instanced_draw_calls;
+    extern const core::metrics::Counter instance_count;
+
+    // Vertex data uploaded through the streaming buffer
+    extern const core::metrics::Counter bytes_streamed;
+
+    // Everything handed to the GL for upload: textures, mesh and instance
+    // buffers, uniform blocks and streamed vertices
+    extern const core::metrics::Counter upload_bytes;
+
+    extern const core::metrics::Gauge render_queue_size;
+
+    // Finding the renderables visible to one camera
+    extern const core::metrics::Histogram culling_usec;
+
+} } }
+
+#endif
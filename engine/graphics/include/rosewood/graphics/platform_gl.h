@@ -13,6 +13,9 @@
 #    define glBindVertexArray glBindVertexArrayOES
 
 #    define SHADER_EXT "es2"
+#    define RW_GL_HAS_INSTANCING 0
+#    define RW_GL_HAS_UNIFORM_BUFFERS 0
+#    define RW_GL_HAS_SYNC_OBJECTS 0
 
 #endif
 
@@ -23,6 +26,9 @@
 #    include <OpenGL/gl3ext.h>
 
 #    define SHADER_EXT "gl32"
+#    define RW_GL_HAS_INSTANCING 1
+#    define RW_GL_HAS_UNIFORM_BUFFERS 1
+#    define RW_GL_HAS_SYNC_OBJECTS 1
 
 #endif
 
@@ -43,6 +49,10 @@
 #    define glDeleteVertexArrays glDeleteVertexArraysOES
 #    define glBindVertexArray glBindVertexArrayOES
 
+#    define RW_GL_HAS_INSTANCING 0
+#    define RW_GL_HAS_UNIFORM_BUFFERS 0
+#    define RW_GL_HAS_SYNC_OBJECTS 0
+
 #endif
 
 #if TARGET_OS_UNIX
@@ -53,6 +63,9 @@
 #    include <GL/glext.h>
 
 #    define SHADER_EXT "gl32"
+#    define RW_GL_HAS_INSTANCING 1
+#    define RW_GL_HAS_UNIFORM_BUFFERS 1
+#    define RW_GL_HAS_SYNC_OBJECTS 1
 
 #endif
 
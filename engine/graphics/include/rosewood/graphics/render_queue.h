@@ -1,6 +1,8 @@
 #ifndef __ROSEWOOD_GRAPHICS_RENDER_QUEUE_H__
 #define __ROSEWOOD_GRAPHICS_RENDER_QUEUE_H__
 
+#include <stdint.h>
+
 #include <memory>
 #include <vector>
 
@@ -8,8 +10,13 @@
 #include "rosewood/core/entity.h"
 #include "rosewood/core/transform.h"
 
+#include "rosewood/data-structures/radix_sort.h"
+
 #include "rosewood/graphics/camera.h"
+#include "rosewood/graphics/instance_batcher.h"
 #include "rosewood/graphics/material.h"
+#include "rosewood/graphics/streaming_buffer.h"
+#include "rosewood/graphics/uniform_buffer.h"
 
 #include "rosewood/math/math_types.h"
 #include "rosewood/math/matrix4.h"
@@ -32,10 +39,15 @@ namespace rosewood { namespace graphics {
                       Camera *camera,
                       Light *light);
 
-        void execute(const RenderCommand *previous) const;
-        void flush() const;
+        void execute(const RenderCommand *previous, RenderQueue *queue) const;
+        void flush(RenderQueue *queue) const;
         bool is_visible() const;
 
+        // Whether this command is drawn through the instanced path, and
+        // whether `other` can be drawn in the same instanced draw call
+        bool is_instanced() const;
+        bool can_share_instanced_draw(const RenderCommand &other) const;
+
     private:
         Camera *_camera;
         Mesh *_mesh;
@@ -47,20 +59,69 @@ namespace rosewood { namespace graphics {
         Light *_light;
 
         void activate_material() const;
+        void activate_shader(const math::Matrix4 &modelview, const math::Matrix3 &normal_matrix,
+                             RenderQueue *queue) const;
+        void draw_static(RenderQueue *queue) const;
 
         friend class RenderQueue;
-        friend bool operator<(const RenderCommand &lhs, const RenderCommand &rhs);
     };
 
+    // Each command gets a packed sort key when it is added (see
+    // sort_key.h), and sort() orders a compact array of keys and command
+    // indices instead of moving the commands themselves.
+    //
+    // Commands using an instancing shader are sorted so that the ones
+    // sharing a shader, material, mesh and light end up next to each
+    // other, and run() draws each such run of commands with a single
+    // instanced draw call.
+    //
+    // Shaders declaring the rw_frame block get their projection and light
+    // from one uniform buffer, rewritten only when the camera or light
+    // changes between commands.
     class RenderQueue {
     public:
+        RenderQueue();
+        ~RenderQueue();
+
         void clear();
         void add_command(const RenderCommand &command);
+
+        // Adds a command without testing it against the view frustum, for
+        // callers that have culled it already
+        void add_visible_command(const RenderCommand &command);
         void sort();
         void run();
 
+        RenderQueue(const RenderQueue&) = delete;
+        RenderQueue &operator=(const RenderQueue&) = delete;
+
     private:
         std::vector<RenderCommand> _commands;
+        std::vector<data_structures::KeyIndex> _order;
+        std::vector<data_structures::KeyIndex> _sort_scratch;
+
+        // Slots handed out in order of first use since the last clear(),
+        // for the camera field of the sort keys
+        std::vector<const Camera*> _cameras;
+
+        InstanceBatcher _instances;
+        GLuint _instance_buffer;
+
+        // Vertices of the dynamic batches of every material
+        StreamingBuffer _vertex_stream;
+
+        UniformBuffer _frame_uniforms;
+        bool _frame_uniforms_bound;
+        const Camera *_frame_camera;
+        const Light *_frame_light;
+
+        uint64_t sort_key(const RenderCommand &command);
+        const RenderCommand &command_at(size_t position) const;
+
+        void draw_instanced(const RenderCommand *previous, size_t begin, size_t end);
+        void use_frame_uniforms(const Camera *camera, const Light *light);
+
+        friend class RenderCommand;
     };
 
     inline RenderCommand::RenderCommand(Mesh *mesh,
@@ -85,9 +146,18 @@ namespace rosewood { namespace graphics {
 
     inline void RenderQueue::add_command(const RenderCommand &command) {
         if (command.is_visible()) {
-            _commands.emplace_back(command);
+            add_visible_command(command);
         }
     }
+
+    inline void RenderQueue::add_visible_command(const RenderCommand &command) {
+        _order.push_back({ sort_key(command), (uint32_t)_commands.size() });
+        _commands.emplace_back(command);
+    }
+
+    inline const RenderCommand &RenderQueue::command_at(size_t position) const {
+        return _commands[_order[position].index];
+    }
 } }
 
 #endif
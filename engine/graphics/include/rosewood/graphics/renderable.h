@@ -17,7 +17,7 @@ namespace rosewood { namespace graphics {
         : core::Component<Renderable>(entity), _enabled(true) { }
 
         std::shared_ptr<Mesh> mesh() { return _mesh; }
-        void set_mesh(std::shared_ptr<Mesh> mesh) { _mesh = mesh; }
+        void set_mesh(std::shared_ptr<Mesh> mesh);
 
         std::shared_ptr<Material> material() { return _material; }
         void set_material(std::shared_ptr<Material> material) { _material = material; }
@@ -32,6 +32,16 @@ namespace rosewood { namespace graphics {
         bool _enabled;
     };
 
+    // The bounds of a renderable depend on its mesh, so systems keeping
+    // track of them are told about new meshes
+    inline void Renderable::set_mesh(std::shared_ptr<Mesh> mesh) {
+        _mesh = mesh;
+
+        if (auto owner = entity().owner) {
+            owner->notify_component_changed<Renderable>(entity());
+        }
+    }
+
 } }
 
 #endif
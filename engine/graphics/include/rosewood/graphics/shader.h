@@ -1,10 +1,10 @@
 #ifndef __ROSEWOOD_GRAPHICS_SHADER_H__
 #define __ROSEWOOD_GRAPHICS_SHADER_H__
 
+#include <array>
 #include <memory>
 #include <vector>
 #include <string>
-#include <unordered_map>
 
 #include "rosewood/graphics/gl_state.h"
 
@@ -52,10 +52,43 @@ namespace rosewood { namespace graphics {
         void initialize_attribute_arrays() const;
         int attribute_stride() const;
 
+        // Shaders with `instancing = true` in their spec are always drawn
+        // instanced, and read their modelview and normal matrices from the
+        // per-instance attributes rw_instance_modelview_matrix (mat4) and
+        // rw_instance_normal_matrix (mat3) instead of the uniforms. The
+        // columns of both occupy consecutive locations starting at
+        // instance_attribute_location().
+        bool supports_instancing() const;
+        GLuint instance_attribute_location() const;
+
         int queue_index() const;
 
+        // Small id unique to each shader, for packing into render sort keys
+        size_t sort_id() const;
+
         const std::vector<AttributeSpec> &extra_attributes() const;
 
+        // Layout of the std140 uniform block `rw_frame`, which holds the
+        // projection and light uniforms for programs declaring it:
+        //
+        //     layout(std140) uniform rw_frame {
+        //         mat4 rw_projection_matrix;
+        //         vec4 rw_light_position;
+        //         vec4 rw_light_color;
+        //     };
+        //
+        // Such programs share one buffer bound at kFrameUniformsBinding,
+        // and ignore set_projection_uniform() and the light setters.
+        struct FrameUniforms {
+            float projection_matrix[16];
+            float light_position[4];
+            float light_color[4];
+        };
+
+        static const GLuint kFrameUniformsBinding = 0;
+
+        bool uses_frame_uniforms() const;
+
         enum class Uniforms {
             kProjectionMatrixUniform,
             kModelViewMatrixUniform,
@@ -73,6 +106,12 @@ namespace rosewood { namespace graphics {
             kNumAttributes
         };
 
+        enum class InstanceAttributes {
+            kModelViewMatrixAttribute,
+            kNormalMatrixAttribute,
+            kNumInstanceAttributes
+        };
+
         Shader(const Shader&) = delete;
         Shader &operator=(const Shader&) = delete;
 
@@ -80,7 +119,10 @@ namespace rosewood { namespace graphics {
 
     private:
         GLuint _program;
-        std::unordered_map<std::string, GLint> _uniforms;
+
+        // Looked up once per link, indexed by Uniforms
+        std::array<GLint, (size_t)Uniforms::kNumUniforms> _uniform_locations;
+        bool _uses_frame_uniforms;
 
         std::shared_ptr<core::AssetView> _shader_spec;
 
@@ -88,6 +130,9 @@ namespace rosewood { namespace graphics {
         std::vector<UniformSpec> _extra_uniforms;
 
         int _queue_index;
+        size_t _sort_id;
+
+        bool _instancing;
 
         bool _depth_test;
         bool _depth_write;
@@ -104,7 +149,9 @@ namespace rosewood { namespace graphics {
         static const int kDefaultQueueIndex;
 
         static const char *kUniformNames[(int)Uniforms::kNumUniforms];
+        static const char *kFrameUniformsBlockName;
         static const char *kAttributeNames[(int)Attributes::kNumAttributes];
+        static const char *kInstanceAttributeNames[(int)InstanceAttributes::kNumInstanceAttributes];
 
         static bool compile_shader(GLuint *out_shader,
                                    GLenum shader_type,
@@ -113,6 +160,14 @@ namespace rosewood { namespace graphics {
     };
 
     inline int Shader::queue_index() const { return _queue_index; }
+    inline size_t Shader::sort_id() const { return _sort_id; }
+
+    inline bool Shader::supports_instancing() const { return _instancing; }
+    inline bool Shader::uses_frame_uniforms() const { return _uses_frame_uniforms; }
+
+    inline GLuint Shader::instance_attribute_location() const {
+        return (GLuint)((int)Attributes::kNumAttributes + _extra_attributes.size());
+    }
 
 } }
 
@@ -0,0 +1,64 @@
+#ifndef __ROSEWOOD_GRAPHICS_SORT_KEY_H__
+#define __ROSEWOOD_GRAPHICS_SORT_KEY_H__
+
+#include <stdint.h>
+#include <string.h>
+
+
+namespace rosewood { namespace graphics {
+
+    // Render commands are drawn in the order of a 64 bit key, packed from
+    // the most significant bit down as:
+    //
+    //   camera slot (4) | queue index (12) | shader id (12) | texture id (12)
+    //   | instanced (1) | depth or instance batch (23)
+    //
+    // Instanced commands don't need depth order among themselves, so they
+    // store the id of their instance batch in the low bits instead, which
+    // places commands that can share a draw call next to each other.
+    const int kSortKeyCameraBits = 4;
+    const int kSortKeyQueueBits = 12;
+    const int kSortKeyShaderBits = 12;
+    const int kSortKeyTextureBits = 12;
+    const int kSortKeyLowBits = 23;
+
+    const size_t kMaxSortKeyCameras = size_t(1) << kSortKeyCameraBits;
+
+    // Maps a depth to an unsigned integer with the same order, keeping the
+    // top kSortKeyLowBits bits of it
+    inline uint32_t quantize_depth(float depth) {
+        uint32_t bits;
+        memcpy(&bits, &depth, sizeof(bits));
+
+        // Flipping the sign bit orders positive floats after negative ones,
+        // and inverting negative floats makes them order by magnitude
+        bits = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+        return bits >> (32 - kSortKeyLowBits);
+    }
+
+    // Ids wider than their field wrap around, which only affects how well
+    // commands are grouped, not whether they are drawn correctly. Camera
+    // slots and queue indices decide the draw order, so they are clamped
+    // to their fields instead: out of range values draw with the nearest
+    // one rather than spilling into the other fields.
+    inline uint64_t make_sort_key(size_t camera_slot, int queue_index,
+                                  size_t shader_id, size_t texture_id,
+                                  bool instanced, uint32_t low_bits) {
+        const int kMaxQueueIndex = (1 << kSortKeyQueueBits) - 1;
+
+        camera_slot = camera_slot < kMaxSortKeyCameras ? camera_slot : kMaxSortKeyCameras - 1;
+        queue_index = queue_index < 0 ? 0 : queue_index > kMaxQueueIndex ? kMaxQueueIndex : queue_index;
+
+        uint64_t key = camera_slot;
+        key = (key << kSortKeyQueueBits) | uint64_t(queue_index);
+        key = (key << kSortKeyShaderBits) | (shader_id & ((1u << kSortKeyShaderBits) - 1));
+        key = (key << kSortKeyTextureBits) | (texture_id & ((1u << kSortKeyTextureBits) - 1));
+        key = (key << 1) | (instanced ? 1 : 0);
+        key = (key << kSortKeyLowBits) | (low_bits & ((1u << kSortKeyLowBits) - 1));
+
+        return key;
+    }
+
+} }
+
+#endif
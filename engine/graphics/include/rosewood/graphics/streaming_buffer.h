@@ -0,0 +1,60 @@
+#ifndef __ROSEWOOD_GRAPHICS_STREAMING_BUFFER_H__
+#define __ROSEWOOD_GRAPHICS_STREAMING_BUFFER_H__
+
+#include <stddef.h>
+
+#include "rosewood/graphics/platform_gl.h"
+
+namespace rosewood { namespace graphics {
+
+    // One array buffer that every dynamic batch of a frame sub-allocates
+    // its vertices from, so that data the GPU may still be reading is
+    // never overwritten in place.
+    //
+    // Where sync objects exist, the buffer is split into kFrameCount
+    // regions used round robin. Writing into a region first waits on the
+    // fence set when it was last used, which is normally long signalled,
+    // and the writes themselves go through unsynchronized mappings.
+    // Elsewhere the whole buffer is orphaned at the start of every frame.
+    class StreamingBuffer {
+    public:
+        static const size_t kFrameCount = 3;
+
+        explicit StreamingBuffer(size_t frame_capacity = 256 * 1024);
+        ~StreamingBuffer();
+
+        void begin_frame();
+        void end_frame();
+
+        // Copies `size` bytes into the current frame's region, and returns
+        // their byte offset into buffer(). The offset is a multiple of
+        // `alignment`, so vertices of that stride can be drawn with
+        // first = offset / alignment. Grows the buffer if the region is
+        // full.
+        size_t append(const void *data, size_t size, size_t alignment);
+
+        GLuint buffer() const { return _buffer; }
+        size_t frame_capacity() const { return _frame_capacity; }
+
+        StreamingBuffer(const StreamingBuffer&) = delete;
+        StreamingBuffer &operator=(const StreamingBuffer&) = delete;
+
+    private:
+        GLuint _buffer;
+        size_t _frame_capacity;
+
+        size_t _frame;
+        size_t _position;
+
+#if RW_GL_HAS_SYNC_OBJECTS
+        GLsync _fences[kFrameCount];
+#endif
+
+        void allocate(size_t frame_capacity);
+        size_t region_start() const;
+        size_t region_size() const;
+    };
+
+} }
+
+#endif
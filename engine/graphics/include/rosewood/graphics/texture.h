@@ -1,6 +1,8 @@
 #ifndef __ROSEWOOD_GRAPHICS_TEXTURE_H__
 #define __ROSEWOOD_GRAPHICS_TEXTURE_H__
 
+#include <functional>
+#include <memory>
 #include <vector>
 
 #include "rosewood/graphics/platform_gl.h"
@@ -8,6 +10,8 @@
 namespace rosewood { namespace core {
     class Asset;
     class AssetView;
+    class ResourceRequest;
+    enum class LoadPriority;
 } }
 
 namespace rosewood { namespace graphics {
@@ -22,7 +26,18 @@ namespace rosewood { namespace graphics {
     public:
         static std::shared_ptr<Texture> create(const std::string &resource_path);
 
+        // Reads and decodes the image on a resource loading thread, and
+        // uploads it from core::commit_loaded_resources(). The texture
+        // passed to `on_loaded` is null if the image could not be found.
+        static std::shared_ptr<core::ResourceRequest>
+        create_async(const std::string &resource_path,
+                     std::function<void(std::shared_ptr<Texture>)> on_loaded,
+                     core::LoadPriority priority);
+
         Texture(const std::shared_ptr<core::Asset> &image_asset);
+
+        // For an asset whose image has already been decoded
+        Texture(const std::shared_ptr<core::Asset> &image_asset, ImageData image_data);
         Texture(const ImageData &image_data);
         ~Texture();
 
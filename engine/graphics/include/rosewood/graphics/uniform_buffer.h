@@ -0,0 +1,46 @@
+#ifndef __ROSEWOOD_GRAPHICS_UNIFORM_BUFFER_H__
+#define __ROSEWOOD_GRAPHICS_UNIFORM_BUFFER_H__
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "rosewood/graphics/platform_gl.h"
+
+namespace rosewood { namespace graphics {
+
+    // Backing storage for a uniform block shared by every program that
+    // declares it. The GL buffer is created on first use, and only exists
+    // where RW_GL_HAS_UNIFORM_BUFFERS is set.
+    class UniformBuffer {
+    public:
+        UniformBuffer(GLuint binding, size_t size);
+        ~UniformBuffer();
+
+        // Attaches the buffer to its binding point, where programs look
+        // for the block
+        void bind();
+
+        // Uploads `size` bytes from `data`, unless they are the same as the
+        // last upload. Returns whether anything was uploaded.
+        bool update(const void *data);
+
+        GLuint binding() const { return _binding; }
+        size_t size() const { return _contents.size(); }
+
+        UniformBuffer(const UniformBuffer&) = delete;
+        UniformBuffer &operator=(const UniformBuffer&) = delete;
+
+    private:
+        GLuint _buffer;
+        GLuint _binding;
+
+        std::vector<unsigned char> _contents;
+        bool _has_contents;
+
+        void create();
+    };
+
+} }
+
+#endif
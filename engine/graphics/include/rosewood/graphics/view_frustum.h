@@ -1,7 +1,10 @@
 #ifndef __ROSEWOOD_GRAPHICS_VIEW_FRUSTUM_H__
 #define __ROSEWOOD_GRAPHICS_VIEW_FRUSTUM_H__
 
+#include <stdint.h>
+
 #include <array>
+#include <vector>
 
 #include "rosewood/math/math_types.h"
 
@@ -17,18 +20,41 @@ namespace rosewood { namespace graphics {
         NumPlanes
     };
     
+    // World space bounding spheres stored as one array per component, so
+    // that many of them can be culled at once
+    struct BoundingSpheres {
+        std::vector<float> xs, ys, zs, radii;
+
+        size_t size() const { return radii.size(); }
+        void clear();
+        void push_back(const math::Vector3 &center, float radius);
+    };
+
     class ViewFrustum {
     public:
+        typedef std::array<math::Plane, (int)FrustumPlane::NumPlanes> PlaneArray;
+
         explicit ViewFrustum(const Camera *camera);
         
         bool is_visible(const Mesh *mesh,
                         const math::Matrix4 &transform,
                         float max_axis_scale) const;
+
+        // Sets bit i % 32 of (*visible)[i / 32] for every sphere that is at
+        // least partly inside the frustum, with the same rule as
+        // is_visible(). `view_transform` takes world space to the camera
+        // space the frustum is defined in.
+        void cull(const math::Matrix4 &view_transform,
+                  const BoundingSpheres &spheres,
+                  std::vector<uint32_t> *visible) const;
+
+        // The frustum planes moved into world space, normals pointing in
+        PlaneArray world_planes(const math::Matrix4 &view_transform) const;
         
     private:
         math::Matrix4 _projection_matrix;
 
-        std::array<math::Plane, (int)FrustumPlane::NumPlanes> _planes;
+        PlaneArray _planes;
         
         void make_perspective_frustum_planes(const Camera *camera);
         void make_orthographic_frustum_planes(const Camera *camera);
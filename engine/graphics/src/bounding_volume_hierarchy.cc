@@ -0,0 +1,480 @@
+#include "rosewood/graphics/bounding_volume_hierarchy.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "rosewood/core/assert.h"
+
+#include "rosewood/math/vector.h"
+
+using rosewood::core::Entity;
+
+using rosewood::math::Plane;
+using rosewood::math::Vector3;
+
+using rosewood::graphics::BoundingBox;
+using rosewood::graphics::BoundingVolumeHierarchy;
+
+const size_t BoundingVolumeHierarchy::kNoProxy;
+
+BoundingBox rosewood::graphics::box_union(const BoundingBox &a, const BoundingBox &b) {
+    return BoundingBox{
+        Vector3(std::min(a.min.x(), b.min.x()), std::min(a.min.y(), b.min.y()), std::min(a.min.z(), b.min.z())),
+        Vector3(std::max(a.max.x(), b.max.x()), std::max(a.max.y(), b.max.y()), std::max(a.max.z(), b.max.z())),
+    };
+}
+
+bool rosewood::graphics::contains(const BoundingBox &outer, const BoundingBox &inner) {
+    return (outer.min.x() <= inner.min.x() && outer.min.y() <= inner.min.y() && outer.min.z() <= inner.min.z() &&
+            outer.max.x() >= inner.max.x() && outer.max.y() >= inner.max.y() && outer.max.z() >= inner.max.z());
+}
+
+bool rosewood::graphics::overlaps(const BoundingBox &a, const BoundingBox &b) {
+    return (a.min.x() <= b.max.x() && a.min.y() <= b.max.y() && a.min.z() <= b.max.z() &&
+            b.min.x() <= a.max.x() && b.min.y() <= a.max.y() && b.min.z() <= a.max.z());
+}
+
+static float surface_area(const BoundingBox &box) {
+    auto d = box.max - box.min;
+    return 2.0f * (d.x() * d.y() + d.y() * d.z() + d.z() * d.x());
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(float margin)
+: _root(kNoProxy), _free_list(kNoProxy), _proxy_count(0), _margin(margin) { }
+
+size_t BoundingVolumeHierarchy::insert(const BoundingBox &box, Entity entity) {
+    auto d = box.max - box.min;
+    auto margin = _margin * std::max({d.x(), d.y(), d.z()});
+    auto extra = Vector3(margin, margin, margin);
+
+    auto leaf = allocate_node();
+    _nodes[leaf].box = BoundingBox{box.min - extra, box.max + extra};
+    _nodes[leaf].entity = entity;
+    _nodes[leaf].height = 0;
+
+    insert_leaf(leaf);
+    ++_proxy_count;
+
+    return leaf;
+}
+
+void BoundingVolumeHierarchy::remove(size_t proxy) {
+    RW_ASSERT(proxy < _nodes.size() && _nodes[proxy].is_leaf() && _nodes[proxy].height == 0,
+              "Removing an invalid proxy");
+
+    remove_leaf(proxy);
+    free_node(proxy);
+    --_proxy_count;
+}
+
+bool BoundingVolumeHierarchy::move(size_t proxy, const BoundingBox &box) {
+    RW_ASSERT(proxy < _nodes.size() && _nodes[proxy].is_leaf() && _nodes[proxy].height == 0,
+              "Moving an invalid proxy");
+
+    if (contains(_nodes[proxy].box, box)) {
+        return false;
+    }
+
+    auto d = box.max - box.min;
+    auto margin = _margin * std::max({d.x(), d.y(), d.z()});
+    auto extra = Vector3(margin, margin, margin);
+
+    remove_leaf(proxy);
+    _nodes[proxy].box = BoundingBox{box.min - extra, box.max + extra};
+    insert_leaf(proxy);
+
+    return true;
+}
+
+int BoundingVolumeHierarchy::height() const {
+    return _root == kNoProxy ? 0 : _nodes[_root].height;
+}
+
+bool BoundingVolumeHierarchy::validate() const {
+    if (_root == kNoProxy) {
+        return _proxy_count == 0;
+    }
+
+    if (_nodes[_root].parent != kNoProxy) {
+        return false;
+    }
+
+    size_t leaves = 0;
+    std::vector<size_t> stack(1, _root);
+
+    while (!stack.empty()) {
+        auto index = stack.back();
+        stack.pop_back();
+
+        const auto &node = _nodes[index];
+
+        if (node.is_leaf()) {
+            if (node.height != 0 || node.right != kNoProxy) return false;
+            ++leaves;
+            continue;
+        }
+
+        const auto &left = _nodes[node.left];
+        const auto &right = _nodes[node.right];
+
+        if (left.parent != index || right.parent != index) return false;
+        if (node.height != 1 + std::max(left.height, right.height)) return false;
+        if (abs(left.height - right.height) > 1) return false;
+
+        auto box = box_union(left.box, right.box);
+        if (!contains(node.box, box) || !contains(box, node.box)) return false;
+
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+
+    return leaves == _proxy_count;
+}
+
+size_t BoundingVolumeHierarchy::allocate_node() {
+    size_t node;
+
+    if (_free_list == kNoProxy) {
+        node = _nodes.size();
+        _nodes.emplace_back();
+    }
+    else {
+        node = _free_list;
+        _free_list = _nodes[node].parent;
+    }
+
+    _nodes[node].parent = kNoProxy;
+    _nodes[node].left = kNoProxy;
+    _nodes[node].right = kNoProxy;
+    _nodes[node].entity = core::nil_entity();
+    _nodes[node].height = 0;
+
+    return node;
+}
+
+void BoundingVolumeHierarchy::free_node(size_t node) {
+    _nodes[node].parent = _free_list;
+    _nodes[node].height = -1;
+    _free_list = node;
+}
+
+void BoundingVolumeHierarchy::insert_leaf(size_t leaf) {
+    if (_root == kNoProxy) {
+        _root = leaf;
+        _nodes[leaf].parent = kNoProxy;
+        return;
+    }
+
+    // Walk down towards the sibling that grows the total surface area the
+    // least, stopping early when pairing with the current node is cheaper
+    // than descending. Only nodes at most one level high are paired with
+    // early, as a deeper sibling would unbalance the new parent more than
+    // a single rotation can fix.
+    auto leaf_box = _nodes[leaf].box;
+    auto index = _root;
+
+    while (!_nodes[index].is_leaf()) {
+        const auto &node = _nodes[index];
+
+        auto area = surface_area(node.box);
+        auto combined_area = surface_area(box_union(node.box, leaf_box));
+
+        auto cost = 2.0f * combined_area;
+        auto inheritance_cost = 2.0f * (combined_area - area);
+
+        auto child_cost = [&](size_t child) {
+            const auto &c = _nodes[child];
+            auto grown = surface_area(box_union(leaf_box, c.box));
+            return (c.is_leaf() ? grown : grown - surface_area(c.box)) + inheritance_cost;
+        };
+
+        auto left_cost = child_cost(node.left);
+        auto right_cost = child_cost(node.right);
+
+        if (cost < left_cost && cost < right_cost && node.height <= 1) {
+            break;
+        }
+
+        index = left_cost < right_cost ? node.left : node.right;
+    }
+
+    auto sibling = index;
+    auto old_parent = _nodes[sibling].parent;
+
+    auto new_parent = allocate_node();
+    _nodes[new_parent].parent = old_parent;
+    _nodes[new_parent].box = box_union(leaf_box, _nodes[sibling].box);
+    _nodes[new_parent].height = _nodes[sibling].height + 1;
+    _nodes[new_parent].left = sibling;
+    _nodes[new_parent].right = leaf;
+
+    if (old_parent == kNoProxy) {
+        _root = new_parent;
+    }
+    else if (_nodes[old_parent].left == sibling) {
+        _nodes[old_parent].left = new_parent;
+    }
+    else {
+        _nodes[old_parent].right = new_parent;
+    }
+
+    _nodes[sibling].parent = new_parent;
+    _nodes[leaf].parent = new_parent;
+
+    refit_from(new_parent);
+}
+
+void BoundingVolumeHierarchy::remove_leaf(size_t leaf) {
+    if (leaf == _root) {
+        _root = kNoProxy;
+        return;
+    }
+
+    auto parent = _nodes[leaf].parent;
+    auto grandparent = _nodes[parent].parent;
+    auto sibling = _nodes[parent].left == leaf ? _nodes[parent].right : _nodes[parent].left;
+
+    free_node(parent);
+
+    if (grandparent == kNoProxy) {
+        _root = sibling;
+        _nodes[sibling].parent = kNoProxy;
+        return;
+    }
+
+    if (_nodes[grandparent].left == parent) {
+        _nodes[grandparent].left = sibling;
+    }
+    else {
+        _nodes[grandparent].right = sibling;
+    }
+    _nodes[sibling].parent = grandparent;
+
+    refit_from(grandparent);
+}
+
+void BoundingVolumeHierarchy::refit_from(size_t index) {
+    while (index != kNoProxy) {
+        index = balance(index);
+
+        auto &node = _nodes[index];
+        const auto &left = _nodes[node.left];
+        const auto &right = _nodes[node.right];
+
+        node.height = 1 + std::max(left.height, right.height);
+        node.box = box_union(left.box, right.box);
+
+        index = node.parent;
+    }
+}
+
+// Rotates the taller child up if the children's heights differ by more
+// than one, and returns the node now at this position in the tree
+size_t BoundingVolumeHierarchy::balance(size_t a) {
+    if (_nodes[a].is_leaf() || _nodes[a].height < 2) {
+        return a;
+    }
+
+    auto b = _nodes[a].left;
+    auto c = _nodes[a].right;
+    auto skew = _nodes[c].height - _nodes[b].height;
+
+    if (skew >= -1 && skew <= 1) {
+        return a;
+    }
+
+    // `up` takes a's place, and a keeps its other child plus the shorter
+    // of up's children
+    bool right_heavy = skew > 1;
+    auto up = right_heavy ? c : b;
+    auto kept = right_heavy ? b : c;
+
+    auto f = _nodes[up].left;
+    auto g = _nodes[up].right;
+    auto taller = _nodes[f].height > _nodes[g].height ? f : g;
+    auto shorter = taller == f ? g : f;
+
+    _nodes[up].parent = _nodes[a].parent;
+    _nodes[a].parent = up;
+
+    auto up_parent = _nodes[up].parent;
+    if (up_parent == kNoProxy) {
+        _root = up;
+    }
+    else if (_nodes[up_parent].left == a) {
+        _nodes[up_parent].left = up;
+    }
+    else {
+        _nodes[up_parent].right = up;
+    }
+
+    _nodes[up].left = a;
+    _nodes[up].right = taller;
+
+    if (right_heavy) {
+        _nodes[a].right = shorter;
+    }
+    else {
+        _nodes[a].left = shorter;
+    }
+    _nodes[shorter].parent = a;
+
+    _nodes[a].box = box_union(_nodes[kept].box, _nodes[shorter].box);
+    _nodes[a].height = 1 + std::max(_nodes[kept].height, _nodes[shorter].height);
+
+    _nodes[up].box = box_union(_nodes[a].box, _nodes[taller].box);
+    _nodes[up].height = 1 + std::max(_nodes[a].height, _nodes[taller].height);
+
+    return up;
+}
+
+void BoundingVolumeHierarchy::collect_leaves(size_t node, std::vector<size_t> *result) const {
+    std::vector<size_t> stack(1, node);
+
+    while (!stack.empty()) {
+        auto index = stack.back();
+        stack.pop_back();
+
+        if (_nodes[index].is_leaf()) {
+            result->push_back(index);
+        }
+        else {
+            stack.push_back(_nodes[index].left);
+            stack.push_back(_nodes[index].right);
+        }
+    }
+}
+
+void BoundingVolumeHierarchy::query_planes(const Plane *planes, size_t n_planes,
+                                           std::vector<size_t> *result) const {
+    RW_ASSERT(n_planes <= 32, "Too many planes for one query");
+
+    if (_root == kNoProxy) {
+        return;
+    }
+
+    // Each entry carries the planes its subtree still has to be tested
+    // against, as a bit mask
+    struct Entry {
+        size_t node;
+        uint32_t planes;
+    };
+
+    std::vector<Entry> stack;
+    stack.push_back({ _root, n_planes == 32 ? ~0u : (1u << n_planes) - 1 });
+
+    while (!stack.empty()) {
+        auto entry = stack.back();
+        stack.pop_back();
+
+        const auto &node = _nodes[entry.node];
+        auto center = (node.box.min + node.box.max) * 0.5f;
+        auto extent = (node.box.max - node.box.min) * 0.5f;
+
+        bool outside = false;
+        for (size_t p = 0; p < n_planes && !outside; ++p) {
+            if (!(entry.planes & (1u << p))) continue;
+
+            const auto &plane = planes[p];
+            auto d = plane.x * center.x() + plane.y * center.y() + plane.z * center.z() + plane.p;
+            auto r = (fabsf(plane.x) * extent.x() + fabsf(plane.y) * extent.y() +
+                      fabsf(plane.z) * extent.z());
+
+            if (d + r < 0) {
+                outside = true;
+            }
+            else if (d - r >= 0) {
+                entry.planes &= ~(1u << p);
+            }
+        }
+
+        if (outside) {
+            continue;
+        }
+
+        if (!entry.planes) {
+            collect_leaves(entry.node, result);
+        }
+        else if (node.is_leaf()) {
+            result->push_back(entry.node);
+        }
+        else {
+            stack.push_back({ node.left, entry.planes });
+            stack.push_back({ node.right, entry.planes });
+        }
+    }
+}
+
+void BoundingVolumeHierarchy::query_box(const BoundingBox &box, std::vector<size_t> *result) const {
+    if (_root == kNoProxy) {
+        return;
+    }
+
+    std::vector<size_t> stack(1, _root);
+
+    while (!stack.empty()) {
+        auto index = stack.back();
+        stack.pop_back();
+
+        const auto &node = _nodes[index];
+        if (!overlaps(node.box, box)) {
+            continue;
+        }
+
+        if (node.is_leaf()) {
+            result->push_back(index);
+        }
+        else {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+}
+
+void BoundingVolumeHierarchy::query_ray(const Vector3 &origin, const Vector3 &direction, float max_distance,
+                                        std::vector<size_t> *result) const {
+    if (_root == kNoProxy) {
+        return;
+    }
+
+    float o[3] = { origin.x(), origin.y(), origin.z() };
+    float inv[3] = { 1.0f / direction.x(), 1.0f / direction.y(), 1.0f / direction.z() };
+
+    std::vector<size_t> stack(1, _root);
+
+    while (!stack.empty()) {
+        auto index = stack.back();
+        stack.pop_back();
+
+        const auto &node = _nodes[index];
+        float lo[3] = { node.box.min.x(), node.box.min.y(), node.box.min.z() };
+        float hi[3] = { node.box.max.x(), node.box.max.y(), node.box.max.z() };
+
+        // Slab test. Division by a zero direction component gives an
+        // infinity, which makes that axis accept exactly the rays starting
+        // inside the slab.
+        float t_min = 0, t_max = max_distance;
+        for (int axis = 0; axis < 3 && t_min <= t_max; ++axis) {
+            auto t1 = (lo[axis] - o[axis]) * inv[axis];
+            auto t2 = (hi[axis] - o[axis]) * inv[axis];
+
+            t_min = std::max(t_min, std::min(t1, t2));
+            t_max = std::min(t_max, std::max(t1, t2));
+        }
+
+        if (t_min > t_max) {
+            continue;
+        }
+
+        if (node.is_leaf()) {
+            result->push_back(index);
+        }
+        else {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+}
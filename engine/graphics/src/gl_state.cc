@@ -1,10 +1,14 @@
 #include "rosewood/graphics/gl_state.h"
 
-#include <iostream>
-#include <functional>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
 #include <unordered_map>
+#include <vector>
 
-#include "rosewood/core/stats.h"
+#include "rosewood/core/assert.h"
 
 #include "rosewood/math/math_types.h"
 #include "rosewood/math/matrix4.h"
@@ -12,6 +16,7 @@
 #include "rosewood/math/vector.h"
 
 #include "rosewood/graphics/gl_func.h"
+#include "rosewood/graphics/metrics.h"
 
 using rosewood::math::Matrix3;
 using rosewood::math::Matrix4;
@@ -19,107 +24,396 @@ using rosewood::math::Vector4;
 
 namespace rosewood { namespace graphics { namespace gl_state {
 
-    // Helper function for state management: Looks up `key` in `map`,
-    // compares it to `value` and calls `if_changed_fn` if they aren't
-    // equal (or if `key` does not exist). Updates `map` after the
-    // callback has been called
-    template<typename TKey, typename TValue, typename TNewValue>
-    static void if_changed(std::unordered_map<TKey, TValue> &map,
-                           TKey key, const TNewValue &value,
-                           std::function<void()> if_changed_fn) {
-        if (map.find(key) == end(map) || map.at(key) != value) {
-            if_changed_fn();
-            map[key] = value;
-        }
+    // Wrappers rather than the GL functions themselves, so that GL_FUNC
+    // can still check every call
+    static void platform_enable(GLenum cap) { GL_FUNC(glEnable)(cap); }
+    static void platform_disable(GLenum cap) { GL_FUNC(glDisable)(cap); }
+    static void platform_depth_func(GLenum func) { GL_FUNC(glDepthFunc)(func); }
+    static void platform_depth_mask(GLboolean flag) { GL_FUNC(glDepthMask)(flag); }
+    static void platform_blend_func(GLenum sfactor, GLenum dfactor) { GL_FUNC(glBlendFunc)(sfactor, dfactor); }
+    static void platform_polygon_offset(GLfloat factor, GLfloat units) { GL_FUNC(glPolygonOffset)(factor, units); }
+    static void platform_bind_vertex_array(GLuint vao) { GL_FUNC(glBindVertexArray)(vao); }
+    static void platform_bind_buffer(GLenum target, GLuint buffer) { GL_FUNC(glBindBuffer)(target, buffer); }
+    static void platform_bind_texture(GLenum target, GLuint texture) { GL_FUNC(glBindTexture)(target, texture); }
+    static void platform_delete_textures(GLsizei n, const GLuint *textures) { GL_FUNC(glDeleteTextures)(n, textures); }
+    static void platform_active_texture(GLenum unit) { GL_FUNC(glActiveTexture)(unit); }
+    static void platform_use_program(GLuint program) { GL_FUNC(glUseProgram)(program); }
+    static void platform_delete_program(GLuint program) { GL_FUNC(glDeleteProgram)(program); }
+
+    static void platform_uniform_matrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {
+        GL_FUNC(glUniformMatrix4fv)(location, count, transpose, value);
+    }
+
+    static void platform_uniform_matrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {
+        GL_FUNC(glUniformMatrix3fv)(location, count, transpose, value);
+    }
+
+    static void platform_uniform4fv(GLint location, GLsizei count, const GLfloat *value) {
+        GL_FUNC(glUniform4fv)(location, count, value);
+    }
+
+    static void platform_uniform1i(GLint location, GLint value) { GL_FUNC(glUniform1i)(location, value); }
+
+    static void platform_enable_vertex_attrib_array(GLuint index) {
+        GL_FUNC(glEnableVertexAttribArray)(index);
+    }
+
+    static void platform_vertex_attrib_pointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                               GLsizei stride, const GLvoid *pointer) {
+        GL_FUNC(glVertexAttribPointer)(index, size, type, normalized, stride, pointer);
     }
 
-    // Helper function for state management: Calls `if_changed_fn` if
-    // `known_value` differs from `new_value` and updates `known_value`
-    // afterwards.
+    static const Dispatch gPlatformDispatch = {
+        platform_enable,
+        platform_disable,
+        platform_depth_func,
+        platform_depth_mask,
+        platform_blend_func,
+        platform_polygon_offset,
+        platform_bind_vertex_array,
+        platform_bind_buffer,
+        platform_bind_texture,
+        platform_delete_textures,
+        platform_active_texture,
+        platform_use_program,
+        platform_delete_program,
+        platform_uniform_matrix4fv,
+        platform_uniform_matrix3fv,
+        platform_uniform4fv,
+        platform_uniform1i,
+        platform_enable_vertex_attrib_array,
+        platform_vertex_attrib_pointer,
+    };
+
+    static Dispatch gDispatch = gPlatformDispatch;
+
+    // Helper function for state management: Stores `new_value` in
+    // `known_value` and returns whether that changed anything, in which
+    // case the caller has to make the GL call
     template<typename TValue>
-    static void if_changed(TValue &known_value, const TValue new_value,
-                           std::function<void()> if_changed_fn) {
-        if (known_value != new_value) {
-            if_changed_fn();
-            known_value = new_value;
+    static bool changed(TValue &known_value, const TValue &new_value) {
+        if (known_value == new_value) {
+            metrics::gl_calls_elided.increment();
+            return false;
         }
+
+        known_value = new_value;
+        metrics::gl_calls_issued.increment();
+        return true;
     }
 
-    static std::unordered_map<GLenum, bool> gKnownState; // glEnable/glDisable
+    // Capabilities the cache knows about; others are passed straight
+    // through to glEnable/glDisable
+    enum Capability {
+        kCapabilityBlend,
+        kCapabilityCullFace,
+        kCapabilityDepthTest,
+        kCapabilityPolygonOffsetFill,
+        kCapabilityScissorTest,
+        kCapabilityStencilTest,
+
+        kCapabilityCount
+    };
+
+    enum KnownState : unsigned char {
+        kStateUnknown,
+        kStateDisabled,
+        kStateEnabled,
+    };
+
+    static int capability_index(GLenum state) {
+        switch (state) {
+            case GL_BLEND: return kCapabilityBlend;
+            case GL_CULL_FACE: return kCapabilityCullFace;
+            case GL_DEPTH_TEST: return kCapabilityDepthTest;
+            case GL_POLYGON_OFFSET_FILL: return kCapabilityPolygonOffsetFill;
+            case GL_SCISSOR_TEST: return kCapabilityScissorTest;
+            case GL_STENCIL_TEST: return kCapabilityStencilTest;
+            default: return -1;
+        }
+    }
+
+    enum UniformType : unsigned char {
+        kUniformUnknown,
+        kUniformInt,
+        kUniformMatrix3,
+        kUniformMatrix4,
+        kUniformVector4,
+    };
+
+    // Uniform values are kept as raw floats, so that comparing and
+    // storing them doesn't need to know the math types
+    struct UniformValue {
+        UniformType type;
+        union {
+            GLint i;
+            GLfloat f[Matrix4::kSize];
+        };
+    };
+
+    struct UniformSlot {
+        UniformValue known;
+
+        // Set while the program isn't current, uploaded when it's used
+        UniformValue pending;
+    };
+
+    struct ProgramUniforms {
+        // Indexed by uniform location
+        std::vector<UniformSlot> slots;
+        std::vector<GLint> pending_locations;
+    };
+
+    static KnownState gKnownState[kCapabilityCount]; // glEnable/glDisable
     static GLuint gCurrentBuffer = UINT_MAX; // glBindBuffer
     static GLuint gCurrentVAO = UINT_MAX; // glBindVertexArray
     static GLuint gCurrentTexture = UINT_MAX; // glBindTexture
     static GLuint gCurrentProgram = UINT_MAX; // glUseProgram
     static GLuint gCurrentTextureUnit = UINT_MAX; // glActiveTexture
-    static GLenum gCurrentDepthFunc = GL_LESS;
-    static bool gCurrentDepthMask = true;
-    static std::pair<GLenum, GLenum> gCurrentBlendFunc = std::make_pair(GL_ONE, GL_ZERO);
-    static std::pair<float, float> gCurrentPolygonOffset = std::make_pair(0, 0);
-    static uniform_map gCurrentUniforms; // All glUniform*
-    static std::unordered_map<GLuint, uniform_map> gSavedShaderStates;
-    static std::unordered_map<GLuint, uniform_map> gNewShaderStates;
-    static std::unordered_map<GLuint, bool> gKnownAttribArrays; // glEnableVertexAttribArray
-    static std::unordered_map<GLuint, VertexAttribPointer> gCurrentVertexAttribPointers; // glVertexAttribPointer
+    static GLenum gCurrentDepthFunc = UINT_MAX; // glDepthFunc
+    static KnownState gCurrentDepthMask = kStateUnknown; // glDepthMask
+    static std::pair<GLenum, GLenum> gCurrentBlendFunc = std::make_pair(UINT_MAX, UINT_MAX); // glBlendFunc
+
+    // NaN never compares equal, so any offset goes through while unknown
+    static std::pair<float, float> gCurrentPolygonOffset = std::make_pair(NAN, NAN); // glPolygonOffset
+
+    static std::vector<ProgramUniforms> gProgramUniforms; // All glUniform*, indexed by program name
+    static bool gKnownAttribArrays[kMaxVertexAttribs]; // glEnableVertexAttribArray
+    static VertexAttribPointer gCurrentVertexAttribPointers[kMaxVertexAttribs]; // glVertexAttribPointer
+
+    static size_t uniform_size(UniformType type) {
+        switch (type) {
+            case kUniformUnknown: return 0;
+            case kUniformInt: return sizeof(GLint);
+            case kUniformMatrix3: return sizeof(GLfloat) * Matrix3::kSize;
+            case kUniformMatrix4: return sizeof(GLfloat) * Matrix4::kSize;
+            case kUniformVector4: return sizeof(GLfloat) * 4;
+        }
 
-    void set_state(GLenum state, bool enabled) {
-        if_changed(gKnownState, state, enabled, [=]() {
-            if (enabled) {
-                GL_FUNC(glEnable)(state);
-            } else {
-                GL_FUNC(glDisable)(state);
+        RW_UNREACHABLE("Unknown uniform type");
+    }
+
+    static bool operator==(const UniformValue &lhs, const UniformValue &rhs) {
+        return lhs.type == rhs.type && memcmp(lhs.f, rhs.f, uniform_size(lhs.type)) == 0;
+    }
+
+    static UniformValue uniform_value(int i) {
+        UniformValue value;
+        value.type = kUniformInt;
+        value.i = i;
+        return value;
+    }
+
+    static UniformValue uniform_value(const Matrix3 &m) {
+        UniformValue value;
+        value.type = kUniformMatrix3;
+        memcpy(value.f, ptr(m), uniform_size(kUniformMatrix3));
+        return value;
+    }
+
+    static UniformValue uniform_value(const Matrix4 &m) {
+        UniformValue value;
+        value.type = kUniformMatrix4;
+        memcpy(value.f, ptr(m), uniform_size(kUniformMatrix4));
+        return value;
+    }
+
+    static UniformValue uniform_value(const Vector4 &vec4) {
+        UniformValue value;
+        value.type = kUniformVector4;
+        memcpy(value.f, math::ptr(vec4), uniform_size(kUniformVector4));
+        return value;
+    }
+
+    static UniformData uniform_data(const UniformValue &value) {
+        switch (value.type) {
+            case kUniformInt:
+                return value.i;
+            case kUniformMatrix3: {
+                Matrix3 m;
+                memcpy(ptr(m), value.f, uniform_size(value.type));
+                return m;
+            }
+            case kUniformMatrix4: {
+                Matrix4 m;
+                memcpy(ptr(m), value.f, uniform_size(value.type));
+                return m;
+            }
+            case kUniformVector4: {
+                Vector4 vec4;
+                memcpy(math::ptr(vec4), value.f, uniform_size(value.type));
+                return vec4;
+            }
+            case kUniformUnknown:
+                break;
+        }
+
+        RW_UNREACHABLE("Uniform has no value");
+    }
+
+    // GL hands out program names densely from 1, so they make good indices
+    static ProgramUniforms &program_uniforms(GLuint program) {
+        if (program >= gProgramUniforms.size()) {
+            gProgramUniforms.resize(program + 1);
+        }
+
+        return gProgramUniforms[program];
+    }
+
+    static UniformSlot &uniform_slot(ProgramUniforms &uniforms, GLint uniform) {
+        if (size_t(uniform) >= uniforms.slots.size()) {
+            uniforms.slots.resize(uniform + 1);
+        }
+
+        return uniforms.slots[uniform];
+    }
+
+    static void upload_uniform(GLint uniform, const UniformValue &value) {
+        switch (value.type) {
+            case kUniformInt:
+                gDispatch.uniform1i(uniform, value.i);
+                break;
+            case kUniformMatrix3:
+                gDispatch.uniform_matrix3fv(uniform, 1, GL_FALSE, value.f);
+                break;
+            case kUniformMatrix4:
+                gDispatch.uniform_matrix4fv(uniform, 1, GL_FALSE, value.f);
+                break;
+            case kUniformVector4:
+                gDispatch.uniform4fv(uniform, 1, value.f);
+                break;
+            case kUniformUnknown:
+                RW_UNREACHABLE("Uniform has no value");
+        }
+    }
+
+    static void set_current_uniform(GLint uniform, const UniformValue &value) {
+        // Location -1 is what GL reports for uniforms the shader doesn't
+        // use, and setting it does nothing
+        if (gCurrentProgram == UINT_MAX || uniform < 0) return;
+
+        auto &slot = uniform_slot(program_uniforms(gCurrentProgram), uniform);
+        if (changed(slot.known, value)) {
+            upload_uniform(uniform, value);
+        }
+    }
+
+    static void set_program_uniform(GLuint program, GLint uniform, const UniformValue &value) {
+        if (gCurrentProgram == program) {
+            set_current_uniform(uniform, value);
+            return;
+        }
+
+        if (program == UINT_MAX || uniform < 0) return;
+
+        auto &uniforms = program_uniforms(program);
+        auto &slot = uniform_slot(uniforms, uniform);
+        if (slot.pending.type == kUniformUnknown) {
+            uniforms.pending_locations.push_back(uniform);
+        }
+        slot.pending = value;
+    }
+
+    static void forget_vertex_attrib_pointers() {
+        std::fill(std::begin(gCurrentVertexAttribPointers), std::end(gCurrentVertexAttribPointers),
+                  VertexAttribPointer());
+    }
+
+    const Dispatch &platform_dispatch() {
+        return gPlatformDispatch;
+    }
+
+    void set_dispatch(const Dispatch &dispatch) {
+        gDispatch = dispatch;
+    }
+
+    void reset() {
+        std::fill(std::begin(gKnownState), std::end(gKnownState), kStateUnknown);
+        gCurrentBuffer = UINT_MAX;
+        gCurrentVAO = UINT_MAX;
+        gCurrentTexture = UINT_MAX;
+        gCurrentProgram = UINT_MAX;
+        gCurrentTextureUnit = UINT_MAX;
+        gCurrentDepthFunc = UINT_MAX;
+        gCurrentDepthMask = kStateUnknown;
+        gCurrentBlendFunc = std::make_pair(UINT_MAX, UINT_MAX);
+        gCurrentPolygonOffset = std::make_pair(NAN, NAN);
+
+        // Pending values are kept, they will still have to be set
+        for (auto &uniforms : gProgramUniforms) {
+            for (auto &slot : uniforms.slots) {
+                slot.known.type = kUniformUnknown;
             }
-        });
+        }
+
+        std::fill(std::begin(gKnownAttribArrays), std::end(gKnownAttribArrays), false);
+        forget_vertex_attrib_pointers();
+    }
+
+    void set_state(GLenum state, bool enabled) {
+        auto index = capability_index(state);
+
+        if (index == -1) {
+            metrics::gl_calls_issued.increment();
+        }
+        else if (!changed(gKnownState[index], enabled ? kStateEnabled : kStateDisabled)) {
+            return;
+        }
+
+        if (enabled) {
+            gDispatch.enable(state);
+        } else {
+            gDispatch.disable(state);
+        }
     }
 
     void enable (GLenum state) { set_state(state, true); }
     void disable(GLenum state) { set_state(state, false); }
 
     void set_depth_func(GLenum depth_func) {
-        if_changed(gCurrentDepthFunc, depth_func, [=]() {
-            GL_FUNC(glDepthFunc)(depth_func);
-        });
+        if (changed(gCurrentDepthFunc, depth_func)) {
+            gDispatch.depth_func(depth_func);
+        }
     }
 
     void set_depth_mask(bool depth_mask) {
-        if_changed(gCurrentDepthMask, depth_mask, [=]() {
-            GL_FUNC(glDepthMask)(depth_mask ? GL_TRUE : GL_FALSE);
-        });
+        if (changed(gCurrentDepthMask, depth_mask ? kStateEnabled : kStateDisabled)) {
+            gDispatch.depth_mask(depth_mask ? GL_TRUE : GL_FALSE);
+        }
     }
 
     void set_blend_func(GLenum sfactor, GLenum dfactor) {
-        auto blend_func = std::make_pair(sfactor, dfactor);
-        if_changed(gCurrentBlendFunc, blend_func, [=]() {
-            GL_FUNC(glBlendFunc)(sfactor, dfactor);
-        });
+        if (changed(gCurrentBlendFunc, std::make_pair(sfactor, dfactor))) {
+            gDispatch.blend_func(sfactor, dfactor);
+        }
     }
 
     void set_polygon_offset(float factor, float units) {
-        auto polygon_offset = std::make_pair(factor, units);
-        if_changed(gCurrentPolygonOffset, polygon_offset, [=]() {
-            GL_FUNC(glPolygonOffset)(factor, units);
-        });
+        if (changed(gCurrentPolygonOffset, std::make_pair(factor, units))) {
+            gDispatch.polygon_offset(factor, units);
+        }
     }
 
     void bind_vertex_array_object(GLuint vao) {
-        if_changed(gCurrentVAO, vao, [=]() {
-            GL_FUNC(glBindVertexArray)(vao);
+        if (changed(gCurrentVAO, vao)) {
+            gDispatch.bind_vertex_array(vao);
             gCurrentBuffer = UINT_MAX;
-            gCurrentVertexAttribPointers.clear();
-            gKnownAttribArrays.clear();
-        });
+            forget_vertex_attrib_pointers();
+            std::fill(std::begin(gKnownAttribArrays), std::end(gKnownAttribArrays), false);
+        }
     }
 
     void bind_array_buffer(GLuint buffer) {
-        if_changed(gCurrentBuffer, buffer, [=]() {
-            GL_FUNC(glBindBuffer)(GL_ARRAY_BUFFER, buffer);
-            gCurrentVertexAttribPointers.clear();
-        });
+        if (changed(gCurrentBuffer, buffer)) {
+            gDispatch.bind_buffer(GL_ARRAY_BUFFER, buffer);
+            forget_vertex_attrib_pointers();
+        }
     }
 
     void bind_texture(GLuint texture) {
-        if_changed(gCurrentTexture, texture, [=]() {
-            GL_FUNC(glBindTexture)(GL_TEXTURE_2D, texture);
-        });
+        if (changed(gCurrentTexture, texture)) {
+            gDispatch.bind_texture(GL_TEXTURE_2D, texture);
+        }
     }
 
     void delete_texture(GLuint texture) {
@@ -127,42 +421,55 @@ namespace rosewood { namespace graphics { namespace gl_state {
             bind_texture(0);
         }
 
-        GL_FUNC(glDeleteTextures)(1, &texture);
+        gDispatch.delete_textures(1, &texture);
     }
 
     void activate_texture_unit(GLuint unit) {
-        if_changed(gCurrentTextureUnit, unit, [=] {
-            GL_FUNC(glActiveTexture)(GL_TEXTURE0 + unit);
-        });
+        if (changed(gCurrentTextureUnit, unit)) {
+            gDispatch.active_texture(GL_TEXTURE0 + unit);
+        }
     }
 
     void use_program(GLuint program) {
-        if_changed(gCurrentProgram, program, [=]() {
-            GL_FUNC(glUseProgram)(program);
-            core::stats::shader_change_count.increment();
+        if (!changed(gCurrentProgram, program)) return;
+
+        gDispatch.use_program(program);
+        metrics::shader_change_count.increment();
 
-            gSavedShaderStates[gCurrentProgram] = gCurrentUniforms;
-            gCurrentUniforms = gSavedShaderStates[program];
-            gCurrentProgram = program;
+        auto &uniforms = program_uniforms(program);
+        for (auto uniform : uniforms.pending_locations) {
+            auto &slot = uniforms.slots[uniform];
+            auto value = slot.pending;
 
-            set_uniforms(program, gNewShaderStates[program]);
+            slot.pending.type = kUniformUnknown;
+            set_current_uniform(uniform, value);
+        }
 
-            gNewShaderStates[program].clear();
-        });
+        uniforms.pending_locations.clear();
     }
 
     uniform_map known_uniform_state() {
-        return gCurrentUniforms;
+        if (gCurrentProgram == UINT_MAX) {
+            return uniform_map();
+        }
+
+        return known_uniform_state(gCurrentProgram);
     }
 
     uniform_map known_uniform_state(GLuint program) {
-        if (program == gCurrentProgram) {
-            return known_uniform_state();
+        uniform_map state;
+        if (program >= gProgramUniforms.size()) {
+            return state;
         }
 
-        uniform_map state = gSavedShaderStates[program];
-        for (auto pair : gNewShaderStates[program]) {
-            state[pair.first] = pair.second;
+        const auto &slots = gProgramUniforms[program].slots;
+        for (size_t uniform = 0; uniform < slots.size(); ++uniform) {
+            if (slots[uniform].pending.type != kUniformUnknown) {
+                state[GLint(uniform)] = uniform_data(slots[uniform].pending);
+            }
+            else if (slots[uniform].known.type != kUniformUnknown) {
+                state[GLint(uniform)] = uniform_data(slots[uniform].known);
+            }
         }
 
         return state;
@@ -190,95 +497,69 @@ namespace rosewood { namespace graphics { namespace gl_state {
     }
 
     void set_uniform(GLuint program, GLint uniform, math::Matrix4 m) {
-        if (gCurrentProgram == program) {
-            set_uniform(uniform, m);
-        }
-        else {
-            gNewShaderStates[program][uniform] = m;
-        }
+        set_program_uniform(program, uniform, uniform_value(m));
     }
 
     void set_uniform(GLint uniform, math::Matrix4 m) {
-        if (gCurrentProgram == UINT_MAX) return;
-
-        if_changed(gCurrentUniforms, uniform, m, [&](){
-            GL_FUNC(glUniformMatrix4fv)(uniform, 1, GL_FALSE, ptr(m));
-        });
+        set_current_uniform(uniform, uniform_value(m));
     }
 
     void set_uniform(GLuint program, GLint uniform, math::Matrix3 m) {
-        if (gCurrentProgram == program) {
-            set_uniform(uniform, m);
-        }
-        else {
-            gNewShaderStates[program][uniform] = m;
-        }
+        set_program_uniform(program, uniform, uniform_value(m));
     }
 
     void set_uniform(GLint uniform, math::Matrix3 m) {
-        if (gCurrentProgram == UINT_MAX) return;
-
-        if_changed(gCurrentUniforms, uniform, m, [&](){
-            GL_FUNC(glUniformMatrix3fv)(uniform, 1, GL_FALSE, ptr(m));
-        });
+        set_current_uniform(uniform, uniform_value(m));
     }
 
     void set_uniform(GLuint program, GLint uniform, math::Vector4 vec4) {
-        if (gCurrentProgram == program) {
-            set_uniform(uniform, vec4);
-        }
-        else {
-            gNewShaderStates[program][uniform] = vec4;
-        }
+        set_program_uniform(program, uniform, uniform_value(vec4));
     }
 
     void set_uniform(GLint uniform, math::Vector4 vec4) {
-        if (gCurrentProgram == UINT_MAX) return;
-
-        if_changed(gCurrentUniforms, uniform, vec4, [=](){
-            GL_FUNC(glUniform4fv)(uniform, 1, math::ptr(vec4));
-        });
+        set_current_uniform(uniform, uniform_value(vec4));
     }
 
     void set_uniform(GLuint program, GLint uniform, int i) {
-        if (gCurrentProgram == program) {
-            set_uniform(uniform, i);
-        }
-        else {
-            gNewShaderStates[program][uniform] = i;
-        }
+        set_program_uniform(program, uniform, uniform_value(i));
     }
 
     void set_uniform(GLint uniform, int i) {
-        if (gCurrentProgram == UINT_MAX) return;
-
-        if_changed(gCurrentUniforms, uniform, i, [=](){
-            GL_FUNC(glUniform1i)(uniform, i);
-        });
+        set_current_uniform(uniform, uniform_value(i));
     }
 
     void delete_program(GLuint program) {
-        gSavedShaderStates[program].clear();
-        gNewShaderStates[program].clear();
+        if (program < gProgramUniforms.size()) {
+            gProgramUniforms[program].slots.clear();
+            gProgramUniforms[program].pending_locations.clear();
+        }
 
         if (gCurrentProgram == program) {
-            gCurrentUniforms.clear();
             use_program(0);
         }
 
-        GL_FUNC(glDeleteProgram)(program);
+        gDispatch.delete_program(program);
     }
 
     void enable_vertex_attrib_array(GLuint attribute) {
-        if_changed(gKnownAttribArrays, attribute, true, [=]() {
-            GL_FUNC(glEnableVertexAttribArray)(attribute);
-        });
+        RW_ASSERT(attribute < kMaxVertexAttribs, "Vertex attribute index out of range");
+
+        if (changed(gKnownAttribArrays[attribute], true)) {
+            gDispatch.enable_vertex_attrib_array(attribute);
+        }
     }
 
     void set_vertex_attrib_pointer(GLuint attribute, VertexAttribPointer pointer) {
-        if_changed(gCurrentVertexAttribPointers, attribute, pointer, [&]() {
-            pointer.enable(attribute);
-        });
+        RW_ASSERT(attribute < kMaxVertexAttribs, "Vertex attribute index out of range");
+
+        if (changed(gCurrentVertexAttribPointers[attribute], pointer)) {
+            gDispatch.vertex_attrib_pointer(attribute,
+                                            pointer.size(),
+                                            (GLenum)pointer.type(),
+                                            pointer.normalized() ? GL_TRUE : GL_FALSE,
+                                            (int)pointer.stride(),
+                                            ((char*)0) + pointer.offset());
+        }
     }
 
 } } }
@@ -0,0 +1,46 @@
+#include "rosewood/graphics/instance_batcher.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "rosewood/math/matrix3.h"
+#include "rosewood/math/matrix4.h"
+
+#include "rosewood/graphics/mesh_buffer.h"
+
+using rosewood::math::Matrix4;
+
+using rosewood::graphics::InstanceBatcher;
+using rosewood::graphics::Light;
+using rosewood::graphics::Material;
+using rosewood::graphics::Mesh;
+using rosewood::graphics::MeshBuffer;
+using rosewood::graphics::Shader;
+
+size_t InstanceBatcher::BatchHash::operator()(const Batch &batch) const {
+    std::hash<const void*> hash;
+    return (hash(batch.shader) ^ (hash(batch.material) * 31)
+            ^ (hash(batch.mesh) * 961) ^ (hash(batch.light) * 29791));
+}
+
+uint32_t InstanceBatcher::batch_id(const Shader *shader, const Material *material,
+                                   const Mesh *mesh, const Light *light) {
+    Batch batch{ shader, material, mesh, light };
+    return _batches.emplace(batch, (uint32_t)_batches.size()).first->second;
+}
+
+void InstanceBatcher::add_instance(const Matrix4 &modelview, const Matrix4 &inverse_modelview) {
+    auto normal_matrix = transposed(mat3(inverse_modelview));
+
+    _instance_data.insert(end(_instance_data), ptr(modelview), ptr(modelview) + 16);
+    _instance_data.insert(end(_instance_data), ptr(normal_matrix), ptr(normal_matrix) + 9);
+}
+
+size_t InstanceBatcher::instance_count() const {
+    return _instance_data.size() / MeshBuffer::kFloatsPerInstance;
+}
+
+void InstanceBatcher::clear() {
+    _batches.clear();
+    _instance_data.clear();
+}
@@ -3,6 +3,7 @@
 #include <ostream>
 
 #include "rosewood/core/assert.h"
+#include "rosewood/core/profiler.h"
 #include "rosewood/core/stats.h"
 
 #include "rosewood/math/matrix4.h"
@@ -10,7 +11,10 @@
 #include "rosewood/graphics/gl_state.h"
 #include "rosewood/graphics/shader.h"
 #include "rosewood/graphics/mesh.h"
+#include "rosewood/graphics/mesh_buffer.h"
+#include "rosewood/graphics/metrics.h"
 #include "rosewood/graphics/gl_func.h"
+#include "rosewood/graphics/streaming_buffer.h"
 #include "rosewood/graphics/texture.h"
 
 #define BUFFER_OFFSET(i) ((char *)nullptr + (i))
@@ -18,15 +22,21 @@
 using rosewood::math::Matrix4;
 
 using rosewood::graphics::Material;
+using rosewood::graphics::StreamingBuffer;
+
+namespace metrics = rosewood::graphics::metrics;
+namespace stats = rosewood::core::stats;
+
+static bool is_draw_call_enabled() {
+    return !stats::debug_single_draw_call_enabled
+        || metrics::draw_calls.current_frame() == (uint64_t)stats::debug_single_draw_call_index;
+}
 
 Material::Material()
-: _light(nullptr), _vbo(UINT_MAX), _vao(UINT_MAX)
-, _last_size(0), _buffer_index(0), _vertex_count(0) { }
+: _light(nullptr), _vao(UINT_MAX)
+, _buffer_index(0), _vertex_count(0), _vao_buffer(UINT_MAX) { }
 
 Material::~Material() {
-    if (_vbo != UINT_MAX) {
-        GL_FUNC(glDeleteBuffers)(1, &_vbo);
-    }
     if (_vao != UINT_MAX) {
         GL_FUNC(glDeleteVertexArrays)(1, &_vao);
     }
@@ -55,35 +65,74 @@ void Material::enqueue_mesh(const Mesh *mesh, Matrix4 transform, Matrix4 inverse
     _vertex_count += nverts;
 }
 
-void Material::submit_draw_calls() {
+void Material::submit_draw_calls(StreamingBuffer *stream) {
     if (!_buffer_index) return;
-    if (_vbo == UINT_MAX) init_vbo();
-    if (_vao == UINT_MAX) init_vao();
+
+    RW_PROFILE_SCOPE("material.submit_draw_calls");
+
+    size_t stride = shader()->attribute_stride();
+    auto offset = stream->append(_buffer.data(), _buffer_index * sizeof(float), stride);
+
+    if (_vao == UINT_MAX || _vao_buffer != stream->buffer()) {
+        init_vao(stream->buffer());
+    }
 
     gl_state::bind_vertex_array_object(_vao);
-    gl_state::bind_array_buffer(_vbo);
 
     bind_texture();
-    upload_vbo_data();
-    draw_triangles();
+    draw_triangles(offset / stride);
 }
 
-void Material::print_debug_info(std::ostream &os, int indent) const {
-    os << std::string(indent, ' ') << "- Material " << this << "\n";
-    os << std::string(indent, ' ') << "  VAO: " << _vao << ", VBO: " << _vbo << ", Buffer size: " << _buffer.size() << "\n";
+void Material::draw_static_mesh(const Mesh *mesh) {
+    RW_ASSERT(mesh, "Expected a mesh to draw_static_mesh");
+    RW_ASSERT(shader(), "Material must have shader set");
+
+    auto &buffer = mesh->gpu_buffer(*shader());
+    buffer.bind();
+
+    bind_texture();
+
+    if (is_draw_call_enabled()) {
+        buffer.draw();
+    }
+    metrics::draw_calls.increment();
+    metrics::triangle_count.increment(buffer.index_count()/3);
 }
 
-void Material::init_vbo() {
-    GL_FUNC(glGenBuffers)(1, &_vbo);
+void Material::draw_instanced_mesh(const Mesh *mesh, GLuint instance_buffer, size_t instance_count) {
+    RW_ASSERT(mesh, "Expected a mesh to draw_instanced_mesh");
+    RW_ASSERT(shader(), "Material must have shader set");
+
+    auto &buffer = mesh->gpu_buffer(*shader());
+    buffer.enable_instancing(instance_buffer, *shader());
+    buffer.bind();
+
+    bind_texture();
+
+    if (is_draw_call_enabled()) {
+        buffer.draw_instanced(instance_count);
+    }
+    metrics::draw_calls.increment();
+    metrics::instanced_draw_calls.increment();
+    metrics::instance_count.increment(instance_count);
+    metrics::triangle_count.increment(instance_count * buffer.index_count()/3);
+}
+
+void Material::print_debug_info(std::ostream &os, int indent) const {
+    os << std::string(indent, ' ') << "- Material " << this << "\n";
+    os << std::string(indent, ' ') << "  VAO: " << _vao << ", Buffer size: " << _buffer.size() << "\n";
 }
 
-void Material::init_vao() {
-    GL_FUNC(glGenVertexArrays)(1, &_vao);
+void Material::init_vao(GLuint buffer) {
+    if (_vao == UINT_MAX) {
+        GL_FUNC(glGenVertexArrays)(1, &_vao);
+    }
 
     gl_state::bind_vertex_array_object(_vao);
-    gl_state::bind_array_buffer(_vbo);
+    gl_state::bind_array_buffer(buffer);
 
     shader()->initialize_attribute_arrays();
+    _vao_buffer = buffer;
 }
 
 void Material::bind_texture() const {
@@ -97,23 +146,10 @@ void Material::bind_texture() const {
     }
 }
 
-void Material::upload_vbo_data() {
-    auto new_size = _buffer_index * sizeof(float);
-
-    if (new_size > _last_size) {
-        GL_FUNC(glBufferData)(GL_ARRAY_BUFFER, new_size, &_buffer[0], GL_DYNAMIC_DRAW);
-        _last_size = new_size;
-    }
-    else {
-        GL_FUNC(glBufferSubData)(GL_ARRAY_BUFFER, 0, new_size, &_buffer[0]);
-    }
-}
-
-void Material::draw_triangles() const {
-    if (!core::stats::debug_single_draw_call_enabled
-        || core::stats::draw_calls.read() == core::stats::debug_single_draw_call_index) {
-        GL_FUNC(glDrawArrays)(GL_TRIANGLES, 0, (int)_vertex_count);
+void Material::draw_triangles(size_t first_vertex) const {
+    if (is_draw_call_enabled()) {
+        GL_FUNC(glDrawArrays)(GL_TRIANGLES, (int)first_vertex, (int)_vertex_count);
     }
-    core::stats::draw_calls.increment();
-    core::stats::triangle_count.increment(_vertex_count/3);
+    metrics::draw_calls.increment();
+    metrics::triangle_count.increment(_vertex_count/3);
 }
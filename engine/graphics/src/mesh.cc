@@ -1,32 +1,43 @@
 #include "rosewood/graphics/mesh.h"
 
-#include <alloca.h>
-
+#include <algorithm>
 #include <numeric>
 
 #include "rosewood/core/assert.h"
+#include "rosewood/core/profiler.h"
 #include "rosewood/core/resource_manager.h"
 
-#include "rosewood/data-format/object.h"
-#include "rosewood/data-format/object_conversions.h"
-#include "rosewood/data-format/reader.h"
+#include "rosewood/data-format/object_view.h"
 
+#include "rosewood/math/batch_transform.h"
 #include "rosewood/math/math_types.h"
 #include "rosewood/math/matrix4.h"
 #include "rosewood/math/vector.h"
 #include "rosewood/math/matrix3.h"
 
+#include "rosewood/graphics/mesh_buffer.h"
 #include "rosewood/graphics/shader.h"
 
 using rosewood::core::Asset;
 using rosewood::core::AssetView;
+using rosewood::core::LoadPriority;
+using rosewood::core::ResourceRequest;
+
+using rosewood::data_format::ObjectView;
 
 using rosewood::math::Matrix4;
+using rosewood::math::Vector2;
 using rosewood::math::Vector3;
 using rosewood::math::Vector4;
 using rosewood::math::length2;
+using rosewood::math::transform_directions;
+using rosewood::math::transform_points;
 
 using rosewood::graphics::Mesh;
+using rosewood::graphics::MeshBuffer;
+using rosewood::graphics::Shader;
+
+const size_t Mesh::kMinStaticVertexCount;
 
 std::shared_ptr<Mesh> Mesh::create(const std::shared_ptr<Asset> &mesh_asset) {
     return std::make_shared<Mesh>(mesh_asset);
@@ -36,79 +47,135 @@ std::shared_ptr<Mesh> Mesh::create(const std::string &resource_path) {
     return create(core::get_resource(resource_path + ".mesh-rbdef"));
 }
 
+std::shared_ptr<ResourceRequest> Mesh::create_async(const std::string &resource_path,
+                                                    std::function<void(std::shared_ptr<Mesh>)> on_loaded,
+                                                    LoadPriority priority) {
+    // The mesh is parsed without an asset, which is only attached once it
+    // is back on the committing thread
+    auto decode = [](const std::string &file_contents) -> std::shared_ptr<void> {
+        auto mesh = std::make_shared<Mesh>();
+        mesh->load_mesh_data(file_contents);
+        return mesh;
+    };
+
+    return core::get_resource_async(resource_path + ".mesh-rbdef", decode,
+                                    [on_loaded](const std::shared_ptr<Asset> &asset,
+                                                const std::shared_ptr<void> &decoded) {
+                                        if (!asset) {
+                                            on_loaded(nullptr);
+                                            return;
+                                        }
+
+                                        auto mesh = std::static_pointer_cast<Mesh>(decoded);
+                                        mesh->attach_mesh_asset(asset);
+                                        on_loaded(mesh);
+                                    },
+                                    priority);
+}
+
 Mesh::Mesh(const std::shared_ptr<Asset> &mesh_asset)
-: _mesh_asset(core::create_view(mesh_asset, [&] { reload_mesh_asset(); })) {
-    reload_mesh_asset();
+: _bounding_sphere_radius2(0), _bounds_version(0), _usage(Usage::Dynamic) {
+    load_mesh_data(mesh_asset->str());
+    attach_mesh_asset(mesh_asset);
 }
 
-Mesh::Mesh() { }
+Mesh::Mesh() : _bounding_sphere_radius2(0), _bounds_version(0), _usage(Usage::Dynamic) { }
 
 void Mesh::instantiate(Matrix4 transform, Matrix4 inverse_transform,
                        std::vector<float>::iterator destination,
                        const std::vector<Shader::AttributeSpec> &attribute_specs) const {
 	RW_ASSERT(this, "Must have mesh object when instantiating mesh");
 
+    auto n_vertices = _vertex_data.size();
+    if (!n_vertices) {
+        return;
+    }
+
     auto n_matrix = transposed(mat3(inverse_transform));
 
-    auto &v_data = vertex_data();
     auto &n_data = normal_data();
     auto &tc_data = texcoord_data();
+    auto &plan = attribute_plan(attribute_specs);
 
-    typedef std::tuple<const Shader::AttributeSpec*, const AttributeData*> attribute_tuple;
+    auto stride = plan.floats_per_vertex;
+    float *out = &*destination;
 
-    attribute_tuple *extra_attributes = static_cast<attribute_tuple*>(alloca(sizeof(attribute_tuple) * attribute_specs.size()));
-    new(extra_attributes) attribute_tuple();
+    // Fill the interleaved output one attribute at a time, so positions
+    // and normals go through the batched kernels
+    transform_points(transform, _vertex_data.data(), n_vertices, out, stride);
+    transform_directions(n_matrix, n_data.data(), n_vertices, out + 3, stride);
 
-    for (int i = 0; i < attribute_specs.size(); ++i) {
-        std::get<0>(extra_attributes[i]) = &attribute_specs[i];
-        std::get<1>(extra_attributes[i]) = &_extra_data.at(attribute_specs[i].name);
+    for (size_t i = 0; i < n_vertices; ++i) {
+        out[i * stride + 6] = tc_data[i].x;
+        out[i * stride + 7] = tc_data[i].y;
     }
 
-    for (size_t i = 0; i < _vertex_data.size(); ++i) {
-        auto v = transform * v_data[i];
-        auto n = n_matrix * n_data[i];
-        auto t = tc_data[i];
-
-        *destination++ = v.x();
-        *destination++ = v.y();
-        *destination++ = v.z();
-        *destination++ = n.x();
-        *destination++ = n.y();
-        *destination++ = n.z();
-        *destination++ = t.x;
-        *destination++ = t.y;
-
-        for (int i = 0; i < attribute_specs.size(); ++i) {
-            auto &spec = *std::get<0>(extra_attributes[i]);
-            auto &data = *std::get<1>(extra_attributes[i]);
-
-            switch (spec.type) {
-                case kTypeFloat:
-                    if (spec.n_comps == 4) {
-                        auto v4 = data.get<std::vector<Vector4>>()[i];
-                        *destination++ = v4.x;
-                        *destination++ = v4.y;
-                        *destination++ = v4.z;
-                        *destination++ = v4.w;
-                    }
-                    else if (spec.n_comps == 1) {
-                        auto f = data.get<std::vector<float>>()[i];
-                        *destination++ = f;
-                    }
-                    break;
+    size_t offset = 8;
+    for (const auto &copy : plan.copies) {
+        for (size_t i = 0; i < n_vertices; ++i) {
+            for (size_t c = 0; c < copy.n_comps; ++c) {
+                out[i * stride + offset + c] = copy.source[i * copy.n_comps + c];
             }
         }
+
+        offset += copy.n_comps;
     }
 }
 
+const Mesh::AttributePlan &Mesh::attribute_plan(const std::vector<Shader::AttributeSpec> &attribute_specs) const {
+    auto &plan = _attribute_plan;
+
+    if (plan.valid && plan.names.size() == attribute_specs.size()
+        && std::equal(begin(plan.names), end(plan.names), begin(attribute_specs),
+                      [](const std::string &name, const Shader::AttributeSpec &spec) {
+                          return name == spec.name;
+                      })) {
+        return plan;
+    }
+
+    plan.names.clear();
+    plan.copies.clear();
+    plan.floats_per_vertex = 8;
+
+    for (const auto &spec : attribute_specs) {
+        RW_ASSERT(spec.type == kTypeFloat && (spec.n_comps == 1 || spec.n_comps == 4),
+                  "Extra attributes must be floats or four component vectors");
+
+        auto &data = _extra_data.at(spec.name);
+        const float *source;
+
+        if (spec.n_comps == 4) {
+            auto &vec4s = data.get<std::vector<Vector4>>();
+            RW_ASSERT(vec4s.size() >= _vertex_data.size(), "Extra attribute data is too short");
+            source = reinterpret_cast<const float*>(vec4s.data());
+        }
+        else {
+            auto &floats = data.get<std::vector<float>>();
+            RW_ASSERT(floats.size() >= _vertex_data.size(), "Extra attribute data is too short");
+            source = floats.data();
+        }
+
+        plan.names.push_back(spec.name);
+        plan.copies.push_back({ source, (size_t)spec.n_comps });
+        plan.floats_per_vertex += spec.n_comps;
+    }
+
+    plan.valid = true;
+    return plan;
+}
+
 void Mesh::set_extra_data(const data_map_key &key, const std::vector<math::Vector4> &vec4_data) {
     _extra_data[key].get<std::vector<math::Vector4>>() = vec4_data;
     _mesh_asset = nullptr;
+    _gpu_buffer = nullptr;
+    _attribute_plan.valid = false;
 }
 
 void Mesh::set_extra_data(const data_map_key &key, const std::vector<float> &float_data) {
     _extra_data[key].get<std::vector<float>>() = float_data;
     _mesh_asset = nullptr;
+    _gpu_buffer = nullptr;
+    _attribute_plan.valid = false;
 }
 
 
@@ -116,57 +183,104 @@ std::shared_ptr<Mesh> Mesh::copy() const {
     return std::make_shared<Mesh>(*this);
 }
 
-void Mesh::reload_mesh_asset() {
-    auto &contents = _mesh_asset->str();
-    auto arrays = data_format::read_data(contents);
+const MeshBuffer &Mesh::gpu_buffer(const Shader &shader) const {
+    if (!_gpu_buffer || !_gpu_buffer->matches(shader)) {
+        _gpu_buffer = std::make_shared<MeshBuffer>(*this, shader);
+    }
 
-    auto vertex_float_array = data_format::as<std::vector<float>>(arrays[0]);
-    auto normal_float_arrays = data_format::as<std::unordered_map<std::string, std::vector<float>>>(arrays[1]);
-    auto texcoord_float_arrays = data_format::as<std::unordered_map<std::string, std::vector<float>>>(arrays[2]);
+    return *_gpu_buffer;
+}
 
-    _vertex_data.clear();
-    _normal_datas.clear();
-    _texcoord_datas.clear();
+// Typed arrays are read in place, everything else goes through scratch,
+// which only holds what a truncated array actually contains
+static const float *array_floats(const ObjectView &array, std::vector<float> *scratch, size_t *out_count) {
+    if (auto floats = array.float_data()) {
+        *out_count = array.size();
+        return floats;
+    }
+
+    array.read_floats(scratch);
+    *out_count = scratch->size();
+    return scratch->data();
+}
 
-    _vertex_data.reserve(vertex_float_array.size()/3);
+static void unpack_vector3s(const ObjectView &array, std::vector<float> *scratch, std::vector<Vector3> *result) {
+    size_t n_floats;
+    auto floats = array_floats(array, scratch, &n_floats);
+    auto count = n_floats/3;
 
-    for (size_t i = 0; i < vertex_float_array.size()/3; ++i) {
-        _vertex_data.emplace_back(vertex_float_array[3*i+0],
-                                  vertex_float_array[3*i+1],
-                                  vertex_float_array[3*i+2]);
+    result->clear();
+    result->reserve(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        result->emplace_back(floats[3*i+0], floats[3*i+1], floats[3*i+2]);
     }
+}
 
-    for (const auto &pair : normal_float_arrays) {
-        const auto &normal_array = pair.second;
-        normal_list normal_data;
-        normal_data.reserve(normal_array.size()/3);
+static void unpack_vector2s(const ObjectView &array, std::vector<float> *scratch, std::vector<Vector2> *result) {
+    size_t n_floats;
+    auto floats = array_floats(array, scratch, &n_floats);
+    auto count = n_floats/2;
 
-        for (size_t i = 0; i < normal_array.size()/3; ++i) {
-            normal_data.emplace_back(normal_array[3*i+0],
-                                     normal_array[3*i+1],
-                                     normal_array[3*i+2]);
-        }
+    result->clear();
+    result->reserve(count);
 
-        _normal_datas.emplace(pair.first, normal_data);
+    for (size_t i = 0; i < count; ++i) {
+        result->emplace_back(floats[2*i+0], floats[2*i+1]);
     }
+}
+
+void Mesh::reload_mesh_asset() {
+    load_mesh_data(_mesh_asset->str());
+    _mesh_asset->did_decode();
+}
 
-    for (const auto &pair : texcoord_float_arrays) {
-        const auto &texcoord_array = pair.second;
-        texcoord_list texcoord_data;
-        texcoord_data.reserve(texcoord_array.size()/2);
+void Mesh::attach_mesh_asset(const std::shared_ptr<Asset> &mesh_asset) {
+    _mesh_asset = core::create_view(mesh_asset, [&] { reload_mesh_asset(); });
+    mesh_asset->did_decode();
 
-        for (size_t i = 0; i < texcoord_array.size()/2; ++i) {
-            texcoord_data.emplace_back(texcoord_array[2*i+0],
-                                       texcoord_array[2*i+1]);
-        }
+    if (_vertex_data.size() >= kMinStaticVertexCount) {
+        _usage = Usage::Static;
+    }
+}
+
+void Mesh::load_mesh_data(const std::string &mesh_data) {
+    RW_PROFILE_SCOPE("mesh.load");
+
+    // The asset is an array of [vertices, {name: normals}, {name: texcoords}].
+    // Read it through a view so numbers go straight from the asset into the
+    // mesh, either in place from typed arrays or via a reused float buffer.
+    auto vertex_array = ObjectView(mesh_data)[0];
+    auto normal_arrays = vertex_array.next();
+    auto texcoord_arrays = normal_arrays.next();
+
+    std::vector<float> scratch;
+
+    _normal_datas.clear();
+    _texcoord_datas.clear();
+    _gpu_buffer = nullptr;
+
+    unpack_vector3s(vertex_array, &scratch, &_vertex_data);
+
+    for (auto it = normal_arrays.begin(); it != normal_arrays.end(); ++it) {
+        auto key = it->as_string().str();
+        ++it;
+
+        unpack_vector3s(*it, &scratch, &_normal_datas[key]);
+    }
+
+    for (auto it = texcoord_arrays.begin(); it != texcoord_arrays.end(); ++it) {
+        auto key = it->as_string().str();
+        ++it;
 
-        _texcoord_datas.emplace(pair.first, texcoord_data);
+        unpack_vector2s(*it, &scratch, &_texcoord_datas[key]);
     }
 
     recompute_bounds();
 }
 
 void Mesh::recompute_bounds() {
+    ++_bounds_version;
     _bounding_sphere_radius2 = std::accumulate(begin(_vertex_data), end(_vertex_data), 0.0f,
                                                [](float acc, Vector3 v){
                                                    return std::max(acc, length2(v));
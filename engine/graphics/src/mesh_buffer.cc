@@ -0,0 +1,206 @@
+#include "rosewood/graphics/mesh_buffer.h"
+
+#include <string.h>
+
+#include <unordered_map>
+
+#include "rosewood/core/assert.h"
+
+#include "rosewood/math/matrix4.h"
+
+#include "rosewood/graphics/gl_func.h"
+#include "rosewood/graphics/gl_state.h"
+#include "rosewood/graphics/mesh.h"
+#include "rosewood/graphics/metrics.h"
+#include "rosewood/graphics/shader.h"
+
+using rosewood::graphics::MeshBuffer;
+using rosewood::graphics::Shader;
+using rosewood::graphics::VertexAttribPointer;
+
+const size_t MeshBuffer::kFloatsPerInstance;
+
+namespace {
+
+    // Hashes and compares vertices by their index into a float array, so
+    // the map used for merging doesn't need to copy them
+    struct VertexHash {
+        const float *data;
+        size_t n_floats;
+
+        size_t operator()(unsigned int vertex) const {
+            auto bytes = reinterpret_cast<const unsigned char*>(data + vertex * n_floats);
+            size_t hash = 2166136261u;
+
+            for (size_t i = 0; i < n_floats * sizeof(float); ++i) {
+                hash = (hash ^ bytes[i]) * 16777619u;
+            }
+            return hash;
+        }
+    };
+
+    struct VertexEqual {
+        const float *data;
+        size_t n_floats;
+
+        bool operator()(unsigned int a, unsigned int b) const {
+            return memcmp(data + a * n_floats, data + b * n_floats, n_floats * sizeof(float)) == 0;
+        }
+    };
+
+}
+
+void rosewood::graphics::deduplicate_vertices(const std::vector<float> &vertices, size_t floats_per_vertex,
+                                              std::vector<float> *unique_vertices,
+                                              std::vector<unsigned int> *indices) {
+    RW_ASSERT(floats_per_vertex && vertices.size() % floats_per_vertex == 0,
+              "Vertex data must consist of whole vertices");
+
+    auto n_vertices = vertices.size() / floats_per_vertex;
+
+    std::unordered_map<unsigned int, unsigned int, VertexHash, VertexEqual> unique_index(
+        n_vertices,
+        VertexHash{vertices.data(), floats_per_vertex},
+        VertexEqual{vertices.data(), floats_per_vertex});
+
+    unique_vertices->clear();
+    indices->clear();
+    indices->reserve(n_vertices);
+
+    for (unsigned int vertex = 0; vertex < n_vertices; ++vertex) {
+        auto next_index = (unsigned int)(unique_vertices->size() / floats_per_vertex);
+        auto inserted = unique_index.emplace(vertex, next_index);
+
+        if (inserted.second) {
+            auto source = vertices.begin() + vertex * floats_per_vertex;
+            unique_vertices->insert(unique_vertices->end(), source, source + floats_per_vertex);
+        }
+
+        indices->push_back(inserted.first->second);
+    }
+}
+
+MeshBuffer::MeshBuffer(const Mesh &mesh, const Shader &shader)
+: _vbo(UINT_MAX), _ibo(UINT_MAX), _vao(UINT_MAX)
+, _index_type(GL_UNSIGNED_SHORT), _vertex_count(0), _index_count(0)
+, _stride(shader.attribute_stride()), _instance_buffer(UINT_MAX) {
+    for (const auto &spec : shader.extra_attributes()) {
+        _extra_attribute_names.push_back(spec.name);
+    }
+
+    auto floats_per_vertex = _stride / sizeof(float);
+
+    // Instantiating with identity matrices gives the mesh in model space,
+    // in exactly the layout the batched path would upload
+    std::vector<float> vertices(mesh.vertex_data().size() * floats_per_vertex);
+    mesh.instantiate(math::make_identity4(), math::make_identity4(),
+                     vertices.begin(), shader.extra_attributes());
+
+    std::vector<float> unique_vertices;
+    std::vector<unsigned int> indices;
+    deduplicate_vertices(vertices, floats_per_vertex, &unique_vertices, &indices);
+
+    _vertex_count = unique_vertices.size() / floats_per_vertex;
+    _index_count = indices.size();
+
+    GL_FUNC(glGenVertexArrays)(1, &_vao);
+    GL_FUNC(glGenBuffers)(1, &_vbo);
+    GL_FUNC(glGenBuffers)(1, &_ibo);
+
+    gl_state::bind_vertex_array_object(_vao);
+    gl_state::bind_array_buffer(_vbo);
+    GL_FUNC(glBufferData)(GL_ARRAY_BUFFER, unique_vertices.size() * sizeof(float),
+                          unique_vertices.data(), GL_STATIC_DRAW);
+    metrics::upload_bytes.increment(unique_vertices.size() * sizeof(float));
+
+    // The element array binding is part of the VAO state, so it is never
+    // rebound after this
+    GL_FUNC(glBindBuffer)(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+
+    if (_vertex_count <= 0xffff) {
+        std::vector<GLushort> short_indices(begin(indices), end(indices));
+        GL_FUNC(glBufferData)(GL_ELEMENT_ARRAY_BUFFER, short_indices.size() * sizeof(GLushort),
+                              short_indices.data(), GL_STATIC_DRAW);
+        metrics::upload_bytes.increment(short_indices.size() * sizeof(GLushort));
+    }
+    else {
+        _index_type = GL_UNSIGNED_INT;
+        GL_FUNC(glBufferData)(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+                              indices.data(), GL_STATIC_DRAW);
+        metrics::upload_bytes.increment(indices.size() * sizeof(GLuint));
+    }
+
+    shader.initialize_attribute_arrays();
+}
+
+MeshBuffer::~MeshBuffer() {
+    GL_FUNC(glDeleteBuffers)(1, &_vbo);
+    GL_FUNC(glDeleteBuffers)(1, &_ibo);
+    GL_FUNC(glDeleteVertexArrays)(1, &_vao);
+}
+
+bool MeshBuffer::matches(const Shader &shader) const {
+    const auto &specs = shader.extra_attributes();
+    if (shader.attribute_stride() != _stride || specs.size() != _extra_attribute_names.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < specs.size(); ++i) {
+        if (specs[i].name != _extra_attribute_names[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void MeshBuffer::bind() const {
+    gl_state::bind_vertex_array_object(_vao);
+    gl_state::bind_array_buffer(_vbo);
+}
+
+void MeshBuffer::draw() const {
+    GL_FUNC(glDrawElements)(GL_TRIANGLES, (int)_index_count, _index_type, nullptr);
+}
+
+void MeshBuffer::enable_instancing(GLuint instance_buffer, const Shader &shader) const {
+#if RW_GL_HAS_INSTANCING
+    RW_ASSERT(shader.supports_instancing(), "Shader does not support instancing");
+
+    if (_instance_buffer == instance_buffer) {
+        return;
+    }
+
+    gl_state::bind_vertex_array_object(_vao);
+    gl_state::bind_array_buffer(instance_buffer);
+
+    auto stride = kFloatsPerInstance * sizeof(float);
+    auto location = shader.instance_attribute_location();
+
+    // One attribute per matrix column: four for the modelview matrix,
+    // then three for the normal matrix
+    for (GLuint column = 0; column < 7; ++column) {
+        auto n_comps = column < 4 ? 4 : 3;
+        auto offset = column < 4 ? column * 4 : 16 + (column - 4) * 3;
+
+        gl_state::enable_vertex_attrib_array(location + column);
+        gl_state::set_vertex_attrib_pointer(location + column,
+                                            VertexAttribPointer(n_comps, kTypeFloat, false,
+                                                                stride, offset * sizeof(float)));
+        GL_FUNC(glVertexAttribDivisor)(location + column, 1);
+    }
+
+    _instance_buffer = instance_buffer;
+#else
+    RW_UNREACHABLE("Instanced drawing is not supported on this platform");
+#endif
+}
+
+void MeshBuffer::draw_instanced(size_t instance_count) const {
+#if RW_GL_HAS_INSTANCING
+    GL_FUNC(glDrawElementsInstanced)(GL_TRIANGLES, (int)_index_count, _index_type, nullptr,
+                                     (int)instance_count);
+#else
+    RW_UNREACHABLE("Instanced drawing is not supported on this platform");
+#endif
+}
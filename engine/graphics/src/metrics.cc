@@ -0,0 +1,21 @@
+#include "rosewood/graphics/metrics.h"
+
+using rosewood::core::metrics::Counter;
+using rosewood::core::metrics::Gauge;
+using rosewood::core::metrics::Histogram;
+
+namespace rosewood { namespace graphics { namespace metrics {
+
+    const Counter draw_calls("graphics.draw_calls");
+    const Counter triangle_count("graphics.triangle_count");
+    const Counter shader_change_count("graphics.shader_change_count");
+    const Counter gl_calls_issued("graphics.gl_calls_issued");
+    const Counter gl_calls_elided("graphics.gl_calls_elided");
+    const Counter instanced_draw_calls("graphics.instanced_draw_calls");
+    const Counter instance_count("graphics.instance_count");
+    const Counter bytes_streamed("graphics.bytes_streamed");
+    const Counter upload_bytes("graphics.upload_bytes");
+    const Gauge render_queue_size("graphics.render_queue_size");
+    const Histogram culling_usec("graphics.culling_usec");
+
+} } }
@@ -3,7 +3,8 @@
 #include <algorithm>
 #include <iostream>
 
-#include "rosewood/core/stats.h"
+#include "rosewood/core/logging.h"
+#include "rosewood/core/profiler.h"
 
 #include "rosewood/math/math_types.h"
 #include "rosewood/math/matrix3.h"
@@ -14,36 +15,34 @@
 #include "rosewood/graphics/shader.h"
 #include "rosewood/graphics/camera.h"
 #include "rosewood/graphics/material.h"
+#include "rosewood/graphics/gl_func.h"
 #include "rosewood/graphics/gl_state.h"
 #include "rosewood/graphics/mesh.h"
+#include "rosewood/graphics/metrics.h"
+#include "rosewood/graphics/sort_key.h"
 #include "rosewood/graphics/view_frustum.h"
 #include "rosewood/graphics/light.h"
 #include "rosewood/graphics/texture.h"
 
 using rosewood::core::transform;
 
+using rosewood::data_structures::radix_sort;
+
+using rosewood::graphics::Camera;
+using rosewood::graphics::Light;
+using rosewood::graphics::Mesh;
 using rosewood::graphics::RenderCommand;
 using rosewood::graphics::RenderQueue;
+using rosewood::graphics::Shader;
 
-bool rosewood::graphics::operator<(const RenderCommand &lhs, const RenderCommand &rhs) {
-    int cmp = (int)(lhs._camera - rhs._camera);
-    if (cmp) return cmp < 0;
-
-    cmp = lhs._shader->queue_index() - rhs._shader->queue_index();
-    if (cmp) return cmp < 0;
-
-    auto lhs_tex_index = lhs._material->texture()
-        ? lhs._material->texture()->index() : 0;
-    auto rhs_tex_index = rhs._material->texture()
-        ? rhs._material->texture()->index() : 0;
-
-    cmp = (int)(lhs_tex_index - rhs_tex_index);
-    if (cmp) return cmp < 0;
-
-    return math::get(lhs._transform, 2, 3) < math::get(rhs._transform, 2, 3);
+// The light's direction in the camera's eye space
+static rosewood::math::Vector4 light_direction(const Camera *camera, const Light *light) {
+    auto light_mat = transform(light->entity())->world_transform();
+    auto inv_camera_mat = transform(camera->entity())->inverse_world_transform();
+    return (inv_camera_mat * light_mat) * rosewood::math::Vector4(0, 0, 1, 0);
 }
 
-void RenderCommand::execute(const RenderCommand *previous) const {
+void RenderCommand::execute(const RenderCommand *previous, RenderQueue *queue) const {
 	RW_ASSERT(_material, "Expecting material for rendering");
 	RW_ASSERT(_mesh, "Expecting mesh for rendering");
 
@@ -51,57 +50,226 @@ void RenderCommand::execute(const RenderCommand *previous) const {
 
     if (old_mat != _material) {
         if (old_mat) {
-            previous->flush();
+            previous->flush(queue);
         }
         activate_material();
     }
 
-    _material->enqueue_mesh(_mesh, _transform, _inverse_transform);
+    if (_mesh->usage() == Mesh::Usage::Static) {
+        // Draw whatever has been batched so far first to keep the order
+        flush(queue);
+        _material->clear_vertex_buffer();
+        draw_static(queue);
+    }
+    else {
+        _material->enqueue_mesh(_mesh, _transform, _inverse_transform);
+    }
 }
 
 bool RenderCommand::is_visible() const {
     return _camera->view_frustum().is_visible(_mesh, _transform, _max_axis_scale);
 }
 
-void RenderCommand::flush() const {
+bool RenderCommand::is_instanced() const {
+    return _shader->supports_instancing();
+}
+
+bool RenderCommand::can_share_instanced_draw(const RenderCommand &other) const {
+    return (is_instanced()
+            && _shader == other._shader
+            && _mesh == other._mesh
+            && _material == other._material
+            && _camera == other._camera
+            && _light == other._light);
+}
+
+void RenderCommand::flush(RenderQueue *queue) const {
     if (_material->has_enqueued_meshes()) {
-        auto shader = _material->shader();
+        activate_shader(math::make_identity4(), mat3(math::make_identity4()), queue);
+        _material->submit_draw_calls(&queue->_vertex_stream);
+    }
+}
+
+void RenderCommand::draw_static(RenderQueue *queue) const {
+    activate_shader(_transform, transposed(mat3(_inverse_transform)), queue);
+    _material->draw_static_mesh(_mesh);
+}
+
+void RenderCommand::activate_shader(const math::Matrix4 &modelview, const math::Matrix3 &normal_matrix,
+                                    RenderQueue *queue) const {
+    auto shader = _material->shader();
+    shader->set_modelview_uniform(modelview);
+    shader->set_normal_uniform(normal_matrix);
+
+    if (shader->uses_frame_uniforms()) {
+        queue->use_frame_uniforms(_camera, _light);
+    }
+    else {
         shader->set_projection_uniform(_camera->projection_matrix());
-        shader->set_modelview_uniform(math::make_identity4());
-        shader->set_normal_uniform(mat3(math::make_identity4()));
 
         if (_light) {
-            auto light_mat = transform(_light->entity())->world_transform();
-            auto inv_camera_mat = transform(_camera->entity())->inverse_world_transform();
-            auto light_dir = (inv_camera_mat * light_mat) * math::Vector4(0, 0, 1, 0);
+            auto light_dir = light_direction(_camera, _light);
 
             shader->set_light_position_uniform(math::Vector3(light_dir.x, light_dir.y, light_dir.z));
             shader->set_light_color_uniform(_light->color());
         }
-        shader->use();
-        _material->submit_draw_calls();
     }
+    shader->use();
 }
 
 void RenderCommand::activate_material() const {
     _material->clear_vertex_buffer();
 }
 
+RenderQueue::RenderQueue()
+: _instance_buffer(UINT_MAX)
+, _frame_uniforms(Shader::kFrameUniformsBinding, sizeof(Shader::FrameUniforms))
+, _frame_uniforms_bound(false)
+, _frame_camera(nullptr), _frame_light(nullptr) { }
+
+RenderQueue::~RenderQueue() {
+    if (_instance_buffer != UINT_MAX) {
+        GL_FUNC(glDeleteBuffers)(1, &_instance_buffer);
+    }
+}
+
 void RenderQueue::clear() {
     _commands.clear();
+    _order.clear();
+    _cameras.clear();
+    _instances.clear();
 }
 
 void RenderQueue::sort() {
-    std::sort(begin(_commands), end(_commands));
+    RW_PROFILE_SCOPE("render.sort");
+    radix_sort(&_order, &_sort_scratch);
+}
+
+uint64_t RenderQueue::sort_key(const RenderCommand &command) {
+    auto camera = std::find(begin(_cameras), end(_cameras), command._camera);
+    if (camera == end(_cameras)) {
+        camera = _cameras.insert(camera, command._camera);
+
+        if (_cameras.size() == kMaxSortKeyCameras + 1) {
+            LOG(WARNING) << "More than " << kMaxSortKeyCameras
+                         << " cameras in one render queue, the last ones draw in no set order";
+        }
+    }
+
+    auto texture = command._material->texture();
+    auto instanced = command.is_instanced();
+
+    uint32_t low_bits;
+    if (instanced) {
+        low_bits = _instances.batch_id(command._shader, command._material, command._mesh, command._light);
+    }
+    else {
+        low_bits = quantize_depth(math::get(command._transform, 2, 3));
+    }
+
+    return make_sort_key(camera - begin(_cameras),
+                         command._shader->queue_index(),
+                         command._shader->sort_id(),
+                         texture ? texture->index() : 0,
+                         instanced, low_bits);
 }
 
 void RenderQueue::run() {
-    core::stats::render_queue_size = _commands.size();
+    RW_PROFILE_SCOPE("render.run");
+
+    metrics::render_queue_size.set((double)_commands.size());
 
-    RenderCommand *prev = nullptr;
-    for (auto &command : _commands) {
-        command.execute(prev);
-        prev = &command;
+    const RenderCommand *prev = nullptr;
+    size_t index = 0;
+
+    // Other queues may have bound their own frame buffer in the meantime,
+    // and the camera may have moved since the last run
+    _frame_uniforms_bound = false;
+
+    _vertex_stream.begin_frame();
+
+    while (index < _order.size()) {
+        auto &command = command_at(index);
+
+        if (!command.is_instanced()) {
+            command.execute(prev, this);
+            prev = &command;
+            ++index;
+            continue;
+        }
+
+        auto run_end = index + 1;
+        while (run_end < _order.size() && command_at(run_end).can_share_instanced_draw(command)) {
+            ++run_end;
+        }
+
+        draw_instanced(prev, index, run_end);
+        prev = &command_at(run_end - 1);
+        index = run_end;
+    }
+    if (prev) prev->flush(this);
+
+    _vertex_stream.end_frame();
+}
+
+void RenderQueue::draw_instanced(const RenderCommand *previous, size_t begin, size_t end) {
+    auto &first = command_at(begin);
+
+    if (previous && previous->_material != first._material) {
+        previous->flush(this);
+        first.activate_material();
+    }
+
+    _instances.clear_instances();
+    for (size_t index = begin; index < end; ++index) {
+        const auto &command = command_at(index);
+        _instances.add_instance(command._transform, command._inverse_transform);
+    }
+
+    auto &instance_data = _instances.instance_data();
+
+    if (_instance_buffer == UINT_MAX) {
+        GL_FUNC(glGenBuffers)(1, &_instance_buffer);
+    }
+
+    // Respecifying the whole buffer lets the driver hand us fresh storage
+    // instead of waiting for draws still reading the previous contents
+    gl_state::bind_array_buffer(_instance_buffer);
+    GL_FUNC(glBufferData)(GL_ARRAY_BUFFER, instance_data.size() * sizeof(float),
+                          instance_data.data(), GL_STREAM_DRAW);
+    metrics::upload_bytes.increment(instance_data.size() * sizeof(float));
+
+    first.activate_shader(math::make_identity4(), mat3(math::make_identity4()), this);
+    first._material->draw_instanced_mesh(first._mesh, _instance_buffer, end - begin);
+}
+
+void RenderQueue::use_frame_uniforms(const Camera *camera, const Light *light) {
+    if (_frame_uniforms_bound && camera == _frame_camera && light == _frame_light) {
+        return;
+    }
+
+    if (!_frame_uniforms_bound) {
+        _frame_uniforms.bind();
+        _frame_uniforms_bound = true;
+    }
+
+    _frame_camera = camera;
+    _frame_light = light;
+
+    Shader::FrameUniforms frame = {};
+
+    auto projection = camera->projection_matrix();
+    std::copy(ptr(projection), ptr(projection) + 16, frame.projection_matrix);
+
+    if (light) {
+        auto light_dir = light_direction(camera, light);
+        auto light_color = light->color();
+
+        frame.light_position[0] = light_dir.x;
+        frame.light_position[1] = light_dir.y;
+        frame.light_position[2] = light_dir.z;
+        std::copy(ptr(light_color), ptr(light_color) + 4, frame.light_color);
     }
-    if (prev) prev->flush();
+
+    _frame_uniforms.update(&frame);
 }
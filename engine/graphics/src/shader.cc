@@ -1,7 +1,9 @@
 #include "rosewood/graphics/shader.h"
 
+#include <algorithm>
 #include <iostream>
 #include <numeric>
+#include <unordered_map>
 
 #include "rosewood/core/resource_manager.h"
 #include "rosewood/core/logging.h"
@@ -16,6 +18,7 @@
 
 #include "rosewood/graphics/gl_state.h"
 #include "rosewood/graphics/gl_func.h"
+#include "rosewood/graphics/sort_key.h"
 
 using rosewood::core::Asset;
 
@@ -26,17 +29,38 @@ using rosewood::math::Vector4;
 using rosewood::graphics::Shader;
 
 const int Shader::kDefaultQueueIndex = 100;
+const GLuint Shader::kFrameUniformsBinding;
+
+static size_t gNextSortId = 0;
 
 const char *Shader::kAttributeNames[(int)Shader::Attributes::kNumAttributes] = {
     "rw_vertex", "rw_normal", "rw_texcoord",
 };
 
+const char *Shader::kInstanceAttributeNames[(int)Shader::InstanceAttributes::kNumInstanceAttributes] = {
+    "rw_instance_modelview_matrix", "rw_instance_normal_matrix",
+};
+
 const char *Shader::kUniformNames[(int)Shader::Uniforms::kNumUniforms] = {
     "rw_projection_matrix", "rw_modelview_matrix", "rw_normal_matrix",
     "rw_texture",
     "rw_light_position", "rw_light_color"
 };
 
+const char *Shader::kFrameUniformsBlockName = "rw_frame";
+
+static bool is_frame_uniform(Shader::Uniforms uniform) {
+    return (uniform == Shader::Uniforms::kProjectionMatrixUniform
+            || uniform == Shader::Uniforms::kLightPositionUniform
+            || uniform == Shader::Uniforms::kLightColorUniform);
+}
+
+// Instanced programs read these from instance attributes instead
+static bool is_instance_uniform(Shader::Uniforms uniform) {
+    return (uniform == Shader::Uniforms::kModelViewMatrixUniform
+            || uniform == Shader::Uniforms::kNormalMatrixUniform);
+}
+
 static GLenum convert_blend_name(const std::string &name) {
     static std::unordered_map<std::string, GLenum> blend_modes{
         { "zero", GL_ZERO }, { "one", GL_ONE },
@@ -58,8 +82,11 @@ std::shared_ptr<Shader> Shader::create(const std::string &resource_path) {
 
 Shader::Shader(std::shared_ptr<Asset> shader_spec_asset)
 : _program(UINT_MAX)
+, _uses_frame_uniforms(false)
 , _shader_spec(core::create_view(shader_spec_asset, [&] { reload_shader(); }))
 , _queue_index(kDefaultQueueIndex)
+, _sort_id(gNextSortId++)
+, _instancing(false)
 , _depth_test(true), _depth_write(true)
 , _enable_blend(false)
 , _polygon_offset_factor(0), _polygon_offset_units(0)
@@ -94,37 +121,37 @@ void Shader::use() const {
 
 void Shader::set_projection_uniform(Matrix4 projection_matrix) const {
     gl_state::set_uniform(_program,
-                          _uniforms.at(kUniformNames[(int)Uniforms::kProjectionMatrixUniform]),
+                          _uniform_locations[(int)Uniforms::kProjectionMatrixUniform],
                           projection_matrix);
 }
 
 void Shader::set_modelview_uniform(Matrix4 modelview_matrix) const {
     gl_state::set_uniform(_program,
-                          _uniforms.at(kUniformNames[(int)Uniforms::kModelViewMatrixUniform]),
+                          _uniform_locations[(int)Uniforms::kModelViewMatrixUniform],
                           modelview_matrix);
 }
 
 void Shader::set_normal_uniform(Matrix3 normal_matrix) const {
     gl_state::set_uniform(_program,
-                          _uniforms.at(kUniformNames[(int)Uniforms::kNormalMatrixUniform]),
+                          _uniform_locations[(int)Uniforms::kNormalMatrixUniform],
                           normal_matrix);
 }
 
 void Shader::set_texture_sampler_uniform(int sampler) const {
     gl_state::set_uniform(_program,
-                          _uniforms.at(kUniformNames[(int)Uniforms::kTextureSamplerUniform]),
+                          _uniform_locations[(int)Uniforms::kTextureSamplerUniform],
                           sampler);
 }
 
 void Shader::set_light_position_uniform(math::Vector3 light_position) const {
     gl_state::set_uniform(_program,
-                          _uniforms.at(kUniformNames[(int)Uniforms::kLightPositionUniform]),
+                          _uniform_locations[(int)Uniforms::kLightPositionUniform],
                           Vector4(light_position.x(), light_position.y(), light_position.z(), 0));
 }
 
 void Shader::set_light_color_uniform(math::Vector4 light_color) const {
     gl_state::set_uniform(_program,
-                          _uniforms.at(kUniformNames[(int)Uniforms::kLightColorUniform]),
+                          _uniform_locations[(int)Uniforms::kLightColorUniform],
                           light_color);
 }
 
@@ -185,6 +212,9 @@ void Shader::reload_shader() {
         destroy_shader();
     }
 
+    _uniform_locations.fill(-1);
+    _uses_frame_uniforms = false;
+
     auto &contents = _shader_spec->str();
     auto spec = data_format::read_data(contents);
 
@@ -227,8 +257,17 @@ void Shader::reload_shader() {
                 _extra_attributes.push_back(spec);
             }
         }
+        else if (key == "instancing") {
+            _instancing = data_format::as<bool>(value);
+        }
         else if (key == "queue-index") {
             _queue_index = data_format::as<int>(value);
+
+            if (_queue_index < 0 || _queue_index >= (1 << kSortKeyQueueBits)) {
+                LOG(WARNING) << "Shader queue index " << _queue_index << " is outside 0-"
+                             << (1 << kSortKeyQueueBits) - 1 << ", clamping it";
+                _queue_index = std::max(0, std::min(_queue_index, (1 << kSortKeyQueueBits) - 1));
+            }
         }
         else if (key == "depth-test") {
             _depth_test = data_format::as<bool>(value);
@@ -254,6 +293,11 @@ void Shader::reload_shader() {
         }
     }
 
+    if (_instancing && !RW_GL_HAS_INSTANCING) {
+        LOG(WARNING) << "Instanced drawing is not supported on this platform";
+        _instancing = false;
+    }
+
     _program = GL_FUNC(glCreateProgram)();
 
     GLuint vertex_shader;
@@ -282,14 +326,33 @@ void Shader::reload_shader() {
                                       _extra_attributes[index].name.c_str());
     }
 
+    if (_instancing) {
+        // The modelview matrix takes four locations, one per column
+        GL_FUNC(glBindAttribLocation)(_program, instance_attribute_location(),
+                                      kInstanceAttributeNames[(int)InstanceAttributes::kModelViewMatrixAttribute]);
+        GL_FUNC(glBindAttribLocation)(_program, instance_attribute_location() + 4,
+                                      kInstanceAttributeNames[(int)InstanceAttributes::kNormalMatrixAttribute]);
+    }
+
     if (!link_program(_program)) {
         LOG(ERROR, "Could not link shader program");
     }
 
+#if RW_GL_HAS_UNIFORM_BUFFERS
+    auto block_index = GL_FUNC(glGetUniformBlockIndex)(_program, kFrameUniformsBlockName);
+    if (block_index != GL_INVALID_INDEX) {
+        GL_FUNC(glUniformBlockBinding)(_program, block_index, kFrameUniformsBinding);
+        _uses_frame_uniforms = true;
+    }
+#endif
+
     for (GLuint index = 0; index < (int)Uniforms::kNumUniforms; ++index) {
-        auto name = kUniformNames[index];
-        _uniforms[name] = GL_FUNC(glGetUniformLocation)(_program, name);
-        if (_uniforms[name] == -1) {
+        _uniform_locations[index] = GL_FUNC(glGetUniformLocation)(_program, kUniformNames[index]);
+
+        // Members of the frame block have no location of their own
+        if (_uniform_locations[index] == -1
+            && !(_uses_frame_uniforms && is_frame_uniform((Uniforms)index))
+            && !(_instancing && is_instance_uniform((Uniforms)index))) {
             LOG(WARNING) << "Could not find uniform " << kUniformNames[index];
         }
     }
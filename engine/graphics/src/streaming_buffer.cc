@@ -0,0 +1,153 @@
+#include "rosewood/graphics/streaming_buffer.h"
+
+#include <limits.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "rosewood/core/assert.h"
+#include "rosewood/core/logging.h"
+
+#include "rosewood/graphics/gl_func.h"
+#include "rosewood/graphics/gl_state.h"
+#include "rosewood/graphics/metrics.h"
+
+using rosewood::graphics::StreamingBuffer;
+
+const size_t StreamingBuffer::kFrameCount;
+
+StreamingBuffer::StreamingBuffer(size_t frame_capacity)
+: _buffer(UINT_MAX), _frame_capacity(frame_capacity), _frame(0), _position(0) {
+#if RW_GL_HAS_SYNC_OBJECTS
+    std::fill(std::begin(_fences), std::end(_fences), nullptr);
+#endif
+}
+
+StreamingBuffer::~StreamingBuffer() {
+#if RW_GL_HAS_SYNC_OBJECTS
+    for (auto fence : _fences) {
+        if (fence) GL_FUNC(glDeleteSync)(fence);
+    }
+#endif
+
+    if (_buffer != UINT_MAX) {
+        GL_FUNC(glDeleteBuffers)(1, &_buffer);
+    }
+}
+
+size_t StreamingBuffer::region_start() const {
+#if RW_GL_HAS_SYNC_OBJECTS
+    return _frame * _frame_capacity;
+#else
+    return 0;
+#endif
+}
+
+size_t StreamingBuffer::region_size() const {
+    return _frame_capacity;
+}
+
+void StreamingBuffer::allocate(size_t frame_capacity) {
+    if (_buffer == UINT_MAX) {
+        GL_FUNC(glGenBuffers)(1, &_buffer);
+    }
+
+    _frame_capacity = frame_capacity;
+
+#if RW_GL_HAS_SYNC_OBJECTS
+    // Fresh storage, so nothing in it can be in use
+    for (auto &fence : _fences) {
+        if (fence) GL_FUNC(glDeleteSync)(fence);
+        fence = nullptr;
+    }
+
+    auto total_size = _frame_capacity * kFrameCount;
+#else
+    auto total_size = _frame_capacity;
+#endif
+
+    // Draws already issued keep reading the storage being replaced
+    gl_state::bind_array_buffer(_buffer);
+    GL_FUNC(glBufferData)(GL_ARRAY_BUFFER, total_size, nullptr, GL_STREAM_DRAW);
+}
+
+void StreamingBuffer::begin_frame() {
+    _position = 0;
+
+    if (_buffer == UINT_MAX) {
+        allocate(_frame_capacity);
+        return;
+    }
+
+#if RW_GL_HAS_SYNC_OBJECTS
+    _frame = (_frame + 1) % kFrameCount;
+
+    auto &fence = _fences[_frame];
+    if (fence) {
+        auto result = GL_FUNC(glClientWaitSync)(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        GL_FUNC(glDeleteSync)(fence);
+        fence = nullptr;
+
+        // The GPU might still be reading the region, so don't write into
+        // it: orphan the whole buffer instead, which also drops the fences
+        if (result == GL_WAIT_FAILED) {
+            LOG(WARNING) << "Waiting for a streaming buffer region failed, orphaning the buffer";
+            allocate(_frame_capacity);
+        }
+    }
+#else
+    allocate(_frame_capacity);
+#endif
+}
+
+void StreamingBuffer::end_frame() {
+#if RW_GL_HAS_SYNC_OBJECTS
+    auto &fence = _fences[_frame];
+    if (fence) GL_FUNC(glDeleteSync)(fence);
+
+    fence = GL_FUNC(glFenceSync)(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+}
+
+size_t StreamingBuffer::append(const void *data, size_t size, size_t alignment) {
+    RW_ASSERT(_buffer != UINT_MAX, "Streaming buffer used outside of a frame");
+    RW_ASSERT(alignment, "Alignment must not be zero");
+
+    auto start = region_start();
+    auto offset = (start + _position + alignment - 1) / alignment * alignment;
+
+    if (offset + size > start + region_size()) {
+        // Growing reallocates every region, so the offsets start over
+        allocate(std::max(_frame_capacity * 2, size + alignment));
+
+        start = region_start();
+        offset = (start + alignment - 1) / alignment * alignment;
+    }
+
+    gl_state::bind_array_buffer(_buffer);
+
+#if RW_GL_HAS_SYNC_OBJECTS
+    // The region's fence has been waited on, so the GPU is done with it.
+    // Mapping can still fail (out of memory, or drivers rejecting the
+    // flags), in which case the driver copies the data for us instead.
+    auto destination = GL_FUNC(glMapBufferRange)(GL_ARRAY_BUFFER, offset, size,
+                                                 GL_MAP_WRITE_BIT
+                                                 | GL_MAP_INVALIDATE_RANGE_BIT
+                                                 | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (destination) {
+        memcpy(destination, data, size);
+        GL_FUNC(glUnmapBuffer)(GL_ARRAY_BUFFER);
+    }
+    else {
+        GL_FUNC(glBufferSubData)(GL_ARRAY_BUFFER, offset, size, data);
+    }
+#else
+    GL_FUNC(glBufferSubData)(GL_ARRAY_BUFFER, offset, size, data);
+#endif
+
+    _position = offset + size - start;
+    metrics::bytes_streamed.increment(size);
+    metrics::upload_bytes.increment(size);
+
+    return offset;
+}
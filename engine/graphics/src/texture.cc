@@ -5,15 +5,40 @@
 #include "rosewood/graphics/gl_state.h"
 #include "rosewood/graphics/gl_func.h"
 #include "rosewood/graphics/image_loader.h"
+#include "rosewood/graphics/metrics.h"
 
 using rosewood::core::Asset;
+using rosewood::core::LoadPriority;
+using rosewood::core::ResourceRequest;
 
+using rosewood::graphics::ImageData;
 using rosewood::graphics::Texture;
 
 std::shared_ptr<Texture> Texture::create(const std::string &resource_path) {
     return std::make_shared<Texture>(core::get_resource(resource_path));
 }
 
+std::shared_ptr<ResourceRequest> Texture::create_async(const std::string &resource_path,
+                                                       std::function<void(std::shared_ptr<Texture>)> on_loaded,
+                                                       LoadPriority priority) {
+    auto decode = [](const std::string &file_contents) -> std::shared_ptr<void> {
+        return std::make_shared<ImageData>(image_loader::load_bytes(file_contents));
+    };
+
+    return core::get_resource_async(resource_path, decode,
+                                    [on_loaded](const std::shared_ptr<Asset> &asset,
+                                                const std::shared_ptr<void> &decoded) {
+                                        if (!asset) {
+                                            on_loaded(nullptr);
+                                            return;
+                                        }
+
+                                        auto &image_data = *std::static_pointer_cast<ImageData>(decoded);
+                                        on_loaded(std::make_shared<Texture>(asset, std::move(image_data)));
+                                    },
+                                    priority);
+}
+
 Texture::Texture(const std::shared_ptr<Asset> &image_asset)
 : _image_asset(core::create_view(image_asset, [&] { reload_image_asset(); })) {
     glGenTextures(1, &_texture);
@@ -22,6 +47,15 @@ Texture::Texture(const std::shared_ptr<Asset> &image_asset)
     reload_image_asset();
 }
 
+Texture::Texture(const std::shared_ptr<Asset> &image_asset, ImageData image_data)
+: _image_asset(core::create_view(image_asset, [&] { reload_image_asset(); }))
+, _image_data(std::move(image_data)) {
+    glGenTextures(1, &_texture);
+    _image_asset->did_decode();
+
+    reload_image_data();
+}
+
 Texture::Texture(const ImageData &image_data)
 : _image_data(image_data) {
     glGenTextures(1, &_texture);
@@ -39,6 +73,7 @@ void Texture::bind() const {
 
 void Texture::reload_image_asset() {
     _image_data = image_loader::load_bytes(_image_asset->str());
+    _image_asset->did_decode();
     reload_image_data();
 }
 
@@ -48,6 +83,7 @@ void Texture::reload_image_data() {
     GL_FUNC(glTexImage2D)(GL_TEXTURE_2D, 0, GL_RGBA,
                           _image_data.width, _image_data.height, 0,
                           GL_RGBA, GL_UNSIGNED_BYTE, &_image_data.bytes[0]);
+    metrics::upload_bytes.increment(_image_data.bytes.size());
     GL_FUNC(glGenerateMipmap)(GL_TEXTURE_2D);
     GL_FUNC(glTexParameteri)(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     GL_FUNC(glTexParameteri)(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -0,0 +1,68 @@
+#include "rosewood/graphics/uniform_buffer.h"
+
+#include <limits.h>
+#include <string.h>
+
+#include "rosewood/core/assert.h"
+
+#include "rosewood/graphics/gl_func.h"
+#include "rosewood/graphics/metrics.h"
+
+using rosewood::graphics::UniformBuffer;
+
+UniformBuffer::UniformBuffer(GLuint binding, size_t size)
+: _buffer(UINT_MAX), _binding(binding), _contents(size), _has_contents(false) { }
+
+UniformBuffer::~UniformBuffer() {
+#if RW_GL_HAS_UNIFORM_BUFFERS
+    if (_buffer != UINT_MAX) {
+        GL_FUNC(glDeleteBuffers)(1, &_buffer);
+    }
+#endif
+}
+
+void UniformBuffer::create() {
+#if RW_GL_HAS_UNIFORM_BUFFERS
+    GL_FUNC(glGenBuffers)(1, &_buffer);
+    GL_FUNC(glBindBuffer)(GL_UNIFORM_BUFFER, _buffer);
+    GL_FUNC(glBufferData)(GL_UNIFORM_BUFFER, _contents.size(), nullptr, GL_DYNAMIC_DRAW);
+#else
+    RW_UNREACHABLE("Uniform buffers are not supported on this platform");
+#endif
+}
+
+void UniformBuffer::bind() {
+#if RW_GL_HAS_UNIFORM_BUFFERS
+    if (_buffer == UINT_MAX) {
+        create();
+    }
+
+    GL_FUNC(glBindBufferBase)(GL_UNIFORM_BUFFER, _binding, _buffer);
+#else
+    RW_UNREACHABLE("Uniform buffers are not supported on this platform");
+#endif
+}
+
+bool UniformBuffer::update(const void *data) {
+    if (_has_contents && memcmp(_contents.data(), data, _contents.size()) == 0) {
+        return false;
+    }
+
+#if RW_GL_HAS_UNIFORM_BUFFERS
+    if (_buffer == UINT_MAX) {
+        create();
+    }
+
+    memcpy(_contents.data(), data, _contents.size());
+    _has_contents = true;
+
+    // GL_UNIFORM_BUFFER is not tracked by gl_state, so binding it here
+    // can't confuse the state cache
+    GL_FUNC(glBindBuffer)(GL_UNIFORM_BUFFER, _buffer);
+    GL_FUNC(glBufferSubData)(GL_UNIFORM_BUFFER, 0, _contents.size(), _contents.data());
+    metrics::upload_bytes.increment(_contents.size());
+    return true;
+#else
+    RW_UNREACHABLE("Uniform buffers are not supported on this platform");
+#endif
+}
@@ -1,10 +1,13 @@
 #include "rosewood/graphics/view_frustum.h"
 
+#include <math.h>
+
 #include <algorithm>
 
 #include "rosewood/math/vector.h"
 #include "rosewood/math/matrix4.h"
 #include "rosewood/math/plane.h"
+#include "rosewood/math/sphere_culling.h"
 
 #include "rosewood/graphics/camera.h"
 #include "rosewood/graphics/mesh.h"
@@ -12,9 +15,12 @@
 using rosewood::math::Vector3;
 using rosewood::math::Vector4;
 using rosewood::math::Matrix4;
+using rosewood::math::Plane;
+using rosewood::math::cull_spheres;
 using rosewood::math::plane_from_points;
 using rosewood::math::distance;
 
+using rosewood::graphics::BoundingSpheres;
 using rosewood::graphics::Camera;
 using rosewood::graphics::Mesh;
 using rosewood::graphics::ViewFrustum;
@@ -48,6 +54,57 @@ bool ViewFrustum::is_visible(const Mesh *mesh,
     return true;
 }
 
+void BoundingSpheres::clear() {
+    xs.clear();
+    ys.clear();
+    zs.clear();
+    radii.clear();
+}
+
+void BoundingSpheres::push_back(const Vector3 &center, float radius) {
+    xs.push_back(center.x());
+    ys.push_back(center.y());
+    zs.push_back(center.z());
+    radii.push_back(radius);
+}
+
+void ViewFrustum::cull(const Matrix4 &view_transform,
+                       const BoundingSpheres &spheres,
+                       std::vector<uint32_t> *visible) const {
+    // Move the planes into world space once, instead of moving every
+    // sphere into camera space
+    auto planes = world_planes(view_transform);
+
+    visible->resize((spheres.size() + 31) / 32);
+    cull_spheres(planes.data(), planes.size(),
+                 spheres.xs.data(), spheres.ys.data(), spheres.zs.data(), spheres.radii.data(),
+                 spheres.size(), visible->data());
+}
+
+ViewFrustum::PlaneArray ViewFrustum::world_planes(const Matrix4 &view_transform) const {
+    PlaneArray planes;
+
+    for (int p = 0; p < (int)FrustumPlane::NumPlanes; ++p) {
+        const auto &plane = _planes[p];
+        float coeffs[4];
+
+        for (int col = 0; col < 4; ++col) {
+            coeffs[col] = (plane.x * get(view_transform, 0, col) +
+                           plane.y * get(view_transform, 1, col) +
+                           plane.z * get(view_transform, 2, col) +
+                           plane.p * get(view_transform, 3, col));
+        }
+
+        // Renormalize in case the camera is scaled, so distances stay in
+        // world units
+        auto length = sqrtf(coeffs[0] * coeffs[0] + coeffs[1] * coeffs[1] + coeffs[2] * coeffs[2]);
+        planes[p] = Plane(coeffs[0] / length, coeffs[1] / length,
+                          coeffs[2] / length, coeffs[3] / length);
+    }
+
+    return planes;
+}
+
 void ViewFrustum::make_perspective_frustum_planes(const Camera *camera) {
     Vector3 forward(0, 0, -1);
     Vector3 up(0, 1, 0);
@@ -0,0 +1,26 @@
+#ifndef __ROSEWOOD_MATH_BATCH_TRANSFORM_H__
+#define __ROSEWOOD_MATH_BATCH_TRANSFORM_H__
+
+#include <stddef.h>
+
+#include "math_types.h"
+
+namespace rosewood { namespace math {
+
+    // Transforms `count` points by `m`, with the same perspective divide as
+    // Matrix4 * Vector3, writing the x, y and z of point i to
+    // out[i * out_stride + 0..2]. Nothing else in `out` is touched.
+    //
+    // Points are processed four at a time with SSE or NEON when available,
+    // transposed into separate x, y and z registers so that every lane
+    // does useful work.
+    void transform_points(const Matrix4 &m, const Vector3 *points, size_t count,
+                          float *out, size_t out_stride);
+
+    // Same as transform_points, but for Matrix3 * Vector3
+    void transform_directions(const Matrix3 &m, const Vector3 *directions, size_t count,
+                              float *out, size_t out_stride);
+
+} }
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef __ROSEWOOD_MATH_SPHERE_CULLING_H__
+#define __ROSEWOOD_MATH_SPHERE_CULLING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "math_types.h"
+
+namespace rosewood { namespace math {
+
+    // Tests `count` spheres, given as separate arrays of centre coordinates
+    // and radii, against `n_planes` normalized planes. Bit i % 32 of
+    // visible[i / 32] is set if sphere i isn't entirely behind any of the
+    // planes. All (count + 31) / 32 words are written, with the bits past
+    // the last sphere cleared.
+    //
+    // Spheres are tested eight at a time with AVX, or four at a time with
+    // SSE or NEON, against all planes before moving on.
+    void cull_spheres(const Plane *planes, size_t n_planes,
+                      const float *xs, const float *ys, const float *zs, const float *radii,
+                      size_t count, uint32_t *visible);
+
+} }
+
+#endif
@@ -0,0 +1,166 @@
+#include "rosewood/math/batch_transform.h"
+
+#if !__SSE__ && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#define RW_BATCH_TRANSFORM_NEON 1
+#include <arm_neon.h>
+#endif
+
+#include "rosewood/math/matrix3.h"
+#include "rosewood/math/matrix4.h"
+#include "rosewood/math/vector.h"
+
+using rosewood::math::Matrix3;
+using rosewood::math::Matrix4;
+using rosewood::math::Vector3;
+
+static void transform_point(const float * __restrict a, const float * __restrict b, float * __restrict r) {
+    float w = a[ 3]*b[ 0] + a[ 7]*b[ 1] + a[11]*b[ 2] + a[15];
+    r[0] = (a[ 0]*b[ 0] + a[ 4]*b[ 1] + a[ 8]*b[ 2] + a[12]) / w;
+    r[1] = (a[ 1]*b[ 0] + a[ 5]*b[ 1] + a[ 9]*b[ 2] + a[13]) / w;
+    r[2] = (a[ 2]*b[ 0] + a[ 6]*b[ 1] + a[10]*b[ 2] + a[14]) / w;
+}
+
+static void transform_direction(const float * __restrict a, const float * __restrict b, float * __restrict r) {
+    r[0] = a[0]*b[0] + a[3]*b[1] + a[6]*b[2];
+    r[1] = a[1]*b[0] + a[4]*b[1] + a[7]*b[2];
+    r[2] = a[2]*b[0] + a[5]*b[1] + a[8]*b[2];
+}
+
+#if __SSE__
+
+// Writes exactly three floats, so interleaved attributes following the
+// vector are left alone
+static inline void store3(float *out, __m128 v) {
+    _mm_storel_pi(reinterpret_cast<__m64*>(out), v);
+    _mm_store_ss(out + 2, _mm_movehl_ps(v, v));
+}
+
+static inline __m128 madd(__m128 a, __m128 b, __m128 c) {
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+
+#elif RW_BATCH_TRANSFORM_NEON
+
+// ARMv7 NEON has no division, so refine the reciprocal estimate twice
+static inline float32x4_t divide(float32x4_t a, float32x4_t b) {
+    auto r = vrecpeq_f32(b);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    return vmulq_f32(a, r);
+}
+
+#endif
+
+void rosewood::math::transform_points(const Matrix4 &m, const Vector3 *points, size_t count,
+                                      float *out, size_t out_stride) {
+    const float *a = ptr(m);
+    size_t i = 0;
+
+#if __SSE__
+    __m128 c[16];
+    for (int k = 0; k < 16; ++k) {
+        c[k] = _mm_set1_ps(a[k]);
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        auto x = points[i + 0].m128;
+        auto y = points[i + 1].m128;
+        auto z = points[i + 2].m128;
+        auto w = points[i + 3].m128;
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+
+        auto rw = madd(c[ 3], x, madd(c[ 7], y, madd(c[11], z, c[15])));
+        auto rx = _mm_div_ps(madd(c[ 0], x, madd(c[ 4], y, madd(c[ 8], z, c[12]))), rw);
+        auto ry = _mm_div_ps(madd(c[ 1], x, madd(c[ 5], y, madd(c[ 9], z, c[13]))), rw);
+        auto rz = _mm_div_ps(madd(c[ 2], x, madd(c[ 6], y, madd(c[10], z, c[14]))), rw);
+        _MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+
+        store3(out + (i + 0) * out_stride, rx);
+        store3(out + (i + 1) * out_stride, ry);
+        store3(out + (i + 2) * out_stride, rz);
+        store3(out + (i + 3) * out_stride, rw);
+    }
+#elif RW_BATCH_TRANSFORM_NEON
+    float32x4_t c[16];
+    for (int k = 0; k < 16; ++k) {
+        c[k] = vdupq_n_f32(a[k]);
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        // Vector3 is padded to four floats, so this splits the components
+        auto v = vld4q_f32(ptr(points[i]));
+        auto x = v.val[0], y = v.val[1], z = v.val[2];
+
+        auto rw = vmlaq_f32(vmlaq_f32(vmlaq_f32(c[15], c[ 3], x), c[ 7], y), c[11], z);
+
+        float32x4x3_t r;
+        r.val[0] = divide(vmlaq_f32(vmlaq_f32(vmlaq_f32(c[12], c[ 0], x), c[ 4], y), c[ 8], z), rw);
+        r.val[1] = divide(vmlaq_f32(vmlaq_f32(vmlaq_f32(c[13], c[ 1], x), c[ 5], y), c[ 9], z), rw);
+        r.val[2] = divide(vmlaq_f32(vmlaq_f32(vmlaq_f32(c[14], c[ 2], x), c[ 6], y), c[10], z), rw);
+
+        vst3q_lane_f32(out + (i + 0) * out_stride, r, 0);
+        vst3q_lane_f32(out + (i + 1) * out_stride, r, 1);
+        vst3q_lane_f32(out + (i + 2) * out_stride, r, 2);
+        vst3q_lane_f32(out + (i + 3) * out_stride, r, 3);
+    }
+#endif
+
+    for (; i < count; ++i) {
+        transform_point(a, ptr(points[i]), out + i * out_stride);
+    }
+}
+
+void rosewood::math::transform_directions(const Matrix3 &m, const Vector3 *directions, size_t count,
+                                          float *out, size_t out_stride) {
+    const float *a = ptr(m);
+    size_t i = 0;
+
+#if __SSE__
+    __m128 c[9];
+    for (int k = 0; k < 9; ++k) {
+        c[k] = _mm_set1_ps(a[k]);
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        auto x = directions[i + 0].m128;
+        auto y = directions[i + 1].m128;
+        auto z = directions[i + 2].m128;
+        auto w = directions[i + 3].m128;
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+
+        auto rx = madd(c[0], x, madd(c[3], y, _mm_mul_ps(c[6], z)));
+        auto ry = madd(c[1], x, madd(c[4], y, _mm_mul_ps(c[7], z)));
+        auto rz = madd(c[2], x, madd(c[5], y, _mm_mul_ps(c[8], z)));
+        _MM_TRANSPOSE4_PS(rx, ry, rz, w);
+
+        store3(out + (i + 0) * out_stride, rx);
+        store3(out + (i + 1) * out_stride, ry);
+        store3(out + (i + 2) * out_stride, rz);
+        store3(out + (i + 3) * out_stride, w);
+    }
+#elif RW_BATCH_TRANSFORM_NEON
+    float32x4_t c[9];
+    for (int k = 0; k < 9; ++k) {
+        c[k] = vdupq_n_f32(a[k]);
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        auto v = vld4q_f32(ptr(directions[i]));
+        auto x = v.val[0], y = v.val[1], z = v.val[2];
+
+        float32x4x3_t r;
+        r.val[0] = vmlaq_f32(vmlaq_f32(vmulq_f32(c[6], z), c[0], x), c[3], y);
+        r.val[1] = vmlaq_f32(vmlaq_f32(vmulq_f32(c[7], z), c[1], x), c[4], y);
+        r.val[2] = vmlaq_f32(vmlaq_f32(vmulq_f32(c[8], z), c[2], x), c[5], y);
+
+        vst3q_lane_f32(out + (i + 0) * out_stride, r, 0);
+        vst3q_lane_f32(out + (i + 1) * out_stride, r, 1);
+        vst3q_lane_f32(out + (i + 2) * out_stride, r, 2);
+        vst3q_lane_f32(out + (i + 3) * out_stride, r, 3);
+    }
+#endif
+
+    for (; i < count; ++i) {
+        transform_direction(a, ptr(directions[i]), out + i * out_stride);
+    }
+}
@@ -0,0 +1,129 @@
+#include "rosewood/math/sphere_culling.h"
+
+#include <string.h>
+
+#if __AVX__
+#include <immintrin.h>
+#elif !__SSE__ && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#define RW_SPHERE_CULLING_NEON 1
+#include <arm_neon.h>
+#endif
+
+using rosewood::math::Plane;
+
+static const size_t kMaxPlanes = 8;
+
+static bool sphere_visible(const Plane *planes, size_t n_planes,
+                           float x, float y, float z, float radius) {
+    for (size_t p = 0; p < n_planes; ++p) {
+        if (planes[p].x * x + planes[p].y * y + planes[p].z * z + planes[p].p < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void rosewood::math::cull_spheres(const Plane *planes, size_t n_planes,
+                                  const float *xs, const float *ys, const float *zs, const float *radii,
+                                  size_t count, uint32_t *visible) {
+    memset(visible, 0, ((count + 31) / 32) * sizeof(uint32_t));
+
+    size_t i = 0;
+
+#if __AVX__
+    if (n_planes <= kMaxPlanes) {
+        __m256 px[kMaxPlanes], py[kMaxPlanes], pz[kMaxPlanes], pp[kMaxPlanes];
+        for (size_t p = 0; p < n_planes; ++p) {
+            px[p] = _mm256_set1_ps(planes[p].x);
+            py[p] = _mm256_set1_ps(planes[p].y);
+            pz[p] = _mm256_set1_ps(planes[p].z);
+            pp[p] = _mm256_set1_ps(planes[p].p);
+        }
+
+        auto zero = _mm256_setzero_ps();
+
+        for (; i + 8 <= count; i += 8) {
+            auto x = _mm256_loadu_ps(xs + i);
+            auto y = _mm256_loadu_ps(ys + i);
+            auto z = _mm256_loadu_ps(zs + i);
+            auto neg_r = _mm256_sub_ps(zero, _mm256_loadu_ps(radii + i));
+
+            auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (size_t p = 0; p < n_planes; ++p) {
+                auto d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], x), _mm256_mul_ps(py[p], y)),
+                                       _mm256_add_ps(_mm256_mul_ps(pz[p], z), pp[p]));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, neg_r, _CMP_GE_OQ));
+            }
+
+            visible[i / 32] |= uint32_t(_mm256_movemask_ps(inside)) << (i % 32);
+        }
+    }
+#elif __SSE__
+    if (n_planes <= kMaxPlanes) {
+        __m128 px[kMaxPlanes], py[kMaxPlanes], pz[kMaxPlanes], pp[kMaxPlanes];
+        for (size_t p = 0; p < n_planes; ++p) {
+            px[p] = _mm_set1_ps(planes[p].x);
+            py[p] = _mm_set1_ps(planes[p].y);
+            pz[p] = _mm_set1_ps(planes[p].z);
+            pp[p] = _mm_set1_ps(planes[p].p);
+        }
+
+        auto zero = _mm_setzero_ps();
+
+        for (; i + 4 <= count; i += 4) {
+            auto x = _mm_loadu_ps(xs + i);
+            auto y = _mm_loadu_ps(ys + i);
+            auto z = _mm_loadu_ps(zs + i);
+            auto neg_r = _mm_sub_ps(zero, _mm_loadu_ps(radii + i));
+
+            auto inside = _mm_cmpeq_ps(zero, zero);
+            for (size_t p = 0; p < n_planes; ++p) {
+                auto d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], x), _mm_mul_ps(py[p], y)),
+                                    _mm_add_ps(_mm_mul_ps(pz[p], z), pp[p]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(d, neg_r));
+            }
+
+            visible[i / 32] |= uint32_t(_mm_movemask_ps(inside)) << (i % 32);
+        }
+    }
+#elif RW_SPHERE_CULLING_NEON
+    if (n_planes <= kMaxPlanes) {
+        float32x4_t px[kMaxPlanes], py[kMaxPlanes], pz[kMaxPlanes], pp[kMaxPlanes];
+        for (size_t p = 0; p < n_planes; ++p) {
+            px[p] = vdupq_n_f32(planes[p].x);
+            py[p] = vdupq_n_f32(planes[p].y);
+            pz[p] = vdupq_n_f32(planes[p].z);
+            pp[p] = vdupq_n_f32(planes[p].p);
+        }
+
+        // NEON has no movemask, so pick one bit per lane and add them up
+        static const uint32_t lane_bits[4] = { 1, 2, 4, 8 };
+        auto bits = vld1q_u32(lane_bits);
+
+        for (; i + 4 <= count; i += 4) {
+            auto x = vld1q_f32(xs + i);
+            auto y = vld1q_f32(ys + i);
+            auto z = vld1q_f32(zs + i);
+            auto neg_r = vnegq_f32(vld1q_f32(radii + i));
+
+            auto inside = vdupq_n_u32(0xffffffffu);
+            for (size_t p = 0; p < n_planes; ++p) {
+                auto d = vmlaq_f32(vmlaq_f32(vmlaq_f32(pp[p], px[p], x), py[p], y), pz[p], z);
+                inside = vandq_u32(inside, vcgeq_f32(d, neg_r));
+            }
+
+            auto lanes = vandq_u32(inside, bits);
+            auto pair = vorr_u32(vget_low_u32(lanes), vget_high_u32(lanes));
+            auto mask = vget_lane_u32(pair, 0) | vget_lane_u32(pair, 1);
+
+            visible[i / 32] |= mask << (i % 32);
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        if (sphere_visible(planes, n_planes, xs[i], ys[i], zs[i], radii[i])) {
+            visible[i / 32] |= 1u << (i % 32);
+        }
+    }
+}
@@ -33,6 +33,11 @@ namespace rosewood { namespace particle_system {
         std::shared_ptr<graphics::Mesh> mesh;
         std::shared_ptr<graphics::Material> material;
 
+        // The copy of `mesh` shared by every emitted particle, and the mesh
+        // it was copied from
+        std::shared_ptr<graphics::Mesh> particle_mesh;
+        std::shared_ptr<graphics::Mesh> particle_mesh_source;
+
         ParticleEmitterArea emission_area;
 
         math::Vector3 direction;
@@ -6,7 +6,9 @@
 namespace rosewood { namespace particle_system {
 
     namespace particle_system {
-        void update(core::EntityManager *entities);
+        // When a job system is given, particles are stepped in parallel.
+        // Decayed particles are always destroyed on the calling thread.
+        void update(core::EntityManager *entities, core::JobSystem *jobs = nullptr);
     }
 
 } }
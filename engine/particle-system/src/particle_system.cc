@@ -1,11 +1,13 @@
 #include "rosewood/particle-system/particle_system.h"
 
 #include <algorithm>
+#include <mutex>
 
 #include "rosewood/core/assert.h"
 #include "rosewood/core/entity.h"
 #include "rosewood/core/transform.h"
 #include "rosewood/core/logging.h"
+#include "rosewood/core/profiler.h"
 
 #include "rosewood/graphics/renderable.h"
 #include "rosewood/graphics/mesh.h"
@@ -19,8 +21,10 @@
 #include "rosewood/utils/time.h"
 
 using rosewood::core::EntityManager;
+using rosewood::core::JobSystem;
 using rosewood::core::Transform;
 
+using rosewood::graphics::Mesh;
 using rosewood::graphics::Renderable;
 
 using rosewood::math::random;
@@ -64,17 +68,29 @@ static bool is_particle_decayed(Particle *particle) {
     return rosewood::utils::frame_usec_time() > particle->decay_time;
 }
 
+// All particles from an emitter share one mesh, so that they can be drawn
+// with a single instanced draw call when the material supports it
+static std::shared_ptr<Mesh> particle_mesh(ParticleEmitter *emitter) {
+    if (!emitter->particle_mesh || emitter->particle_mesh_source != emitter->mesh) {
+        auto mesh = emitter->mesh->copy();
+        mesh->set_usage(Mesh::Usage::Dynamic);
+        mesh->set_extra_data("color", std::vector<Vector4>(mesh->vertex_data().size(), Vector4(0, 0, 0, 1)));
+
+        emitter->particle_mesh = mesh;
+        emitter->particle_mesh_source = emitter->mesh;
+    }
+
+    return emitter->particle_mesh;
+}
+
 static void emit_single(Transform *transform, ParticleEmitter *emitter) {
     EntityManager *entities = transform->entity().owner;
 
     auto particle_obj = entities->create_entity();
     auto renderable = particle_obj.add_component<Renderable>();
-    auto mesh = emitter->mesh->copy();
-
-    mesh->set_extra_data("color", std::vector<Vector4>(mesh->vertex_data().size(), Vector4(0, 0, 0, 1)));
 
     renderable->set_material(emitter->material);
-    renderable->set_mesh(mesh);
+    renderable->set_mesh(particle_mesh(emitter));
 
     auto particle_tform = particle_obj.add_component<Transform>();
     particle_tform->set_local_position(transform->local_position() + generate_starting_point(emitter->emission_area));
@@ -105,16 +121,35 @@ static void step_particle_emitter(Transform *transform, ParticleEmitter *emitter
     }
 }
 
-void rosewood::particle_system::particle_system::update(EntityManager *entities) {
+void rosewood::particle_system::particle_system::update(EntityManager *entities, JobSystem *jobs) {
+    RW_PROFILE_SCOPE("particles.update");
+
     std::vector<core::Entity> entities_to_destroy;
 
-    entities->for_components<Transform, Particle>([&entities_to_destroy](Transform *tform, Particle *particle) {
-        step_particle(tform, particle);
+    if (jobs) {
+        // Setting a local position only touches the particle's own
+        // transform node. Only a small fraction of particles decays each
+        // frame, so the lock is rarely taken.
+        std::mutex destroy_mutex;
 
-        if (is_particle_decayed(particle)) {
-            entities_to_destroy.push_back(particle->entity());
-        }
-    });
+        entities->parallel_for_components<Transform, Particle>(*jobs, [&](Transform *tform, Particle *particle) {
+            step_particle(tform, particle);
+
+            if (is_particle_decayed(particle)) {
+                std::lock_guard<std::mutex> lock(destroy_mutex);
+                entities_to_destroy.push_back(particle->entity());
+            }
+        });
+    }
+    else {
+        entities->for_components<Transform, Particle>([&entities_to_destroy](Transform *tform, Particle *particle) {
+            step_particle(tform, particle);
+
+            if (is_particle_decayed(particle)) {
+                entities_to_destroy.push_back(particle->entity());
+            }
+        });
+    }
 
     for (auto entity : entities_to_destroy) {
         entity.destroy();
@@ -3,13 +3,13 @@
 #include <iostream>
 
 #include "rosewood/core/transform.h"
-#include "rosewood/core/stats.h"
 
 #include "rosewood/math/matrix4.h"
 #include "rosewood/math/matrix3.h"
 
 #include "rosewood/graphics/gl_func.h"
 #include "rosewood/graphics/gl_state.h"
+#include "rosewood/graphics/metrics.h"
 #include "rosewood/graphics/shader.h"
 #include "rosewood/graphics/camera.h"
 
@@ -142,5 +142,5 @@ void DebugRenderer::draw_lines() {
 
     GL_FUNC(glDrawArrays)(GL_LINES, 0, _line_count * 2);
 
-    core::stats::draw_calls.increment();
+    graphics::metrics::draw_calls.increment();
 }
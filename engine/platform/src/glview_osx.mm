@@ -21,6 +21,10 @@ using rosewood::core::add_resource_loader;
 
 using rosewood::utils::NSBundleResourceLoader;
 
+// Time spent each frame finishing asynchronous resource loads, mostly
+// texture uploads
+static const double kResourceCommitBudgetUsec = 2000;
+
 static __weak RWGLView *gDefaultView = nil;
 
 static CVReturn display_link_callback(__unused CVDisplayLinkRef displayLink,
@@ -145,6 +149,7 @@ static CVReturn display_link_callback(__unused CVDisplayLinkRef displayLink,
     NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
     if (now - _lastFrame >= 1.0/60.0) {
         rosewood::utils::mark_frame_beginning();
+        rosewood::core::commit_loaded_resources(kResourceCommitBudgetUsec);
         rosewood::utils::tick_all_animations();
         [_delegate rosewoodUpdateDidTick:self];
         _lastFrame = now;
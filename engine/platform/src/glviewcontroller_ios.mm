@@ -19,6 +19,9 @@ using rosewood::core::add_resource_loader;
 
 using rosewood::utils::NSBundleResourceLoader;
 
+// Frame time given to committing asynchronous resource loads
+static const double kResourceCommitBudgetUsec = 2000;
+
 @implementation RWViewController {
     bool _skipFrame;
 }
@@ -68,6 +71,7 @@ using rosewood::utils::NSBundleResourceLoader;
 
 - (void)update {
     rosewood::utils::mark_frame_beginning();
+    rosewood::core::commit_loaded_resources(kResourceCommitBudgetUsec);
     rosewood::utils::tick_all_animations();
     [_rwDelegate rosewoodDidReshapeViewport:self];
     [_rwDelegate rosewoodUpdateDidTick:self];
@@ -0,0 +1,35 @@
+#ifndef __ROSEWOOD_UTILS_ARCHIVE_RESOURCE_LOADER_H__
+#define __ROSEWOOD_UTILS_ARCHIVE_RESOURCE_LOADER_H__
+
+#include <memory>
+#include <string>
+
+#include "rosewood/core/resource_manager.h"
+
+namespace rosewood { namespace data_format {
+    class AssetArchive;
+} }
+
+namespace rosewood { namespace utils {
+
+    // Serves assets from an archive written by the build server's `pack`
+    // command. The archive is mapped once, and lookups go through its
+    // index without touching the file system. Every asset reports the
+    // modification time of the archive itself.
+    class ArchiveResourceLoader : public core::IResourceLoader {
+    public:
+        ArchiveResourceLoader(const std::string &archive_path);
+        virtual ~ArchiveResourceLoader() override;
+        virtual core::FileInfo find_file(std::string path) const override;
+        virtual std::string read_file(std::string path) const override;
+
+        bool is_open() const { return !!_archive; }
+
+    private:
+        std::unique_ptr<data_format::AssetArchive> _archive;
+        struct timespec _mtime;
+    };
+
+} }
+
+#endif
@@ -2,6 +2,8 @@
 #define __ROSEWOOD_UTILS_FOLDER_RESOURCE_LOADER_H__
 
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "rosewood/core/resource_manager.h"
 
@@ -14,8 +16,25 @@ namespace rosewood { namespace utils {
         virtual core::FileInfo find_file(std::string path) const override;
         virtual std::string read_file(std::string path) const override;
 
+        // Starts watching the root and every folder below it, reporting
+        // files that are written or moved in through
+        // collect_changed_files(), along with every file in folders created
+        // or moved in later. If the kernel drops events, every file is
+        // reported. Uses inotify, so returns false on anything but Linux.
+        bool watch_for_changes();
+        virtual void collect_changed_files(std::vector<std::string> *out_paths) override;
+
     private:
         std::string _root;
+
+        int _inotify_fd;
+
+        // Watch descriptor to folder path relative to the root
+        std::unordered_map<int, std::string> _watched_folders;
+
+        // Watches `folder` and every folder below it, adding the files in
+        // them to out_paths unless it is null
+        void watch_folder(const std::string &folder, std::vector<std::string> *out_paths);
     };
 
 } }
@@ -1,26 +1,80 @@
 #ifndef __ROSEWOOD_ENGINE_SCENE_H__
 #define __ROSEWOOD_ENGINE_SCENE_H__
 
+#include <stdint.h>
+
 #include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "rosewood/core/entity.h"
 
+#include "rosewood/graphics/bounding_volume_hierarchy.h"
 #include "rosewood/graphics/render_queue.h"
+#include "rosewood/graphics/view_frustum.h"
+
+namespace rosewood { namespace graphics {
+    class Mesh;
+    class Renderable;
+} }
 
 namespace rosewood { namespace utils {
 
     class RenderSystem {
     public:
-        RenderSystem(core::EntityManager *entities, std::mutex *scene_mutex)
-        : _entities(entities), _scene_mutex(scene_mutex) { }
+        RenderSystem(core::EntityManager *entities, std::mutex *scene_mutex);
         void draw();
 
+        // Bounds of every renderable as of the last draw(), for picking and
+        // other spatial queries. Hold the scene mutex while querying.
+        const graphics::BoundingVolumeHierarchy &bounding_volumes() const { return _bvh; }
+
     private:
+        struct CullCandidate {
+            graphics::Renderable *renderable;
+            core::Transform *transform;
+            float max_axis_scale;
+        };
+
         core::EntityManager *_entities;
         graphics::RenderQueue _queue;
 
+        struct Proxy {
+            size_t node;
+            const graphics::Mesh *mesh;
+        };
+
+        // The entities whose boxes were computed from one mesh, and the
+        // mesh's bounds version at the time, so that a reloaded mesh
+        // updates them too
+        struct MeshUsers {
+            unsigned int bounds_version;
+            std::unordered_set<core::EntityId> entities;
+        };
+
+        // Only updated for the renderables, transforms and meshes that
+        // changed since the previous frame
+        graphics::BoundingVolumeHierarchy _bvh;
+        std::unordered_map<core::EntityId, Proxy> _proxies;
+        std::unordered_map<const graphics::Mesh*, MeshUsers> _mesh_users;
+        std::vector<core::Entity> _changed;
+        std::vector<core::Entity> _removed;
+
+        // Renderables whose boxes touch the frustum of the camera being
+        // drawn, with their exact bounding spheres
+        std::vector<size_t> _hits;
+        std::vector<CullCandidate> _candidates;
+        graphics::BoundingSpheres _spheres;
+        std::vector<uint32_t> _visible;
+
         std::mutex *_scene_mutex;
+
+        void sync_bounding_volumes();
+        void update_bounds(core::Entity entity);
+        void set_proxy_mesh(core::EntityId eid, Proxy *proxy, const graphics::Mesh *mesh);
+        void draw_camera(graphics::Camera *camera);
     };
 
 } }
@@ -20,7 +20,7 @@ namespace rosewood { namespace utils {
     UsecTime delta_usec_time();
     FSecTime delta_time(); // Time it took to render the last frame
     
-    void mark_frame_beginning();
+    void mark_frame_beginning(); // Also ends the frame in core::metrics
     
 } }
 
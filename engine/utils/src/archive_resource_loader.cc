@@ -0,0 +1,56 @@
+#include "rosewood/utils/archive_resource_loader.h"
+
+#include <sys/stat.h>
+
+#include "rosewood/core/logging.h"
+
+#include "rosewood/data-format/asset_archive.h"
+
+using rosewood::data_format::AssetArchive;
+
+using rosewood::utils::ArchiveResourceLoader;
+
+ArchiveResourceLoader::ArchiveResourceLoader(const std::string &archive_path)
+: _archive(AssetArchive::open(archive_path)), _mtime{0, 0} {
+    struct stat s;
+
+    if (!_archive || stat(archive_path.c_str(), &s)) {
+        LOG(ERROR) << "Could not open asset archive: " << archive_path;
+        _archive = nullptr;
+        return;
+    }
+
+#if defined(__APPLE__)
+    _mtime = s.st_mtimespec;
+#elif defined(EMSCRIPTEN)
+    _mtime.tv_sec = 10000;
+#else
+    _mtime = s.st_mtim;
+#endif
+}
+
+ArchiveResourceLoader::~ArchiveResourceLoader() { }
+
+rosewood::core::FileInfo ArchiveResourceLoader::find_file(std::string path) const {
+    AssetArchive::Entry entry;
+
+    rosewood::core::FileInfo i;
+    i.exists = _archive && _archive->find(path, &entry);
+    i.mtime = _mtime;
+
+    return i;
+}
+
+std::string ArchiveResourceLoader::read_file(std::string path) const {
+    AssetArchive::Entry entry;
+    std::string contents;
+
+    if (!_archive || !_archive->find(path, &entry)) {
+        LOG(ERROR) << "File does not exist in archive: " << path;
+    }
+    else if (!AssetArchive::read(entry, &contents)) {
+        LOG(ERROR) << "Could not inflate archived file: " << path;
+    }
+
+    return contents;
+}
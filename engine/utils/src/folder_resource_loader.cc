@@ -2,6 +2,14 @@
 
 #include <sys/stat.h>
 
+#ifdef __linux__
+# include <dirent.h>
+# include <errno.h>
+# include <string.h>
+# include <sys/inotify.h>
+# include <unistd.h>
+#endif
+
 #include <fstream>
 #include <iterator>
 #include <iostream>
@@ -12,8 +20,16 @@ using rosewood::core::IResourceLoader;
 
 using rosewood::utils::FolderResourceLoader;
 
-FolderResourceLoader::FolderResourceLoader(const std::string &root) : _root(root) { }
-FolderResourceLoader::~FolderResourceLoader() { }
+FolderResourceLoader::FolderResourceLoader(const std::string &root)
+: _root(root), _inotify_fd(-1) { }
+
+FolderResourceLoader::~FolderResourceLoader() {
+#ifdef __linux__
+    if (_inotify_fd >= 0) {
+        close(_inotify_fd);
+    }
+#endif
+}
 
 rosewood::core::FileInfo FolderResourceLoader::find_file(std::string path) const {
     path = _root + path;
@@ -22,15 +38,17 @@ rosewood::core::FileInfo FolderResourceLoader::find_file(std::string path) const
     struct stat s;
 
     if (stat(path.c_str(), &s)) {
-        LOG(WARNING) << "File does not exist: " << path;
+        LOG(DBG) << "File does not exist: " << path;
         i.exists = false;
     }
     else {
         i.exists = true;
-#ifndef EMSCRIPTEN
+#if defined(__APPLE__)
         i.mtime = s.st_mtimespec;
-#else
+#elif defined(EMSCRIPTEN)
         i.mtime.tv_sec = 10000;
+#else
+        i.mtime = s.st_mtim;
 #endif
     }
 
@@ -47,3 +65,131 @@ std::string FolderResourceLoader::read_file(std::string path) const {
 
     return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
 }
+
+#ifdef __linux__
+
+static const uint32_t kWatchedEvents = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR;
+
+bool FolderResourceLoader::watch_for_changes() {
+    if (_inotify_fd >= 0) {
+        return true;
+    }
+
+    _inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_inotify_fd < 0) {
+        LOG(ERROR) << "Could not start watching " << _root << ": " << strerror(errno);
+        return false;
+    }
+
+    watch_folder("", nullptr);
+    return true;
+}
+
+// Not every file system fills in d_type, so fall back to asking for it
+static unsigned char entry_type(const std::string &path, const struct dirent *entry) {
+    if (entry->d_type != DT_UNKNOWN) {
+        return entry->d_type;
+    }
+
+    struct stat s;
+    if (lstat(path.c_str(), &s)) {
+        return DT_UNKNOWN;
+    }
+
+    return S_ISDIR(s.st_mode) ? DT_DIR : S_ISREG(s.st_mode) ? DT_REG : DT_UNKNOWN;
+}
+
+void FolderResourceLoader::watch_folder(const std::string &folder, std::vector<std::string> *out_paths) {
+    auto path = _root + folder;
+
+    // IN_ONLYDIR only applies to the watched path itself, the events of
+    // files inside it are still reported
+    int wd = inotify_add_watch(_inotify_fd, path.c_str(), kWatchedEvents);
+    if (wd < 0) {
+        LOG(WARNING) << "Could not watch " << path << ": " << strerror(errno);
+        return;
+    }
+
+    _watched_folders[wd] = folder;
+
+    // inotify is not recursive, so every folder gets a watch of its own.
+    // Files can be written into a folder before its watch exists, so when
+    // asked, every file found is reported as changed.
+    auto dir = opendir(path.c_str());
+    if (!dir) return;
+
+    while (auto entry = readdir(dir)) {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) continue;
+
+        auto type = entry_type(path + entry->d_name, entry);
+        if (type == DT_DIR) {
+            if (entry->d_name[0] != '.') {
+                watch_folder(folder + entry->d_name + "/", out_paths);
+            }
+        }
+        else if (type == DT_REG && out_paths) {
+            out_paths->push_back(folder + entry->d_name);
+        }
+    }
+
+    closedir(dir);
+}
+
+void FolderResourceLoader::collect_changed_files(std::vector<std::string> *out_paths) {
+    if (_inotify_fd < 0) return;
+
+    alignas(struct inotify_event) char buffer[4096];
+
+    for (;;) {
+        auto length = read(_inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            if (length < 0 && errno != EAGAIN) {
+                LOG(WARNING) << "Could not read file changes: " << strerror(errno);
+            }
+            return;
+        }
+
+        for (char *p = buffer; p < buffer + length;) {
+            auto event = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            // The kernel dropped events, so anything might have changed
+            if (event->mask & IN_Q_OVERFLOW) {
+                LOG(WARNING) << "Missed file changes in " << _root << ", reloading everything";
+                watch_folder("", out_paths);
+                continue;
+            }
+
+            if (event->mask & IN_IGNORED) {
+                _watched_folders.erase(event->wd);
+                continue;
+            }
+
+            auto it = _watched_folders.find(event->wd);
+            if (it == _watched_folders.end() || !event->len) continue;
+
+            auto path = it->second + event->name;
+
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    watch_folder(path + "/", out_paths);
+                }
+            }
+            else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                out_paths->push_back(path);
+            }
+        }
+    }
+}
+
+#else
+
+bool FolderResourceLoader::watch_for_changes() {
+    return false;
+}
+
+void FolderResourceLoader::collect_changed_files(std::vector<std::string>*) { }
+
+void FolderResourceLoader::watch_folder(const std::string&, std::vector<std::string>*) { }
+
+#endif
@@ -1,6 +1,11 @@
 #include "rosewood/utils/render_system.h"
 
+#include <math.h>
+
+#include <algorithm>
+
 #include "rosewood/core/memory.h"
+#include "rosewood/core/profiler.h"
 #include "rosewood/core/transform.h"
 
 #include "rosewood/math/vector.h"
@@ -14,48 +19,190 @@
 #include "rosewood/graphics/mesh.h"
 #include "rosewood/graphics/render_queue.h"
 #include "rosewood/graphics/light.h"
+#include "rosewood/graphics/metrics.h"
 
+using rosewood::core::Entity;
+using rosewood::core::EntityId;
 using rosewood::core::EntityManager;
 using rosewood::core::Transform;
 using rosewood::core::transform;
 using rosewood::core::ComponentArrayView;
+using rosewood::core::metrics::ScopedLatency;
 
 using rosewood::math::Matrix4;
+using rosewood::math::Vector3;
+using rosewood::math::make_hand_shift4;
 
+using rosewood::graphics::BoundingBox;
 using rosewood::graphics::Camera;
 using rosewood::graphics::RenderQueue;
 using rosewood::graphics::Renderable;
 using rosewood::graphics::RenderCommand;
 using rosewood::graphics::Light;
+using rosewood::graphics::Mesh;
 using rosewood::graphics::camera;
 
 using rosewood::utils::RenderSystem;
 
-static void draw_camera(EntityManager *entities, RenderQueue *queue, Camera *camera) {
-    auto first_light = *entities->components<Light>().begin();
-
-    entities->for_components<Renderable, Transform>(
-        [=](Renderable *renderable, Transform *transform) {
-            if (!renderable->enabled()) return;
-
-            auto scale = transform->local_scale();
-            queue->add_command(RenderCommand(renderable->mesh().get(),
-                                             transform->world_transform(),
-                                             transform->inverse_world_transform(),
-                                             std::max({scale.x(), scale.y(), scale.z()}),
-                                             renderable->material().get(),
-                                             camera,
-                                             first_light));
-        });
+static void bounding_sphere(Renderable *renderable, Transform *transform,
+                            Vector3 *center, float *radius, float *max_axis_scale) {
+    auto scale = transform->local_scale();
+    auto world = transform->world_transform();
+
+    *max_axis_scale = std::max({scale.x(), scale.y(), scale.z()});
+    *center = Vector3(get(world, 0, 3), get(world, 1, 3), get(world, 2, 3));
+    *radius = *max_axis_scale * sqrtf(renderable->mesh()->bounding_sphere_radius2());
+}
+
+RenderSystem::RenderSystem(EntityManager *entities, std::mutex *scene_mutex)
+: _entities(entities), _scene_mutex(scene_mutex) {
+    _entities->track_component_changes<Renderable>();
+    _entities->transform_hierarchy().set_tracks_world_changes(true);
+}
+
+void RenderSystem::update_bounds(Entity entity) {
+    auto renderable = entity.component<Renderable>();
+    auto transform = entity.component<Transform>();
+    auto proxy = _proxies.find(entity.eid);
+
+    if (!renderable || !renderable->mesh() || !transform) {
+        if (proxy != end(_proxies)) {
+            _bvh.remove(proxy->second.node);
+            set_proxy_mesh(entity.eid, &proxy->second, nullptr);
+            _proxies.erase(proxy);
+        }
+        return;
+    }
+
+    Vector3 center;
+    float radius, max_axis_scale;
+    bounding_sphere(renderable, transform, &center, &radius, &max_axis_scale);
+
+    auto extent = Vector3(radius, radius, radius);
+    auto box = BoundingBox{ center - extent, center + extent };
+
+    if (proxy != end(_proxies)) {
+        _bvh.move(proxy->second.node, box);
+    }
+    else {
+        proxy = _proxies.emplace(entity.eid, Proxy{ _bvh.insert(box, entity), nullptr }).first;
+    }
+
+    set_proxy_mesh(entity.eid, &proxy->second, renderable->mesh().get());
+}
+
+void RenderSystem::set_proxy_mesh(EntityId eid, Proxy *proxy, const Mesh *mesh) {
+    if (proxy->mesh == mesh) return;
+
+    if (proxy->mesh) {
+        auto users = _mesh_users.find(proxy->mesh);
+        users->second.entities.erase(eid);
+        if (users->second.entities.empty()) {
+            _mesh_users.erase(users);
+        }
+    }
+
+    proxy->mesh = mesh;
+
+    if (mesh) {
+        auto &users = _mesh_users[mesh];
+        if (users.entities.empty()) {
+            users.bounds_version = mesh->bounds_version();
+        }
+        users.entities.insert(eid);
+    }
+}
+
+void RenderSystem::sync_bounding_volumes() {
+    // update_bounds looks the components up again, so entities that were
+    // removed and then re-added in the same frame end up in the right state
+    _entities->take_component_changes<Renderable>(&_changed, &_removed);
+    for (auto entity : _removed) update_bounds(entity);
+    for (auto entity : _changed) update_bounds(entity);
+
+    // Also picks up renderables that only just got their transform
+    _entities->transform_hierarchy().take_world_changes(&_changed);
+    for (auto entity : _changed) update_bounds(entity);
+
+    // Meshes whose bounds changed, e.g. when reloaded. There are far fewer
+    // meshes than renderables, so they are simply all checked.
+    _changed.clear();
+    for (auto &users : _mesh_users) {
+        auto bounds_version = users.first->bounds_version();
+        if (users.second.bounds_version == bounds_version) continue;
+
+        users.second.bounds_version = bounds_version;
+        for (auto eid : users.second.entities) {
+            _changed.push_back(Entity{ _entities, eid });
+        }
+    }
+    for (auto entity : _changed) update_bounds(entity);
+}
+
+void RenderSystem::draw_camera(Camera *camera) {
+    auto first_light = *_entities->components<Light>().begin();
+    auto view_transform = make_hand_shift4() * transform(camera->entity())->inverse_world_transform();
+    auto planes = camera->view_frustum().world_planes(view_transform);
+
+    {
+        RW_PROFILE_SCOPE("render.cull");
+        ScopedLatency culling_latency(rosewood::graphics::metrics::culling_usec);
+
+        _hits.clear();
+        _bvh.query_planes(planes.data(), planes.size(), &_hits);
+
+        _candidates.clear();
+        _spheres.clear();
+
+        for (auto proxy : _hits) {
+            auto entity = _bvh.entity(proxy);
+            auto renderable = entity.component<Renderable>();
+            if (!renderable->enabled()) continue;
+
+            auto transform = entity.component<Transform>();
+
+            Vector3 center;
+            float radius, max_axis_scale;
+            bounding_sphere(renderable, transform, &center, &radius, &max_axis_scale);
+
+            _candidates.push_back({ renderable, transform, max_axis_scale });
+            _spheres.push_back(center, radius);
+        }
+
+        // The tree works on enlarged boxes, so refine with the exact spheres
+        camera->view_frustum().cull(view_transform, _spheres, &_visible);
+    }
+
+    for (size_t word = 0; word < _visible.size(); ++word) {
+        // Only visit the set bits, so culled renderables cost nothing here
+        for (auto bits = _visible[word]; bits; bits &= bits - 1) {
+            const auto &candidate = _candidates[word * 32 + __builtin_ctz(bits)];
+            auto renderable = candidate.renderable;
+
+            _queue.add_visible_command(RenderCommand(renderable->mesh().get(),
+                                                     candidate.transform->world_transform(),
+                                                     candidate.transform->inverse_world_transform(),
+                                                     candidate.max_axis_scale,
+                                                     renderable->material().get(),
+                                                     camera,
+                                                     first_light));
+        }
+    }
 }
 
 void RenderSystem::draw() {
+    RW_PROFILE_SCOPE("render.draw");
+
     _queue.clear();
 
     std::lock_guard<std::mutex> lock(*_scene_mutex);
 
+    _entities->transform_hierarchy().update();
+
+    sync_bounding_volumes();
+
     _entities->for_components<Camera>([this](Camera *camera) {
-        draw_camera(_entities, &_queue, camera);
+        draw_camera(camera);
     });
 
     _queue.sort();
@@ -2,6 +2,9 @@
 
 #include <sys/time.h>
 
+#include "rosewood/core/metrics.h"
+#include "rosewood/core/profiler.h"
+
 static uint64_t gFirstFrameTime = 0;
 static uint64_t gLastFrameTime = 0;
 static uint64_t gCurrentFrameTime = 0;
@@ -36,6 +39,9 @@ namespace rosewood { namespace utils {
     }
     
     void mark_frame_beginning() {
+        core::metrics::end_frame();
+        core::profiler::end_frame();
+
         auto new_current = current_usec_time();
         
         if (!gFirstFrameTime) {
@@ -27,6 +27,11 @@ using namespace rosewood::utils;
 
 using sample_app::RosewoodApp;
 
+// Cubes circling the two large ones, all drawn with one instanced draw
+// call where the platform supports it
+static const int kRingCubeCount = 24;
+static const float kRingRadius = 3.0f;
+
 RosewoodApp *RosewoodApp::create() {
     return new RosewoodApp();
 }
@@ -81,6 +86,31 @@ RosewoodApp::RosewoodApp() : _render_system(&_entity_manager, &_scene_mutex), _r
     parent->add_child(_cube1.component<Transform>());
     parent->add_child(_cube2.component<Transform>());
 
+#if RW_GL_HAS_INSTANCING
+    auto ring_shader = Shader::create("Shaders/instanced_shader." SHADER_EXT);
+#else
+    auto ring_shader = shader;
+#endif
+
+    // Sharing the mesh and material is what lets the ring be instanced
+    material = std::make_shared<Material>();
+    material->set_shader(ring_shader);
+    material->set_texture(checkered);
+
+    for (int i = 0; i < kRingCubeCount; ++i) {
+        auto angle = deg2rad(360.0f * i / kRingCubeCount);
+
+        auto cube = _entity_manager.create_entity<Transform, Renderable>();
+        auto cube_tform = cube.component<Transform>();
+        cube_tform->set_local_position(kRingRadius * cosf(angle), 0, kRingRadius * sinf(angle));
+        cube_tform->set_local_scale(0.25f, 0.25f, 0.25f);
+        parent->add_child(cube_tform);
+
+        renderable = cube.component<Renderable>();
+        renderable->set_mesh(mesh);
+        renderable->set_material(material);
+    }
+
     _root = _entity_manager.create_entity();
     auto root_tform = _root.add_component<Transform>();
     root_tform->add_child(camera_object.component<Transform>());
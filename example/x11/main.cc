@@ -10,6 +10,8 @@
 
 #include "rosewood/core/memory.h"
 #include "rosewood/core/logging.h"
+#include "rosewood/core/profiler.h"
+#include "rosewood/core/resource_manager.h"
 
 #include "rosewood/graphics/platform_gl.h"
 
@@ -52,10 +54,41 @@ static GLXContext gl_context;
 
 static AppClass *app;
 
+// Frame time given to committing asynchronous resource loads
+static const double kResourceCommitBudgetUsec = 2000;
+
+// How long an edited file has to stay untouched before it is reloaded, so
+// that an editor saving in several steps causes one reload
+static const double kHotReloadQuietUsec = 50000;
+
+// Written when profiling is toggled off with the P key
+static const char *kProfileTracePath = "rosewood-trace.json";
+
 using rosewood::core::add_resource_loader;
 
 using rosewood::utils::FolderResourceLoader;
 
+// The trace holds the slowest frames seen while profiling was on
+static void toggle_profiling() {
+	namespace profiler = rosewood::core::profiler;
+
+	if (!profiler::is_enabled()) {
+		profiler::clear_capture();
+		profiler::set_enabled(true);
+		LOG(INFO, "Profiling started");
+		return;
+	}
+
+	profiler::set_enabled(false);
+
+	if (profiler::write_chrome_trace(kProfileTracePath)) {
+		LOG(INFO) << "Wrote the slowest profiled frames to " << kProfileTracePath;
+	}
+	else {
+		LOG(ERROR) << "Could not write " << kProfileTracePath;
+	}
+}
+
 class ScopedDisplayLock {
 public:
 	ScopedDisplayLock(Display *display) : _display(display) { XLockDisplay(_display); }
@@ -66,6 +99,8 @@ private:
 };
 
 static void render_loop(GLXFBConfig fbcfg, bool *is_rendering) {
+	rosewood::core::profiler::set_thread_name("render");
+
 	XLockDisplay(main_display);
 
 	gl_context = glXCreateContextAttribsARB(main_display, fbcfg, NULL, GL_TRUE, gl3_attributes);
@@ -100,6 +135,8 @@ static void render_loop(GLXFBConfig fbcfg, bool *is_rendering) {
 
 	while (*is_rendering) {
 		rosewood::utils::mark_frame_beginning();
+		rosewood::core::reload_changed_resources(kHotReloadQuietUsec);
+		rosewood::core::commit_loaded_resources(kResourceCommitBudgetUsec);
 		rosewood::utils::tick_all_animations();
 
 		app->update();
@@ -181,7 +218,11 @@ int main(int, const char **) {
 
 	LOG(INFO) << "Rosewood Root: " << cwd;
 
-	add_resource_loader(make_unique<FolderResourceLoader>(cwd));
+	auto loader = make_unique<FolderResourceLoader>(cwd);
+	if (!loader->watch_for_changes()) {
+		LOG(WARNING, "Not watching the resource folder, edited files will not be reloaded");
+	}
+	add_resource_loader(std::move(loader));
 
 	XMapWindow(main_display, dest_window);
 	XStoreName(main_display, dest_window, "Rosewood Example");
@@ -224,6 +265,9 @@ int main(int, const char **) {
 				if (sym == XK_q) {
 					is_rendering = false;
 				}
+				else if (sym == XK_p) {
+					toggle_profiling();
+				}
 				break;
 			}
 			}
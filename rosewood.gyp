@@ -67,6 +67,8 @@
                 "engine/engine.gyp:rw_math",
                 "engine/engine.gyp:rw_core",
                 "engine/engine.gyp:rw_data_format",
+                "engine/engine.gyp:rw_graphics",
+                "engine/engine.gyp:rw_utils",
                 "rw_gtest",
             ],
  
@@ -92,5 +94,23 @@
                 ],
             ],
        },
+
+        {
+            "target_name": "rw_benchmarks",
+            "type": "executable",
+
+            "includes": [
+                "benchmarks/sources.gypi",
+            ],
+
+            "dependencies": [
+                "engine/engine.gyp:rw_math",
+                "engine/engine.gyp:rw_core",
+                "engine/engine.gyp:rw_data_format",
+                "engine/engine.gyp:rw_graphics",
+                "engine/engine.gyp:rw_particle_system",
+                "engine/engine.gyp:rw_utils",
+            ],
+        },
     ],
 }
\ No newline at end of file
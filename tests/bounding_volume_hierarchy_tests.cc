@@ -0,0 +1,267 @@
+#include <gtest/gtest.h>
+
+#include <math.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "rosewood/core/entity.h"
+
+#include "rosewood/math/math_types.h"
+#include "rosewood/math/vector.h"
+
+#include "rosewood/graphics/bounding_volume_hierarchy.h"
+
+using namespace rosewood::graphics;
+using namespace rosewood::math;
+
+using rosewood::core::Entity;
+using rosewood::core::EntityManager;
+
+namespace {
+
+    // Runs random inserts, moves and removals on a tree while keeping the
+    // live proxies on the side, so every query can be checked against a
+    // scan over all of them
+    class BVHChecker {
+    public:
+        explicit BVHChecker(unsigned seed) : _rng(seed) { }
+
+        BoundingVolumeHierarchy bvh;
+        std::vector<size_t> proxies;
+        std::vector<Entity> entities;
+
+        float uniform(float lo, float hi) {
+            return std::uniform_real_distribution<float>(lo, hi)(_rng);
+        }
+
+        size_t index(size_t n) {
+            return std::uniform_int_distribution<size_t>(0, n - 1)(_rng);
+        }
+
+        Vector3 random_point(float range) {
+            return Vector3(uniform(-range, range), uniform(-range, range), uniform(-range, range));
+        }
+
+        BoundingBox random_box(float range, float max_size) {
+            auto min = random_point(range);
+            auto size = Vector3(uniform(0.01f, max_size), uniform(0.01f, max_size), uniform(0.01f, max_size));
+            return BoundingBox{min, min + size};
+        }
+
+        void insert(const BoundingBox &box) {
+            auto entity = _entities.create_entity();
+            proxies.push_back(bvh.insert(box, entity));
+            entities.push_back(entity);
+        }
+
+        void remove_random() {
+            auto i = index(proxies.size());
+            bvh.remove(proxies[i]);
+
+            proxies[i] = proxies.back();
+            proxies.pop_back();
+            entities[i] = entities.back();
+            entities.pop_back();
+        }
+
+        void check_tree() {
+            ASSERT_TRUE(bvh.validate());
+            ASSERT_EQ(proxies.size(), bvh.proxy_count());
+
+            for (size_t i = 0; i < proxies.size(); ++i) {
+                ASSERT_EQ(entities[i], bvh.entity(proxies[i]));
+            }
+
+            // A height-balanced tree over 2n - 1 nodes is at most about
+            // 1.44 log2(n) high
+            if (!proxies.empty()) {
+                auto nodes = 2.0 * proxies.size() - 1;
+                EXPECT_LE(bvh.height(), 1.45 * log2(nodes + 2));
+            }
+            else {
+                EXPECT_EQ(0, bvh.height());
+            }
+        }
+
+        void check_queries(int n_queries) {
+            for (int q = 0; q < n_queries; ++q) {
+                check_box_query(random_box(12, 6));
+                check_ray_query();
+                check_plane_query();
+            }
+        }
+
+    private:
+        std::mt19937 _rng;
+        EntityManager _entities;
+
+        static std::vector<size_t> sorted(std::vector<size_t> v) {
+            std::sort(begin(v), end(v));
+            return v;
+        }
+
+        template<typename TPred>
+        std::vector<size_t> brute_force(TPred pred) const {
+            std::vector<size_t> result;
+            for (auto proxy : proxies) {
+                if (pred(bvh.fat_box(proxy))) result.push_back(proxy);
+            }
+            return sorted(result);
+        }
+
+        void check_box_query(const BoundingBox &box) {
+            std::vector<size_t> result;
+            bvh.query_box(box, &result);
+
+            EXPECT_EQ(brute_force([&](const BoundingBox &b) { return overlaps(b, box); }), sorted(result));
+        }
+
+        void check_ray_query() {
+            auto origin = random_point(15);
+            auto direction = normalized(random_point(1));
+            auto max_distance = uniform(1, 40);
+
+            std::vector<size_t> result;
+            bvh.query_ray(origin, direction, max_distance, &result);
+
+            float o[3] = { origin.x(), origin.y(), origin.z() };
+            float d[3] = { direction.x(), direction.y(), direction.z() };
+
+            auto hit = [&](const BoundingBox &b) {
+                float lo[3] = { b.min.x(), b.min.y(), b.min.z() };
+                float hi[3] = { b.max.x(), b.max.y(), b.max.z() };
+
+                float t_min = 0, t_max = max_distance;
+                for (int axis = 0; axis < 3; ++axis) {
+                    auto t1 = (lo[axis] - o[axis]) / d[axis];
+                    auto t2 = (hi[axis] - o[axis]) / d[axis];
+                    t_min = std::max(t_min, std::min(t1, t2));
+                    t_max = std::min(t_max, std::max(t1, t2));
+                }
+                return t_min <= t_max;
+            };
+
+            EXPECT_EQ(brute_force(hit), sorted(result));
+        }
+
+        void check_plane_query() {
+            std::vector<Plane> planes;
+            auto n_planes = 1 + index(6);
+            for (size_t i = 0; i < n_planes; ++i) {
+                auto n = normalized(random_point(1));
+                planes.emplace_back(n.x(), n.y(), n.z(), uniform(-4, 12));
+            }
+
+            std::vector<size_t> result;
+            bvh.query_planes(planes.data(), planes.size(), &result);
+
+            auto in_front = [&](const BoundingBox &b) {
+                auto center = (b.min + b.max) * 0.5f;
+                auto extent = (b.max - b.min) * 0.5f;
+                for (auto &plane : planes) {
+                    auto d = plane.x * center.x() + plane.y * center.y() + plane.z * center.z() + plane.p;
+                    auto r = fabsf(plane.x) * extent.x() + fabsf(plane.y) * extent.y() + fabsf(plane.z) * extent.z();
+                    if (d + r < 0) return false;
+                }
+                return true;
+            };
+
+            EXPECT_EQ(brute_force(in_front), sorted(result));
+        }
+    };
+
+}
+
+TEST(BoundingVolumeHierarchyTests, EmptyTree) {
+    BoundingVolumeHierarchy bvh;
+    EXPECT_TRUE(bvh.validate());
+    EXPECT_EQ(0, bvh.height());
+
+    std::vector<size_t> result;
+    bvh.query_box(BoundingBox{Vector3(-1, -1, -1), Vector3(1, 1, 1)}, &result);
+    bvh.query_ray(Vector3(0, 0, 0), Vector3(1, 0, 0), 10, &result);
+    EXPECT_TRUE(result.empty());
+}
+
+TEST(BoundingVolumeHierarchyTests, LeavesAreEnlargedByTheMargin) {
+    BoundingVolumeHierarchy bvh(0.5f);
+    auto proxy = bvh.insert(BoundingBox{Vector3(0, 0, 0), Vector3(2, 1, 1)}, rosewood::core::nil_entity());
+
+    EXPECT_EQ(Vector3(-1, -1, -1), bvh.fat_box(proxy).min);
+    EXPECT_EQ(Vector3(3, 2, 2), bvh.fat_box(proxy).max);
+
+    // Moving inside the enlarged box leaves the tree alone
+    EXPECT_FALSE(bvh.move(proxy, BoundingBox{Vector3(0.5f, 0, 0), Vector3(2.5f, 1, 1)}));
+    EXPECT_EQ(Vector3(-1, -1, -1), bvh.fat_box(proxy).min);
+
+    EXPECT_TRUE(bvh.move(proxy, BoundingBox{Vector3(5, 0, 0), Vector3(7, 1, 1)}));
+    EXPECT_EQ(Vector3(4, -1, -1), bvh.fat_box(proxy).min);
+    EXPECT_TRUE(bvh.validate());
+}
+
+TEST(BoundingVolumeHierarchyTests, InsertsMatchBruteForce) {
+    BVHChecker checker(1);
+
+    for (int i = 0; i < 600; ++i) {
+        checker.insert(checker.random_box(10, 2));
+        if (i % 50 == 0) {
+            ASSERT_NO_FATAL_FAILURE(checker.check_tree());
+        }
+    }
+
+    ASSERT_NO_FATAL_FAILURE(checker.check_tree());
+    checker.check_queries(50);
+}
+
+TEST(BoundingVolumeHierarchyTests, MovesMatchBruteForce) {
+    BVHChecker checker(2);
+
+    for (int i = 0; i < 400; ++i) {
+        checker.insert(checker.random_box(10, 2));
+    }
+
+    for (int round = 0; round < 5; ++round) {
+        // Mostly small moves that stay inside the margin, and some jumps
+        // across the whole scene
+        for (auto proxy : checker.proxies) {
+            auto box = checker.bvh.fat_box(proxy);
+            auto shift = checker.index(4) == 0 ? checker.random_point(8) : checker.random_point(0.1f);
+            auto size = (box.max - box.min) / 1.2f;
+            auto min = box.min + (box.max - box.min - size) * 0.5f + shift;
+            checker.bvh.move(proxy, BoundingBox{min, min + size});
+        }
+
+        ASSERT_NO_FATAL_FAILURE(checker.check_tree());
+        checker.check_queries(20);
+    }
+}
+
+TEST(BoundingVolumeHierarchyTests, RemovalsKeepTheTreeBalanced) {
+    BVHChecker checker(3);
+
+    for (int i = 0; i < 800; ++i) {
+        checker.insert(checker.random_box(10, 2));
+    }
+
+    // Interleave removals with a few inserts, so freed nodes get reused
+    while (checker.proxies.size() > 1) {
+        checker.remove_random();
+        if (checker.index(8) == 0) {
+            checker.insert(checker.random_box(10, 2));
+        }
+
+        if (checker.proxies.size() % 40 == 0) {
+            ASSERT_NO_FATAL_FAILURE(checker.check_tree());
+            checker.check_queries(5);
+        }
+    }
+
+    checker.remove_random();
+    ASSERT_NO_FATAL_FAILURE(checker.check_tree());
+
+    std::vector<size_t> result;
+    checker.bvh.query_box(BoundingBox{Vector3(-20, -20, -20), Vector3(20, 20, 20)}, &result);
+    EXPECT_TRUE(result.empty());
+}
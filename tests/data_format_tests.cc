@@ -1,7 +1,13 @@
 #include <gtest/gtest.h>
 
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "rosewood/data-format/asset_archive.h"
+#include "rosewood/data-format/mapped_file.h"
 #include "rosewood/data-format/object.h"
 #include "rosewood/data-format/object_conversions.h"
+#include "rosewood/data-format/object_view.h"
 #include "rosewood/data-format/reader.h"
 
 using namespace rosewood::data_format;
@@ -259,3 +265,226 @@ TEST(DataFormatTests, StringNumberDictionary) {
 
     EXPECT_EQ(mapping, (as<std::unordered_map<std::string, int>>(object)));
 }
+
+TEST(DataFormatTests, ViewScalars) {
+    EXPECT_TRUE(ObjectView(std::string("n")).is_null());
+    EXPECT_TRUE(ObjectView(std::string("t")).as_bool());
+    EXPECT_FALSE(ObjectView(std::string("f")).as_bool());
+
+    EXPECT_EQ(0x0a0b0c0d, ObjectView(std::string("i\x0a\x0b\x0c\x0d")).as_int());
+    EXPECT_EQ(0x0a0b0c0d0e0f0001, ObjectView(std::string("I\x0a\x0b\x0c\x0d\x0e\x0f\x00\x01", 9)).as_int());
+    EXPECT_EQ(5.5f, ObjectView(std::string("p\x40\xb0\x00\x00", 5)).as_float());
+    EXPECT_EQ(1.03223687423093579695887456182,
+              ObjectView(std::string("P\x3F\xF0\x84\x0A\xD0\x08\xC1\x10", 9)).as_double());
+}
+
+TEST(DataFormatTests, ViewStringPointsIntoSource) {
+    std::string source("s\x00\x00\x00\x09test\x00more", 14);
+    auto string = ObjectView(source).as_string();
+
+    EXPECT_EQ(source.data() + 5, string.data());
+    EXPECT_EQ(9, string.size());
+    EXPECT_EQ(StringView(std::string("test\x00more", 9)), string);
+}
+
+TEST(DataFormatTests, ViewNestedNavigation) {
+    // [[1, 2], {"key": "value", "n": 4}, true]
+    std::string source("a\x00\x00\x00\x03"
+                       "a\x00\x00\x00\x02" "i\x00\x00\x00\x01" "i\x00\x00\x00\x02"
+                       "d\x00\x00\x00\x02"
+                       "s\x00\x00\x00\x03key" "s\x00\x00\x00\x05value"
+                       "s\x00\x00\x00\x01n" "i\x00\x00\x00\x04"
+                       "t",
+                       5 + 15 + 5 + 8 + 10 + 6 + 5 + 1);
+    ObjectView root(source);
+
+    ASSERT_EQ(DataType::Array, root.type());
+    ASSERT_EQ(3, root.size());
+
+    EXPECT_EQ(2, root[0].size());
+    EXPECT_EQ(2, root[0][1].as_int());
+
+    auto dictionary = root[1];
+    ASSERT_EQ(DataType::Dictionary, dictionary.type());
+    EXPECT_EQ(StringView("value"), dictionary["key"].as_string());
+    EXPECT_EQ(4, dictionary["n"].as_int());
+    EXPECT_FALSE(dictionary.contains("missing"));
+
+    EXPECT_TRUE(root[2].as_bool());
+    EXPECT_TRUE(root[0].next().next().as_bool());
+
+    int n_items = 0;
+    for (const auto &item : root) {
+        EXPECT_TRUE(item.valid());
+        ++n_items;
+    }
+    EXPECT_EQ(3, n_items);
+}
+
+TEST(DataFormatTests, ViewReadFloats) {
+    std::string source("a\x00\x00\x00\x04"
+                       "p\x41\x48\x00\x00"
+                       "i\x00\x00\x00\x04"
+                       "p\x40\xb0\x00\x00"
+                       "i\x00\x00\x00\x08",
+                       5 * 5);
+
+    std::vector<float> floats;
+    ObjectView(source).read_floats(&floats);
+    EXPECT_EQ((std::vector<float>{12.5, 4, 5.5, 8}), floats);
+
+    float partial[2];
+    EXPECT_EQ(2, ObjectView(source).copy_floats(partial, 2));
+    EXPECT_EQ(12.5, partial[0]);
+    EXPECT_EQ(4, partial[1]);
+}
+
+TEST(DataFormatTests, ViewEmptyArray) {
+    std::string source("a\x00\x00\x00\x00", 5);
+    ObjectView root(source);
+
+    EXPECT_EQ(0, root.size());
+    EXPECT_TRUE(root.begin() == root.end());
+}
+
+TEST(DataFormatTests, ViewTypedFloatArray) {
+    std::string source("vf\x00\x00\x00\x02"
+                       "\x00\x00"
+                       "\x00\x00\x48\x41"
+                       "\x00\x00\xb0\x40",
+                       6 + 2 + 2 * 4);
+    ObjectView root(source);
+
+    EXPECT_EQ(DataType::Array, root.type());
+    EXPECT_TRUE(root.is_typed_array());
+    EXPECT_EQ(TypedArrayType::Float32, root.typed_array_type());
+    EXPECT_EQ(2, root.size());
+
+    std::vector<float> floats;
+    root.read_floats(&floats);
+    EXPECT_EQ((std::vector<float>{12.5, 5.5}), floats);
+
+    auto in_place = root.float_data();
+    ASSERT_NE(nullptr, in_place);
+    EXPECT_EQ(source.data() + 8, reinterpret_cast<const char*>(in_place));
+    EXPECT_EQ(12.5, in_place[0]);
+    EXPECT_EQ(nullptr, root.uint16_data());
+
+    EXPECT_EQ((std::vector<float>{12.5, 5.5}), as<std::vector<float>>(root.to_object()));
+}
+
+TEST(DataFormatTests, ViewTypedArrayPaddingIsRelativeToBuffer) {
+    std::string source("a\x00\x00\x00\x02"
+                       "vH\x00\x00\x00\x03"
+                       "\x00"
+                       "\x01\x00\x02\x00\x00\x01"
+                       "i\x00\x00\x00\x07",
+                       5 + 6 + 1 + 3 * 2 + 5);
+    ObjectView root(source);
+
+    auto indices = root[0];
+    EXPECT_EQ(TypedArrayType::UInt16, indices.typed_array_type());
+    EXPECT_EQ(3, indices.size());
+    EXPECT_EQ(7, indices.next().as_int());
+    EXPECT_EQ(7, root[1].as_int());
+
+    std::vector<float> floats;
+    indices.read_floats(&floats);
+    EXPECT_EQ((std::vector<float>{1, 2, 256}), floats);
+
+    EXPECT_EQ((std::vector<int>{1, 2, 256}), as<std::vector<int>>(indices.to_object()));
+}
+
+TEST(DataFormatTests, ViewTruncatedTypedArray) {
+    // Claims three floats, but the buffer ends inside the second
+    std::string source("vf\x00\x00\x00\x03"
+                       "\x00\x00"
+                       "\x00\x00\x48\x41"
+                       "\x00\x00",
+                       6 + 2 + 4 + 2);
+    ObjectView root(source);
+
+    EXPECT_EQ(3, root.size());
+    EXPECT_EQ(nullptr, root.float_data());
+
+    std::vector<float> floats;
+    root.read_floats(&floats);
+    EXPECT_EQ((std::vector<float>{12.5}), floats);
+
+    float partial[3];
+    EXPECT_EQ(1, root.copy_floats(partial, 3));
+
+    EXPECT_EQ((std::vector<float>{12.5}), as<std::vector<float>>(root.to_object()));
+}
+
+TEST(DataFormatTests, MappedFile) {
+    char path[] = "/tmp/rw_mapped_file_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_LE(0, fd);
+    ASSERT_EQ(5, write(fd, "i\x00\x00\x00\x2a", 5));
+    close(fd);
+
+    auto file = MappedFile::open(path);
+    ASSERT_NE(nullptr, file);
+    EXPECT_EQ(5, file->size());
+    EXPECT_EQ(42, file->root().as_int());
+
+    unlink(path);
+    EXPECT_EQ(nullptr, MappedFile::open(path));
+}
+
+TEST(DataFormatTests, AssetArchive) {
+    char path[] = "/tmp/rw_asset_archive_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_LE(0, fd);
+    close(fd);
+
+    std::vector<AssetArchiveFile> files;
+    files.push_back({"meshes/cube.mesh-rbdef", std::string(1000, 'a'), true});
+    files.push_back({"textures/happy.png", std::string("\x89PNG\x00\x01", 6), false});
+    files.push_back({"empty", "", true});
+    for (int i = 0; i < 50; ++i) {
+        files.push_back({"file" + std::to_string(i), std::to_string(i * i), i % 2 == 0});
+    }
+
+    ASSERT_TRUE(write_asset_archive(path, files));
+
+    auto archive = AssetArchive::open(path);
+    ASSERT_NE(nullptr, archive);
+    EXPECT_EQ(files.size(), archive->entry_count());
+
+    for (const auto &file : files) {
+        AssetArchive::Entry entry;
+        ASSERT_TRUE(archive->find(file.path, &entry)) << file.path;
+        EXPECT_EQ(0, (entry.data - (const char*)nullptr) % AssetArchive::kDataAlignment);
+
+        std::string contents;
+        ASSERT_TRUE(AssetArchive::read(entry, &contents));
+        EXPECT_EQ(file.contents, contents);
+    }
+
+    AssetArchive::Entry entry;
+    EXPECT_TRUE(archive->find("meshes/cube.mesh-rbdef", &entry));
+    EXPECT_TRUE(entry.compressed);
+    EXPECT_LT(entry.stored_size, entry.size);
+
+    EXPECT_FALSE(archive->find("meshes/cube", &entry));
+    EXPECT_FALSE(archive->find("", &entry));
+
+    unlink(path);
+}
+
+TEST(DataFormatTests, AssetArchiveRejectsOtherFiles) {
+    char path[] = "/tmp/rw_asset_archive_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_LE(0, fd);
+
+    // Claims far more entries than the file holds
+    ASSERT_EQ(16, write(fd, "RWPK\x00\x00\x00\x01\x00\x00\x10\x00\x00\x00\x00\x00", 16));
+    close(fd);
+
+    EXPECT_EQ(nullptr, AssetArchive::open(path));
+
+    unlink(path);
+    EXPECT_EQ(nullptr, AssetArchive::open(path));
+}
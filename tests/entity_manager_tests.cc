@@ -1,7 +1,10 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <type_traits>
+#include <vector>
 
 #include "rosewood/target.h"
 
@@ -36,7 +39,20 @@ TEST_F(EntityManagerTests, ReuseId) {
 
     Entity e3 = _entities.create_entity();
 
-    EXPECT_EQ(e1.eid, e3.eid);
+    EXPECT_EQ(entity_index(e1.eid), entity_index(e3.eid));
+    EXPECT_NE(e1, e3);
+}
+
+TEST_F(EntityManagerTests, StaleHandleIsInvalid) {
+    Entity e1 = _entities.create_entity();
+    _entities.destroy_entity(e1);
+
+    Entity e2 = _entities.create_entity();
+    ASSERT_EQ(entity_index(e1.eid), entity_index(e2.eid));
+
+    EXPECT_FALSE(_entities.is_valid(e1));
+    EXPECT_TRUE(_entities.is_valid(e2));
+    EXPECT_FALSE(_entities.is_valid(Entity{&_entities, make_entity_id(entity_index(e1.eid), 0)}));
 }
 
 struct TestComponent : public Component<TestComponent> {
@@ -93,6 +109,24 @@ TEST_F(EntityManagerTests, AutoAddManyComponents) {
     ASSERT_NE((TestComponent2 *)nullptr, _entities.component<TestComponent2>(e1));
 }
 
+TEST_F(EntityManagerTests, StaleHandleDoesNotAliasComponents) {
+    Entity e1 = _entities.create_entity();
+    _entities.destroy_entity(e1);
+
+    Entity e2 = _entities.create_entity();
+    auto comp = _entities.add_component<TestComponent>(e2);
+
+    EXPECT_EQ(comp, _entities.component<TestComponent>(e2));
+    EXPECT_EQ((TestComponent *)nullptr, _entities.component<TestComponent>(e1));
+
+    _entities.remove_component<TestComponent>(e1);
+    _entities.destroy_entity(e1);
+
+    EXPECT_TRUE(_entities.is_valid(e2));
+    EXPECT_EQ(comp, _entities.component<TestComponent>(e2));
+    EXPECT_EQ(1, _entities.entity_count());
+}
+
 TEST_F(EntityManagerTests, RemoveComponent) {
     bool ctor_called = false, dtor_called = false;
     Entity e1 = _entities.create_entity();
@@ -149,3 +183,314 @@ TEST_F(EntityManagerTests, AlignedComponent) {
     EXPECT_EQ(0, size_t(c3) % 1024);
     EXPECT_EQ(0, size_t(c4) % 1024);
 }
+
+class ArchetypeEntityManagerTests : public ::testing::Test {
+protected:
+    ArchetypeEntityManagerTests() : _entities(StorageMode::Archetype) { }
+
+    EntityManager _entities;
+};
+
+struct ValueComponent : public Component<ValueComponent> {
+    ValueComponent(Entity owner, int value) : Component<ValueComponent>(owner), value(value) { }
+
+    int value;
+};
+
+TEST_F(ArchetypeEntityManagerTests, AddAndGetComponent) {
+    Entity e1 = _entities.create_entity();
+    Entity e2 = _entities.create_entity();
+
+    auto comp = _entities.add_component<TestComponent>(e1);
+    ASSERT_NE((TestComponent *)nullptr, comp);
+
+    EXPECT_EQ(comp, _entities.component<TestComponent>(e1));
+    EXPECT_EQ((TestComponent *)nullptr, _entities.component<TestComponent>(e2));
+    EXPECT_EQ(e1, comp->entity());
+}
+
+TEST_F(ArchetypeEntityManagerTests, ComponentsSurviveArchetypeChange) {
+    Entity e1 = _entities.create_entity();
+
+    _entities.add_component<ValueComponent>(e1, 42);
+    _entities.add_component<TestComponent>(e1);
+    _entities.add_component<TestComponent2>(e1);
+
+    ASSERT_NE((ValueComponent *)nullptr, _entities.component<ValueComponent>(e1));
+    EXPECT_EQ(42, _entities.component<ValueComponent>(e1)->value);
+
+    _entities.remove_component<TestComponent>(e1);
+
+    EXPECT_EQ((TestComponent *)nullptr, _entities.component<TestComponent>(e1));
+    ASSERT_NE((TestComponent2 *)nullptr, _entities.component<TestComponent2>(e1));
+    EXPECT_EQ(42, _entities.component<ValueComponent>(e1)->value);
+}
+
+TEST_F(ArchetypeEntityManagerTests, RemovingEntityKeepsOthersIntact) {
+    std::vector<Entity> entities;
+    for (int i = 0; i < 1000; ++i) {
+        auto e = _entities.create_entity();
+        _entities.add_component<ValueComponent>(e, i);
+        entities.push_back(e);
+    }
+
+    for (int i = 0; i < 1000; i += 3) {
+        _entities.destroy_entity(entities[i]);
+    }
+
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 3 == 0) continue;
+
+        auto comp = _entities.component<ValueComponent>(entities[i]);
+        ASSERT_NE((ValueComponent *)nullptr, comp);
+        EXPECT_EQ(i, comp->value);
+        EXPECT_EQ(entities[i], comp->entity());
+    }
+}
+
+TEST_F(ArchetypeEntityManagerTests, RemoveComponentsWhenEntityRemoved) {
+    bool ctor_called = false, dtor_called = false;
+    Entity e1 = _entities.create_entity();
+
+    _entities.add_component<TestComponent>(e1);
+    _entities.add_component<CtorDtorComponent>(e1, &ctor_called, &dtor_called);
+    EXPECT_TRUE(ctor_called);
+    EXPECT_FALSE(dtor_called);
+
+    _entities.destroy_entity(e1);
+    EXPECT_TRUE(dtor_called);
+
+    for (auto __unused comp : _entities.components<CtorDtorComponent>()) {
+        GTEST_FAIL();
+    }
+
+    _entities.for_components<CtorDtorComponent>([](CtorDtorComponent *) {
+        GTEST_FAIL();
+    });
+}
+
+TEST_F(ArchetypeEntityManagerTests, IterateOnlyMatchingEntities) {
+    for (int i = 0; i < 100; ++i) {
+        auto e = _entities.create_entity();
+        _entities.add_component<ValueComponent>(e, i);
+        if (i % 10 == 0) {
+            _entities.add_component<TestComponent>(e);
+        }
+    }
+
+    int n_values = 0;
+    for (auto comp : _entities.components<ValueComponent>()) {
+        ASSERT_NE((ValueComponent *)nullptr, comp);
+        ++n_values;
+    }
+    EXPECT_EQ(100, n_values);
+
+    int n_matched = 0, sum = 0;
+    _entities.for_components<ValueComponent, TestComponent>([&](ValueComponent *value, TestComponent *test) {
+        EXPECT_EQ(value->entity(), test->entity());
+        ++n_matched;
+        sum += value->value;
+    });
+    EXPECT_EQ(10, n_matched);
+    EXPECT_EQ(450, sum);
+}
+
+TEST_F(ArchetypeEntityManagerTests, AlignedComponent) {
+    for (int i = 0; i < 64; ++i) {
+        auto e = _entities.create_entity();
+        auto c = _entities.add_component<AlignedComponent>(e, i);
+        _entities.add_component<TestComponent>(e);
+
+        EXPECT_EQ(0, size_t(c) % 1024);
+        EXPECT_EQ(0, size_t(_entities.component<AlignedComponent>(e)) % 1024);
+        EXPECT_EQ(i, _entities.component<AlignedComponent>(e)->i);
+    }
+}
+
+TEST_F(EntityManagerTests, ForComponentsJoin) {
+    std::vector<Entity> entities;
+    for (int i = 0; i < 1000; ++i) {
+        auto e = _entities.create_entity<TestComponent>();
+        if (i % 100 == 0) {
+            e.add_component<TestComponent2>();
+        }
+        entities.push_back(e);
+    }
+
+    std::vector<Entity> visited;
+    _entities.for_components<TestComponent, TestComponent2>([&](TestComponent *c1, TestComponent2 *c2) {
+        EXPECT_EQ(c1->entity(), c2->entity());
+        visited.push_back(c1->entity());
+    });
+
+    ASSERT_EQ(10, visited.size());
+    for (int i = 0; i < 1000; i += 100) {
+        EXPECT_NE(end(visited), std::find(begin(visited), end(visited), entities[i]));
+    }
+}
+
+TEST_F(EntityManagerTests, ForComponentsDestroyWhileIterating) {
+    for (int i = 0; i < 100; ++i) {
+        _entities.create_entity<TestComponent>();
+    }
+
+    int n_visited = 0;
+    _entities.for_components<TestComponent>([&](TestComponent *comp) {
+        ++n_visited;
+        comp->entity().destroy();
+    });
+
+    EXPECT_EQ(100, n_visited);
+    EXPECT_EQ(0, _entities.entity_count());
+
+    _entities.for_components<TestComponent>([](TestComponent *) {
+        GTEST_FAIL();
+    });
+}
+
+TEST_F(ArchetypeEntityManagerTests, ForComponentsDestroyWhileIterating) {
+    std::vector<Entity> entities;
+    for (int i = 0; i < 1000; ++i) {
+        auto e = _entities.create_entity();
+        _entities.add_component<ValueComponent>(e, i);
+        if (i % 2) {
+            _entities.add_component<TestComponent>(e);
+        }
+        entities.push_back(e);
+    }
+
+    std::vector<int> visited(1000, 0);
+    _entities.for_components<ValueComponent>([&](ValueComponent *comp) {
+        ++visited[comp->value];
+        if (comp->value % 3 == 0) {
+            comp->entity().destroy();
+        }
+        else if (comp->value % 3 == 1) {
+            _entities.remove_component<ValueComponent>(comp->entity());
+        }
+    });
+
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(1, visited[i]) << "entity " << i;
+    }
+
+    int n_left = 0;
+    for (auto comp : _entities.components<ValueComponent>()) {
+        EXPECT_EQ(2, comp->value % 3);
+        ++n_left;
+        comp->entity().destroy();
+    }
+    EXPECT_EQ(333, n_left);
+
+    for (auto __unused comp : _entities.components<ValueComponent>()) {
+        GTEST_FAIL();
+    }
+}
+
+TEST_F(ArchetypeEntityManagerTests, ForComponentsChangeOtherComponentsWhileIterating) {
+    for (int i = 0; i < 8; ++i) {
+        auto e = _entities.create_entity();
+        _entities.add_component<ValueComponent>(e, i);
+        if (i % 2) {
+            _entities.add_component<TestComponent>(e);
+        }
+    }
+
+    // Each change moves the entity to another archetype still holding a
+    // ValueComponent, which must not get it visited again
+    std::vector<int> visited(8, 0);
+    _entities.for_components<ValueComponent>([&](ValueComponent *comp) {
+        ++visited[comp->value];
+        if (comp->value % 2) {
+            _entities.remove_component<TestComponent>(comp->entity());
+        }
+        else {
+            _entities.add_component<TestComponent2>(comp->entity());
+        }
+    });
+
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(1, visited[i]) << "entity " << i;
+    }
+
+    std::fill(begin(visited), end(visited), 0);
+    for (auto comp : _entities.components<ValueComponent>()) {
+        ++visited[comp->value];
+        if (comp->value % 2) {
+            _entities.add_component<TestComponent>(comp->entity());
+        }
+        else {
+            _entities.remove_component<TestComponent2>(comp->entity());
+        }
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(1, visited[i]) << "entity " << i;
+    }
+}
+
+TEST_F(EntityManagerTests, ParallelForComponents) {
+    for (int i = 0; i < 1000; ++i) {
+        auto e = _entities.create_entity<TestComponent>();
+        if (i % 2 == 0) {
+            _entities.add_component<ValueComponent>(e, i);
+        }
+    }
+
+    JobSystem jobs(4);
+    std::atomic<int> n_visited(0), sum(0);
+
+    _entities.parallel_for_components<TestComponent, ValueComponent>(jobs, [&](TestComponent *test, ValueComponent *value) {
+        EXPECT_EQ(test->entity(), value->entity());
+        ++n_visited;
+        sum += value->value;
+    }, 16);
+
+    EXPECT_EQ(500, n_visited.load());
+    EXPECT_EQ(249500, sum.load());
+}
+
+TEST_F(ArchetypeEntityManagerTests, ParallelForComponents) {
+    for (int i = 0; i < 5000; ++i) {
+        auto e = _entities.create_entity();
+        _entities.add_component<ValueComponent>(e, i);
+        if (i % 2 == 0) {
+            _entities.add_component<TestComponent>(e);
+        }
+    }
+
+    JobSystem jobs(4);
+    std::atomic<long> n_visited(0), sum(0);
+
+    _entities.parallel_for_components<ValueComponent>(jobs, [&](ValueComponent *value) {
+        ++n_visited;
+        sum += value->value;
+    });
+
+    EXPECT_EQ(5000, n_visited.load());
+    EXPECT_EQ(12497500, sum.load());
+}
+
+TEST_F(EntityManagerTests, TrackComponentChanges) {
+    auto existing = _entities.create_entity<TestComponent>();
+    _entities.track_component_changes<TestComponent>();
+
+    auto added = _entities.create_entity<TestComponent>();
+    auto untracked = _entities.create_entity<TestComponent2>();
+    _entities.notify_component_changed<TestComponent>(existing);
+
+    std::vector<Entity> changed, removed;
+    _entities.take_component_changes<TestComponent>(&changed, &removed);
+
+    EXPECT_EQ((std::vector<Entity>{ existing, added, existing }), changed);
+    EXPECT_TRUE(removed.empty());
+
+    added.remove_component<TestComponent>();
+    existing.destroy();
+    untracked.destroy();
+
+    _entities.take_component_changes<TestComponent>(&changed, &removed);
+
+    EXPECT_TRUE(changed.empty());
+    EXPECT_EQ((std::vector<Entity>{ added, existing }), removed);
+}
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <thread>
+#include <vector>
+
 #include "rosewood/core/event.h"
 
 using namespace rosewood::core;
@@ -88,3 +91,199 @@ TEST_F(EventManagerTests, ListenToGlobal) {
     EXPECT_EQ(1, listener.n_global_received);
     EXPECT_EQ(0, listener.n_received);
 }
+
+TEST_F(EventManagerTests, OnlyTheListenedSenderIsDelivered) {
+    Sender sender, other_sender;
+    Listener listener;
+
+    _events.add_listener<TestEvent>(&sender, &listener, &Listener::did_receive_event);
+
+    _events.send_event(&other_sender, TestEvent(1));
+    EXPECT_EQ(0, listener.n_received);
+
+    _events.send_event(&sender, TestEvent(2));
+    EXPECT_EQ(1, listener.n_received);
+    EXPECT_EQ(2, listener.last_event.data);
+}
+
+TEST_F(EventManagerTests, CallableHandlers) {
+    Sender sender;
+    Listener listener;
+    int sum = 0;
+
+    _events.add_listener<TestEvent>(&listener, [&sum](Listener *l, Sender *, const TestEvent *event) {
+        ++l->n_global_received;
+        sum += event->data;
+    });
+
+    _events.send_event(&sender, TestEvent(3));
+    _events.send_event(&sender, TestEvent(4));
+
+    EXPECT_EQ(2, listener.n_global_received);
+    EXPECT_EQ(7, sum);
+}
+
+TEST_F(EventManagerTests, RemoveListenerWhileSending) {
+    Sender sender;
+    Listener first, second;
+
+    _events.add_listener<TestEvent>(&first, [this, &second](Listener *l, Sender *, const TestEvent *) {
+        ++l->n_global_received;
+        _events.remove_listener(&second);
+    });
+    _events.add_listener<TestEvent>(&second, &Listener::did_receive_global_event);
+
+    _events.send_event(&sender, TestEvent(1));
+    _events.send_event(&sender, TestEvent(2));
+
+    EXPECT_EQ(2, first.n_global_received);
+    EXPECT_EQ(0, second.n_global_received);
+}
+
+TEST_F(EventManagerTests, AddListenerWhileSendingGrowsTheList) {
+    Sender sender;
+    Listener first;
+
+    struct {
+        std::vector<Listener> added;
+        int sum;
+    } state { std::vector<Listener>(64), 0 };
+
+    // Two captures keep this handler inline in the delegate, so they must
+    // survive the list being reallocated while the handler runs
+    _events.add_listener<TestEvent>(&first, [this, &state](Listener *l, Sender *, const TestEvent *event) {
+        if (!l->n_global_received) {
+            for (auto &listener : state.added) {
+                _events.add_listener<TestEvent>(&listener, &Listener::did_receive_global_event);
+            }
+        }
+
+        ++l->n_global_received;
+        state.sum += event->data;
+    });
+
+    _events.send_event(&sender, TestEvent(3));
+
+    EXPECT_EQ(1, first.n_global_received);
+    EXPECT_EQ(3, state.sum);
+    EXPECT_EQ(0, state.added.front().n_global_received);
+
+    _events.send_event(&sender, TestEvent(4));
+
+    EXPECT_EQ(2, first.n_global_received);
+    EXPECT_EQ(7, state.sum);
+    for (const auto &listener : state.added) {
+        EXPECT_EQ(1, listener.n_global_received);
+    }
+}
+
+struct OtherEvent : public Event<OtherEvent> {
+    int data;
+
+    OtherEvent(int data) : data(data) { }
+};
+
+TEST_F(EventManagerTests, QueuedEventsAreDeliveredInBatchesByType) {
+    Sender sender;
+    Listener listener;
+    std::vector<int> delivered;
+
+    _events.add_listener<TestEvent>(&listener, [&](Listener *, Sender *, const TestEvent *event) {
+        delivered.push_back(event->data);
+
+        // Queued while delivering, so it waits for the next frame
+        if (event->data == 1) _events.queue_event(&sender, TestEvent(5));
+    });
+    _events.add_listener<OtherEvent>(&listener, [&](Listener *, Sender *, const OtherEvent *event) {
+        delivered.push_back(100 + event->data);
+    });
+
+    _events.queue_event(&sender, TestEvent(1));
+    _events.queue_event(&sender, OtherEvent(2));
+    _events.queue_event(&sender, TestEvent(3));
+
+    EXPECT_TRUE(delivered.empty());
+
+    _events.deliver_queued_events();
+    EXPECT_EQ((std::vector<int>{ 1, 3, 102 }), delivered);
+
+    delivered.clear();
+    _events.deliver_queued_events();
+    EXPECT_EQ((std::vector<int>{ 5 }), delivered);
+
+    delivered.clear();
+    _events.deliver_queued_events();
+    EXPECT_TRUE(delivered.empty());
+}
+
+TEST_F(EventManagerTests, ChannelDispatchesInOrder) {
+    Sender sender;
+    Listener listener;
+    std::vector<int> delivered;
+
+    _events.add_listener<TestEvent>(&listener, [&](Listener *, Sender *, const TestEvent *event) {
+        delivered.push_back(event->data);
+    });
+    _events.add_listener<OtherEvent>(&listener, [&](Listener *, Sender *, const OtherEvent *event) {
+        delivered.push_back(100 + event->data);
+    });
+
+    EventChannel<Sender*> channel;
+    EXPECT_EQ(0u, channel.dispatch(&_events));
+
+    channel.send_event(&sender, TestEvent(1));
+    channel.send_event(&sender, OtherEvent(2));
+    channel.send_event(&sender, TestEvent(3));
+
+    EXPECT_TRUE(delivered.empty());
+    EXPECT_EQ(3u, channel.dispatch(&_events));
+    EXPECT_EQ((std::vector<int>{ 1, 102, 3 }), delivered);
+
+    // Left undelivered, to check the channel frees them
+    channel.send_event(&sender, TestEvent(4));
+}
+
+TEST_F(EventManagerTests, ChannelFromManyThreads) {
+    static const int kThreads = 4;
+    static const int kEventsPerThread = 10000;
+
+    Sender senders[kThreads];
+    Listener listener;
+    int last_seen[kThreads];
+    int n_received[kThreads] = { 0 };
+    bool in_order = true;
+
+    for (auto &seen : last_seen) seen = -1;
+
+    _events.add_listener<TestEvent>(&listener, [&](Listener *, Sender *sender, const TestEvent *event) {
+        auto thread = sender - senders;
+        in_order = in_order && event->data == last_seen[thread] + 1;
+        last_seen[thread] = event->data;
+        ++n_received[thread];
+    });
+
+    EventChannel<Sender*> channel;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < kEventsPerThread; ++i) {
+                channel.send_event(&senders[t], TestEvent(i));
+            }
+        });
+    }
+
+    size_t total = 0;
+    while (total < kThreads * kEventsPerThread) {
+        total += channel.dispatch(&_events);
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_TRUE(in_order);
+    for (int t = 0; t < kThreads; ++t) {
+        EXPECT_EQ(kEventsPerThread, n_received[t]);
+    }
+}
@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+
+#ifdef __linux__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "rosewood/utils/folder_resource_loader.h"
+
+using rosewood::utils::FolderResourceLoader;
+
+typedef std::vector<std::string> Paths;
+
+// Gives every test an empty folder of its own, removed again afterwards
+class FolderResourceLoaderTests : public ::testing::Test {
+protected:
+    std::string root;
+
+    virtual void SetUp() override {
+        char path[] = "/tmp/rw_folder_loader_XXXXXX";
+        ASSERT_TRUE(mkdtemp(path));
+        root = std::string(path) + "/";
+    }
+
+    virtual void TearDown() override {
+        ASSERT_EQ(0, system(("rm -rf '" + root + "'").c_str()));
+    }
+
+    void write_file(const std::string &path, const std::string &contents) {
+        std::ofstream(root + path) << contents;
+    }
+
+    void make_folder(const std::string &path) {
+        ASSERT_EQ(0, mkdir((root + path).c_str(), 0755));
+    }
+
+    static Paths collect(FolderResourceLoader *loader) {
+        Paths paths;
+        loader->collect_changed_files(&paths);
+        std::sort(begin(paths), end(paths));
+        return paths;
+    }
+};
+
+TEST_F(FolderResourceLoaderTests, ReportsWrittenFiles) {
+    make_folder("existing");
+    write_file("a.txt", "a");
+
+    FolderResourceLoader loader(root);
+    ASSERT_TRUE(loader.watch_for_changes());
+    EXPECT_EQ(Paths(), collect(&loader));
+
+    write_file("a.txt", "changed");
+    write_file("new.txt", "new");
+    write_file("existing/b.txt", "b");
+
+    EXPECT_EQ((Paths{ "a.txt", "existing/b.txt", "new.txt" }), collect(&loader));
+    EXPECT_EQ(Paths(), collect(&loader));
+
+    EXPECT_EQ("changed", loader.read_file("a.txt"));
+}
+
+TEST_F(FolderResourceLoaderTests, ReportsFilesMovedIn) {
+    FolderResourceLoader loader(root);
+    ASSERT_TRUE(loader.watch_for_changes());
+
+    // Editors often save by writing a temporary file and renaming it
+    write_file(".a.txt.swp", "a");
+    ASSERT_EQ(0, rename((root + ".a.txt.swp").c_str(), (root + "a.txt").c_str()));
+
+    EXPECT_EQ((Paths{ ".a.txt.swp", "a.txt" }), collect(&loader));
+}
+
+TEST_F(FolderResourceLoaderTests, WatchesFoldersCreatedLater) {
+    FolderResourceLoader loader(root);
+    ASSERT_TRUE(loader.watch_for_changes());
+
+    make_folder("later");
+    EXPECT_EQ(Paths(), collect(&loader));
+
+    make_folder("later/nested");
+    EXPECT_EQ(Paths(), collect(&loader));
+
+    write_file("later/a.txt", "a");
+    write_file("later/nested/b.txt", "b");
+
+    EXPECT_EQ((Paths{ "later/a.txt", "later/nested/b.txt" }), collect(&loader));
+
+    // Renaming a folder reports its files under the new name
+    ASSERT_EQ(0, rename((root + "later").c_str(), (root + "moved").c_str()));
+    EXPECT_EQ((Paths{ "moved/a.txt", "moved/nested/b.txt" }), collect(&loader));
+
+    write_file("moved/c.txt", "c");
+    EXPECT_EQ((Paths{ "moved/c.txt" }), collect(&loader));
+}
+
+TEST_F(FolderResourceLoaderTests, ReportsFilesWrittenBeforeTheFolderIsWatched) {
+    FolderResourceLoader loader(root);
+    ASSERT_TRUE(loader.watch_for_changes());
+
+    // The folder's watch is only added when its creation is collected
+    make_folder("later");
+    write_file("later/a.txt", "a");
+    make_folder("later/nested");
+    write_file("later/nested/b.txt", "b");
+
+    EXPECT_EQ((Paths{ "later/a.txt", "later/nested/b.txt" }), collect(&loader));
+    EXPECT_EQ(Paths(), collect(&loader));
+}
+
+TEST_F(FolderResourceLoaderTests, ReportsEverythingAfterOverflow) {
+    int max_queued_events = 0;
+    std::ifstream("/proc/sys/fs/inotify/max_queued_events") >> max_queued_events;
+    if (max_queued_events <= 0 || max_queued_events > 1 << 20) {
+        return;
+    }
+
+    make_folder("sub");
+    write_file("sub/untouched.txt", "u");
+
+    FolderResourceLoader loader(root);
+    ASSERT_TRUE(loader.watch_for_changes());
+
+    // Alternate between two files, since identical consecutive events are
+    // merged into one
+    for (int i = 0; i <= max_queued_events; ++i) {
+        write_file(i % 2 ? "a.txt" : "b.txt", "x");
+    }
+
+    auto paths = collect(&loader);
+    paths.erase(std::unique(begin(paths), end(paths)), end(paths));
+    EXPECT_EQ((Paths{ "a.txt", "b.txt", "sub/untouched.txt" }), paths);
+
+    write_file("sub/c.txt", "c");
+    EXPECT_EQ((Paths{ "sub/c.txt" }), collect(&loader));
+}
+
+TEST_F(FolderResourceLoaderTests, ForgetsRemovedFolders) {
+    make_folder("sub");
+    write_file("sub/a.txt", "a");
+    write_file("b.txt", "b");
+
+    FolderResourceLoader loader(root);
+    ASSERT_TRUE(loader.watch_for_changes());
+
+    // Removing files is not a change anyone could reload
+    ASSERT_EQ(0, unlink((root + "sub/a.txt").c_str()));
+    ASSERT_EQ(0, unlink((root + "b.txt").c_str()));
+
+    // The kernel drops the watch of a removed folder with IN_IGNORED
+    ASSERT_EQ(0, rmdir((root + "sub").c_str()));
+    EXPECT_EQ(Paths(), collect(&loader));
+
+    // A new folder under the old name is watched afresh, and reports its
+    // files once
+    make_folder("sub");
+    EXPECT_EQ(Paths(), collect(&loader));
+
+    write_file("sub/c.txt", "c");
+    EXPECT_EQ((Paths{ "sub/c.txt" }), collect(&loader));
+}
+
+TEST_F(FolderResourceLoaderTests, NothingReportedWithoutWatching) {
+    FolderResourceLoader loader(root);
+
+    write_file("a.txt", "a");
+    EXPECT_EQ(Paths(), collect(&loader));
+}
+
+#endif
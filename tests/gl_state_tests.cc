@@ -0,0 +1,221 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "rosewood/math/math_types.h"
+#include "rosewood/math/matrix4.h"
+#include "rosewood/math/vector.h"
+
+#include "rosewood/graphics/gl_state.h"
+#include "rosewood/graphics/metrics.h"
+
+using rosewood::math::Matrix4;
+using rosewood::math::Vector4;
+
+using rosewood::graphics::metrics::gl_calls_elided;
+using rosewood::graphics::metrics::gl_calls_issued;
+
+namespace gl_state = rosewood::graphics::gl_state;
+
+// Stands in for the driver, writing every call down as its name and
+// integer arguments
+typedef std::vector<std::string> Calls;
+static Calls gCalls;
+
+static void record(const char *name, std::initializer_list<long> args = {}) {
+    std::string call(name);
+    for (auto arg : args) {
+        call += " " + std::to_string(arg);
+    }
+    gCalls.push_back(call);
+}
+
+static void record_enable(GLenum cap) { record("enable", { (long)cap }); }
+static void record_disable(GLenum cap) { record("disable", { (long)cap }); }
+static void record_depth_func(GLenum func) { record("depth_func", { (long)func }); }
+static void record_depth_mask(GLboolean flag) { record("depth_mask", { (long)flag }); }
+static void record_blend_func(GLenum s, GLenum d) { record("blend_func", { (long)s, (long)d }); }
+static void record_polygon_offset(GLfloat f, GLfloat u) { record("polygon_offset", { (long)f, (long)u }); }
+static void record_bind_vertex_array(GLuint vao) { record("bind_vertex_array", { (long)vao }); }
+static void record_bind_buffer(GLenum, GLuint buffer) { record("bind_buffer", { (long)buffer }); }
+static void record_bind_texture(GLenum, GLuint texture) { record("bind_texture", { (long)texture }); }
+static void record_delete_textures(GLsizei, const GLuint *t) { record("delete_texture", { (long)t[0] }); }
+static void record_active_texture(GLenum unit) { record("active_texture", { (long)(unit - GL_TEXTURE0) }); }
+static void record_use_program(GLuint program) { record("use_program", { (long)program }); }
+static void record_delete_program(GLuint program) { record("delete_program", { (long)program }); }
+static void record_uniform_matrix4fv(GLint location, GLsizei, GLboolean, const GLfloat*) {
+    record("uniform_matrix4", { location });
+}
+static void record_uniform_matrix3fv(GLint location, GLsizei, GLboolean, const GLfloat*) {
+    record("uniform_matrix3", { location });
+}
+static void record_uniform4fv(GLint location, GLsizei, const GLfloat*) { record("uniform4", { location }); }
+static void record_uniform1i(GLint location, GLint value) { record("uniform1i", { location, value }); }
+static void record_enable_attrib(GLuint index) { record("enable_vertex_attrib_array", { (long)index }); }
+static void record_attrib_pointer(GLuint index, GLint, GLenum, GLboolean, GLsizei, const GLvoid*) {
+    record("vertex_attrib_pointer", { (long)index });
+}
+
+static const gl_state::Dispatch gRecordingDispatch = {
+    record_enable, record_disable, record_depth_func, record_depth_mask, record_blend_func,
+    record_polygon_offset, record_bind_vertex_array, record_bind_buffer, record_bind_texture,
+    record_delete_textures, record_active_texture, record_use_program, record_delete_program,
+    record_uniform_matrix4fv, record_uniform_matrix3fv, record_uniform4fv, record_uniform1i,
+    record_enable_attrib, record_attrib_pointer,
+};
+
+class GLStateTests : public ::testing::Test {
+protected:
+    virtual void SetUp() override {
+        gl_state::set_dispatch(gRecordingDispatch);
+        gl_state::reset();
+        gCalls.clear();
+    }
+
+    virtual void TearDown() override {
+        gl_state::reset();
+        gl_state::set_dispatch(gl_state::platform_dispatch());
+    }
+
+    static Calls take_calls() {
+        Calls calls;
+        calls.swap(gCalls);
+        return calls;
+    }
+};
+
+TEST_F(GLStateTests, SkipsRedundantCalls) {
+    for (int i = 0; i < 3; ++i) {
+        gl_state::enable(GL_DEPTH_TEST);
+        gl_state::set_depth_func(GL_LEQUAL);
+        gl_state::set_depth_mask(false);
+        gl_state::set_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        gl_state::set_polygon_offset(1, 2);
+        gl_state::bind_vertex_array_object(4);
+        gl_state::bind_texture(5);
+        gl_state::activate_texture_unit(1);
+        gl_state::use_program(6);
+    }
+
+    EXPECT_EQ((Calls{
+        "enable " + std::to_string(GL_DEPTH_TEST),
+        "depth_func " + std::to_string(GL_LEQUAL),
+        "depth_mask 0",
+        "blend_func " + std::to_string(GL_SRC_ALPHA) + " " + std::to_string(GL_ONE_MINUS_SRC_ALPHA),
+        "polygon_offset 1 2",
+        "bind_vertex_array 4",
+        "bind_texture 5",
+        "active_texture 1",
+        "use_program 6",
+    }), take_calls());
+
+    // Changing a value goes through again
+    gl_state::disable(GL_DEPTH_TEST);
+    gl_state::set_depth_mask(true);
+    EXPECT_EQ((Calls{ "disable " + std::to_string(GL_DEPTH_TEST), "depth_mask 1" }), take_calls());
+}
+
+TEST_F(GLStateTests, CountsIssuedAndElidedCalls) {
+    auto issued = gl_calls_issued.total();
+    auto elided = gl_calls_elided.total();
+
+    gl_state::set_depth_func(GL_LESS);
+    gl_state::set_depth_func(GL_LESS);
+    gl_state::set_depth_func(GL_LESS);
+    gl_state::bind_texture(1);
+    gl_state::bind_texture(2);
+
+    EXPECT_EQ(3u, gl_calls_issued.total() - issued);
+    EXPECT_EQ(2u, gl_calls_elided.total() - elided);
+    EXPECT_EQ(3u, take_calls().size());
+}
+
+TEST_F(GLStateTests, ResetForgetsValuesMatchingTheGLDefaults) {
+    auto set_defaults = []() {
+        gl_state::set_depth_func(GL_LESS);
+        gl_state::set_depth_mask(true);
+        gl_state::set_blend_func(GL_ONE, GL_ZERO);
+        gl_state::set_polygon_offset(0, 0);
+    };
+
+    // Whatever the context was left with, the first call can't be skipped
+    set_defaults();
+    EXPECT_EQ(4u, take_calls().size());
+
+    set_defaults();
+    EXPECT_EQ(0u, take_calls().size());
+
+    gl_state::reset();
+    set_defaults();
+    EXPECT_EQ(4u, take_calls().size());
+}
+
+TEST_F(GLStateTests, FlushesPendingUniformsWhenTheProgramIsUsed) {
+    gl_state::use_program(1);
+    take_calls();
+
+    gl_state::set_uniform(2, 0, 7);
+    gl_state::set_uniform(2, 1, Vector4(1, 2, 3, 4));
+    gl_state::set_uniform(2, 0, 8);
+    EXPECT_EQ(0u, take_calls().size());
+
+    auto known = gl_state::known_uniform_state(2);
+    ASSERT_EQ(2u, known.size());
+    EXPECT_EQ(8, known[0].get<int>());
+
+    gl_state::use_program(2);
+    EXPECT_EQ((Calls{ "use_program 2", "uniform1i 0 8", "uniform4 1" }), take_calls());
+
+    // Uploaded now, so setting the same values again does nothing
+    gl_state::set_uniform(0, 8);
+    gl_state::set_uniform(2, 1, Vector4(1, 2, 3, 4));
+    EXPECT_EQ(0u, take_calls().size());
+
+    // Values of the current program go straight through
+    gl_state::set_uniform(2, 2, Matrix4());
+    EXPECT_EQ((Calls{ "uniform_matrix4 2" }), take_calls());
+
+    // Switching back and forth doesn't upload anything again
+    gl_state::use_program(1);
+    gl_state::use_program(2);
+    EXPECT_EQ((Calls{ "use_program 1", "use_program 2" }), take_calls());
+}
+
+TEST_F(GLStateTests, DeletingAProgramForgetsItsUniforms) {
+    gl_state::use_program(3);
+    gl_state::set_uniform(0, 7);
+    gl_state::set_uniform(4, 1, 9);
+    take_calls();
+
+    gl_state::delete_program(3);
+    EXPECT_EQ((Calls{ "use_program 0", "delete_program 3" }), take_calls());
+    EXPECT_TRUE(gl_state::known_uniform_state(3).empty());
+
+    // GL reuses the name for the next program, which starts out with
+    // nothing uploaded
+    gl_state::use_program(3);
+    gl_state::set_uniform(0, 7);
+    EXPECT_EQ((Calls{ "use_program 3", "uniform1i 0 7" }), take_calls());
+
+    // Deleting a program that isn't current leaves the binding alone and
+    // drops its pending values
+    gl_state::delete_program(4);
+    gl_state::use_program(4);
+    EXPECT_EQ((Calls{ "delete_program 4", "use_program 4" }), take_calls());
+}
+
+TEST_F(GLStateTests, BindingAVertexArrayForgetsAttributeState) {
+    gl_state::bind_vertex_array_object(1);
+    gl_state::enable_vertex_attrib_array(0);
+    gl_state::enable_vertex_attrib_array(0);
+    gl_state::bind_vertex_array_object(2);
+    gl_state::enable_vertex_attrib_array(0);
+
+    EXPECT_EQ((Calls{
+        "bind_vertex_array 1",
+        "enable_vertex_attrib_array 0",
+        "bind_vertex_array 2",
+        "enable_vertex_attrib_array 0",
+    }), take_calls());
+}
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "rosewood/data-structures/radix_sort.h"
+
+#include "rosewood/math/math_types.h"
+#include "rosewood/math/matrix3.h"
+#include "rosewood/math/matrix4.h"
+#include "rosewood/math/quaternion.h"
+#include "rosewood/math/trig.h"
+#include "rosewood/math/vector.h"
+
+#include "rosewood/graphics/instance_batcher.h"
+#include "rosewood/graphics/mesh_buffer.h"
+#include "rosewood/graphics/sort_key.h"
+
+using namespace rosewood::graphics;
+using namespace rosewood::math;
+
+using rosewood::data_structures::KeyIndex;
+using rosewood::data_structures::radix_sort;
+
+// The batcher only compares the pointers, so distinct addresses stand in
+// for the real objects
+static char gObjects[8];
+
+static const Shader *shader(int i) { return reinterpret_cast<const Shader*>(&gObjects[i]); }
+static const Material *material(int i) { return reinterpret_cast<const Material*>(&gObjects[i]); }
+static const Mesh *mesh(int i) { return reinterpret_cast<const Mesh*>(&gObjects[i]); }
+static const Light *light(int i) { return reinterpret_cast<const Light*>(&gObjects[i]); }
+
+TEST(InstanceBatcherTests, BatchesByShaderMaterialMeshAndLight) {
+    InstanceBatcher batcher;
+
+    auto first = batcher.batch_id(shader(0), material(0), mesh(0), light(0));
+    EXPECT_EQ(0u, first);
+    EXPECT_EQ(first, batcher.batch_id(shader(0), material(0), mesh(0), light(0)));
+
+    // Changing any one of them starts a new batch
+    std::vector<uint32_t> ids = {
+        first,
+        batcher.batch_id(shader(1), material(0), mesh(0), light(0)),
+        batcher.batch_id(shader(0), material(1), mesh(0), light(0)),
+        batcher.batch_id(shader(0), material(0), mesh(1), light(0)),
+        batcher.batch_id(shader(0), material(0), mesh(0), nullptr),
+    };
+
+    EXPECT_EQ((std::vector<uint32_t>{ 0, 1, 2, 3, 4 }), ids);
+    EXPECT_EQ(5u, batcher.batch_count());
+
+    EXPECT_EQ(2u, batcher.batch_id(shader(0), material(1), mesh(0), light(0)));
+
+    batcher.clear();
+    EXPECT_EQ(0u, batcher.batch_count());
+    EXPECT_EQ(0u, batcher.batch_id(shader(1), material(1), mesh(1), light(1)));
+}
+
+TEST(InstanceBatcherTests, SortingPutsBatchesNextToEachOther) {
+    InstanceBatcher batcher;
+
+    // Commands arrive interleaved: three meshes with the same shader and
+    // texture, each command with a different depth
+    std::vector<KeyIndex> order;
+    std::vector<uint32_t> command_batches;
+
+    for (uint32_t i = 0; i < 30; ++i) {
+        auto batch = batcher.batch_id(shader(0), material(0), mesh(i % 3), light(0));
+        command_batches.push_back(batch);
+        order.push_back({ make_sort_key(0, 1000, 0, 0, true, batch), i });
+    }
+
+    std::vector<KeyIndex> scratch;
+    radix_sort(&order, &scratch);
+
+    // Each batch forms exactly one run
+    std::vector<uint32_t> runs;
+    for (auto &entry : order) {
+        auto batch = command_batches[entry.index];
+        if (runs.empty() || runs.back() != batch) runs.push_back(batch);
+    }
+
+    EXPECT_EQ((std::vector<uint32_t>{ 0, 1, 2 }), runs);
+}
+
+TEST(InstanceBatcherTests, PacksModelviewThenNormalMatrix) {
+    InstanceBatcher batcher;
+
+    auto first = make_translation4(Vector3(1, 2, 3)) * make_scale4(Vector3(2, 2, 2));
+    auto first_inverse = make_scale4(Vector3(0.5f, 0.5f, 0.5f)) * make_translation4(Vector3(-1, -2, -3));
+
+    auto second = make_rotation4(quaternion_from_axis_angle(Vector3(0, 1, 0), deg2rad(90)));
+    auto second_inverse = transposed(second);
+
+    batcher.add_instance(first, first_inverse);
+    batcher.add_instance(second, second_inverse);
+
+    ASSERT_EQ(2u, batcher.instance_count());
+    ASSERT_EQ(2 * MeshBuffer::kFloatsPerInstance, batcher.instance_data().size());
+
+    auto data = batcher.instance_data().data();
+
+    std::vector<float> expected;
+    for (auto pair : { std::make_pair(first, first_inverse), std::make_pair(second, second_inverse) }) {
+        auto normal_matrix = transposed(mat3(pair.second));
+        expected.insert(end(expected), ptr(pair.first), ptr(pair.first) + 16);
+        expected.insert(end(expected), ptr(normal_matrix), ptr(normal_matrix) + 9);
+    }
+
+    EXPECT_EQ(expected, std::vector<float>(data, data + batcher.instance_data().size()));
+
+    // A uniform scale of 2 has a normal matrix of 0.5 along the diagonal
+    EXPECT_FLOAT_EQ(0.5f, data[16]);
+    EXPECT_FLOAT_EQ(0.5f, data[16 + 4]);
+    EXPECT_FLOAT_EQ(0.5f, data[16 + 8]);
+    EXPECT_FLOAT_EQ(0.0f, data[16 + 1]);
+
+    batcher.clear_instances();
+    EXPECT_EQ(0u, batcher.instance_count());
+}
+
+TEST(SortKeyTests, OutOfRangeFieldsAreClamped) {
+    // A negative queue index must not set the camera bits, and an extra
+    // camera must not wrap around to the first slot
+    EXPECT_EQ(make_sort_key(0, 0, 5, 6, false, 7), make_sort_key(0, -1, 5, 6, false, 7));
+    EXPECT_LT(make_sort_key(0, 4095, 0, 0, false, 0), make_sort_key(1, 0, 0, 0, false, 0));
+    EXPECT_EQ(make_sort_key(0, 4095, 5, 6, false, 7), make_sort_key(0, 5000, 5, 6, false, 7));
+
+    EXPECT_EQ(make_sort_key(kMaxSortKeyCameras - 1, 10, 0, 0, false, 0),
+              make_sort_key(kMaxSortKeyCameras, 10, 0, 0, false, 0));
+    EXPECT_LT(make_sort_key(1, 4095, 0, 0, false, 0),
+              make_sort_key(kMaxSortKeyCameras + 3, 0, 0, 0, false, 0));
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+#include "rosewood/core/job_system.h"
+
+using namespace rosewood::core;
+
+TEST(JobSystemTests, SingleThreadRunsInline) {
+    JobSystem jobs(1);
+    EXPECT_EQ(1, jobs.thread_count());
+
+    std::vector<size_t> ranges;
+    jobs.parallel_for(0, 10, 3, [&](size_t begin, size_t end) {
+        ranges.push_back(begin);
+        ranges.push_back(end);
+    });
+
+    ASSERT_EQ(2, ranges.size());
+    EXPECT_EQ(0, ranges[0]);
+    EXPECT_EQ(10, ranges[1]);
+}
+
+TEST(JobSystemTests, VisitEveryIndexOnce) {
+    JobSystem jobs(4);
+    EXPECT_EQ(4, jobs.thread_count());
+
+    std::vector<std::atomic<int>> counts(10000);
+    for (auto &count : counts) count = 0;
+
+    jobs.parallel_for(0, counts.size(), 64, [&](size_t begin, size_t end) {
+        EXPECT_LE(end - begin, 64);
+        for (size_t i = begin; i < end; ++i) {
+            ++counts[i];
+        }
+    });
+
+    for (auto &count : counts) {
+        EXPECT_EQ(1, count.load());
+    }
+}
+
+TEST(JobSystemTests, EmptyRange) {
+    JobSystem jobs(2);
+
+    jobs.parallel_for(5, 5, 1, [](size_t, size_t) {
+        GTEST_FAIL();
+    });
+}
+
+TEST(JobSystemTests, NestedParallelFor) {
+    JobSystem jobs(4);
+    std::atomic<int> total(0);
+
+    jobs.parallel_for(0, 16, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            jobs.parallel_for(0, 100, 10, [&](size_t inner_begin, size_t inner_end) {
+                total += int(inner_end - inner_begin);
+            });
+        }
+    });
+
+    EXPECT_EQ(1600, total.load());
+}
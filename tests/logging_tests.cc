@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rosewood/core/logging.h"
+
+using rosewood::core::LogLevel;
+using rosewood::core::LogWriter;
+using rosewood::core::flush_log;
+
+class LoggingTests : public ::testing::Test {
+protected:
+    virtual void SetUp() override {
+        flush_log();
+        fflush(stderr);
+
+        _capture = tmpfile();
+        _saved_stderr = dup(fileno(stderr));
+        dup2(fileno(_capture), fileno(stderr));
+    }
+
+    virtual void TearDown() override {
+        LogWriter::gLogLevel = LogLevel::kStatementLevel;
+
+        stop_capture();
+        fclose(_capture);
+    }
+
+    std::string captured() {
+        flush_log();
+        stop_capture();
+
+        std::string contents;
+        char buffer[4096];
+
+        rewind(_capture);
+        while (auto n = fread(buffer, 1, sizeof(buffer), _capture)) {
+            contents.append(buffer, n);
+        }
+
+        return contents;
+    }
+
+    static size_t count(const std::string &haystack, const std::string &needle) {
+        size_t n = 0;
+        for (auto pos = haystack.find(needle); pos != std::string::npos; pos = haystack.find(needle, pos + 1)) {
+            ++n;
+        }
+        return n;
+    }
+
+private:
+    FILE *_capture;
+    int _saved_stderr;
+
+    void stop_capture() {
+        if (_saved_stderr < 0) return;
+
+        fflush(stderr);
+        dup2(_saved_stderr, fileno(stderr));
+        close(_saved_stderr);
+        _saved_stderr = -1;
+    }
+};
+
+TEST_F(LoggingTests, MessagesFromManyThreads) {
+    static const int kThreads = 4;
+    static const int kMessages = 4;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < kMessages; ++i) {
+                LOG(INFO) << "thread " << t << " message " << i;
+            }
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    auto output = captured();
+
+    for (int t = 0; t < kThreads; ++t) {
+        size_t last = 0;
+        for (int i = 0; i < kMessages; ++i) {
+            auto message = "thread " + std::to_string(t) + " message " + std::to_string(i) + "\n";
+            auto pos = output.find(message);
+
+            ASSERT_NE(std::string::npos, pos) << message;
+            EXPECT_LE(last, pos);
+            last = pos;
+        }
+    }
+
+    EXPECT_EQ(size_t(kThreads * kMessages), count(output, "[INFO logging_tests.cc:"));
+}
+
+TEST_F(LoggingTests, DisabledLevelsSkipArguments) {
+    int evaluated = 0;
+    auto argument = [&] { return ++evaluated; };
+
+    LogWriter::gLogLevel = LogLevel::kWarningLevel;
+
+    LOG(INFO) << "hidden " << argument();
+    LOG(WARNING) << "shown " << argument();
+
+    auto output = captured();
+
+    EXPECT_EQ(1, evaluated);
+    EXPECT_EQ(std::string::npos, output.find("hidden"));
+    EXPECT_NE(std::string::npos, output.find("[WARNING logging_tests.cc:"));
+}
+
+TEST_F(LoggingTests, RepeatedMessagesAreRateLimited) {
+    for (int i = 0; i < 100; ++i) {
+        LOG(WARNING) << "repeated";
+    }
+
+    LOG(WARNING) << "different";
+
+    auto output = captured();
+
+    EXPECT_EQ(LogWriter::kRateLimitBurst, count(output, "repeated"));
+    EXPECT_EQ(1u, count(output, "different"));
+}
+
+TEST_F(LoggingTests, ErrorsAreNeverRateLimited) {
+    for (int i = 0; i < 100; ++i) {
+        LOG(ERROR) << "repeated error";
+    }
+
+    auto output = captured();
+
+    EXPECT_EQ(100u, count(output, "repeated error"));
+    EXPECT_EQ(0u, count(output, "suppressed"));
+}
+
+TEST_F(LoggingTests, UnbracedIfElse) {
+    int branch = 0;
+
+    for (int i = 0; i < 2; ++i)
+        if (i == 0) LOG(INFO) << "then " << (branch += 1);
+        else LOG(INFO) << "else " << (branch += 10);
+
+    auto output = captured();
+
+    EXPECT_EQ(11, branch);
+    EXPECT_EQ(1u, count(output, "then 1"));
+    EXPECT_EQ(1u, count(output, "else 11"));
+}
@@ -1,8 +1,14 @@
 #include <gtest/gtest.h>
 
+#include <vector>
+
+#include "rosewood/math/batch_transform.h"
 #include "rosewood/math/math_types.h"
 #include "rosewood/math/vector.h"
+#include "rosewood/math/matrix3.h"
 #include "rosewood/math/matrix4.h"
+#include "rosewood/math/quaternion.h"
+#include "rosewood/math/sphere_culling.h"
 
 using namespace rosewood::math;
 
@@ -72,3 +78,71 @@ TEST(MathTests, Matrix4Vector4Translate) {
     EXPECT_EQ(10, v1.z);
     EXPECT_EQ(1, v1.w);
 }
+
+// Seven points cover both the four-wide path and the scalar remainder, and
+// a stride of eight checks that the floats between outputs are left alone
+TEST(MathTests, BatchTransformPoints) {
+    auto m = make_perspective4(1.0f, 1.5f, 0.1f, 100.0f) * make_translation4(Vector3(1, -2, -10));
+
+    std::vector<Vector3> points;
+    for (int i = 0; i < 7; ++i) {
+        points.emplace_back(float(i), float(i * 2 - 5), float(-i));
+    }
+
+    std::vector<float> out(points.size() * 8, -1.0f);
+    transform_points(m, points.data(), points.size(), out.data(), 8);
+
+    for (size_t i = 0; i < points.size(); ++i) {
+        auto expected = m * points[i];
+
+        EXPECT_FLOAT_EQ(expected.x(), out[i * 8 + 0]);
+        EXPECT_FLOAT_EQ(expected.y(), out[i * 8 + 1]);
+        EXPECT_FLOAT_EQ(expected.z(), out[i * 8 + 2]);
+        EXPECT_EQ(-1.0f, out[i * 8 + 3]);
+        EXPECT_EQ(-1.0f, out[i * 8 + 7]);
+    }
+}
+
+TEST(MathTests, BatchTransformDirections) {
+    auto m = mat3(make_rotation4(Quaternion(0.5f, 0.5f, 0.5f, 0.5f)) * make_scale4(Vector3(1, 2, 3)));
+
+    std::vector<Vector3> directions;
+    for (int i = 0; i < 7; ++i) {
+        directions.emplace_back(float(i), 1.0f, float(3 - i));
+    }
+
+    std::vector<float> out(directions.size() * 8, -1.0f);
+    transform_directions(m, directions.data(), directions.size(), out.data(), 8);
+
+    for (size_t i = 0; i < directions.size(); ++i) {
+        auto expected = m * directions[i];
+
+        EXPECT_FLOAT_EQ(expected.x(), out[i * 8 + 0]);
+        EXPECT_FLOAT_EQ(expected.y(), out[i * 8 + 1]);
+        EXPECT_FLOAT_EQ(expected.z(), out[i * 8 + 2]);
+        EXPECT_EQ(-1.0f, out[i * 8 + 3]);
+    }
+}
+
+// 37 spheres cover whole SIMD groups, a partial group, and a second mask word
+TEST(MathTests, CullSpheres) {
+    Plane planes[] = { Plane(1, 0, 0, 0), Plane(0, 0, -1, 10) };
+
+    std::vector<float> xs, ys, zs, radii;
+    for (int i = 0; i < 37; ++i) {
+        xs.push_back(float(i % 5) - 2.0f);
+        ys.push_back(float(i));
+        zs.push_back(float(i % 13));
+        radii.push_back(float(i % 3) * 0.75f);
+    }
+
+    uint32_t visible[2] = { 0xdeadbeef, 0xdeadbeef };
+    cull_spheres(planes, 2, xs.data(), ys.data(), zs.data(), radii.data(), xs.size(), visible);
+
+    for (size_t i = 0; i < xs.size(); ++i) {
+        bool expected = xs[i] >= -radii[i] && 10.0f - zs[i] >= -radii[i];
+        EXPECT_EQ(expected, bool(visible[i / 32] & (1u << (i % 32)))) << "sphere " << i;
+    }
+
+    EXPECT_EQ(0u, visible[1] >> 5);
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "rosewood/core/metrics.h"
+
+using namespace rosewood::core;
+
+static const metrics::Counter gTestCounter("tests.counter");
+static const metrics::Gauge gTestGauge("tests.gauge");
+static const metrics::Histogram gTestHistogram("tests.histogram");
+
+class MetricsTests : public ::testing::Test {
+protected:
+    virtual void SetUp() override {
+        // Starts every test on a fresh frame, and pushes whatever earlier
+        // tests recorded out of the histogram's window
+        for (size_t i = 0; i < metrics::kWindowFrames; ++i) {
+            metrics::end_frame();
+        }
+    }
+};
+
+TEST_F(MetricsTests, CountersAreSummedPerFrame) {
+    auto total = gTestCounter.total();
+
+    gTestCounter.increment();
+    gTestCounter.increment(4);
+    EXPECT_EQ(5u, gTestCounter.current_frame());
+    EXPECT_EQ(total + 5, gTestCounter.total());
+
+    metrics::end_frame();
+    EXPECT_EQ(5u, gTestCounter.last_frame());
+    EXPECT_EQ(0u, gTestCounter.current_frame());
+
+    gTestCounter.increment(7);
+    metrics::end_frame();
+    EXPECT_EQ(7u, gTestCounter.last_frame());
+    EXPECT_DOUBLE_EQ(12.0 / metrics::kWindowFrames, gTestCounter.window_average());
+}
+
+TEST_F(MetricsTests, CountsFromExitedThreadsAreKept) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 1000; ++i) {
+                gTestCounter.increment();
+            }
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    metrics::end_frame();
+    EXPECT_EQ(4000u, gTestCounter.last_frame());
+}
+
+TEST_F(MetricsTests, GaugesAreSampledAtTheEndOfFrames) {
+    gTestGauge.set(10);
+    metrics::end_frame();
+
+    gTestGauge.set(30);
+    gTestGauge.set(20);
+    metrics::end_frame();
+
+    EXPECT_EQ(20, gTestGauge.value());
+    EXPECT_EQ(20, gTestGauge.window_max());
+}
+
+TEST_F(MetricsTests, HistogramPercentiles) {
+    for (int i = 1; i <= 1000; ++i) {
+        gTestHistogram.record(i);
+    }
+
+    // Not part of the window until the frame ends
+    EXPECT_EQ(0u, gTestHistogram.window_count());
+
+    metrics::end_frame();
+    EXPECT_EQ(1000u, gTestHistogram.window_count());
+
+    EXPECT_NEAR(500, gTestHistogram.percentile(0.5), 500 * 0.07);
+    EXPECT_NEAR(950, gTestHistogram.percentile(0.95), 950 * 0.07);
+    EXPECT_NEAR(990, gTestHistogram.percentile(0.99), 990 * 0.07);
+
+    // Falls out of the window after kWindowFrames frames
+    for (size_t i = 0; i < metrics::kWindowFrames; ++i) {
+        metrics::end_frame();
+    }
+    EXPECT_EQ(0u, gTestHistogram.window_count());
+    EXPECT_EQ(0, gTestHistogram.percentile(0.5));
+}
+
+TEST_F(MetricsTests, FindByName) {
+    EXPECT_EQ(&gTestCounter, metrics::find_counter("tests.counter"));
+    EXPECT_EQ(&gTestGauge, metrics::find_gauge("tests.gauge"));
+    EXPECT_EQ(&gTestHistogram, metrics::find_histogram("tests.histogram"));
+    EXPECT_EQ(&metrics::frame_time_usec, metrics::find_histogram("core.frame_time_usec"));
+
+    EXPECT_EQ(nullptr, metrics::find_counter("tests.gauge"));
+    EXPECT_EQ(nullptr, metrics::find_counter("tests.missing"));
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "rosewood/core/profiler.h"
+
+using namespace rosewood::core;
+
+static size_t count_occurrences(const std::string &text, const std::string &needle) {
+    size_t count = 0;
+    for (auto at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+class ProfilerTests : public ::testing::Test {
+protected:
+    virtual void SetUp() override {
+        profiler::set_enabled(true);
+
+        // Starts every test on a fresh frame with nothing captured
+        profiler::end_frame();
+        profiler::clear_capture();
+    }
+
+    virtual void TearDown() override {
+        profiler::set_enabled(false);
+        profiler::end_frame();
+        profiler::clear_capture();
+    }
+};
+
+TEST_F(ProfilerTests, NestedScopesAreExported) {
+    {
+        RW_PROFILE_SCOPE("tests.outer");
+        {
+            RW_PROFILE_SCOPE("tests.inner");
+        }
+    }
+
+    std::thread([] {
+        profiler::set_thread_name("tests \"worker\"");
+        RW_PROFILE_SCOPE("tests.worker");
+    }).join();
+
+    profiler::end_frame();
+
+    auto trace = profiler::chrome_trace();
+    EXPECT_EQ(0u, trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+    EXPECT_EQ(1u, count_occurrences(trace, "\"cat\":\"frame\""));
+    EXPECT_EQ(1u, count_occurrences(trace, "\"tests.worker\""));
+    EXPECT_EQ(1u, count_occurrences(trace, "\"tests \\\"worker\\\"\""));
+
+    // The outer scope comes first, so that it encloses the inner one
+    auto outer = trace.find("\"tests.outer\"");
+    auto inner = trace.find("\"tests.inner\"");
+    ASSERT_NE(std::string::npos, outer);
+    ASSERT_NE(std::string::npos, inner);
+    EXPECT_LT(outer, inner);
+}
+
+TEST_F(ProfilerTests, DisabledScopesAreNotRecorded) {
+    profiler::set_enabled(false);
+    {
+        RW_PROFILE_SCOPE("tests.disabled");
+    }
+    profiler::end_frame();
+
+    EXPECT_EQ(std::string::npos, profiler::chrome_trace().find("tests.disabled"));
+}
+
+TEST_F(ProfilerTests, KeepsTheSlowestFrames) {
+    static const char *kSlowScopes[] = { "tests.slow0", "tests.slow1", "tests.slow2", "tests.slow3" };
+
+    for (size_t frame = 0; frame < profiler::kSlowestFrameCount * 3; ++frame) {
+        if (frame % 6 == 3) {
+            RW_PROFILE_SCOPE(kSlowScopes[frame / 6]);
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        else {
+            RW_PROFILE_SCOPE("tests.fast");
+        }
+
+        profiler::end_frame();
+    }
+
+    auto trace = profiler::chrome_trace();
+    EXPECT_EQ(profiler::kSlowestFrameCount, count_occurrences(trace, "\"cat\":\"frame\""));
+
+    for (auto name : kSlowScopes) {
+        EXPECT_EQ(1u, count_occurrences(trace, std::string("\"") + name + "\"")) << name;
+    }
+}
+
+TEST_F(ProfilerTests, FullBuffersDropScopes) {
+    for (size_t i = 0; i < 64 * 1024; ++i) {
+        RW_PROFILE_SCOPE("tests.flood");
+    }
+
+    EXPECT_GT(profiler::dropped_scope_count(), 0u);
+    profiler::end_frame();
+
+    // The buffer is usable again once the frame has collected it
+    auto dropped = profiler::dropped_scope_count();
+    {
+        RW_PROFILE_SCOPE("tests.after_flood");
+    }
+    EXPECT_EQ(dropped, profiler::dropped_scope_count());
+}
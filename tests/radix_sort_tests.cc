@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "rosewood/data-structures/radix_sort.h"
+
+using namespace rosewood::data_structures;
+
+TEST(RadixSortTests, SortsLikeStableSort) {
+    std::mt19937_64 rng(1234);
+    std::vector<KeyIndex> entries, scratch;
+
+    for (uint32_t i = 0; i < 5000; ++i) {
+        // Few distinct keys, so stability is exercised too
+        entries.push_back({ rng() % 64 * 0x0101010101010101ull, i });
+    }
+
+    auto expected = entries;
+    std::stable_sort(begin(expected), end(expected),
+                     [](const KeyIndex &lhs, const KeyIndex &rhs) { return lhs.key < rhs.key; });
+
+    radix_sort(&entries, &scratch);
+
+    ASSERT_EQ(expected.size(), entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        EXPECT_EQ(expected[i].key, entries[i].key);
+        EXPECT_EQ(expected[i].index, entries[i].index);
+    }
+}
+
+TEST(RadixSortTests, ConstantHighBits) {
+    std::vector<KeyIndex> entries = { { 0xff00000000000003ull, 0 },
+                                      { 0xff00000000000001ull, 1 },
+                                      { 0xff00000000000002ull, 2 } };
+    std::vector<KeyIndex> scratch;
+
+    radix_sort(&entries, &scratch);
+
+    EXPECT_EQ(1, entries[0].index);
+    EXPECT_EQ(2, entries[1].index);
+    EXPECT_EQ(0, entries[2].index);
+}
+
+TEST(RadixSortTests, EqualKeysKeepOrder) {
+    std::vector<KeyIndex> entries = { { 7, 0 }, { 7, 1 }, { 7, 2 } };
+    std::vector<KeyIndex> scratch;
+
+    radix_sort(&entries, &scratch);
+
+    EXPECT_EQ(0, entries[0].index);
+    EXPECT_EQ(1, entries[1].index);
+    EXPECT_EQ(2, entries[2].index);
+}
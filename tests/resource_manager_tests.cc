@@ -0,0 +1,429 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "rosewood/core/metrics.h"
+#include "rosewood/core/resource_manager.h"
+#include "rosewood/core/stats.h"
+
+using namespace rosewood::core;
+
+// Serves files from memory, and blocks reads of "blocker" files until
+// released so that the tests can fill the loading queue first
+class MemoryResourceLoader : public IResourceLoader {
+public:
+    MemoryResourceLoader() : _held(false), _blocked_reads(0) { }
+
+    void add_file(const std::string &path, const std::string &contents) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _files[path] = contents;
+    }
+
+    void change_file(const std::string &path, const std::string &contents) {
+        add_file(path, contents);
+        _changed_files.push_back(path);
+    }
+
+    void collect_changed_files(std::vector<std::string> *out_paths) override {
+        out_paths->insert(out_paths->end(), _changed_files.begin(), _changed_files.end());
+        _changed_files.clear();
+    }
+
+    void hold() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _held = true;
+    }
+
+    void wait_for_blocked_reads(size_t count) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _changed.wait(lock, [&] { return _blocked_reads == count; });
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _held = false;
+        }
+        _changed.notify_all();
+    }
+
+    std::vector<std::string> take_reads() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto reads = std::move(_reads);
+        _reads.clear();
+        return reads;
+    }
+
+    FileInfo find_file(std::string path) const override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        FileInfo info;
+        info.exists = _files.find(path) != _files.end();
+        info.mtime.tv_sec = 1;
+        info.mtime.tv_nsec = 0;
+        return info;
+    }
+
+    std::string read_file(std::string path) const override {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (path.compare(0, 7, "blocker") == 0) {
+            ++_blocked_reads;
+            _changed.notify_all();
+            _changed.wait(lock, [&] { return !_held; });
+            --_blocked_reads;
+        }
+        else {
+            _reads.push_back(path);
+        }
+        return _files.at(path);
+    }
+
+private:
+    mutable std::mutex _mutex;
+    mutable std::condition_variable _changed;
+    std::unordered_map<std::string, std::string> _files;
+    mutable std::vector<std::string> _reads;
+    std::vector<std::string> _changed_files;
+    bool _held;
+    mutable size_t _blocked_reads;
+};
+
+static MemoryResourceLoader *memory_loader() {
+    static MemoryResourceLoader *loader = nullptr;
+    if (!loader) {
+        loader = new MemoryResourceLoader;
+        add_resource_loader(std::unique_ptr<IResourceLoader>(loader));
+    }
+    return loader;
+}
+
+static void commit_until_done(const std::shared_ptr<ResourceRequest> &request) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!request->is_done() && std::chrono::steady_clock::now() < deadline) {
+        commit_loaded_resources(1000);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// Occupies every loading thread until the loader is released
+static std::vector<std::shared_ptr<ResourceRequest>> block_loading_threads() {
+    static int n_blockers = 0;
+
+    auto loader = memory_loader();
+    loader->hold();
+
+    std::vector<std::shared_ptr<ResourceRequest>> blockers;
+    for (size_t i = 0; i < kResourceLoaderThreadCount; ++i) {
+        // A new file each time, since loaded ones are not read again
+        auto path = "blocker" + std::to_string(n_blockers++);
+        loader->add_file(path, "");
+        blockers.push_back(get_resource_async(path, [](const std::shared_ptr<Asset>&) { }));
+    }
+
+    loader->wait_for_blocked_reads(kResourceLoaderThreadCount);
+    return blockers;
+}
+
+TEST(ResourceManagerTests, LoadAsync) {
+    memory_loader()->add_file("async.txt", "contents");
+
+    std::shared_ptr<Asset> loaded;
+    auto request = get_resource_async("async.txt", [&](const std::shared_ptr<Asset> &asset) {
+        loaded = asset;
+    });
+
+    EXPECT_EQ("async.txt", request->path());
+
+    commit_until_done(request);
+    ASSERT_TRUE(request->is_done());
+    ASSERT_TRUE(!!loaded);
+    EXPECT_EQ("contents", loaded->str());
+    EXPECT_EQ(loaded, request->asset());
+
+    // Published for synchronous lookups as well
+    EXPECT_EQ(loaded, get_resource("async.txt"));
+}
+
+TEST(ResourceManagerTests, LoadAsyncMissingFile) {
+    bool called = false;
+    auto request = get_resource_async("missing.txt",
+                                      [](const std::string&) -> std::shared_ptr<void> {
+                                          ADD_FAILURE() << "Decoded a missing file";
+                                          return nullptr;
+                                      },
+                                      [&](const std::shared_ptr<Asset> &asset, const std::shared_ptr<void>&) {
+                                          called = true;
+                                          EXPECT_FALSE(!!asset);
+                                      });
+
+    commit_until_done(request);
+    EXPECT_TRUE(request->is_done());
+    EXPECT_TRUE(called);
+    EXPECT_FALSE(!!request->asset());
+}
+
+TEST(ResourceManagerTests, DecodeOnLoadingThread) {
+    memory_loader()->add_file("decode.txt", "12345");
+
+    auto caller = std::this_thread::get_id();
+    std::thread::id decode_thread;
+    size_t decoded_length = 0;
+
+    auto request = get_resource_async("decode.txt",
+                                      [&](const std::string &contents) -> std::shared_ptr<void> {
+                                          decode_thread = std::this_thread::get_id();
+                                          return std::make_shared<size_t>(contents.size());
+                                      },
+                                      [&](const std::shared_ptr<Asset>&, const std::shared_ptr<void> &decoded) {
+                                          EXPECT_EQ(caller, std::this_thread::get_id());
+                                          decoded_length = *std::static_pointer_cast<size_t>(decoded);
+                                      });
+
+    commit_until_done(request);
+    EXPECT_NE(caller, decode_thread);
+    EXPECT_EQ(5, decoded_length);
+}
+
+TEST(ResourceManagerTests, HigherPriorityLoadsFirst) {
+    auto loader = memory_loader();
+    for (int i = 0; i < 20; ++i) {
+        loader->add_file("low" + std::to_string(i), "");
+    }
+    loader->add_file("high", "");
+
+    auto blockers = block_loading_threads();
+    loader->take_reads();
+
+    std::vector<std::shared_ptr<ResourceRequest>> requests;
+    for (int i = 0; i < 20; ++i) {
+        requests.push_back(get_resource_async("low" + std::to_string(i),
+                                              [](const std::shared_ptr<Asset>&) { },
+                                              LoadPriority::Low));
+    }
+    requests.push_back(get_resource_async("high", [](const std::shared_ptr<Asset>&) { },
+                                          LoadPriority::High));
+
+    loader->release();
+    for (auto &request : requests) {
+        commit_until_done(request);
+    }
+
+    auto reads = loader->take_reads();
+    ASSERT_EQ(21, reads.size());
+
+    // Each loading thread may already be reading a file of its own when
+    // the high priority one is picked
+    auto position = (size_t)(std::find(begin(reads), end(reads), "high") - begin(reads));
+    EXPECT_LT(position, kResourceLoaderThreadCount);
+}
+
+TEST(ResourceManagerTests, CancelBeforeRead) {
+    auto loader = memory_loader();
+    loader->add_file("cancelled.txt", "");
+
+    auto blockers = block_loading_threads();
+    loader->take_reads();
+
+    bool called = false;
+    auto request = get_resource_async("cancelled.txt", [&](const std::shared_ptr<Asset>&) {
+        called = true;
+    });
+    request->cancel();
+
+    loader->release();
+    for (auto &blocker : blockers) {
+        commit_until_done(blocker);
+    }
+
+    commit_loaded_resources(1000);
+
+    EXPECT_TRUE(request->is_cancelled());
+    EXPECT_FALSE(request->is_done());
+    EXPECT_FALSE(called);
+    EXPECT_TRUE(loader->take_reads().empty());
+}
+
+TEST(ResourceManagerTests, CommitBudget) {
+    memory_loader()->add_file("budget.txt", "");
+    auto asset = get_resource("budget.txt");
+
+    // Loaded assets skip the loading threads and are ready to commit
+    int committed = 0;
+    std::vector<std::shared_ptr<ResourceRequest>> requests;
+    for (int i = 0; i < 3; ++i) {
+        requests.push_back(get_resource_async("budget.txt", [&](const std::shared_ptr<Asset> &loaded) {
+            EXPECT_EQ(asset, loaded);
+            ++committed;
+        }));
+    }
+
+    EXPECT_EQ(2, commit_loaded_resources(0));
+    EXPECT_EQ(1, committed);
+
+    EXPECT_EQ(0, commit_loaded_resources(1e6));
+    EXPECT_EQ(3, committed);
+}
+
+// Restores the default cache options when a test is done with them
+struct CacheOptionsScope {
+    ResourceCacheOptions saved;
+
+    CacheOptionsScope(size_t budget_bytes, bool drop_decoded_contents)
+    : saved(resource_cache_options()) {
+        set_resource_cache_options({budget_bytes, drop_decoded_contents});
+    }
+
+    ~CacheOptionsScope() { set_resource_cache_options(saved); }
+};
+
+TEST(ResourceManagerTests, KeepReleasedAssetsWithinBudget) {
+    CacheOptionsScope options(1024 * 1024, false);
+
+    auto loader = memory_loader();
+    loader->add_file("kept.cache", "kept");
+    loader->take_reads();
+
+    auto &type_stats = stats::asset_type_stats("cache");
+    auto hits = type_stats.hits.total();
+
+    get_resource("kept.cache");
+    trim_resource_cache();
+
+    auto asset = get_resource("kept.cache");
+    ASSERT_TRUE(!!asset);
+    EXPECT_EQ("kept", asset->str());
+
+    EXPECT_EQ(1, loader->take_reads().size());
+    EXPECT_EQ(hits + 1, type_stats.hits.total());
+    EXPECT_LE(1, type_stats.resident_count);
+
+    auto registered_hits = metrics::find_counter("resources.cache.hits");
+    ASSERT_TRUE(registered_hits);
+    EXPECT_EQ(hits + 1, registered_hits->total());
+}
+
+TEST(ResourceManagerTests, EvictReleasedAssetsOverBudget) {
+    CacheOptionsScope options(0, false);
+
+    auto loader = memory_loader();
+    loader->add_file("evicted.cache", "evicted");
+    loader->take_reads();
+
+    auto &type_stats = stats::asset_type_stats("cache");
+    auto evictions = type_stats.evictions.total();
+    auto misses = type_stats.misses.total();
+
+    auto asset = get_resource("evicted.cache");
+    auto resident_bytes = type_stats.resident_bytes;
+
+    // Assets in use are never evicted
+    trim_resource_cache();
+    EXPECT_EQ(evictions, type_stats.evictions.total());
+    EXPECT_EQ(asset, get_resource("evicted.cache"));
+
+    asset = nullptr;
+    trim_resource_cache();
+    EXPECT_EQ(evictions + 1, type_stats.evictions.total());
+    EXPECT_EQ(resident_bytes - 7, type_stats.resident_bytes);
+
+    get_resource("evicted.cache");
+    EXPECT_EQ(2, loader->take_reads().size());
+    EXPECT_EQ(misses + 2, type_stats.misses.total());
+}
+
+TEST(ResourceManagerTests, DropDecodedContents) {
+    CacheOptionsScope options(1024 * 1024, true);
+
+    auto loader = memory_loader();
+    loader->add_file("decoded.cache", "decoded");
+    loader->take_reads();
+
+    auto &type_stats = stats::asset_type_stats("cache");
+
+    auto asset = get_resource("decoded.cache");
+    auto resident_bytes = type_stats.resident_bytes;
+
+    asset->did_decode();
+    EXPECT_FALSE(asset->has_contents());
+    EXPECT_EQ("", asset->str());
+    EXPECT_EQ(resident_bytes - 7, type_stats.resident_bytes);
+
+    // Whoever asks next gets the contents back
+    EXPECT_EQ(asset, get_resource("decoded.cache"));
+    EXPECT_TRUE(asset->has_contents());
+    EXPECT_EQ("decoded", asset->str());
+    EXPECT_EQ(resident_bytes, type_stats.resident_bytes);
+    EXPECT_EQ(2, loader->take_reads().size());
+
+    // Assets created outside the cache could not be read again
+    Asset uncached("uncached");
+    uncached.did_decode();
+    EXPECT_EQ("uncached", uncached.str());
+}
+
+TEST(ResourceManagerTests, ReloadChangedResources) {
+    auto loader = memory_loader();
+    loader->add_file("changed.txt", "1");
+
+    auto asset = get_resource("changed.txt");
+    loader->take_reads();
+
+    int n_changes = 0;
+    auto view = create_view(asset, [&] { ++n_changes; });
+
+    auto hot_reloads = metrics::find_counter("resources.hot_reloads");
+    ASSERT_TRUE(hot_reloads);
+    auto reloads = hot_reloads->total();
+
+    loader->change_file("changed.txt", "2");
+    loader->change_file("changed.txt", "3");
+    loader->change_file("not-loaded.txt", "");
+
+    // Not quiet for long enough yet
+    reload_changed_resources(1e9);
+    EXPECT_EQ(0, n_changes);
+
+    reload_changed_resources(0);
+    EXPECT_EQ(1, n_changes);
+    EXPECT_EQ("3", asset->str());
+    EXPECT_EQ(reloads + 1, hot_reloads->total());
+
+    // Only the asset that is loaded is read again
+    EXPECT_EQ(std::vector<std::string>{"changed.txt"}, loader->take_reads());
+
+    reload_changed_resources(0);
+    EXPECT_EQ(1, n_changes);
+}
+
+TEST(ResourceManagerTests, ReloadNotifiesEveryViewBeforeDropping) {
+    CacheOptionsScope options(1024 * 1024, true);
+
+    auto loader = memory_loader();
+    loader->add_file("shared.cache", "1");
+
+    auto asset = get_resource("shared.cache");
+    loader->take_reads();
+
+    // Both views decode in their callbacks, like shaders and textures do
+    std::vector<std::string> decoded;
+    std::shared_ptr<AssetView> first, second;
+    first = create_view(asset, [&] { decoded.push_back(first->str()); first->did_decode(); });
+    second = create_view(asset, [&] { decoded.push_back(second->str()); second->did_decode(); });
+
+    loader->change_file("shared.cache", "2");
+    reload_changed_resources(0);
+
+    EXPECT_EQ((std::vector<std::string>{"2", "2"}), decoded);
+
+    // Dropped once everyone has seen them
+    EXPECT_FALSE(asset->has_contents());
+    EXPECT_EQ("", asset->str());
+
+    EXPECT_EQ("2", get_resource("shared.cache")->str());
+}
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "rosewood/math/vector.h"
 #include "rosewood/math/quaternion.h"
 #include "rosewood/math/matrix4.h"
@@ -206,3 +208,152 @@ TEST_F(TransformTests, ConvertRotationToTransform) {
     EXPECT_PRED2(quat_eq, y45, _leaf1->convert_to(quaternion_identity(), _leaf2));
     EXPECT_PRED2(quat_eq, yNeg45, _leaf2->convert_to(quaternion_identity(), _leaf1));
 }
+
+TEST_F(TransformTests, ParentChangeAfterRead) {
+    _leaf1->set_local_position(4, 1, 1);
+    EXPECT_EQ(Vector3(4, 1, 1), _leaf1->world_position());
+
+    _root->set_local_position(1, 0, 0);
+    EXPECT_EQ(Vector3(1, 0, 0), _inner->world_position());
+
+    // _inner's world matrix was refreshed by the read above, _leaf1 must
+    // still notice that its parent changed
+    EXPECT_EQ(Vector3(5, 1, 1), _leaf1->world_position());
+}
+
+TEST_F(TransformTests, BatchedUpdate) {
+    _root->set_local_position(1, 0, 0);
+    _inner->set_local_position(1, 3, 2);
+    _leaf1->set_local_position(4, 1, 1);
+    _leaf2->set_local_position(-2, 3, 8);
+
+    _entities.transform_hierarchy().update();
+
+    EXPECT_EQ(Vector3(6, 4, 3), _leaf1->world_position());
+    EXPECT_EQ(Vector3(-1, 3, 8), _leaf2->world_position());
+
+    _root->set_local_position(0, 0, 0);
+    _entities.transform_hierarchy().update();
+
+    EXPECT_EQ(Vector3(5, 4, 3), _leaf1->world_position());
+}
+
+TEST_F(TransformTests, BatchedUpdateAfterReparenting) {
+    // The new parent is created after its children, so the hierarchy has
+    // to reorder its nodes
+    auto new_root = transform(_entities.create_entity<Transform>());
+    new_root->add_child(_root);
+    new_root->set_local_position(0, 10, 0);
+    _leaf1->set_local_position(1, 0, 0);
+
+    _entities.transform_hierarchy().update();
+
+    EXPECT_EQ(new_root, _leaf1->root());
+    EXPECT_EQ(Vector3(1, 10, 0), _leaf1->world_position());
+    EXPECT_EQ(Vector3(0, 10, 0), _leaf2->world_position());
+}
+
+TEST_F(TransformTests, DestroyingParentDetachesChildren) {
+    _inner->set_local_position(1, 3, 2);
+    _leaf1->set_local_position(4, 1, 1);
+
+    _inner->entity().destroy();
+
+    EXPECT_EQ(nullptr, _leaf1->parent());
+    EXPECT_EQ(1, _root->children().size());
+    EXPECT_EQ(Vector3(4, 1, 1), _leaf1->world_position());
+
+    _entities.transform_hierarchy().update();
+    EXPECT_EQ(3, _entities.transform_hierarchy().node_count());
+}
+
+TEST(TransformChangeTests, TrackWorldChanges) {
+    EntityManager entities;
+    auto &hierarchy = entities.transform_hierarchy();
+
+    auto parent = entities.create_entity<Transform>();
+    auto child = entities.create_entity<Transform>();
+    auto other = entities.create_entity<Transform>();
+    transform(parent)->add_child(transform(child));
+
+    hierarchy.set_tracks_world_changes(true);
+    hierarchy.update();
+
+    std::vector<Entity> changed;
+    hierarchy.take_world_changes(&changed);
+    EXPECT_EQ(3, changed.size());
+
+    hierarchy.update();
+    hierarchy.take_world_changes(&changed);
+    EXPECT_TRUE(changed.empty());
+
+    // Moving the parent moves the child too, and reading a matrix before
+    // update() must not record the change twice
+    transform(parent)->set_local_position(1, 2, 3);
+    transform(child)->world_transform();
+    hierarchy.update();
+    hierarchy.update();
+
+    hierarchy.take_world_changes(&changed);
+    EXPECT_EQ((std::vector<Entity>{ parent, child }), changed);
+    (void)other;
+}
+
+TEST(TransformChangeTests, ReusedNodeStartsFresh) {
+    EntityManager entities;
+    auto &hierarchy = entities.transform_hierarchy();
+
+    auto parent = entities.create_entity<Transform>();
+    auto child = entities.create_entity<Transform>();
+    transform(parent)->set_local_position(1, 2, 3);
+    transform(parent)->add_child(transform(child));
+    transform(child)->set_local_position(4, 5, 6);
+
+    hierarchy.set_tracks_world_changes(true);
+    hierarchy.update();
+    EXPECT_EQ(Vector3(5, 7, 9), transform(child)->world_position());
+
+    // The new entity takes over the child's node while its change is
+    // still waiting to be taken
+    child.destroy();
+    auto reused = entities.create_entity<Transform>();
+    EXPECT_EQ(Vector3(0, 0, 0), transform(reused)->world_position());
+    EXPECT_EQ(make_identity4(), transform(reused)->world_transform());
+
+    transform(reused)->set_local_position(1, 1, 1);
+    hierarchy.update();
+    EXPECT_EQ(Vector3(1, 1, 1), transform(reused)->world_position());
+
+    std::vector<Entity> changed;
+    hierarchy.take_world_changes(&changed);
+    EXPECT_EQ((std::vector<Entity>{ parent, reused }), changed);
+}
+
+struct MarkerComponent : public Component<MarkerComponent> {
+    explicit MarkerComponent(Entity owner) : Component<MarkerComponent>(owner) { }
+};
+
+TEST(ArchetypeTransformTests, LinksSurviveRelocation) {
+    EntityManager entities(StorageMode::Archetype);
+
+    auto parent_entity = entities.create_entity<Transform>();
+    auto child_entity = entities.create_entity<Transform>();
+
+    transform(parent_entity)->add_child(transform(child_entity));
+    transform(parent_entity)->set_local_position(1, 2, 3);
+    transform(child_entity)->set_local_position(1, 0, 0);
+
+    // Moves both transforms into a new archetype
+    parent_entity.add_component<MarkerComponent>();
+    child_entity.add_component<MarkerComponent>();
+
+    auto parent = transform(parent_entity);
+    auto child = transform(child_entity);
+
+    EXPECT_EQ(parent, child->parent());
+    ASSERT_EQ(1, parent->children().size());
+    EXPECT_EQ(child, parent->children()[0]);
+
+    entities.transform_hierarchy().update();
+    EXPECT_EQ(Vector3(2, 2, 3), child->world_position());
+}